@@ -60,6 +60,8 @@ $(OBJDIR)/modules/cab.o: modules/cab.c src/deark-config.h \
  src/deark-private.h src/deark.h
 $(OBJDIR)/modules/cardfile.o: modules/cardfile.c src/deark-config.h \
  src/deark-private.h src/deark.h
+$(OBJDIR)/modules/carve.o: modules/carve.c src/deark-config.h \
+ src/deark-private.h src/deark.h
 $(OBJDIR)/modules/cdiimage.o: modules/cdiimage.c src/deark-private.h \
  src/deark.h src/deark-config.h src/deark-fmtutil.h
 $(OBJDIR)/modules/cfb.o: modules/cfb.c src/deark-config.h \
@@ -357,6 +359,8 @@ $(OBJDIR)/modules/zip.o: modules/zip.c src/deark-config.h \
  src/deark-private.h src/deark.h src/deark-fmtutil.h
 $(OBJDIR)/modules/zoo.o: modules/zoo.c src/deark-private.h src/deark.h \
  src/deark-config.h src/deark-fmtutil.h src/deark-fmtutil-arch.h
+$(OBJDIR)/src/deark-bench.o: src/deark-bench.c src/deark-config.h \
+ src/deark-private.h src/deark.h src/deark-fmtutil.h src/deark-user.h
 $(OBJDIR)/src/deark-bitmap.o: src/deark-bitmap.c src/deark-config.h \
  src/deark-private.h src/deark.h
 $(OBJDIR)/src/deark-char.o: src/deark-char.c src/deark-config.h \
@@ -369,10 +373,14 @@ $(OBJDIR)/src/deark-dbuf.o: src/deark-dbuf.c src/deark-config.h \
  src/deark-private.h src/deark.h
 $(OBJDIR)/src/deark-font.o: src/deark-font.c src/deark-config.h \
  src/deark-private.h src/deark.h
+$(OBJDIR)/src/deark-fuzz.o: src/deark-fuzz.c src/deark-config.h \
+ src/deark-private.h src/deark.h src/deark-user.h
 $(OBJDIR)/src/deark-modules.o: src/deark-modules.c src/deark-config.h \
  src/deark-private.h src/deark.h src/deark-user.h src/deark-modules.h
 $(OBJDIR)/src/deark-png.o: src/deark-png.c src/deark-config.h \
  src/deark-private.h src/deark.h src/deark-fmtutil.h
+$(OBJDIR)/src/deark-stats.o: src/deark-stats.c src/deark-config.h \
+ src/deark-private.h src/deark.h
 $(OBJDIR)/src/deark-tar.o: src/deark-tar.c src/deark-config.h \
  src/deark-private.h src/deark.h
 $(OBJDIR)/src/deark-ucstring.o: src/deark-ucstring.c src/deark-config.h \
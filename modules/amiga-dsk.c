@@ -226,7 +226,7 @@ static int read_file_segment_from_blocks_tbl(deark *c, lctx *d, struct member_da
 	i64 k;
 	int retval = 0;
 
-	nbytes_left_to_copy = md->fsize - md->outf->len;
+	nbytes_left_to_copy = md->fsize - dbuf_get_length(md->outf);
 
 	for(k=0; k<md->tmpbpt.high_seq; k++) {
 		i64 blknum;
@@ -324,7 +324,7 @@ static void read_file_using_blocks_table(deark *c, lctx *d, struct member_data *
 			i64 next_ext_header_blk = 0;
 
 			if(cur_ext_header_blk == 0) break;
-			if(md->outf->len >= md->fsize) break;
+			if(dbuf_get_length(md->outf) >= md->fsize) break;
 
 			if(!read_file_segment_from_extension_block(c, d, md, cur_ext_header_blk,
 				&next_ext_header_blk))
@@ -335,7 +335,7 @@ static void read_file_using_blocks_table(deark *c, lctx *d, struct member_data *
 		}
 	}
 
-	if(md->outf->len < md->fsize) {
+	if(dbuf_get_length(md->outf) < md->fsize) {
 		on_adf_error(c, d, 26);
 		goto done;
 	}
@@ -1474,6 +1474,58 @@ static int de_identify_arj(deark *c)
 	return 75;
 }
 
+// The carve signature is that of the archive header. Walk through the headers
+// to find the end-of-archive marker.
+static int de_carve_arj(deark *c, dbuf *f, i64 sigpos, i64 *ppos, i64 *plen)
+{
+	i64 pos = sigpos;
+	i64 foundpos = 0;
+
+	// Check the archive header's CRC.
+	if(!fmtutil_scan_for_arj_data(f, sigpos, 0, 0, &foundpos)) return 0;
+
+	while(1) {
+		i64 basic_hdr_size;
+		i64 cmpr_len;
+
+		if(pos+4 > f->len) return 0;
+		if(dbuf_memcmp(f, pos, g_arj_hdr_id, 2)) return 0;
+		basic_hdr_size = dbuf_getu16le(f, pos+2);
+		if(basic_hdr_size==0) { // End of archive
+			pos += 4;
+			break;
+		}
+		if(basic_hdr_size>ARJ_MAX_BASIC_HEADER_SIZE) return 0;
+
+		if(pos==sigpos) {
+			cmpr_len = 0;
+		}
+		else {
+			cmpr_len = dbuf_getu32le(f, pos+16);
+		}
+
+		pos += 4 + basic_hdr_size + 4;
+
+		// Extended headers
+		while(1) {
+			i64 ext_hdr_size;
+
+			if(pos+2 > f->len) return 0;
+			ext_hdr_size = dbuf_getu16le(f, pos);
+			pos += 2;
+			if(ext_hdr_size==0) break;
+			pos += ext_hdr_size + 4;
+		}
+
+		pos += cmpr_len;
+		if(pos > f->len) return 0;
+	}
+
+	*ppos = sigpos;
+	*plen = pos - sigpos;
+	return 1;
+}
+
 static void de_help_arj(deark *c)
 {
 	de_msg(c, "-opt arj:entrypoint=<n> : Offset of archive header");
@@ -1489,6 +1541,9 @@ void de_module_arj(deark *c, struct deark_module_info *mi)
 	mi->identify_fn = de_identify_arj;
 	mi->help_fn = de_help_arj;
 	mi->flags |= DE_MODFLAG_MULTIPART;
+	mi->carve_sig = "\x60\xea";
+	mi->carve_siglen = 2;
+	mi->carve_fn = de_carve_arj;
 }
 
 /////////////////////// ARJ relocator utility
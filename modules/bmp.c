@@ -150,6 +150,28 @@ static void rle_to_bytes_append_unit24(deark *c, struct rle_dcmpr_ctx *rc,
 	rc->xpos++;
 }
 
+// Mark count units starting at xpos as set in the mask (if present), and
+// update rc->xpos.
+static void rle_to_bytes_advance(deark *c, struct rle_dcmpr_ctx *rc, i64 count)
+{
+	i64 k;
+
+	if(rc->mask) {
+		for(k=0; k<count; k++) {
+			de_bitmap_setpixel_gray(rc->mask, rc->xpos+k, rc->ypos, 0xff);
+		}
+	}
+	rc->xpos += count;
+}
+
+// Append count units of an 8-bit or 24-bit color, all at once.
+static void rle_to_bytes_append_run(deark *c, struct rle_dcmpr_ctx *rc,
+	const u8 *unit, i64 count)
+{
+	dbuf_write_unit_run(rc->unc_pixels, unit, rc->unit_size/8, count);
+	rle_to_bytes_advance(c, rc, count);
+}
+
 static void rle_to_bytes_on_eol(deark *c, struct rle_dcmpr_ctx *rc, i64 nlines_complete)
 {
 	rle_to_bytes_flush(c, rc);
@@ -265,15 +287,9 @@ static void decompress_rle_to_bytes(deark *c, struct rle_dcmpr_ctx *rc)
 			else { // b2 noncompressed pixels (8-bit units) follow
 				num_units_to_decode = (i64)b2;
 				num_bytes_to_read = de_pad_to_2(num_units_to_decode);
-				num_units_decoded = 0;
-
-				for(k=0; k<num_bytes_to_read; k++) {
-					b = dbuf_getbyte_p(rc->inf, &pos);
-					if(num_units_decoded<num_units_to_decode) {
-						rle_to_bytes_append_unit8(c, rc, b, 1);
-						num_units_decoded++;
-					}
-				}
+				dbuf_copy(rc->inf, pos, num_units_to_decode, rc->unc_pixels);
+				rle_to_bytes_advance(c, rc, num_units_to_decode);
+				pos += num_bytes_to_read;
 			}
 		}
 		else { // Compressed pixels - b1 pixels
@@ -281,21 +297,30 @@ static void decompress_rle_to_bytes(deark *c, struct rle_dcmpr_ctx *rc)
 			if(rc->unit_size==4) { // b1 pixels alternating between the colors in b2
 				pix1 = b2>>4;
 				pix2 = b2&0x0f;
-				for(k=0; k<num_units_to_decode; k++) {
+				k = 0;
+				if(rc->num_pending_bits==0 && num_units_to_decode>=2) {
+					// Starting at a byte boundary, so whole bytes of the run
+					// are just copies of b2.
+					dbuf_write_run(rc->unc_pixels, b2, num_units_to_decode/2);
+					k = (num_units_to_decode/2)*2;
+					rle_to_bytes_advance(c, rc, k);
+				}
+				for(; k<num_units_to_decode; k++) {
 					rle_to_bytes_append_unit4(c, rc, (k%2)?pix2:pix1, 1);
 				}
 			}
 			else if(rc->unit_size==24) {
+				u8 unit[3];
+
 				cg = dbuf_getbyte_p(rc->inf, &pos);
 				cr = dbuf_getbyte_p(rc->inf, &pos);
-				for(k=0; k<num_units_to_decode; k++) {
-					rle_to_bytes_append_unit24(c, rc, cr, cg, b2, 1);
-				}
+				unit[0] = b2;
+				unit[1] = cg;
+				unit[2] = cr;
+				rle_to_bytes_append_run(c, rc, unit, num_units_to_decode);
 			}
 			else { // 8:  b1 pixels of color b2
-				for(k=0; k<num_units_to_decode; k++) {
-					rle_to_bytes_append_unit8(c, rc, b2, 1);
-				}
+				rle_to_bytes_append_run(c, rc, &b2, num_units_to_decode);
 			}
 		}
 	}
@@ -777,30 +802,39 @@ static de_bitmap *bmp_bitmap_create(deark *c, lctx *d, int bypp)
 	return img;
 }
 
-static void do_image_paletted(deark *c, lctx *d, dbuf *bits, i64 bits_offset, u8 want_trns)
+static int get_bypp_paletted(lctx *d, u8 want_trns)
 {
 	int bypp;
 
 	if(d->pal_is_grayscale) bypp = 1;
 	else bypp = 3;
 	if(want_trns) bypp++;
+	return bypp;
+}
 
-	d->img = bmp_bitmap_create(c, d, bypp);
+// The decode_image_* functions decode img->height rows, starting at
+// bits_offset, into img.
+
+static void decode_image_paletted(deark *c, lctx *d, dbuf *bits, i64 bits_offset,
+	de_bitmap *img)
+{
 	de_convert_image_paletted(bits, bits_offset,
-		d->bitcount, d->rowspan, d->pal, d->img, 0);
+		d->bitcount, d->rowspan, d->pal, img, 0);
 }
 
-static void do_image_24bit(deark *c, lctx *d, dbuf *bits, i64 bits_offset, u8 want_trns)
+static void do_image_paletted(deark *c, lctx *d, dbuf *bits, i64 bits_offset, u8 want_trns)
+{
+	d->img = bmp_bitmap_create(c, d, get_bypp_paletted(d, want_trns));
+	decode_image_paletted(c, d, bits, bits_offset, d->img);
+}
+
+static void decode_image_24bit(deark *c, lctx *d, dbuf *bits, i64 bits_offset,
+	de_bitmap *img)
 {
 	i64 i, j;
 	u32 clr;
-	int bypp;
 
-	if(want_trns) bypp = 4;
-	else bypp = 3;
-
-	d->img = bmp_bitmap_create(c, d, bypp);
-	for(j=0; j<d->height; j++) {
+	for(j=0; j<img->height; j++) {
 		i64 rowpos = bits_offset + j*d->rowspan;
 		i64 pos_in_this_row = 0;
 		u8 cbuf[3];
@@ -817,19 +851,21 @@ static void do_image_24bit(deark *c, lctx *d, dbuf *bits, i64 bits_offset, u8 wa
 				}
 			}
 			clr = DE_MAKE_RGB(cbuf[2], cbuf[1], cbuf[0]);
-			de_bitmap_setpixel_rgb(d->img, i, j, clr);
+			de_bitmap_setpixel_rgb(img, i, j, clr);
 			pos_in_this_row += 3;
 		}
 	}
 }
 
-static void do_image_16_32bit(deark *c, lctx *d, dbuf *bits, i64 bits_offset)
+static void do_image_24bit(deark *c, lctx *d, dbuf *bits, i64 bits_offset, u8 want_trns)
+{
+	d->img = bmp_bitmap_create(c, d, want_trns?4:3);
+	decode_image_24bit(c, d, bits, bits_offset, d->img);
+}
+
+static int get_bypp_16_32bit(lctx *d)
 {
-	i64 i, j;
 	int has_transparency;
-	u32 v;
-	i64 k;
-	u8 sm[4];
 
 	if(d->bitfields_type==BF_SEGMENT) {
 		has_transparency = (d->bitfields_segment_len>=16 && d->bitfield[3].mask!=0);
@@ -840,9 +876,18 @@ static void do_image_16_32bit(deark *c, lctx *d, dbuf *bits, i64 bits_offset)
 	else {
 		has_transparency = 0;
 	}
+	return has_transparency?4:3;
+}
 
-	d->img = bmp_bitmap_create(c, d, has_transparency?4:3);
-	for(j=0; j<d->height; j++) {
+static void decode_image_16_32bit(deark *c, lctx *d, dbuf *bits, i64 bits_offset,
+	de_bitmap *img)
+{
+	i64 i, j;
+	u32 v;
+	i64 k;
+	u8 sm[4];
+
+	for(j=0; j<img->height; j++) {
 		for(i=0; i<d->pdwidth; i++) {
 			if(d->bitcount==16) {
 				v = (u32)dbuf_getu16le(bits, bits_offset + j*d->rowspan + 2*i);
@@ -862,9 +907,65 @@ static void do_image_16_32bit(deark *c, lctx *d, dbuf *bits, i64 bits_offset)
 						sm[k] = 0; // Default other samples = 0
 				}
 			}
-			de_bitmap_setpixel_rgba(d->img, i, j, DE_MAKE_RGBA(sm[0], sm[1], sm[2], sm[3]));
+			de_bitmap_setpixel_rgba(img, i, j, DE_MAKE_RGBA(sm[0], sm[1], sm[2], sm[3]));
+		}
+	}
+}
+
+typedef void (*decode_image_fn)(deark *c, lctx *d, dbuf *bits, i64 bits_offset,
+	de_bitmap *img);
+
+// For large images: Decode one row at a time, and write it immediately.
+static void do_image_streamed(deark *c, lctx *d, int bypp, UI createflags,
+	decode_image_fn decode_fn)
+{
+	de_bitmap *rowimg = NULL;
+	de_bitmap_writer *bw = NULL;
+	i64 j;
+	int flip;
+
+	de_dbg(c, "writing image one row at a time");
+	flip = (d->createflags & DE_CREATEFLAG_FLIP_IMAGE)?1:0;
+	createflags |= d->createflags & ~(UI)DE_CREATEFLAG_FLIP_IMAGE;
+
+	bw = de_bitmap_writer_create(c, d->width, d->pdwidth, d->height, bypp,
+		d->fi, createflags);
+	if(!bw) goto done;
+	rowimg = de_bitmap_create2(c, d->width, d->pdwidth, 1, bypp);
+
+	for(j=0; j<d->height; j++) {
+		i64 filerow;
+
+		filerow = flip ? (d->height-1-j) : j;
+		decode_fn(c, d, c->infile, d->bits_offset + filerow*d->rowspan, rowimg);
+		de_bitmap_writer_add_rows(bw, rowimg, 1);
+	}
+
+done:
+	de_bitmap_writer_finish(bw);
+	de_bitmap_destroy(rowimg);
+}
+
+// Uncompressed images that are not 64-bit
+static void do_image_uncmpr(deark *c, lctx *d, int bypp, decode_image_fn decode_fn)
+{
+	UI createflags = 0;
+
+	if(!d->want_returned_img && de_bitmap_want_streaming(c, d->pdwidth, d->height, bypp)) {
+		// The image can't be optimized after it's decoded, so detect the
+		// simplest case here.
+		if(d->bitcount==1 && d->pal_is_grayscale &&
+			(d->pal[0]==DE_STOCKCOLOR_BLACK || d->pal[0]==DE_STOCKCOLOR_WHITE) &&
+			(d->pal[1]==DE_STOCKCOLOR_BLACK || d->pal[1]==DE_STOCKCOLOR_WHITE))
+		{
+			createflags |= DE_CREATEFLAG_IS_BWIMG;
 		}
+		do_image_streamed(c, d, bypp, createflags, decode_fn);
+		return;
 	}
+
+	d->img = bmp_bitmap_create(c, d, bypp);
+	decode_fn(c, d, c->infile, d->bits_offset, d->img);
 }
 
 static void do_image_64bit(deark *c, lctx *d, dbuf *bits, i64 bits_offset)
@@ -1052,13 +1153,13 @@ static void do_image(deark *c, lctx *d)
 	}
 
 	if(d->bitcount>=1 && d->bitcount<=8 && d->compression_type==CMPR_NONE) {
-		do_image_paletted(c, d, c->infile, d->bits_offset, 0);
+		do_image_uncmpr(c, d, get_bypp_paletted(d, 0), decode_image_paletted);
 	}
 	else if(d->bitcount==24 && d->compression_type==CMPR_NONE) {
-		do_image_24bit(c, d, c->infile, d->bits_offset, 0);
+		do_image_uncmpr(c, d, 3, decode_image_24bit);
 	}
 	else if((d->bitcount==16 || d->bitcount==32) && d->compression_type==CMPR_NONE) {
-		do_image_16_32bit(c, d, c->infile, d->bits_offset);
+		do_image_uncmpr(c, d, get_bypp_16_32bit(d), decode_image_16_32bit);
 	}
 	else if((d->compression_type==CMPR_RLE4 && (d->bitcount==1 || d->bitcount==4)) ||
 		(d->compression_type==CMPR_RLE8 && d->bitcount==8) ||
@@ -0,0 +1,196 @@
+// This file is part of Deark.
+// Copyright (C) 2026 Jason Summers
+// See the file COPYING for terms of use.
+
+// Find embedded files of several formats in arbitrary files
+// (e.g. disk images), in a single pass.
+//
+// The formats are those whose modules set carve_sig and carve_fn. Each file
+// found is decoded by its module, or extracted if the module sets
+// carve_extract. See struct deark_module_info.
+
+#include <deark-config.h>
+#include <deark-private.h>
+DE_DECLARE_MODULE(de_module_carve);
+
+// The file is scanned in chunks of this size. Consecutive chunks overlap by
+// (DE_MAX_CARVE_SIGLEN-1) bytes, so that a signature that crosses a chunk
+// boundary is still found.
+#define CARVE_CHUNK_SIZE 65536
+
+// Signatures are tracked in a bitmask, so there can't be more than this.
+#define CARVE_MAX_SIGS 32
+
+typedef struct carvectx_struct {
+	dbuf *inf;
+	u8 raw_mode;
+	i64 num_found;
+	size_t num_sigs;
+	struct deark_module_info *sig_mi[CARVE_MAX_SIGS];
+	// For each possible first byte, a bitmask of the signatures (indices into
+	// sig_mi[]) that start with that byte.
+	UI first_byte_map[256];
+
+	i64 buf_pos; // File offset of buf[0]
+	i64 buf_scan_len; // Number of starting positions in buf that we may scan
+	i64 buf_len; // Number of valid bytes in buf
+	u8 buf[CARVE_CHUNK_SIZE+DE_MAX_CARVE_SIGLEN-1];
+} carvectx;
+
+static void build_sig_table(deark *c, carvectx *d)
+{
+	int i;
+
+	for(i=0; i<c->num_modules; i++) {
+		struct deark_module_info *mi = &c->module_info[i];
+
+		if(!mi->carve_fn || !mi->run_fn) continue;
+		if(mi->carve_siglen<1 || mi->carve_siglen>DE_MAX_CARVE_SIGLEN) continue;
+		if(d->num_sigs>=CARVE_MAX_SIGS) {
+			de_internal_err_nonfatal(c, "Too many carve signatures");
+			break;
+		}
+		de_dbg2(c, "signature for %s", mi->id);
+		d->first_byte_map[(u8)mi->carve_sig[0]] |= 1U<<d->num_sigs;
+		d->sig_mi[d->num_sigs++] = mi;
+	}
+}
+
+static void load_chunk(carvectx *d, i64 pos)
+{
+	d->buf_pos = pos;
+	d->buf_scan_len = de_min_int(CARVE_CHUNK_SIZE, d->inf->len - pos);
+	d->buf_len = de_min_int(CARVE_CHUNK_SIZE+DE_MAX_CARVE_SIGLEN-1, d->inf->len - pos);
+	dbuf_read(d->inf, d->buf, pos, d->buf_len);
+}
+
+// Find the next position >= pos1 at which at least one signature occurs.
+// Sets *psigmask to the set of signatures that occur there.
+static int find_next_sig(carvectx *d, i64 pos1, i64 *pfoundpos, UI *psigmask)
+{
+	i64 pos = pos1;
+
+	while(pos < d->inf->len) {
+		i64 i;
+
+		if(pos < d->buf_pos || pos >= d->buf_pos+d->buf_scan_len) {
+			load_chunk(d, pos);
+		}
+
+		for(i=pos-d->buf_pos; i<d->buf_scan_len; i++) {
+			UI candidates;
+			UI sigmask = 0;
+			size_t k;
+
+			candidates = d->first_byte_map[d->buf[i]];
+			if(!candidates) continue;
+
+			for(k=0; k<d->num_sigs; k++) {
+				if(!(candidates & (1U<<k))) continue;
+				if(i+(i64)d->sig_mi[k]->carve_siglen > d->buf_len) continue;
+				if(de_memcmp(&d->buf[i], d->sig_mi[k]->carve_sig,
+					(size_t)d->sig_mi[k]->carve_siglen))
+				{
+					continue;
+				}
+				sigmask |= 1U<<k;
+			}
+
+			if(sigmask) {
+				*pfoundpos = d->buf_pos + i;
+				*psigmask = sigmask;
+				return 1;
+			}
+		}
+
+		pos = d->buf_pos + d->buf_scan_len;
+	}
+	return 0;
+}
+
+// Returns nonzero if the signature at sigpos led to an embedded file, in
+// which case *pnextpos is set to the position at which to continue.
+static int do_candidate(deark *c, carvectx *d, struct deark_module_info *mi,
+	i64 sigpos, i64 *pnextpos)
+{
+	i64 objpos = 0;
+	i64 objlen = 0;
+	int conf;
+
+	de_dbg(c, "possible %s signature at %"I64_FMT, mi->id, sigpos);
+	if(!mi->carve_fn(c, d->inf, sigpos, &objpos, &objlen)) return 0;
+	if(objpos<0 || objlen<1 || objpos+objlen > d->inf->len) return 0;
+
+	conf = de_identify_module_on_slice(c, mi, d->inf, objpos, objlen);
+	if(conf<1) {
+		de_dbg(c, "not identified as %s", mi->id);
+		return 0;
+	}
+
+	de_dbg(c, "%s file at %"I64_FMT", len=%"I64_FMT, mi->id, objpos, objlen);
+	d->num_found++;
+	if(d->raw_mode || mi->carve_extract) {
+		dbuf_create_file_from_slice(d->inf, objpos, objlen, mi->id, NULL, 0);
+	}
+	else {
+		de_dbg_indent(c, 1);
+		de_run_module_by_id_on_slice(c, mi->id, NULL, d->inf, objpos, objlen);
+		de_dbg_indent(c, -1);
+	}
+
+	*pnextpos = de_max_int(sigpos+1, objpos+objlen);
+	return 1;
+}
+
+static void de_run_carve(deark *c, de_module_params *mparams)
+{
+	carvectx *d = NULL;
+	i64 pos = 0;
+
+	d = de_malloc(c, sizeof(carvectx));
+	d->inf = c->infile;
+	d->buf_pos = -1;
+	d->raw_mode = (u8)de_get_ext_option_bool(c, "carve:raw", 0);
+	// The carve functions tend to read small pieces of the file, near the
+	// current position.
+	dbuf_enable_block_cache(d->inf, 65536, 0);
+
+	build_sig_table(c, d);
+
+	while(1) {
+		i64 sigpos = 0;
+		UI sigmask = 0;
+		size_t k;
+		int found_obj = 0;
+
+		if(!find_next_sig(d, pos, &sigpos, &sigmask)) break;
+
+		for(k=0; k<d->num_sigs; k++) {
+			if(!(sigmask & (1U<<k))) continue;
+			if(do_candidate(c, d, d->sig_mi[k], sigpos, &pos)) {
+				found_obj = 1;
+				break;
+			}
+		}
+
+		if(!found_obj) {
+			pos = sigpos+1;
+		}
+	}
+
+	de_dbg(c, "embedded files found: %"I64_FMT, d->num_found);
+	de_free(c, d);
+}
+
+static void de_help_carve(deark *c)
+{
+	de_msg(c, "-opt carve:raw : Extract all embedded files, instead of decoding them");
+}
+
+void de_module_carve(deark *c, struct deark_module_info *mi)
+{
+	mi->id = "carve";
+	mi->desc = "Find embedded JPEG, ZIP, and ARJ files in arbitrary files";
+	mi->run_fn = de_run_carve;
+	mi->help_fn = de_help_carve;
+}
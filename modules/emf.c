@@ -58,6 +58,7 @@ static void do_dbg_colorref(deark *c, lctx *d, u32 colorref)
 	u32 clr;
 	char csamp[16];
 
+	if(!de_dbg_enabled(c, 1)) return;
 	clr = colorref_to_color(colorref);
 	de_get_colorsample_code(c, clr, csamp, sizeof(csamp));
 	de_dbg(c, "colorref: 0x%08x%s", (UI)colorref, csamp);
@@ -294,7 +295,7 @@ static void do_emfplus_object(deark *c, lctx *d, i64 pos, i64 len,
 // EMF+ Comment
 static int emfplus_handler_4003(deark *c, lctx *d, i64 rectype, i64 pos, i64 len)
 {
-	if(c->debug_level>=2) {
+	if(de_dbg_enabled(c, 2)) {
 		de_dbg_hexdump(c, c->infile, pos, len, 256, "comment", 0x1);
 	}
 	else {
@@ -310,6 +311,7 @@ static int emfplus_handler_401c(deark *c, lctx *d, i64 rectype, i64 pos1, i64 le
 	i64 nchars;
 	de_ucstring *s = NULL;
 
+	if(!de_dbg_enabled(c, 1)) goto done;
 	pos += 8; // brushid, formatid
 	nchars = de_getu32le(pos);
 	pos += 4;
@@ -818,6 +820,7 @@ static void do_emf_xEmrText(deark *c, lctx *d, i64 recpos, i64 pos1, i64 len,
 	i64 offstring;
 	de_ucstring *s = NULL;
 
+	if(!de_dbg_enabled(c, 1)) goto done;
 	pos += 8; // Reference
 	nchars = de_getu32le(pos);
 	pos += 4;
@@ -874,6 +877,7 @@ static void do_LogFont(deark *c, lctx *d, struct decoder_params *dp, i64 pos1, i
 	i64 n, n2;
 	u8 b;
 
+	if(!de_dbg_enabled(c, 1)) goto done;
 	if(len<92) goto done;
 
 	n = de_geti32le_p(&pos);
@@ -118,6 +118,7 @@ static void dbg_timestamp(deark *c, struct de_timestamp *ts, const char *name)
 {
 	char timestamp_buf[64];
 
+	if(!de_dbg_enabled(c, 1)) return;
 	de_timestamp_to_string(ts, timestamp_buf, sizeof(timestamp_buf), 0);
 	de_dbg(c, "%s: %s", name, timestamp_buf);
 }
@@ -165,7 +166,7 @@ static int extract_file_lowlevel(deark *c, lctx *d, struct member_data *md, dbuf
 		if(!is_good_clusternum(d, cur_cluster)) break;
 		if(d->cluster_used_flags[cur_cluster]) break;
 		d->cluster_used_flags[cur_cluster] = 1;
-		if(c->debug_level>=3) de_dbg3(c, "cluster: %d", (int)cur_cluster);
+		DE_DBG3(c, "cluster: %d", (int)cur_cluster);
 		dpos = clusternum_to_offset(c, d, cur_cluster);
 		nbytes_to_copy = de_min_int(d->bytes_per_cluster, nbytes_remaining);
 		dbuf_copy(c->infile, dpos, nbytes_to_copy, outf);
@@ -320,7 +321,7 @@ static void handle_vfat_lfn(deark *c, lctx *d, struct dirctx *dctx,
 	md->long_fn = ucstring_create(c);
 	ucstring_append_bytes(md->long_fn, dctx->pending_lfn, len_in_ucs2_chars*2,
 		0, DE_ENCODING_UTF16LE);
-	de_dbg(c, "long filename: \"%s\"", ucstring_getpsz_d(md->long_fn));
+	DE_DBG(c, "long filename: \"%s\"", ucstring_getpsz_d(md->long_fn));
 
 done:
 	;
@@ -424,9 +425,11 @@ static int do_dir_entry(deark *c, lctx *d, struct dirctx *dctx,
 	retval = 1;
 
 	md->attribs = (UI)de_getbyte(pos1+11);
-	descr = ucstring_create(c);
-	de_describe_dos_attribs(c, md->attribs, descr, 0x1);
-	de_dbg(c, "attribs: 0x%02x (%s)", md->attribs, ucstring_getpsz_d(descr));
+	if(de_dbg_enabled(c, 1)) {
+		descr = ucstring_create(c);
+		de_describe_dos_attribs(c, md->attribs, descr, 0x1);
+		de_dbg(c, "attribs: 0x%02x (%s)", md->attribs, ucstring_getpsz_d(descr));
+	}
 	if((md->attribs & 0x3f)==0x0f) {
 		do_vfat_entry(c, d, dctx, pos1, firstbyte);
 		goto done;
@@ -478,7 +481,7 @@ static int do_dir_entry(deark *c, lctx *d, struct dirctx *dctx,
 		decode_short_filename(c, d, md);
 	}
 
-	de_dbg(c, "filename: \"%s\"", ucstring_getpsz_d(md->short_fn));
+	DE_DBG(c, "filename: \"%s\"", ucstring_getpsz_d(md->short_fn));
 
 	if(ucstring_isnonempty(md->long_fn)) {
 		de_strarray_push(d->curpath, md->long_fn);
@@ -937,7 +940,7 @@ static int do_read_fat(deark *c, lctx *d)
 		goto done;
 	}
 
-	if(c->debug_level>=3) {
+	if(de_dbg_enabled(c, 3)) {
 		for(i=0; i<d->num_fat_entries; i++) {
 			de_dbg3(c, "fat[%"I64_FMT"]: %"I64_FMT, i, (i64)d->fat_nextcluster[i]);
 		}
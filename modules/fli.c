@@ -61,6 +61,7 @@ struct image_ctx_type {
 	int error_flag;
 	struct de_density_info density;
 	de_bitmap *img;
+	de_frame_writer *frame_writer;
 	u32 pal[256];
 };
 
@@ -114,6 +115,7 @@ static struct image_ctx_type *create_image_ctx(deark *c, lctx *d, i64 w, i64 h)
 	ictx->w = w;
 	ictx->h = h;
 	ictx->img = de_bitmap_create(c, w, h, 3);
+	ictx->frame_writer = de_frame_writer_create(c);
 	return ictx;
 }
 
@@ -123,6 +125,7 @@ static void destroy_image_ctx(deark *c, struct image_ctx_type *ictx)
 	if(ictx->img) {
 		de_bitmap_destroy(ictx->img);
 	}
+	de_frame_writer_destroy(ictx->frame_writer);
 	de_free(c, ictx);
 }
 
@@ -565,7 +568,7 @@ static void do_chunk_frame(deark *c, lctx *d, struct chunk_info_type *ci)
 			fi = de_finfo_create(c);
 			fi->density = ci->ictx->density;
 			fi->internal_mod_time = d->mod_timestamp;
-			de_bitmap_write_to_file_finfo(ci->ictx->img, fi, 0);
+			de_frame_writer_write(ci->ictx->frame_writer, ci->ictx->img, fi, 0);
 		}
 	}
 
@@ -32,6 +32,10 @@ typedef struct localctx_struct {
 	de_color global_ct[256];
 
 	de_bitmap *screen_img;
+	// Saved pixels, for disposal method "restore to previous". Reused for
+	// each image that's the same size.
+	de_bitmap *saved_img;
+	de_frame_writer *frame_writer;
 	struct gceinfo *gce; // The Graphic Control Ext. in effect for the next image
 	de_finfo *fi; // Reused for each image
 } lctx;
@@ -630,7 +634,7 @@ static void do_plaintext_extension(deark *c, lctx *d, i64 pos1)
 	if(!ctx->header_ok) goto done;
 
 	if(d->compose) {
-		de_bitmap_write_to_file_finfo(d->screen_img, d->fi, 0);
+		de_frame_writer_write(d->frame_writer, d->screen_img, d->fi, 0);
 
 		// TODO: Too much code is duplicated with do_image().
 		if(ctx->disposal_method==DISPOSE_BKGD) {
@@ -1097,7 +1101,6 @@ static int do_image(deark *c, lctx *d, i64 pos1, i64 *bytesused)
 {
 	int retval = 0;
 	struct gif_image_data *gi = NULL;
-	de_bitmap *prev_img = NULL;
 	u8 disposal_method = 0;
 
 	de_dbg_indent(c, 1);
@@ -1119,25 +1122,34 @@ static int do_image(deark *c, lctx *d, i64 pos1, i64 *bytesused)
 
 		if(disposal_method == DISPOSE_PREVIOUS) {
 			// In this case, we need to save a copy of the pixels that may
-			// be overwritten
-			prev_img = de_bitmap_create(c, gi->width, gi->height, 4);
-			de_bitmap_copy_rect(d->screen_img, prev_img,
+			// be overwritten. (Every pixel of saved_img gets overwritten, so
+			// it doesn't have to be cleared if we reuse it.)
+			if(d->saved_img && (d->saved_img->width!=gi->width ||
+				d->saved_img->height!=gi->height))
+			{
+				de_bitmap_destroy(d->saved_img);
+				d->saved_img = NULL;
+			}
+			if(!d->saved_img) {
+				d->saved_img = de_bitmap_create(c, gi->width, gi->height, 4);
+			}
+			de_bitmap_copy_rect(d->screen_img, d->saved_img,
 				gi->xpos, gi->ypos, gi->width, gi->height,
 				0, 0, 0);
 		}
 
 		de_bitmap_copy_rect(gi->img, d->screen_img,
-			0, 0, d->screen_img->width, d->screen_img->height,
+			0, 0, gi->width, gi->height,
 			gi->xpos, gi->ypos, DE_BITMAPFLAG_MERGE);
 
-		de_bitmap_write_to_file_finfo(d->screen_img, d->fi, 0);
+		de_frame_writer_write(d->frame_writer, d->screen_img, d->fi, 0);
 
 		if(disposal_method == DISPOSE_BKGD) {
 			de_bitmap_rect(d->screen_img, gi->xpos, gi->ypos, gi->width, gi->height,
 				DE_STOCKCOLOR_TRANSPARENT, 0);
 		}
-		else if(disposal_method == DISPOSE_PREVIOUS && prev_img) {
-			de_bitmap_copy_rect(prev_img, d->screen_img,
+		else if(disposal_method == DISPOSE_PREVIOUS && d->saved_img) {
+			de_bitmap_copy_rect(d->saved_img, d->screen_img,
 				0, 0, gi->width, gi->height,
 				gi->xpos, gi->ypos, 0);
 		}
@@ -1147,7 +1159,6 @@ static int do_image(deark *c, lctx *d, i64 pos1, i64 *bytesused)
 	}
 
 done:
-	de_bitmap_destroy(prev_img);
 	if(gi) {
 		de_bitmap_destroy(gi->img);
 		de_free(c, gi->interlace_map);
@@ -1235,6 +1246,7 @@ static void de_run_gif(deark *c, de_module_params *mparams)
 			d->screen_h = 1;
 		}
 		d->screen_img = de_bitmap_create(c, d->screen_w, d->screen_h, 4);
+		d->frame_writer = de_frame_writer_create(c);
 	}
 
 	while(1) {
@@ -1284,6 +1296,8 @@ done:
 			}
 			de_bitmap_destroy(d->screen_img);
 		}
+		de_bitmap_destroy(d->saved_img);
+		de_frame_writer_destroy(d->frame_writer);
 		discard_current_gce_data(c, d);
 		de_finfo_destroy(c, d->fi);
 		de_free(c, d);
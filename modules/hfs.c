@@ -64,6 +64,12 @@ typedef struct localctx_struct {
 
 	struct de_inthashtable *nodes_seen;
 	struct de_inthashtable *dirid_hash;
+
+	// Index of the file and directory records found in pass 1, in the order
+	// they were found. Pass 2 works from this, instead of from the catalog.
+	i64 recidx_count;
+	i64 recidx_alloc;
+	struct recorddata **recidx;
 } lctx;
 
 static i64 block_dpos(lctx *d, i64 blknum)
@@ -359,7 +365,7 @@ static void read_timestamp_fields(deark *c, lctx *d, i64 pos1,
 	//pos += 4;
 }
 
-static void do_extract_dir(deark *c, lctx *d, struct nodedata *nd,
+static void do_extract_dir(deark *c, lctx *d,
 	struct recorddata *rd,  struct de_advfile *advf)
 {
 	i64 pos = rd->datapos;
@@ -490,7 +496,7 @@ static int my_advfile_cbfn(deark *c, struct de_advfile *advf,
 	return 1;
 }
 
-static void do_extract_file(deark *c, lctx *d, struct nodedata *nd,
+static void do_extract_file(deark *c, lctx *d,
 	struct recorddata *rd, struct de_advfile *advf)
 {
 	i64 pos = rd->datapos;
@@ -577,7 +583,7 @@ static void do_extract_file(deark *c, lctx *d, struct nodedata *nd,
 	de_free(c, ectx);
 }
 
-static void do_leaf_node_record_extract_item(deark *c, lctx *d, struct nodedata *nd,
+static void do_leaf_node_record_extract_item(deark *c, lctx *d,
 	struct recorddata *rd)
 {
 	struct de_advfile *advf = NULL;
@@ -604,16 +610,53 @@ static void do_leaf_node_record_extract_item(deark *c, lctx *d, struct nodedata
 	advf->snflags = DE_SNFLAG_FULLPATH;
 
 	if(rd->cdrType==CDRTYPE_DIR) {
-		do_extract_dir(c, d, nd, rd, advf);
+		do_extract_dir(c, d, rd, advf);
 	}
 	else if(rd->cdrType==CDRTYPE_FILE) {
-		do_extract_file(c, d, nd, rd, advf);
+		do_extract_file(c, d, rd, advf);
 	}
 
 	de_advfile_destroy(advf);
 }
 
-static void do_leaf_node_record(deark *c, lctx *d, struct nodedata *nd, i64 idx, int pass)
+static void destroy_recorddata(deark *c, struct recorddata *rd)
+{
+	if(!rd) return;
+	de_destroy_stringreaderdata(c, rd->name_srd);
+	de_free(c, rd);
+}
+
+// Takes ownership of rd.
+static void add_to_record_index(deark *c, lctx *d, struct recorddata *rd)
+{
+	if(d->recidx_count >= d->recidx_alloc) {
+		i64 new_alloc;
+
+		new_alloc = d->recidx_alloc ? d->recidx_alloc*2 : 256;
+		d->recidx = de_realloc(c, d->recidx,
+			d->recidx_alloc * sizeof(struct recorddata*),
+			new_alloc * sizeof(struct recorddata*));
+		d->recidx_alloc = new_alloc;
+	}
+	d->recidx[d->recidx_count++] = rd;
+}
+
+static void destroy_record_index(deark *c, lctx *d)
+{
+	i64 i;
+
+	for(i=0; i<d->recidx_count; i++) {
+		destroy_recorddata(c, d->recidx[i]);
+	}
+	de_free(c, d->recidx);
+	d->recidx = NULL;
+	d->recidx_count = 0;
+	d->recidx_alloc = 0;
+}
+
+// Called only in pass 1. Remembers the directory info, and adds file and
+// directory records to the record index.
+static void do_leaf_node_record(deark *c, lctx *d, struct nodedata *nd, i64 idx)
 {
 	i64 pos1_rel, pos;
 	i64 len;
@@ -645,15 +688,7 @@ static void do_leaf_node_record(deark *c, lctx *d, struct nodedata *nd, i64 idx,
 	rd->cdrType = (int)dbuf_geti8(c->infile, rd->datapos);
 	de_dbg(c, "cdrType: %d (%s)", rd->cdrType, get_cdrType_name(rd->cdrType));
 
-	if(pass==1) {
-		if(rd->cdrType!=CDRTYPE_DIR) goto done;
-	}
-	else if(pass==2) {
-		if(rd->cdrType!=CDRTYPE_DIR && rd->cdrType!=CDRTYPE_FILE) goto done;
-	}
-	else {
-		goto done;
-	}
+	if(rd->cdrType!=CDRTYPE_DIR && rd->cdrType!=CDRTYPE_FILE) goto done;
 
 	pos++; // ckrResrv1
 	rd->ParID = (u32)de_getu32be_p(&pos);
@@ -666,36 +701,24 @@ static void do_leaf_node_record(deark *c, lctx *d, struct nodedata *nd, i64 idx,
 
 	// == Catalog File Data Record
 
-	switch(rd->cdrType) {
-	case CDRTYPE_DIR:
-		if(pass==1) {
-			do_leaf_node_record_directory_pass1(c, d, nd, rd);
-		}
-		else if(pass==2) {
-			do_leaf_node_record_extract_item(c, d, nd, rd);
-		}
-		break;
-	case CDRTYPE_FILE:
-		if(pass==2) {
-			do_leaf_node_record_extract_item(c, d, nd, rd);
-		}
-		break;
+	if(rd->cdrType==CDRTYPE_DIR) {
+		do_leaf_node_record_directory_pass1(c, d, nd, rd);
 	}
 
+	add_to_record_index(c, d, rd);
+	rd = NULL;
+
 done:
 	de_dbg_indent(c, -1);
-	if(rd) {
-		de_destroy_stringreaderdata(c, rd->name_srd);
-		de_free(c, rd);
-	}
+	destroy_recorddata(c, rd);
 }
 
-static void do_leaf_node(deark *c, lctx *d, struct nodedata *nd, int pass)
+static void do_leaf_node(deark *c, lctx *d, struct nodedata *nd)
 {
 	i64 i;
 
 	for(i=0; i<nd->nrecs; i++) {
-		do_leaf_node_record(c, d, nd, i, pass);
+		do_leaf_node_record(c, d, nd, i);
 	}
 }
 
@@ -708,8 +731,7 @@ static void destroy_nodedata(deark *c, struct nodedata *nd)
 
 // Caller must allocate nd, set some fields in it, call this function,
 // and is responsible for destroying nd.
-// pass is relevant only for leaf nodes.
-static int do_node(deark *c, lctx *d, struct nodedata *nd, int pass)
+static int do_node(deark *c, lctx *d, struct nodedata *nd)
 {
 	i64 pos;
 	i64 i;
@@ -721,7 +743,7 @@ static int do_node(deark *c, lctx *d, struct nodedata *nd, int pass)
 	if(d->nesting_level>20) goto done;
 	if(nd->nodenum==0 && !nd->expecting_header) goto done;
 
-	if(pass==1) {
+	if(!nd->expecting_header) {
 		if(!de_inthashtable_add_item(c, d->nodes_seen, nd->nodenum, NULL)) {
 			de_err(c, "Invalid node list");
 			goto done;
@@ -730,6 +752,7 @@ static int do_node(deark *c, lctx *d, struct nodedata *nd, int pass)
 	retval = 1;
 
 	nd->dpos = node_dpos(d, nd->nodenum);
+	dbuf_prefetch(c->infile, nd->dpos, 512);
 	pos = nd->dpos;
 
 	de_dbg(c, "node #%"I64_FMT" at %"I64_FMT, nd->nodenum, nd->dpos);
@@ -765,7 +788,7 @@ static int do_node(deark *c, lctx *d, struct nodedata *nd, int pass)
 	}
 
 	if(nd->node_type == -1) {
-		do_leaf_node(c, d, nd, pass);
+		do_leaf_node(c, d, nd);
 	}
 	else if(nd->node_type==1) {
 		do_header_node(c, d, nd);
@@ -777,13 +800,13 @@ done:
 	return retval;
 }
 
-static int do_all_leaf_nodes(deark *c, lctx *d, struct nodedata *hdr_node, int pass)
+static int do_all_leaf_nodes(deark *c, lctx *d, struct nodedata *hdr_node)
 {
 	i64 curr_nodenum;
 	struct nodedata *nd = NULL;
 	int retval = 0;
 
-	de_dbg(c, "reading leaf nodes, pass %d", pass);
+	de_dbg(c, "reading leaf nodes");
 	de_dbg_indent(c, 1);
 
 	// Read all leaf nodes, using the leaf-to-leaf links
@@ -793,7 +816,7 @@ static int do_all_leaf_nodes(deark *c, lctx *d, struct nodedata *hdr_node, int p
 		nd = de_malloc(c, sizeof(struct nodedata));
 		nd->nodenum = curr_nodenum;
 
-		if(!do_node(c, d, nd, pass)) goto done;
+		if(!do_node(c, d, nd)) goto done;
 
 		curr_nodenum = nd->f_link;
 		destroy_nodedata(c, nd);
@@ -807,6 +830,23 @@ done:
 	return retval;
 }
 
+static void do_all_indexed_records(deark *c, lctx *d)
+{
+	i64 i;
+
+	de_dbg(c, "extracting items");
+	de_dbg_indent(c, 1);
+	for(i=0; i<d->recidx_count; i++) {
+		struct recorddata *rd = d->recidx[i];
+
+		de_dbg(c, "record at %"I64_FMT" (%s)", rd->pos1, get_cdrType_name(rd->cdrType));
+		de_dbg_indent(c, 1);
+		do_leaf_node_record_extract_item(c, d, rd);
+		de_dbg_indent(c, -1);
+	}
+	de_dbg_indent(c, -1);
+}
+
 static int do_catalog(deark *c, lctx *d)
 {
 	i64 pos;
@@ -822,7 +862,7 @@ static int do_catalog(deark *c, lctx *d)
 	hdr_node->expecting_header = 1;
 	hdr_node->nodenum = 0;
 	de_dbg_indent(c, 1);
-	if(!do_node(c, d, hdr_node, 0)) goto done;
+	if(!do_node(c, d, hdr_node)) goto done;
 	de_dbg_indent(c, -1);
 
 	if(hdr_node->node_type != 1) {
@@ -836,10 +876,12 @@ static int do_catalog(deark *c, lctx *d)
 	// because we wouldn't have to make an extra pass to collect directory info.
 	// But for now, we'll make two passes.
 
-	// Pass 1 to figure out the directory tree structure, and detect node loops
-	if(!do_all_leaf_nodes(c, d, hdr_node, 1)) goto done;
-	// Pass 2 to extract files
-	if(!do_all_leaf_nodes(c, d, hdr_node, 2)) goto done;
+	// Pass 1 to figure out the directory tree structure, detect node loops,
+	// and make a list of the items to extract.
+	if(!do_all_leaf_nodes(c, d, hdr_node)) goto done;
+	// Pass 2 to extract files. This only uses the list made in pass 1; the
+	// catalog tree isn't walked again.
+	do_all_indexed_records(c, d);
 
 	retval = 1;
 done:
@@ -876,6 +918,8 @@ static void de_run_hfs(deark *c, de_module_params *mparams)
 	d->input_encoding = de_get_input_encoding(c, NULL, DE_ENCODING_MACROMAN);
 
 	d->blocksize = 512;
+	// Catalog nodes are scattered around the file, and read in small pieces.
+	dbuf_enable_block_cache(c->infile, 512, 0);
 	d->nodes_seen = de_inthashtable_create(c);
 	d->dirid_hash = de_inthashtable_create(c);
 
@@ -887,6 +931,7 @@ done:
 	if(d) {
 		de_inthashtable_destroy(c, d->nodes_seen);
 		destroy_dirid_hash(c, d);
+		destroy_record_index(c, d);
 		de_free(c, d);
 	}
 }
@@ -551,12 +551,12 @@ static void do_hall_decompression(deark *c, lctx *d, dbuf *inf, i64 pos1, i64 le
 	UI n;
 	i64 outf_expected_endpos;
 
-	outf_expected_endpos = outf->len + unc_len_expected;
+	outf_expected_endpos = dbuf_get_length(outf) + unc_len_expected;
 
 	while(1) {
 		u8 b;
 
-		if(outf->len >= outf_expected_endpos) goto unc_done;
+		if(dbuf_get_length(outf) >= outf_expected_endpos) goto unc_done;
 		if(pos >= endpos) goto unc_done;
 		b = dbuf_getbyte_p(inf, &pos);
 		switch(action[b&0x0f]) {
@@ -998,10 +998,10 @@ static void decompress_topic_block(deark *c, lctx *d, struct topic_ctx *tctx,
 	dcmpro.len_known = 1;
 	// TODO: Confirm what happens if a block decompresses to more than 16384-12 bytes.
 	dcmpro.expected_len = 16384-TOPICBLOCKHDRSIZE;
-	len_before = outf->len;
+	len_before = dbuf_get_length(outf);
 	fmtutil_hlp_lz77_codectype1(c, &dcmpri, &dcmpro, &dres, NULL);
 	de_dbg(c, "decompressed %"I64_FMT" to %"I64_FMT" bytes", blk_dlen,
-		outf->len - len_before);
+		dbuf_get_length(outf) - len_before);
 }
 
 static void do_file_TOPIC(deark *c, lctx *d, i64 pos1, i64 len)
@@ -111,6 +111,7 @@ typedef struct localctx_ilbm {
 	u8 opt_allowdctv;
 	u8 opt_allowhame;
 	u8 opt_anim_includedups;
+	de_frame_writer *frame_writer; // Used for ANIM frames
 	u8 found_bmhd;
 	u8 found_cmap;
 	u8 cmap_changed_flag;
@@ -2287,6 +2288,10 @@ static void write_frame(deark *c, lctx *d, struct imgbody_info *ibi, struct fram
 	UI createflags = 0;
 	u32 pixelval[8];
 	u8 pixeltrnsval[8];
+	u8 pbytes[8];
+	u8 pixels[8];
+	u8 *planebuf = NULL; // The current row of the frame buffer
+	i64 planebuf_size;
 
 	if(d->errflag) goto done;
 	if(!frctx) goto done;
@@ -2315,6 +2320,8 @@ static void write_frame(deark *c, lctx *d, struct imgbody_info *ibi, struct fram
 	rowbuf_size = (UI)ibi->width;
 	rowbuf = de_mallocarray(c, rowbuf_size, sizeof(rowbuf[0]));
 	rowbuf_trns = de_mallocarray(c, rowbuf_size, sizeof(rowbuf_trns[0]));
+	planebuf_size = ibi->bytes_per_row_per_plane * ibi->planes_total;
+	planebuf = de_malloc(c, planebuf_size);
 
 	if(ibi->is_rgb24) {
 		bypp = 3;
@@ -2348,29 +2355,38 @@ static void write_frame(deark *c, lctx *d, struct imgbody_info *ibi, struct fram
 		i64 plane;
 		UI k;
 
+		dbuf_read(frctx->frame_buffer, planebuf, j*ibi->frame_buffer_rowspan,
+			planebuf_size);
+
 		// Process 8 pixels at a time
 		for(z=0; z<ibi->bytes_per_row_per_plane; z++) {
 			de_zeromem(pixelval, sizeof(pixelval));
 			de_zeromem(pixeltrnsval, sizeof(pixeltrnsval));
 
-			// Read the zth byte in each plane
-			for(plane=0; plane<ibi->planes_total; plane++) {
-				u8 b;
+			// Convert the foreground planes, up to 8 at a time
+			for(plane=0; plane<ibi->planes_fg; plane+=8) {
+				UI nplanes_this_time;
+				UI pn;
+
+				nplanes_this_time = (UI)de_min_int(ibi->planes_fg-plane, 8);
+				for(pn=0; pn<nplanes_this_time; pn++) {
+					pbytes[pn] = planebuf[(plane+(i64)pn)*ibi->bytes_per_row_per_plane + z];
+				}
+				de_planar_to_chunky8(pbytes, nplanes_this_time, 0, pixels);
+				for(k=0; k<8; k++) {
+					pixelval[k] |= (u32)pixels[k] << (UI)plane;
+				}
+			}
 
-				b = dbuf_getbyte(frctx->frame_buffer,
-					j*ibi->frame_buffer_rowspan +
-					plane*ibi->bytes_per_row_per_plane + z);
+			// The only way there can be more planes is if the next plane is a
+			// 1-bit transparency mask.
+			for(plane=ibi->planes_fg; plane<ibi->planes_total; plane++) {
+				u8 b;
 
+				b = planebuf[plane*ibi->bytes_per_row_per_plane + z];
 				for(k=0; k<8; k++) {
 					if(b & (1U<<(7-k))) {
-						if(plane < ibi->planes_fg) {
-							pixelval[k] |= 1U<<(UI)plane;
-						}
-						else {
-							// The only way this can happen is if this plane is a
-							// 1-bit transparency mask.
-							pixeltrnsval[k] = 1;
-						}
+						pixeltrnsval[k] = 1;
 					}
 				}
 			}
@@ -2431,13 +2447,23 @@ after_render:
 		createflags |= DE_CREATEFLAG_IS_AUX;
 	}
 
-	de_bitmap_write_to_file_finfo(img, fi, createflags);
+	if(d->is_anim && !ibi->is_thumb) {
+		// With anim:includedups, frames are often identical.
+		if(!d->frame_writer) {
+			d->frame_writer = de_frame_writer_create(c);
+		}
+		de_frame_writer_write(d->frame_writer, img, fi, createflags);
+	}
+	else {
+		de_bitmap_write_to_file_finfo(img, fi, createflags);
+	}
 
 done:
 	de_bitmap_destroy(img);
 	de_finfo_destroy(c, fi);
 	de_free(c, rowbuf);
 	de_free(c, rowbuf_trns);
+	de_free(c, planebuf);
 }
 
 static void on_frame_begin(deark *c, lctx *d, u32 formtype)
@@ -2905,6 +2931,7 @@ done:
 		destroy_frame(c, d, d->frctx);
 		destroy_frame(c, d, d->oldfrctx[0]);
 		destroy_frame(c, d, d->oldfrctx[1]);
+		de_frame_writer_destroy(d->frame_writer);
 		de_free(c, d);
 	}
 }
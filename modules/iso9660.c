@@ -154,6 +154,7 @@ static void dbg_timestamp(deark *c, struct de_timestamp *ts, const char *field_n
 {
 	char timestamp_buf[64];
 
+	if(!de_dbg_enabled(c, 1)) return;
 	if(ts->is_valid) {
 		de_dbg_timestamp_to_string(c, ts, timestamp_buf, sizeof(timestamp_buf), 0);
 		de_dbg(c, "%s: %s", field_name, timestamp_buf);
@@ -452,7 +453,7 @@ static void do_SUSP_rockridge_NM(deark *c, lctx *d, struct dir_record *dr,
 	// NM item.
 	dbuf_read_to_ucstring(c->infile, pos1+5, len-5, dr->rr_name, 0x0,
 		d->rr_encoding);
-	de_dbg(c, "Rock Ridge name: \"%s\"", ucstring_getpsz_d(dr->rr_name));
+	DE_DBG(c, "Rock Ridge name: \"%s\"", ucstring_getpsz_d(dr->rr_name));
 }
 
 static void do_SUSP_rockridge_PX(deark *c, lctx *d, struct dir_record *dr,
@@ -684,7 +685,7 @@ static void do_dir_rec_SUSP_set(deark *c, lctx *d, struct dir_record *dr,
 				// as SUSP anyway. They're sufficiently compatible.
 				do_Apple_AA_HFS(c, d, dr, itempos, itemlen);
 			}
-			else if(c->debug_level>=2) {
+			else if(de_dbg_enabled(c, 2)) {
 				de_dbg_hexdump(c, c->infile, pos, itemlen-4, 256, NULL, 0x1);
 			}
 		}
@@ -777,7 +778,7 @@ static void do_dir_rec_system_use_area(deark *c, lctx *d, struct dir_record *dr,
 
 	if(non_SUSP_len>0 && !non_SUSP_handled) {
 		de_dbg(c, "[unidentified system use data]");
-		if(c->debug_level>=2) {
+		if(de_dbg_enabled(c, 2)) {
 			de_dbg_indent(c, 1);
 			de_dbg_hexdump(c, c->infile, pos, non_SUSP_len, 256, NULL, 0x1);
 			de_dbg_indent(c, -1);
@@ -853,7 +854,7 @@ static int do_directory_record(deark *c, lctx *d, i64 pos1, struct dir_record *d
 		ucstring_append_flags_item(tmps, "multi-extent");
 		dr->is_specialfileformat = 1;
 	}
-	de_dbg(c, "file flags: 0x%02x (%s)", (unsigned int)dr->file_flags,
+	DE_DBG(c, "file flags: 0x%02x (%s)", (unsigned int)dr->file_flags,
 		ucstring_getpsz_d(tmps));
 
 	if(d->vol->is_hsf) {
@@ -917,7 +918,7 @@ static int do_directory_record(deark *c, lctx *d, i64 pos1, struct dir_record *d
 
 	dr->fname = ucstring_create(c);
 	dbuf_read_to_ucstring(c->infile, pos, dr->file_id_len, dr->fname, 0, file_id_encoding);
-	de_dbg(c, "file id: \"%s\"", ucstring_getpsz_d(dr->fname));
+	DE_DBG(c, "file id: \"%s\"", ucstring_getpsz_d(dr->fname));
 
 	if(d->names_to_lowercase && !d->vol->is_joliet) {
 		name_to_lowercase(dr->fname);
@@ -1025,6 +1026,9 @@ static void do_directory(deark *c, lctx *d, i64 pos1, i64 len, int nesting_level
 			pos1, len);
 	}
 
+	// We're about to read the whole directory extent, a few bytes at a time.
+	dbuf_prefetch(c->infile, pos1, len);
+
 	while(1) {
 		int ret;
 
@@ -1498,6 +1502,9 @@ static void de_run_iso9660(deark *c, de_module_params *mparams)
 		DE_ENCODING_UTF8 : d->user_req_encoding;
 
 	d->secsize = 2048;
+	// Directories and volume descriptors tend to be read in small pieces,
+	// from all over the file.
+	dbuf_enable_block_cache(c->infile, d->secsize, 0);
 
 	if(!dbuf_memcmp(c->infile, 512, "PM\x00\x00", 4)) {
 		de_info(c, "Note: This file includes an Apple Partition Map. "
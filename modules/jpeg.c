@@ -1784,7 +1784,7 @@ static void do_segment(deark *c, lctx *d, const struct marker_info *mi,
 	}
 }
 
-// TODO: This is very similar to detect_jpeg_len().
+// TODO: This is very similar to fmtutil_detect_jpeg_len().
 // Maybe they should be consolidated.
 static int do_read_scan_data(deark *c, lctx *d,
 	i64 pos1, i64 *bytes_consumed)
@@ -2134,99 +2134,17 @@ done:
 	}
 }
 
-typedef struct scanctx_struct {
-	i64 len;
-	u8 is_jpegls;
-} scanctx;
-
-static int detect_jpeg_len(deark *c, scanctx *d, i64 pos1, i64 len)
-{
-	u8 b0, b1;
-	i64 pos;
-	i64 seg_size;
-	int in_scan = 0;
-	int found_sof = 0;
-	int found_scan = 0;
-
-	d->len = 0;
-	d->is_jpegls = 0;
-	pos = pos1;
-
-	while(1) {
-		if(pos>=pos1+len)
-			break;
-		b0 = de_getbyte(pos);
-
-		if(b0!=0xff) {
-			pos++;
-			continue;
-		}
-
-		// Peek at the next byte (after this 0xff byte).
-		b1 = de_getbyte(pos+1);
-
-		if(b1==0xff) {
-			// A "fill byte", not a marker.
-			pos++;
-			continue;
-		}
-		else if(b1==0x00 || (d->is_jpegls && b1<0x80 && in_scan)) {
-			// An escape sequence, not a marker.
-			pos+=2;
-			continue;
-		}
-		else if(b1==0xd9) { // EOI. That's what we're looking for.
-			if(!found_sof || !found_scan) return 0;
-			pos+=2;
-			d->len = pos-pos1;
-			return 1;
-		}
-		else if(b1==0xf7) {
-			de_dbg(c, "Looks like a JPEG-LS file.");
-			found_sof = 1;
-			d->is_jpegls = 1;
-		}
-		else if(b1>=0xc0 && b1<=0xcf && b1!=0xc4 && b1!=0xc8 && b1!=0xcc) {
-			found_sof = 1;
-		}
-
-		if(b1==0xda) { // SOS - Start of scan
-			if(!found_sof) return 0;
-			found_scan = 1;
-			in_scan = 1;
-		}
-		else if(b1>=0xd0 && b1<=0xd7) {
-			// RSTn markers don't change the in_scan state.
-			;
-		}
-		else {
-			in_scan = 0;
-		}
-
-		if((b1>=0xd0 && b1<=0xda) || b1==0x01) {
-			// Markers that have no content.
-			pos+=2;
-			continue;
-		}
-
-		// Everything else should be a marker segment, with a length field.
-		seg_size = de_getu16be(pos+2);
-		if(seg_size<2) break; // bogus size
-
-		pos += seg_size+2;
-	}
-
-	return 0;
-}
-
 static void de_run_jpegscan(deark *c, de_module_params *mparams)
 {
 	i64 pos = 0;
 	i64 foundpos = 0;
-	scanctx *d = NULL;
+	i64 jpeg_len;
+	u8 is_jpegls;
 	int ret;
 
-	d = de_malloc(c, sizeof(*d));
+	// Finding the end of a JPEG file requires reading it a byte at a time,
+	// and the file could be anywhere in the input.
+	dbuf_enable_block_cache(c->infile, 65536, 0);
 
 	while(1) {
 		if(pos >= c->infile->len) break;
@@ -2239,19 +2157,19 @@ static void de_run_jpegscan(deark *c, de_module_params *mparams)
 
 		pos = foundpos;
 
-		if(detect_jpeg_len(c, d, pos, c->infile->len-pos)) {
-			de_dbg(c, "length=%d", (int)d->len);
-			dbuf_create_file_from_slice(c->infile, pos, d->len,
-				d->is_jpegls ? "jls" : "jpg", NULL, 0);
-			pos += d->len;
+		if(fmtutil_detect_jpeg_len(c, c->infile, pos, c->infile->len-pos,
+			&jpeg_len, &is_jpegls))
+		{
+			de_dbg(c, "length=%d", (int)jpeg_len);
+			dbuf_create_file_from_slice(c->infile, pos, jpeg_len,
+				is_jpegls ? "jls" : "jpg", NULL, 0);
+			pos += jpeg_len;
 		}
 		else {
 			de_dbg(c, "Doesn't seem to be a valid JPEG.");
 			pos++;
 		}
 	}
-
-	de_free(c, d);
 }
 
 static int de_identify_jpeg(deark *c)
@@ -2262,6 +2180,17 @@ static int de_identify_jpeg(deark *c)
 	return 0;
 }
 
+static int de_carve_jpeg(deark *c, dbuf *f, i64 sigpos, i64 *ppos, i64 *plen)
+{
+	u8 is_jpegls = 0;
+
+	if(!fmtutil_detect_jpeg_len(c, f, sigpos, f->len-sigpos, plen, &is_jpegls)) {
+		return 0;
+	}
+	*ppos = sigpos;
+	return 1;
+}
+
 void de_module_jpeg(deark *c, struct deark_module_info *mi)
 {
 	mi->id = "jpeg";
@@ -2269,6 +2198,10 @@ void de_module_jpeg(deark *c, struct deark_module_info *mi)
 	mi->desc2 = "resources only";
 	mi->run_fn = de_run_jpeg;
 	mi->identify_fn = de_identify_jpeg;
+	mi->carve_sig = "\xff\xd8\xff";
+	mi->carve_siglen = 3;
+	mi->carve_extract = 1;
+	mi->carve_fn = de_carve_jpeg;
 }
 
 void de_module_jpegscan(deark *c, struct deark_module_info *mi)
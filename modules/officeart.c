@@ -196,7 +196,7 @@ static int do_OfficeArtStream_record(deark *c, struct officeartctx *oactx,
 
 		cmprlen = reclen-extra_bytes;
 		fmtutil_decompress_deflate(inf, pos, cmprlen, outf, 0, NULL, DE_DEFLATEFLAG_ISZLIB);
-		de_dbg(c, "decompressed %"I64_FMT" to %"I64_FMT" bytes", cmprlen, outf->len);
+		de_dbg(c, "decompressed %"I64_FMT" to %"I64_FMT" bytes", cmprlen, dbuf_get_length(outf));
 	}
 	else {
 		dbuf_copy(inf, pos, reclen-extra_bytes, outf);
@@ -1611,7 +1611,7 @@ static void do_write_dcmpr(deark *c, lctx *d)
 		if(possible_beta_filesize_bug) {
 			copy_overlay = 1;
 		}
-		else if(outf->len == d->guest_ei->end_of_dos_code) {
+		else if(dbuf_get_length(outf) == d->guest_ei->end_of_dos_code) {
 			copy_overlay = 1;
 		}
 		else {
@@ -3574,17 +3574,84 @@ static u8 scale_float_to_255(double x)
 	return (u8)(0.5+x*255.0);
 }
 
+struct psd_bitmap_ctx {
+	const struct image_info *iinfo;
+	dbuf *f;
+	i64 pos;
+	i64 nplanes; // Number of planes to read. May be less than d->num_channels.
+	i64 planespan, rowspan, samplespan;
+};
+
+// Decodes row j of the image, to row dst_j of img.
+static void decode_bitmap_row(deark *c, lctx *d, struct psd_bitmap_ctx *bctx,
+	i64 j, de_bitmap *img, i64 dst_j)
+{
+	const struct image_info *iinfo = bctx->iinfo;
+	i64 i, plane;
+	u8 b;
+
+	for(plane=0; plane<bctx->nplanes; plane++) {
+		i64 rowpos = bctx->pos + plane*bctx->planespan + j*bctx->rowspan;
+
+		for(i=0; i<iinfo->width; i++) {
+			if(iinfo->bits_per_channel==32) {
+				// TODO: The format of 32-bit samples does not seem to be documented.
+				// This is little more than a guess.
+				double tmpd;
+				tmpd = dbuf_getfloat32x(bctx->f, rowpos + i*bctx->samplespan, d->is_le);
+				b = scale_float_to_255(tmpd);
+			}
+			else {
+				b = dbuf_getbyte(bctx->f, rowpos + i*bctx->samplespan);
+			}
+			if(iinfo->color_mode==PSD_CM_RGB) {
+				de_bitmap_setsample(img, i, dst_j, plane, b);
+			}
+			else if(iinfo->color_mode==PSD_CM_GRAY) {
+				de_bitmap_setpixel_gray(img, i, dst_j, b);
+			}
+			else if(iinfo->color_mode==PSD_CM_PALETTE) {
+				de_bitmap_setpixel_rgb(img, i, dst_j, iinfo->pal[(unsigned int)b]);
+			}
+		}
+	}
+}
+
+// For large images: Decode one row at a time, and write it immediately.
+static void do_bitmap_streamed(deark *c, lctx *d, struct psd_bitmap_ctx *bctx,
+	int bypp, de_finfo *fi)
+{
+	de_bitmap *rowimg = NULL;
+	de_bitmap_writer *bw = NULL;
+	i64 j;
+
+	de_dbg(c, "writing image one row at a time");
+	bw = de_bitmap_writer_create(c, bctx->iinfo->width, bctx->iinfo->width,
+		bctx->iinfo->height, bypp, fi, 0);
+	if(!bw) goto done;
+	rowimg = de_bitmap_create(c, bctx->iinfo->width, 1, bypp);
+
+	for(j=0; j<bctx->iinfo->height; j++) {
+		decode_bitmap_row(c, d, bctx, j, rowimg, 0);
+		de_bitmap_writer_add_rows(bw, rowimg, 1);
+	}
+
+done:
+	de_bitmap_writer_finish(bw);
+	de_bitmap_destroy(rowimg);
+}
+
 // Extract the primary image
 static void do_bitmap(deark *c, lctx *d, const struct image_info *iinfo, dbuf *f,
 	i64 pos, i64 len)
 {
 	de_bitmap *img = NULL;
 	de_finfo *fi = NULL;
-	i64 i, j, plane;
-	i64 nplanes = 0; // Number of planes to read. May be less than d->num_channels.
-	i64 planespan, rowspan, samplespan;
-	u8 b;
+	i64 j;
+	int bypp;
+	struct psd_bitmap_ctx bctx;
 
+	de_zeromem(&bctx, sizeof(struct psd_bitmap_ctx));
 	if(!de_good_image_dimensions(c, iinfo->width, iinfo->height)) goto done;
 
 	if(iinfo->color_mode==PSD_CM_BITMAP && iinfo->bits_per_channel==1 &&
@@ -3603,13 +3670,13 @@ static void do_bitmap(deark *c, lctx *d, const struct image_info *iinfo, dbuf *f
 	}
 
 	if(iinfo->color_mode==PSD_CM_GRAY && iinfo->num_channels>=1) {
-		nplanes = 1;
+		bctx.nplanes = 1;
 	}
 	else if(iinfo->color_mode==PSD_CM_PALETTE && iinfo->num_channels>=1 && iinfo->bits_per_channel==8) {
-		nplanes = 1;
+		bctx.nplanes = 1;
 	}
 	else if(iinfo->color_mode==PSD_CM_RGB && iinfo->num_channels>=3) {
-		nplanes = 3;
+		bctx.nplanes = 3;
 	}
 	else {
 		de_err(c, "This type of image is not supported (color=%d, "
@@ -3618,8 +3685,7 @@ static void do_bitmap(deark *c, lctx *d, const struct image_info *iinfo, dbuf *f
 		goto done;
 	}
 
-	img = de_bitmap_create(c, iinfo->width, iinfo->height,
-		iinfo->color_mode==PSD_CM_GRAY ? 1 : 3);
+	bypp = (iinfo->color_mode==PSD_CM_GRAY) ? 1 : 3;
 
 	fi = de_finfo_create(c);
 
@@ -3627,34 +3693,28 @@ static void do_bitmap(deark *c, lctx *d, const struct image_info *iinfo, dbuf *f
 		fi->density = iinfo->density;
 	}
 
-	samplespan = iinfo->bits_per_channel/8;
-	rowspan = iinfo->width * samplespan;
-	planespan = iinfo->height * rowspan;
-
-	for(plane=0; plane<nplanes; plane++) {
-		for(j=0; j<iinfo->height; j++) {
-			for(i=0; i<iinfo->width; i++) {
-				if(iinfo->bits_per_channel==32) {
-					// TODO: The format of 32-bit samples does not seem to be documented.
-					// This is little more than a guess.
-					double tmpd;
-					tmpd = dbuf_getfloat32x(f, pos + plane*planespan + j*rowspan + i*samplespan, d->is_le);
-					b = scale_float_to_255(tmpd);
-				}
-				else {
-					b = dbuf_getbyte(f, pos + plane*planespan + j*rowspan + i*samplespan);
-				}
-				if(iinfo->color_mode==PSD_CM_RGB) {
-					de_bitmap_setsample(img, i, j, plane, b);
-				}
-				else if(iinfo->color_mode==PSD_CM_GRAY) {
-					de_bitmap_setpixel_gray(img, i, j, b);
-				}
-				else if(iinfo->color_mode==PSD_CM_PALETTE) {
-					de_bitmap_setpixel_rgb(img, i, j, iinfo->pal[(unsigned int)b]);
-				}
-			}
+	bctx.iinfo = iinfo;
+	bctx.f = f;
+	bctx.pos = pos;
+	bctx.samplespan = iinfo->bits_per_channel/8;
+	bctx.rowspan = iinfo->width * bctx.samplespan;
+	bctx.planespan = iinfo->height * bctx.rowspan;
+
+	if(de_bitmap_want_streaming(c, iinfo->width, iinfo->height, bypp)) {
+		// The image can't be optimized after it's decoded, so at least
+		// detect grayscale palettes.
+		if(iinfo->color_mode==PSD_CM_PALETTE &&
+			de_is_grayscale_palette(iinfo->pal, 256))
+		{
+			bypp = 1;
 		}
+		do_bitmap_streamed(c, d, &bctx, bypp, fi);
+		goto done;
+	}
+
+	img = de_bitmap_create(c, iinfo->width, iinfo->height, bypp);
+	for(j=0; j<iinfo->height; j++) {
+		decode_bitmap_row(c, d, &bctx, j, img, j);
 	}
 
 	de_bitmap_write_to_file_finfo(img, fi, 0);
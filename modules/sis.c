@@ -224,9 +224,9 @@ static void do_extract_file(deark *c, lctx *d, struct file_rec *fr,
 		{
 			goto done;
 		}
-		if(outf->len != fr->ffi[fork_num].orig_len) {
+		if(dbuf_get_length(outf) != fr->ffi[fork_num].orig_len) {
 			de_warn(c, "expected %"I64_FMT" bytes, got %"I64_FMT,
-				fr->ffi[fork_num].orig_len, outf->len);
+				fr->ffi[fork_num].orig_len, dbuf_get_length(outf));
 		}
 	}
 	else {
@@ -319,7 +319,7 @@ static void do_decode_rle_internal(deark *c1, struct de_dfilter_in_params *dcmpr
 {
 	u8 b;
 	i64 count;
-	i64 k;
+	i64 npixels_left;
 	u8 buf[8];
 	i64 pos = dcmpri->pos;
 	i64 nbytes_written = 0;
@@ -330,6 +330,10 @@ static void do_decode_rle_internal(deark *c1, struct de_dfilter_in_params *dcmpr
 		if(pos >= dcmpri->pos + dcmpri->len) break;
 		if(nbytes_written >= dcmpro->expected_len) break;
 
+		// Don't write more (whole) pixels than the image needs.
+		npixels_left = (dcmpro->expected_len - nbytes_written + bytes_per_pixel - 1) /
+			bytes_per_pixel;
+
 		b = dbuf_getbyte(dcmpri->f, pos);
 		pos++;
 
@@ -337,14 +341,14 @@ static void do_decode_rle_internal(deark *c1, struct de_dfilter_in_params *dcmpr
 			count = (i64)(b - 0x80) + 1;
 			dbuf_read(dcmpri->f, buf, pos, bytes_per_pixel);
 			pos += bytes_per_pixel;
-			for(k=0; k<count; k++) {
-				dbuf_write(dcmpro->f, buf, bytes_per_pixel);
-			}
+			dbuf_write_unit_run(dcmpro->f, buf, bytes_per_pixel,
+				de_min_int(count, npixels_left));
 			nbytes_written += count * bytes_per_pixel;
 		}
 		else { // uncompressed block
 			count = (i64)(b) + 1;
-			dbuf_copy(dcmpri->f, pos, count * bytes_per_pixel, dcmpro->f);
+			dbuf_copy(dcmpri->f, pos, de_min_int(count, npixels_left) * bytes_per_pixel,
+				dcmpro->f);
 			pos += count * bytes_per_pixel;
 			nbytes_written += count * bytes_per_pixel;
 		}
@@ -1263,7 +1263,7 @@ static void handler_colormap(deark *c, lctx *d, const struct taginfo *tg, const
 			b2 = (de_colorsample)(b1>>8);
 		}
 		clr = DE_MAKE_RGB(r2, g2, b2);
-		if(c->debug_level>=2) {
+		if(de_dbg_enabled(c, 2)) {
 			de_snprintf(tmps, sizeof(tmps), "(%5d,%5d,%5d) "DE_CHAR_RIGHTARROW" ",
 				(int)r1, (int)g1, (int)b1);
 			de_dbg_pal_entry2(c, i, clr, tmps, NULL, NULL);
@@ -2781,7 +2781,7 @@ static void do_dbg_print_text_single_value(deark *c, lctx *d, const struct tagin
 static void do_dbg_print_values(deark *c, lctx *d, const struct taginfo *tg, const struct tagnuminfo *tni,
 	de_ucstring *dbgline)
 {
-	if(c->debug_level<1) return;
+	if(!de_dbg_enabled(c, 1)) return;
 	if(tni->flags&0x08) return; // Auto-display of values is suppressed for this tag.
 	if(tg->valcount<1) return;
 
@@ -2891,6 +2891,7 @@ struct decode_page_ctx {
 	u8 is_tiled;
 	u8 is_separated;
 	u8 dst_flag_16bit;
+	u8 is_streaming; // If set, the bitmap holds just the current strip
 	u8 is_grayscale;
 	u8 grayscale_reverse_polarity;
 	u8 need_to_reverse_bits;
@@ -3153,21 +3154,49 @@ done:
 	return retval;
 }
 
+// The decompressed data for one plane of a strile, accessed directly in
+// memory. Bytes past the end are treated as 0.
+struct unc_strile_mem {
+	const u8 *mem;
+	i64 len;
+};
+
+static u8 unc_strile_getbyte(const struct unc_strile_mem *um, i64 pos)
+{
+	if(pos<0 || pos>=um->len) return 0;
+	return um->mem[pos];
+}
+
 static void paint_decompressed_strile_to_image(deark *c, lctx *d, struct page_ctx *pg,
 	struct decode_page_ctx *dctx, de_bitmap *img, de_bitmap *img_lo)
 {
 	i64 i, j;
 	u32 s_idx;
+	UI k;
 	u32 sample_mask;
 	u32 sample_scalefactor;
 	u32 prev_sample[DE_TIFF_MAX_SAMPLES];
 	u32 sample[DE_TIFF_MAX_SAMPLES];
 	u8 sample_lo[DE_TIFF_MAX_SAMPLES];
+	struct unc_strile_mem um[DE_TIFF_MAX_SAMPLES];
 	de_color clr_lo = 0;
+	i64 dst_ypos;
 
 	de_zeromem(&prev_sample, sizeof(prev_sample));
 	de_zeromem(&sample, sizeof(sample));
 	de_zeromem(&sample_lo, sizeof(sample_lo));
+	de_zeromem(um, sizeof(um));
+
+	// The striles are always in membufs, so we can read them directly, instead
+	// of calling a dbuf function for every sample.
+	for(k=0; k<dctx->num_planes_to_decode; k++) {
+		dbuf *f = dctx->unc_strile_dbuf[k];
+
+		um[k].mem = dbuf_get_direct_ptr(f, 0, f->len);
+		if(um[k].mem) um[k].len = f->len;
+	}
+
+	dst_ypos = dctx->is_streaming ? 0 : dctx->strileset_ypos;
 
 	sample_mask = (1U<<(u32)pg->bits_per_sample)-1U;
 	if(pg->bits_per_sample<=8) {
@@ -3190,6 +3219,7 @@ static void paint_decompressed_strile_to_image(deark *c, lctx *d, struct page_ct
 				UI dbuf_idx;
 				i64 sample_offset;
 				i64 bytepos;
+				i64 bitpos;
 
 				if(dctx->is_separated) {
 					dbuf_idx = s_idx;
@@ -3202,18 +3232,28 @@ static void paint_decompressed_strile_to_image(deark *c, lctx *d, struct page_ct
 
 				switch(pg->bits_per_sample) {
 				case 1: case 2: case 4:
-					sample[s_idx] = de_get_bits_symbol(dctx->unc_strile_dbuf[dbuf_idx], (i64)pg->bits_per_sample,
-						dctx->strileset_rowspan*j, i*(i64)dctx->samples_per_pixel_per_plane + sample_offset);
+					bitpos = (i*(i64)dctx->samples_per_pixel_per_plane + sample_offset) *
+						(i64)pg->bits_per_sample;
+					bytepos = dctx->strileset_rowspan*j + bitpos/8;
+					sample[s_idx] = (unc_strile_getbyte(&um[dbuf_idx], bytepos) >>
+						(8 - pg->bits_per_sample - (UI)(bitpos%8))) & sample_mask;
 					break;
 				case 8:
 					bytepos = dctx->strileset_rowspan*j + i*(i64)dctx->samples_per_pixel_per_plane + sample_offset;
-					sample[s_idx] = dbuf_getbyte(dctx->unc_strile_dbuf[dbuf_idx], bytepos);
+					sample[s_idx] = unc_strile_getbyte(&um[dbuf_idx], bytepos);
 					break;
 				case 16:
 					bytepos = dctx->strileset_rowspan*j + (i*(i64)dctx->samples_per_pixel_per_plane + sample_offset)*2;
 					// Byte order for 16-bit samples is dictated by the TIFF file header -- at least
 					// for uncompressed images.
-					sample[s_idx] = (u32)dbuf_getu16x(dctx->unc_strile_dbuf[dbuf_idx], bytepos, d->is_le);
+					if(d->is_le) {
+						sample[s_idx] = (u32)unc_strile_getbyte(&um[dbuf_idx], bytepos) |
+							((u32)unc_strile_getbyte(&um[dbuf_idx], bytepos+1) << 8);
+					}
+					else {
+						sample[s_idx] = ((u32)unc_strile_getbyte(&um[dbuf_idx], bytepos) << 8) |
+							(u32)unc_strile_getbyte(&um[dbuf_idx], bytepos+1);
+					}
 					break;
 				default:
 					sample[s_idx] = 0;
@@ -3278,9 +3318,9 @@ static void paint_decompressed_strile_to_image(deark *c, lctx *d, struct page_ct
 				}
 			}
 
-			de_bitmap_setpixel_rgba(img, dctx->strileset_xpos+i, dctx->strileset_ypos+j, clr);
+			de_bitmap_setpixel_rgba(img, dctx->strileset_xpos+i, dst_ypos+j, clr);
 			if(dctx->dst_flag_16bit) {
-				de_bitmap_setpixel_rgba(img_lo, dctx->strileset_xpos+i, dctx->strileset_ypos+j, clr_lo);
+				de_bitmap_setpixel_rgba(img_lo, dctx->strileset_xpos+i, dst_ypos+j, clr_lo);
 			}
 		}
 	}
@@ -3437,10 +3477,36 @@ static void preprocess_fillorder_lsb(deark *c, lctx *d, struct page_ctx *pg,
 	detiff_warn(c, d, pg, "Unexpected FillOrder for this image type. Ignoring.");
 }
 
+// Decide whether to write the image one strip at a time, instead of decoding
+// it to a whole bitmap first. Only the simplest cases are supported.
+static void setup_streaming(deark *c, lctx *d, struct page_ctx *pg,
+	struct decode_page_ctx *dctx, int *poutput_bypp, UI *pcreateflags)
+{
+	if(dctx->is_tiled || dctx->dst_flag_16bit) return;
+	if(pg->orientation>1) return;
+	if(!de_bitmap_want_streaming(c, dctx->width, dctx->height, *poutput_bypp)) return;
+
+	dctx->is_streaming = 1;
+	de_dbg(c, "writing image one strip at a time");
+
+	// The image can't be optimized after it's decoded, so choose the output
+	// format based on what we know about it.
+	if(dctx->has_alpha) return;
+	if(dctx->use_pal && !pg->is_dexxa && pg->bits_per_sample<=8 &&
+		de_is_grayscale_palette(pg->pal, (i64)1<<pg->bits_per_sample))
+	{
+		*poutput_bypp = 1;
+	}
+	else if(dctx->is_grayscale && pg->bits_per_sample==1) {
+		*pcreateflags |= DE_CREATEFLAG_IS_BWIMG;
+	}
+}
+
 static void do_process_ifd_image(deark *c, lctx *d, struct page_ctx *pg)
 {
 	de_bitmap *img = NULL;
 	de_bitmap *img_lo = NULL;
+	de_bitmap_writer *bw = NULL;
 	struct decode_page_ctx *dctx = NULL;
 	de_finfo *fi = NULL;
 	int need_errmsg = 0;
@@ -3738,9 +3804,24 @@ static void do_process_ifd_image(deark *c, lctx *d, struct page_ctx *pg)
 		dctx->dst_flag_16bit = 1;
 	}
 
-	img = de_bitmap_create(c, dctx->width, dctx->height, output_bypp);
-	if(dctx->dst_flag_16bit) {
-		img_lo = de_bitmap_create(c, dctx->width, dctx->height, output_bypp);
+	fi = de_finfo_create(c);
+	if(pg->is_thumb) {
+		createflags |= DE_CREATEFLAG_IS_AUX;
+		de_finfo_set_name_from_sz(c, fi, "thumb", 0, DE_ENCODING_LATIN1);
+	}
+	set_image_density(c, d, pg, fi);
+	fi->internal_mod_time = pg->internal_mod_time;
+
+	setup_streaming(c, d, pg, dctx, &output_bypp, &createflags);
+
+	if(dctx->is_streaming) {
+		img = de_bitmap_create(c, dctx->width, dctx->strile_max_h, output_bypp);
+	}
+	else {
+		img = de_bitmap_create(c, dctx->width, dctx->height, output_bypp);
+		if(dctx->dst_flag_16bit) {
+			img_lo = de_bitmap_create(c, dctx->width, dctx->height, output_bypp);
+		}
 	}
 
 	de_dbg_indent_save(c, &saved_indent_level2);
@@ -3794,11 +3875,28 @@ static void do_process_ifd_image(deark *c, lctx *d, struct page_ctx *pg)
 		}
 
 		paint_decompressed_strile_to_image(c, d, pg, dctx, img, img_lo);
+
+		if(dctx->is_streaming) {
+			if(!bw) {
+				bw = de_bitmap_writer_create(c, dctx->width, dctx->width, dctx->height,
+					output_bypp, fi, createflags);
+			}
+			de_bitmap_writer_add_rows(bw, img, dctx->strileset_height);
+		}
 	}
 
 after_paint:
 	de_dbg_indent_restore(c, saved_indent_level2);
-	fi = de_finfo_create(c);
+
+	if(dctx->is_streaming) {
+		if(!bw) {
+			bw = de_bitmap_writer_create(c, dctx->width, dctx->width, dctx->height,
+				output_bypp, fi, createflags);
+		}
+		de_bitmap_writer_finish(bw);
+		bw = NULL;
+		goto done;
+	}
 
 	if(pg->orientation>=5 && pg->orientation<=8) {
 		de_bitmap_transpose(img);
@@ -3813,14 +3911,6 @@ after_paint:
 		createflags |= DE_CREATEFLAG_FLIP_IMAGE;
 	}
 
-	if(pg->is_thumb) {
-		createflags |= DE_CREATEFLAG_IS_AUX;
-		de_finfo_set_name_from_sz(c, fi, "thumb", 0, DE_ENCODING_LATIN1);
-	}
-
-	set_image_density(c, d, pg, fi);
-	fi->internal_mod_time = pg->internal_mod_time;
-
 	createflags |= DE_CREATEFLAG_OPT_IMAGE;
 	de_bitmap16_write_to_file_finfo(img, img_lo, fi, createflags);
 
@@ -3828,6 +3918,7 @@ done:
 	for(i=0; i<DE_TIFF_MAX_SAMPLES; i++) {
 		if(tmp_membuf[i]) dbuf_close(tmp_membuf[i]);
 	}
+	de_bitmap_writer_finish(bw);
 	de_bitmap_destroy(img);
 	de_bitmap_destroy(img_lo);
 	de_finfo_destroy(c, fi);
@@ -4006,18 +4097,20 @@ static void process_ifd(deark *c, lctx *d, int ifd_idx1, i64 ifdpos1, u8 ifdtype
 			tni = &default_tni; // Make sure tni is not NULL.
 		}
 
-		ucstring_empty(dbgline);
-		ucstring_printf(dbgline, DE_ENCODING_UTF8,
-			"tag %d (%s) ty=%d #=%d offs=%" I64_FMT,
-			tg.tagnum, tni->tagname,
-			tg.datatype, (int)tg.valcount,
-			tg.val_offset);
+		if(de_dbg_enabled(c, 1)) {
+			ucstring_empty(dbgline);
+			ucstring_printf(dbgline, DE_ENCODING_UTF8,
+				"tag %d (%s) ty=%d #=%d offs=%" I64_FMT,
+				tg.tagnum, tni->tagname,
+				tg.datatype, (int)tg.valcount,
+				tg.val_offset);
 
-		do_dbg_print_values(c, d, &tg, tni, dbgline);
+			do_dbg_print_values(c, d, &tg, tni, dbgline);
 
-		// do_dbg_print_values() already tried to limit the line length.
-		// The "500+" in the next line is an emergency brake.
-		de_dbg(c, "%s", ucstring_getpsz_n(dbgline, 500+DE_DBG_MAX_STRLEN));
+			// do_dbg_print_values() already tried to limit the line length.
+			// The "500+" in the next line is an emergency brake.
+			de_dbg(c, "%s", ucstring_getpsz_n(dbgline, 500+DE_DBG_MAX_STRLEN));
+		}
 
 		de_dbg_indent(c, 1);
 
@@ -62,6 +62,7 @@ static void do_dbg_colorref(deark *c, lctx *d, struct decoder_params *dp, u32 co
 	u32 clr;
 	char csamp[16];
 
+	if(!de_dbg_enabled(c, 1)) return;
 	clr = colorref_to_color(colorref);
 	de_get_colorsample_code(c, clr, csamp, sizeof(csamp));
 	de_dbg(c, "colorref: 0x%08x%s", (unsigned int)colorref, csamp);
@@ -84,6 +85,7 @@ static int wmf_handler_TEXTOUT(deark *c, lctx *d, struct decoder_params *dp)
 	i64 stringlen;
 	de_ucstring *s = NULL;
 
+	if(!de_dbg_enabled(c, 1)) goto done;
 	stringlen = de_getu16le(pos);
 	pos += 2;
 
@@ -368,6 +370,7 @@ static int wmf_handler_EXTTEXTOUT(deark *c, lctx *d, struct decoder_params *dp)
 	de_ucstring *s = NULL;
 	u32 fwOpts;
 
+	if(!de_dbg_enabled(c, 1)) goto done;
 	pos += 4; // Y, X
 
 	stringlen = de_getu16le(pos);
@@ -504,6 +507,7 @@ static int handler_CREATEPENINDIRECT(deark *c, lctx *d, struct decoder_params *d
 	unsigned int base_style;
 	de_ucstring *style_descr = NULL;
 
+	if(!de_dbg_enabled(c, 1)) goto done;
 	if(dp->dlen<10) goto done;
 	style = (unsigned int)de_getu16le_p(&pos);
 	base_style = style&0x0f; // ?
@@ -539,6 +543,7 @@ static int handler_CREATEFONTINDIRECT(deark *c, lctx *d, struct decoder_params *
 	u8 b;
 	i64 pos = dp->dpos;
 
+	if(!de_dbg_enabled(c, 1)) return 1;
 	n = de_geti16le_p(&pos);
 	n2 = de_geti16le_p(&pos);
 	de_dbg(c, "height,width: %d,%d", (int)n, (int)n2);
@@ -2341,13 +2341,8 @@ static void de_run_zip_normally(deark *c, lctx *d)
 {
 	int eocd_found;
 
-	if(c->detection_data && c->detection_data->zip_eocd_looked_for) {
-		eocd_found = (int)c->detection_data->zip_eocd_found;
-		d->eocd_pos = c->detection_data->zip_eocd_pos;
-	}
-	else {
-		eocd_found = fmtutil_find_zip_eocd(c, c->infile, 0, &d->eocd_pos);
-	}
+	// (The result may have been cached during format detection.)
+	eocd_found = fmtutil_find_zip_eocd(c, c->infile, 0, &d->eocd_pos);
 	if(!eocd_found) {
 		if(c->module_disposition==DE_MODDISP_AUTODETECT ||
 			c->module_disposition==DE_MODDISP_EXPLICIT)
@@ -2476,12 +2471,9 @@ static int de_identify_zip(deark *c)
 		has_mz_sig = 1;
 	}
 
-	// First try "fast" mode. Note that we won't update c->detection_data
-	// if this fails, because a later full search might succeed.
+	// First try "fast" mode. (fmtutil_find_zip_eocd() remembers the result
+	// in c->detection_data, unless a "fast" search fails.)
 	if(fmtutil_find_zip_eocd(c, c->infile, 0x1, &eocd_pos)) {
-		c->detection_data->zip_eocd_looked_for = 1;
-		c->detection_data->zip_eocd_found = 1;
-		c->detection_data->zip_eocd_pos = eocd_pos;
 		return has_zip_ext ? 100 : 19;
 	}
 
@@ -2499,10 +2491,7 @@ static int de_identify_zip(deark *c)
 	// Slow tests:
 
 	if(has_mz_sig || has_zip_ext) {
-		c->detection_data->zip_eocd_looked_for = 1;
 		if(fmtutil_find_zip_eocd(c, c->infile, 0, &eocd_pos)) {
-			c->detection_data->zip_eocd_found = 1;
-			c->detection_data->zip_eocd_pos = eocd_pos;
 			return 19;
 		}
 	}
@@ -2514,6 +2503,42 @@ static int de_identify_zip(deark *c)
 	return 0;
 }
 
+// The carve signature is that of the end-of-central-directory record, which
+// lets us figure out where the ZIP file starts and ends.
+static int de_carve_zip(deark *c, dbuf *f, i64 sigpos, i64 *ppos, i64 *plen)
+{
+	u8 m[22];
+	i64 num_entries;
+	i64 cdir_size, cdir_offs;
+	i64 cmt_len;
+	i64 startpos, endpos;
+
+	if(sigpos+22 > f->len) return 0;
+	dbuf_read(f, m, sigpos, 22);
+	if(de_getu16le_direct(&m[4])!=0) return 0; // this disk num
+	if(de_getu16le_direct(&m[6])!=0) return 0; // central dir disk num
+	num_entries = de_getu16le_direct(&m[8]);
+	if(num_entries != de_getu16le_direct(&m[10])) return 0;
+	// Empty ZIP files, and ZIP64, aren't supported.
+	if(num_entries==0 || num_entries==0xffff) return 0;
+	cdir_size = de_getu32le_direct(&m[12]);
+	cdir_offs = de_getu32le_direct(&m[16]);
+	if(cdir_offs==0xffffffffLL) return 0;
+	cmt_len = de_getu16le_direct(&m[20]);
+
+	startpos = sigpos - cdir_size - cdir_offs;
+	if(startpos<0) return 0;
+	endpos = sigpos + 22 + cmt_len;
+	if(endpos > f->len) return 0;
+
+	if((u32)dbuf_getu32be(f, startpos) != CODE_PK34) return 0;
+	if((u32)dbuf_getu32be(f, startpos+cdir_offs) != CODE_PK12) return 0;
+
+	*ppos = startpos;
+	*plen = endpos - startpos;
+	return 1;
+}
+
 static void de_help_zip(deark *c)
 {
 	de_msg(c, "-opt zip:scanmode : Do not use the \"central directory\"");
@@ -2532,6 +2557,9 @@ void de_module_zip(deark *c, struct deark_module_info *mi)
 	mi->identify_fn = de_identify_zip;
 	mi->help_fn = de_help_zip;
 	mi->flags |= DE_MODFLAG_MULTIPART;
+	mi->carve_sig = "PK\x05\x06";
+	mi->carve_siglen = 4;
+	mi->carve_fn = de_carve_zip;
 }
 
 /////////////////////// ZIP relocator utility
@@ -2795,12 +2823,6 @@ static void do_run_zip_relocator(deark *c, de_module_params *mparams,
 			d->eocd_pos = edd_from_parent->zip_eocd_pos;
 		}
 	}
-	else if(c->detection_data && c->detection_data->zip_eocd_looked_for) {
-		eocd_found = (int)c->detection_data->zip_eocd_found;
-		if(eocd_found) {
-			d->eocd_pos = c->detection_data->zip_eocd_pos;
-		}
-	}
 	else {
 		eocd_found = fmtutil_find_zip_eocd(c, c->infile, 0, &d->eocd_pos);
 	}
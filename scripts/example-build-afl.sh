@@ -2,11 +2,17 @@
 
 # Example script to build Deark for testing with American fuzzy lop
 # (http://lcamtuf.coredump.cx/afl/).
-# Run this script from your main deark directory, to create aflobj/deark.
+# Run this script from your main deark directory, to create aflobj/deark and
+# aflobj/deark-fuzz.
 # Then, the steps to use it, in simplest form, are something like this:
 #   mkdir -p testcase_dir findings_dir
 #   [Copy some small test files into testcase_dir.]
 #   afl-fuzz -i testcase_dir -o findings_dir -- aflobj/deark -fromstdin -l -q
+# Or, to use the in-process harness, which is much faster:
+#   afl-fuzz -i testcase_dir -o findings_dir -- aflobj/deark-fuzz
+# The harness uses AFL's persistent mode only if CC is afl-clang-fast (or
+# similar). Set DEARK_FUZZ_MODULE to fuzz a specific module. To replay a
+# file, run "aflobj/deark-fuzz <file>".
 
 set -e
 export DEARK_OBJDIR="aflobj"
@@ -21,5 +27,5 @@ else
  mkdir -p $DEARK_OBJDIR/modules
  make -j4 dep
  make -j4
+ make -j4 $DEARK_OBJDIR/deark-fuzz
 fi
-
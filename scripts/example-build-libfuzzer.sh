@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Example script to build Deark's in-process fuzzing harness for libFuzzer
+# (https://llvm.org/docs/LibFuzzer.html).
+# Run this script from your main deark directory, to create
+# fuzzobj/deark-fuzz. It is the same as "make fuzz-libfuzzer".
+# Then, the steps to use it, in simplest form, are something like this:
+#   mkdir -p corpus_dir
+#   [Copy some small test files into corpus_dir.]
+#   fuzzobj/deark-fuzz corpus_dir
+# Set DEARK_FUZZ_MODULE to fuzz a specific module.
+# After a fatal error, the harness abandons the input, but the memory it was
+# using is still freed, so leak detection can stay enabled.
+
+set -e
+
+if [ "$1" = "clean" ]
+then
+ DEARK_OBJDIR="fuzzobj" make clean
+else
+ make -j4 fuzz-libfuzzer
+fi
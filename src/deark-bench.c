@@ -0,0 +1,2694 @@
+// This file is part of Deark.
+// Copyright (C) 2026 Jason Summers
+// See the file COPYING for terms of use.
+
+// Benchmarks ("make bench", "make bench-e2e", "make bench-identify").
+// Also a summarizer for "deark -opt dbuf:trace=<file>" ("-dbuftrace").
+// This is a developer tool. It is not part of the deark program.
+//
+// Codec microbenchmark: Deark can only decompress most of its formats, so
+// for each codec we generate deterministic synthetic data, compress it with
+// a minimal encoder written here, and then time the library's decoder on it.
+// The first decode of each codec is checked against the original data.
+// Memory accounting is enabled, so that the number of allocations per decode,
+// and the peak memory used by the decoder, can be reported.
+
+#define DE_NOT_IN_MODULE
+#include "deark-config.h"
+#include "deark-private.h"
+#include "deark-fmtutil.h"
+#include "deark-user.h"
+#include <time.h>
+
+#define BENCH_DEFAULT_MIN_SECONDS 0.5
+#define BENCH_DEFAULT_DATA_SIZE   (4*1024*1024)
+#define BENCH_FAX_WIDTH 1728
+
+enum bench_data_enum {
+	BENCH_DATA_TEXT = 0, // Text-like data, with lots of repeated strings
+	BENCH_DATA_RUNS,     // Data with lots of repeated bytes
+	BENCH_DATA_BILEVEL,  // Packed 1-bit image, BENCH_FAX_WIDTH pixels wide
+	BENCH_DATA_COUNT
+};
+
+struct benchctx;
+
+typedef void (*bench_encode_fn)(struct benchctx *bctx, const u8 *src, i64 len,
+	dbuf *outf);
+typedef void (*bench_decode_fn)(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres);
+
+struct bench_codec {
+	const char *name;
+	enum bench_data_enum datatype;
+	bench_encode_fn encode_fn;
+	bench_decode_fn decode_fn;
+};
+
+struct bench_data {
+	u8 *buf;
+	i64 len;
+};
+
+struct benchctx {
+	deark *c;
+	double min_seconds;
+	i64 data_size;
+	u32 prng_state;
+	i64 fax_height;
+	struct bench_data data[BENCH_DATA_COUNT];
+};
+
+static u32 bench_rand(struct benchctx *bctx)
+{
+	// xorshift32
+	bctx->prng_state ^= bctx->prng_state << 13;
+	bctx->prng_state ^= bctx->prng_state >> 17;
+	bctx->prng_state ^= bctx->prng_state << 5;
+	return bctx->prng_state;
+}
+
+// Returns a random number from 0 to n-1.
+static UI bench_rand_n(struct benchctx *bctx, UI n)
+{
+	return (UI)(bench_rand(bctx) % (u32)n);
+}
+
+///////////////////////////////////
+// Test data generators
+
+static void gen_text_data(struct benchctx *bctx, struct bench_data *d)
+{
+	static const char *words[] = {
+		"the", "of", "and", "to", "in", "is", "was", "that", "for", "it",
+		"file", "format", "data", "image", "compressed", "header", "archive",
+		"version", "bytes", "offset", "length", "palette", "bitmap", "member",
+		"decompression", "Deark", "module", "codec", "table", "window" };
+	i64 pos = 0;
+	UI col = 0;
+
+	d->len = bctx->data_size;
+	d->buf = de_malloc(bctx->c, d->len);
+
+	while(pos < d->len) {
+		const char *w;
+		char numbuf[16];
+		size_t wlen;
+		size_t i;
+		UI r;
+
+		// Skew the word distribution, so that the Huffman-based codecs have
+		// something to work with.
+		r = bench_rand_n(bctx, 1000);
+		if(r<600) {
+			w = words[r%10];
+		}
+		else if(r<990) {
+			w = words[10 + r%20];
+		}
+		else {
+			de_snprintf(numbuf, sizeof(numbuf), "%u", bench_rand_n(bctx, 100000));
+			w = numbuf;
+		}
+
+		wlen = de_strlen(w);
+		for(i=0; i<wlen && pos<d->len; i++) {
+			d->buf[pos++] = (u8)w[i];
+		}
+		col += (UI)wlen + 1;
+		if(pos>=d->len) break;
+
+		if(col>70) {
+			d->buf[pos++] = '\n';
+			col = 0;
+		}
+		else if(bench_rand_n(bctx, 12)==0) {
+			d->buf[pos++] = ',';
+		}
+		else {
+			d->buf[pos++] = ' ';
+		}
+	}
+}
+
+static void gen_runs_data(struct benchctx *bctx, struct bench_data *d)
+{
+	i64 pos = 0;
+
+	d->len = bctx->data_size;
+	d->buf = de_malloc(bctx->c, d->len);
+
+	while(pos < d->len) {
+		i64 n;
+		i64 i;
+
+		if(bench_rand_n(bctx, 3)==0) {
+			// A stretch of random bytes. Include the RLE90 escape byte sometimes.
+			n = 1 + (i64)bench_rand_n(bctx, 24);
+			for(i=0; i<n && pos<d->len; i++) {
+				d->buf[pos++] = (bench_rand_n(bctx, 50)==0) ? 0x90 : (u8)bench_rand(bctx);
+			}
+		}
+		else {
+			u8 b;
+
+			// A run, usually of a "background" value
+			n = 2 + (i64)bench_rand_n(bctx, 300);
+			b = (bench_rand_n(bctx, 4)==0) ? (u8)bench_rand(bctx) : 0x00;
+			for(i=0; i<n && pos<d->len; i++) {
+				d->buf[pos++] = b;
+			}
+		}
+	}
+}
+
+// Something vaguely like a scanned text document: mostly white, with short
+// black runs clustered into "lines of text".
+static void gen_bilevel_data(struct benchctx *bctx, struct bench_data *d)
+{
+	i64 rowspan = (BENCH_FAX_WIDTH+7)/8;
+	i64 j;
+
+	bctx->fax_height = bctx->data_size / 4 / rowspan;
+	if(bctx->fax_height<1) bctx->fax_height = 1;
+	d->len = rowspan * bctx->fax_height;
+	d->buf = de_malloc(bctx->c, d->len);
+
+	for(j=0; j<bctx->fax_height; j++) {
+		u8 *row = &d->buf[j*rowspan];
+		i64 x;
+
+		if((j%40) >= 28) continue; // blank line spacing
+
+		x = 100 + (i64)bench_rand_n(bctx, 40);
+		while(x < BENCH_FAX_WIDTH-100) {
+			i64 runlen;
+			i64 k;
+
+			runlen = 1 + (i64)bench_rand_n(bctx, 12);
+			for(k=x; k<x+runlen && k<BENCH_FAX_WIDTH; k++) {
+				row[k/8] |= (u8)(0x80 >> (k%8));
+			}
+			x += runlen;
+			x += 1 + (i64)bench_rand_n(bctx, (bench_rand_n(bctx, 10)==0) ? 200 : 16);
+		}
+	}
+}
+
+///////////////////////////////////
+// Bit writer for the encoders
+
+struct bench_bitwriter {
+	dbuf *f;
+	u8 is_lsb;
+	UI nbits_in_bitbuf;
+	u32 bitbuf;
+};
+
+// nbits must be no more than 24.
+static void bw_put(struct bench_bitwriter *bw, u32 code, UI nbits)
+{
+	if(nbits==0) return;
+	code &= (u32)((1U<<nbits)-1);
+	if(bw->is_lsb) {
+		bw->bitbuf |= code << bw->nbits_in_bitbuf;
+		bw->nbits_in_bitbuf += nbits;
+		while(bw->nbits_in_bitbuf>=8) {
+			dbuf_writebyte(bw->f, (u8)(bw->bitbuf & 0xff));
+			bw->bitbuf >>= 8;
+			bw->nbits_in_bitbuf -= 8;
+		}
+	}
+	else {
+		bw->bitbuf = (bw->bitbuf << nbits) | code;
+		bw->nbits_in_bitbuf += nbits;
+		while(bw->nbits_in_bitbuf>=8) {
+			dbuf_writebyte(bw->f, (u8)(bw->bitbuf >> (bw->nbits_in_bitbuf-8)));
+			bw->nbits_in_bitbuf -= 8;
+		}
+		bw->bitbuf &= (u32)((1U<<bw->nbits_in_bitbuf)-1);
+	}
+}
+
+static void bw_flush(struct bench_bitwriter *bw)
+{
+	if(bw->nbits_in_bitbuf>0) {
+		bw_put(bw, 0, 8-bw->nbits_in_bitbuf);
+	}
+}
+
+///////////////////////////////////
+// Deflate
+
+static void enc_deflate(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	struct fmtutil_tdefl_ctx *tdctx;
+
+	tdctx = fmtutil_tdefl_create(bctx->c, outf,
+		fmtutil_tdefl_create_comp_flags_from_zip_params(6, -15, 0));
+	fmtutil_tdefl_compress_buffer(tdctx, src, (size_t)len, FMTUTIL_TDEFL_FINISH);
+	fmtutil_tdefl_destroy(tdctx);
+}
+
+static void dec_deflate_miniz(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	struct de_deflate_params deflparams;
+
+	de_zeromem(&deflparams, sizeof(struct de_deflate_params));
+	bctx->c->deflate_decoder_id = 1;
+	fmtutil_deflate_codectype1(bctx->c, dcmpri, dcmpro, dres, (void*)&deflparams);
+}
+
+static void dec_deflate_native(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	struct de_deflate_params deflparams;
+
+	de_zeromem(&deflparams, sizeof(struct de_deflate_params));
+	bctx->c->deflate_decoder_id = 2;
+	fmtutil_deflate_codectype1(bctx->c, dcmpri, dcmpro, dres, (void*)&deflparams);
+}
+
+///////////////////////////////////
+// LZW
+
+struct bench_lzw_enc {
+	UI min_codesize;
+	UI max_codesize;
+	UI first_dyn_code;
+	UI clear_code; // 0 = none
+	UI eoi_code; // 0 = none
+	u8 unixcompress_padding;
+
+	struct bench_bitwriter bw;
+	UI curr_codesize;
+	UI next_code; // The next code the encoder will assign
+	UI dec_free_code; // The next code the decoder will assign
+	UI ncodes_since_clear;
+	UI ncodes_in_bitgroup;
+	// Dictionary, indexed by hash of (parent code, byte value)
+	u32 *ht_key;
+	u16 *ht_code;
+};
+
+#define BENCH_LZW_HT_SIZE (1<<18)
+
+static void lzwenc_reset_dict(struct bench_lzw_enc *e)
+{
+	de_memset(e->ht_key, 0xff, BENCH_LZW_HT_SIZE*sizeof(u32));
+	e->next_code = e->first_dyn_code;
+	e->dec_free_code = e->first_dyn_code;
+	e->curr_codesize = e->min_codesize;
+	e->ncodes_since_clear = 0;
+}
+
+static void lzwenc_end_bitgroup(struct bench_lzw_enc *e)
+{
+	if(!e->unixcompress_padding) return;
+	while(e->ncodes_in_bitgroup%8 != 0) {
+		bw_put(&e->bw, 0, e->curr_codesize);
+		e->ncodes_in_bitgroup++;
+	}
+	e->ncodes_in_bitgroup = 0;
+}
+
+// Emit a code, and track what the decoder will do with its code size.
+static void lzwenc_emit(struct bench_lzw_enc *e, UI code)
+{
+	bw_put(&e->bw, code, e->curr_codesize);
+	e->ncodes_in_bitgroup++;
+	if(e->clear_code && code==e->clear_code) {
+		lzwenc_end_bitgroup(e);
+		return;
+	}
+
+	e->ncodes_since_clear++;
+	// The decoder adds a dictionary entry after every code except the first.
+	if(e->ncodes_since_clear>=2 && e->dec_free_code < (1U<<e->max_codesize)) {
+		e->dec_free_code++;
+		if(e->dec_free_code > (1U<<e->curr_codesize)-1) {
+			lzwenc_end_bitgroup(e);
+			if(e->curr_codesize < e->max_codesize) {
+				e->curr_codesize++;
+			}
+		}
+	}
+}
+
+static u32 lzwenc_hash(u32 key)
+{
+	return (key * 2654435761U) >> (32-18);
+}
+
+static void lzw_encode_main(struct benchctx *bctx, struct bench_lzw_enc *e,
+	const u8 *src, i64 len)
+{
+	i64 pos;
+	UI prefix;
+
+	e->ht_key = de_mallocarray(bctx->c, BENCH_LZW_HT_SIZE, sizeof(u32));
+	e->ht_code = de_mallocarray(bctx->c, BENCH_LZW_HT_SIZE, sizeof(u16));
+	lzwenc_reset_dict(e);
+	if(e->clear_code) {
+		lzwenc_emit(e, e->clear_code);
+	}
+	if(len<1) goto done;
+
+	prefix = src[0];
+	for(pos=1; pos<len; pos++) {
+		u32 key;
+		u32 h;
+
+		key = ((u32)prefix << 8) | src[pos];
+		h = lzwenc_hash(key);
+		while(e->ht_key[h]!=0xffffffffU && e->ht_key[h]!=key) {
+			h = (h+1) & (BENCH_LZW_HT_SIZE-1);
+		}
+		if(e->ht_key[h]==key) {
+			prefix = e->ht_code[h];
+			continue;
+		}
+
+		lzwenc_emit(e, prefix);
+		if(e->next_code < (1U<<e->max_codesize)) {
+			e->ht_key[h] = key;
+			e->ht_code[h] = (u16)e->next_code;
+			e->next_code++;
+		}
+		else if(e->clear_code) {
+			lzwenc_emit(e, e->clear_code);
+			lzwenc_reset_dict(e);
+		}
+		prefix = src[pos];
+	}
+	lzwenc_emit(e, prefix);
+
+done:
+	if(e->eoi_code) {
+		bw_put(&e->bw, e->eoi_code, e->curr_codesize);
+	}
+	bw_flush(&e->bw);
+	de_free(bctx->c, e->ht_key);
+	de_free(bctx->c, e->ht_code);
+}
+
+static void enc_lzw_unixcompress(struct benchctx *bctx, const u8 *src, i64 len,
+	dbuf *outf)
+{
+	struct bench_lzw_enc e;
+
+	de_zeromem(&e, sizeof(struct bench_lzw_enc));
+	dbuf_writebyte(outf, 0x1f);
+	dbuf_writebyte(outf, 0x9d);
+	dbuf_writebyte(outf, 0x90); // Block mode, 16-bit max code size
+	e.bw.f = outf;
+	e.bw.is_lsb = 1;
+	e.min_codesize = 9;
+	e.max_codesize = 16;
+	e.first_dyn_code = 257;
+	e.unixcompress_padding = 1;
+	lzw_encode_main(bctx, &e, src, len);
+}
+
+static void dec_lzw_unixcompress(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	struct de_lzw_params delzwp;
+
+	de_zeromem(&delzwp, sizeof(struct de_lzw_params));
+	delzwp.fmt = DE_LZWFMT_UNIXCOMPRESS;
+	delzwp.flags |= DE_LZWFLAG_HAS3BYTEHEADER;
+	fmtutil_decompress_lzw(bctx->c, dcmpri, dcmpro, dres, &delzwp);
+}
+
+static void enc_lzw_gif(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	struct bench_lzw_enc e;
+
+	de_zeromem(&e, sizeof(struct bench_lzw_enc));
+	e.bw.f = outf;
+	e.bw.is_lsb = 1;
+	e.min_codesize = 9;
+	e.max_codesize = 12;
+	e.clear_code = 256;
+	e.eoi_code = 257;
+	e.first_dyn_code = 258;
+	lzw_encode_main(bctx, &e, src, len);
+}
+
+static void dec_lzw_gif(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	struct de_lzw_params delzwp;
+
+	de_zeromem(&delzwp, sizeof(struct de_lzw_params));
+	delzwp.fmt = DE_LZWFMT_GIF;
+	delzwp.gif_root_code_size = 8;
+	fmtutil_decompress_lzw(bctx->c, dcmpri, dcmpro, dres, &delzwp);
+}
+
+///////////////////////////////////
+// LZSS (Okumura-style, as used by fmtutil_lzss1_codectype1)
+
+#define BENCH_LZSS_N 4096
+#define BENCH_LZSS_F 18
+#define BENCH_LZSS_HASHSIZE 4096
+
+static void enc_lzss(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	i64 *hash_head;
+	i64 pos = 0;
+	u8 unitbuf[1+8*2];
+	size_t unitbuf_len = 1;
+	UI nitems = 0;
+
+	hash_head = de_mallocarray(bctx->c, BENCH_LZSS_HASHSIZE, sizeof(i64));
+	de_memset(hash_head, 0xff, BENCH_LZSS_HASHSIZE*sizeof(i64));
+	unitbuf[0] = 0;
+
+	// Greedy matching, using only the most recent position with the same
+	// 3-byte hash. The ring buffer position of source byte N is
+	// (N + N_4096 - 18) % 4096.
+	while(pos < len) {
+		i64 matchlen = 0;
+		i64 candpos = -1;
+
+		if(pos+3 <= len) {
+			UI h;
+
+			h = (((UI)src[pos]<<8) ^ ((UI)src[pos+1]<<4) ^ (UI)src[pos+2]) % BENCH_LZSS_HASHSIZE;
+			candpos = hash_head[h];
+			hash_head[h] = pos;
+			if(candpos>=0 && pos-candpos <= BENCH_LZSS_N-BENCH_LZSS_F) {
+				i64 maxlen = de_min_int(BENCH_LZSS_F, len-pos);
+
+				while(matchlen<maxlen && src[candpos+matchlen]==src[pos+matchlen]) {
+					matchlen++;
+				}
+			}
+		}
+
+		if(matchlen>=3) {
+			UI rpos = (UI)((candpos + BENCH_LZSS_N - BENCH_LZSS_F) % BENCH_LZSS_N);
+
+			unitbuf[unitbuf_len++] = (u8)(rpos & 0xff);
+			unitbuf[unitbuf_len++] = (u8)(((rpos>>4)&0xf0) | (UI)(matchlen-3));
+			pos += matchlen;
+		}
+		else {
+			unitbuf[0] |= (u8)(1U<<nitems);
+			unitbuf[unitbuf_len++] = src[pos];
+			pos++;
+		}
+
+		nitems++;
+		if(nitems==8) {
+			dbuf_write(outf, unitbuf, (i64)unitbuf_len);
+			unitbuf[0] = 0;
+			unitbuf_len = 1;
+			nitems = 0;
+		}
+	}
+	if(nitems>0) {
+		dbuf_write(outf, unitbuf, (i64)unitbuf_len);
+	}
+
+	de_free(bctx->c, hash_head);
+}
+
+static void dec_lzss(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	struct de_lzss1_params lzssparams;
+
+	de_zeromem(&lzssparams, sizeof(struct de_lzss1_params));
+	fmtutil_lzss1_codectype1(bctx->c, dcmpri, dcmpro, dres, (void*)&lzssparams);
+}
+
+///////////////////////////////////
+// Squeeze (CP/M & ARC-style Huffman)
+
+#define BENCH_SQ_NSYMS 257
+
+static void enc_squeeze(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	i64 freq[BENCH_SQ_NSYMS];
+	// "items" are the roots of the trees still being merged. Each item is a
+	// dval: <0 for a leaf, >=0 for a temporary internal node number.
+	int items[BENCH_SQ_NSYMS];
+	i64 item_weight[BENCH_SQ_NSYMS];
+	int nitems = 0;
+	int tmpnodes[BENCH_SQ_NSYMS][2];
+	int ntmpnodes = 0;
+	u64 code[BENCH_SQ_NSYMS];
+	UI code_nbits[BENCH_SQ_NSYMS];
+	struct bench_bitwriter bw;
+	int i;
+	i64 k;
+
+	de_zeromem(freq, sizeof(freq));
+	for(k=0; k<len; k++) {
+		freq[src[k]]++;
+	}
+	freq[256] = 1; // STOP code
+
+	for(i=0; i<BENCH_SQ_NSYMS; i++) {
+		if(freq[i]==0) continue;
+		items[nitems] = -(i+1);
+		item_weight[nitems] = freq[i];
+		nitems++;
+	}
+
+	// Repeatedly combine the two lightest items.
+	while(nitems>1) {
+		int m[2];
+		int n;
+
+		for(n=0; n<2; n++) {
+			int j;
+
+			m[n] = -1;
+			for(j=0; j<nitems; j++) {
+				if(n==1 && j==m[0]) continue;
+				if(m[n]<0 || item_weight[j]<item_weight[m[n]]) m[n] = j;
+			}
+		}
+
+		tmpnodes[ntmpnodes][0] = items[m[0]];
+		tmpnodes[ntmpnodes][1] = items[m[1]];
+		items[m[0]] = ntmpnodes;
+		item_weight[m[0]] += item_weight[m[1]];
+		ntmpnodes++;
+		items[m[1]] = items[nitems-1];
+		item_weight[m[1]] = item_weight[nitems-1];
+		nitems--;
+	}
+
+	// The decoder starts at node 0, so renumber the nodes in reverse order,
+	// making the last node created (the root) node 0.
+	dbuf_writeu16le(outf, (i64)ntmpnodes);
+	for(i=ntmpnodes-1; i>=0; i--) {
+		int n;
+
+		for(n=0; n<2; n++) {
+			int dval = tmpnodes[i][n];
+
+			if(dval>=0) dval = ntmpnodes-1-dval;
+			dbuf_writei16le(outf, (i64)dval);
+		}
+	}
+
+	// Derive each symbol's code. Bit 0 of the code is the first branch taken.
+	de_zeromem(code_nbits, sizeof(code_nbits));
+	{
+		u64 node_code[BENCH_SQ_NSYMS];
+		UI node_nbits[BENCH_SQ_NSYMS];
+
+		node_code[ntmpnodes-1] = 0;
+		node_nbits[ntmpnodes-1] = 0;
+		for(i=ntmpnodes-1; i>=0; i--) {
+			int n;
+
+			for(n=0; n<2; n++) {
+				int dval = tmpnodes[i][n];
+				u64 cc = node_code[i] | ((u64)n << node_nbits[i]);
+
+				if(dval>=0) {
+					node_code[dval] = cc;
+					node_nbits[dval] = node_nbits[i]+1;
+				}
+				else {
+					code[-dval-1] = cc;
+					code_nbits[-dval-1] = node_nbits[i]+1;
+				}
+			}
+		}
+	}
+
+	de_zeromem(&bw, sizeof(struct bench_bitwriter));
+	bw.f = outf;
+	bw.is_lsb = 1;
+	for(k=0; k<=len; k++) {
+		UI sym = (k<len) ? (UI)src[k] : 256;
+		u64 cc = code[sym];
+		UI nbits_left = code_nbits[sym];
+
+		while(nbits_left>0) {
+			UI n = (nbits_left>16) ? 16 : nbits_left;
+
+			bw_put(&bw, (u32)(cc & 0xffff), n);
+			cc >>= n;
+			nbits_left -= n;
+		}
+	}
+	bw_flush(&bw);
+}
+
+static void dec_squeeze(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	fmtutil_huff_squeeze_codectype1(bctx->c, dcmpri, dcmpro, dres, NULL);
+}
+
+///////////////////////////////////
+// Helpers for the LZ77+Huffman encoders
+
+// A greedy LZ77 match finder, using hash chains.
+#define BENCH_LZ77_HASHSIZE (1<<15)
+
+struct bench_lz77 {
+	i64 window_size; // Must be a power of 2. Max distance is window_size-1.
+	i64 max_len;
+	UI max_chain;
+	i64 *head; // [BENCH_LZ77_HASHSIZE]
+	i64 *prev; // [window_size]
+};
+
+static void lz77_create(struct benchctx *bctx, struct bench_lz77 *m,
+	i64 window_size, i64 max_len)
+{
+	de_zeromem(m, sizeof(struct bench_lz77));
+	m->window_size = window_size;
+	m->max_len = max_len;
+	m->max_chain = 32;
+	m->head = de_mallocarray(bctx->c, BENCH_LZ77_HASHSIZE, sizeof(i64));
+	m->prev = de_mallocarray(bctx->c, window_size, sizeof(i64));
+	de_memset(m->head, 0xff, BENCH_LZ77_HASHSIZE*sizeof(i64));
+	de_memset(m->prev, 0xff, (size_t)window_size*sizeof(i64));
+}
+
+static void lz77_destroy(struct benchctx *bctx, struct bench_lz77 *m)
+{
+	de_free(bctx->c, m->head);
+	de_free(bctx->c, m->prev);
+}
+
+static UI lz77_hash(const u8 *p)
+{
+	u32 key = ((u32)p[0]<<16) | ((u32)p[1]<<8) | (u32)p[2];
+
+	return (UI)((key * 2654435761U) >> (32-15));
+}
+
+// Call for every position, in order, after looking for a match there.
+static void lz77_insert(struct bench_lz77 *m, const u8 *src, i64 pos, i64 len)
+{
+	UI h;
+
+	if(pos+3 > len) return;
+	h = lz77_hash(&src[pos]);
+	m->prev[pos & (m->window_size-1)] = m->head[h];
+	m->head[h] = pos;
+}
+
+// Returns the length of the longest match (0 if less than 3) found at pos.
+static i64 lz77_find_match(struct bench_lz77 *m, const u8 *src, i64 pos, i64 len,
+	i64 *pdist)
+{
+	i64 maxlen = de_min_int(m->max_len, len-pos);
+	i64 best = 0;
+	i64 cand;
+	UI nchain = 0;
+
+	if(maxlen<3) return 0;
+	cand = m->head[lz77_hash(&src[pos])];
+	while(cand>=0 && pos-cand < m->window_size && nchain<m->max_chain) {
+		i64 prevcand;
+
+		if(src[cand+best]==src[pos+best]) {
+			i64 n = 0;
+
+			while(n<maxlen && src[cand+n]==src[pos+n]) n++;
+			if(n>best) {
+				best = n;
+				*pdist = pos-cand;
+				if(best>=maxlen) break;
+			}
+		}
+
+		// The prev[] slot may have been reused by a newer position.
+		prevcand = m->prev[cand & (m->window_size-1)];
+		if(prevcand>=cand) break;
+		cand = prevcand;
+		nchain++;
+	}
+	return (best>=3) ? best : 0;
+}
+
+#define BENCH_HUFF_MAX_SYMS 512
+
+// Make Huffman code lengths, no longer than maxlen, for the symbols with
+// nonzero frequency. If there's only one such symbol, its length is 1.
+static void huff_make_lengths(const i64 *freq, UI nsyms, UI maxlen, u8 *lens)
+{
+	i64 f[BENCH_HUFF_MAX_SYMS];
+	i64 weight[2*BENCH_HUFF_MAX_SYMS];
+	UI parent[2*BENCH_HUFF_MAX_SYMS];
+	UI depth[2*BENCH_HUFF_MAX_SYMS];
+	// The roots of the trees still being merged. Node numbers below nsyms are
+	// leaves (symbols); the rest are internal nodes.
+	UI items[BENCH_HUFF_MAX_SYMS];
+	UI s;
+
+	for(s=0; s<nsyms; s++) {
+		f[s] = freq[s];
+	}
+
+	while(1) {
+		UI nitems = 0;
+		UI nnodes = nsyms;
+		UI maxdepth = 0;
+		UI k;
+
+		de_zeromem(lens, nsyms);
+		for(s=0; s<nsyms; s++) {
+			if(f[s]<1) continue;
+			weight[s] = f[s];
+			items[nitems++] = s;
+		}
+		if(nitems==0) return;
+		if(nitems==1) {
+			lens[items[0]] = 1;
+			return;
+		}
+
+		// Repeatedly combine the two lightest items.
+		while(nitems>1) {
+			UI m[2];
+			UI n;
+
+			for(n=0; n<2; n++) {
+				UI j;
+
+				m[n] = nitems;
+				for(j=0; j<nitems; j++) {
+					if(n==1 && j==m[0]) continue;
+					if(m[n]==nitems || weight[items[j]]<weight[items[m[n]]]) m[n] = j;
+				}
+			}
+
+			weight[nnodes] = weight[items[m[0]]] + weight[items[m[1]]];
+			parent[items[m[0]]] = nnodes;
+			parent[items[m[1]]] = nnodes;
+			items[m[0]] = nnodes;
+			nnodes++;
+			items[m[1]] = items[nitems-1];
+			nitems--;
+		}
+
+		// A node's parent is always created after it, so the last node is the root.
+		depth[nnodes-1] = 0;
+		for(k=nnodes-1; k>nsyms; k--) {
+			depth[k-1] = depth[parent[k-1]] + 1;
+		}
+		for(s=0; s<nsyms; s++) {
+			if(f[s]<1) continue;
+			lens[s] = (u8)(depth[parent[s]] + 1);
+			if(lens[s]>maxdepth) maxdepth = lens[s];
+		}
+		if(maxdepth<=maxlen) return;
+
+		// Too long. Flatten the distribution, and try again.
+		for(s=0; s<nsyms; s++) {
+			if(f[s]>0) f[s] = (f[s]+1)/2;
+		}
+	}
+}
+
+// Number of symbols with a nonzero length. If it's exactly 1, *psym is set
+// to that symbol.
+static UI huff_count_used(const u8 *lens, UI nsyms, UI *psym)
+{
+	UI count = 0;
+	UI s;
+
+	for(s=0; s<nsyms; s++) {
+		if(lens[s]) {
+			*psym = s;
+			count++;
+		}
+	}
+	return count;
+}
+
+// Write a Huffman code, first bit first. (The decoders read codes one bit at
+// a time, with the first bit read being the code's most significant bit.)
+static void bw_put_huffcode(struct bench_bitwriter *bw, u32 code, UI nbits)
+{
+	if(bw->is_lsb) {
+		u32 rev = 0;
+		UI i;
+
+		for(i=0; i<nbits; i++) {
+			rev = (rev<<1) | ((code>>i) & 1);
+		}
+		code = rev;
+	}
+	bw_put(bw, code, nbits);
+}
+
+///////////////////////////////////
+// LH5, LH6, LH7 (LHA)
+
+#define BENCH_LH_NC 510 // literals & match lengths
+#define BENCH_LH_NT 19 // code-lengths tree
+#define BENCH_LH_MAX_NP 17 // offsets
+#define BENCH_LH_BLOCK_NCODES 16384
+
+struct bench_lh_enc {
+	UI np;
+	UI pbit;
+	struct bench_bitwriter bw;
+	UI nitems;
+	u16 item_code[BENCH_LH_BLOCK_NCODES];
+	u16 item_offset[BENCH_LH_BLOCK_NCODES];
+};
+
+// Canonical codes, as in Deflate: shorter codes first, then by symbol.
+static void lh_make_codes(const u8 *lens, UI nsyms, u32 *codes)
+{
+	u32 code = 0;
+	UI symlen;
+	UI s;
+
+	for(symlen=1; symlen<=16; symlen++) {
+		for(s=0; s<nsyms; s++) {
+			if(lens[s]==symlen) codes[s] = code++;
+		}
+		code <<= 1;
+	}
+}
+
+static UI lh_offset_code(UI offset)
+{
+	UI n = 0;
+
+	while(offset) {
+		n++;
+		offset >>= 1;
+	}
+	return n;
+}
+
+static void lh_put_codelen(struct bench_bitwriter *bw, UI symlen)
+{
+	UI i;
+
+	if(symlen<7) {
+		bw_put(bw, symlen, 3);
+		return;
+	}
+	bw_put(bw, 7, 3);
+	for(i=7; i<symlen; i++) {
+		bw_put(bw, 1, 1);
+	}
+	bw_put(bw, 0, 1);
+}
+
+// Writes the number of lengths, then the lengths, in the format of the
+// code-lengths and offsets trees. A tree with only one symbol is written as
+// a "0" count followed by that symbol, and its code length becomes 0.
+static void lh_put_simple_tree(struct bench_bitwriter *bw, u8 *lens, UI nsyms,
+	UI nbits_field, int has_special_skip)
+{
+	UI n;
+	UI i;
+	UI sym = 0;
+
+	if(huff_count_used(lens, nsyms, &sym)<=1) {
+		bw_put(bw, 0, nbits_field);
+		bw_put(bw, sym, nbits_field);
+		lens[sym] = 0;
+		return;
+	}
+
+	n = nsyms;
+	while(lens[n-1]==0) n--;
+	bw_put(bw, n, nbits_field);
+	i = 0;
+	while(i<n) {
+		lh_put_codelen(bw, lens[i]);
+		i++;
+		if(i==3 && has_special_skip) {
+			UI nzeros = 0;
+
+			while(nzeros<3 && i+nzeros<n && lens[i+nzeros]==0) nzeros++;
+			bw_put(bw, nzeros, 2);
+			i += nzeros;
+		}
+	}
+}
+
+static void lh_write_block(struct bench_lh_enc *e)
+{
+	i64 c_freq[BENCH_LH_NC];
+	i64 p_freq[BENCH_LH_MAX_NP];
+	i64 t_freq[BENCH_LH_NT];
+	u8 c_len[BENCH_LH_NC];
+	u8 p_len[BENCH_LH_MAX_NP];
+	u8 t_len[BENCH_LH_NT];
+	u32 c_code[BENCH_LH_NC];
+	u32 p_code[BENCH_LH_MAX_NP];
+	u32 t_code[BENCH_LH_NT];
+	// The literals tree's code lengths, as (code-lengths tree symbol, number
+	// of extra bits, extra bits) tokens
+	u8 tok_sym[2*BENCH_LH_NC];
+	u8 tok_nbits[2*BENCH_LH_NC];
+	u16 tok_val[2*BENCH_LH_NC];
+	UI ntoks = 0;
+	UI c_n;
+	UI c_sym = 0;
+	UI i;
+
+	de_zeromem(c_freq, sizeof(c_freq));
+	de_zeromem(p_freq, sizeof(p_freq));
+	de_zeromem(t_freq, sizeof(t_freq));
+	for(i=0; i<e->nitems; i++) {
+		c_freq[e->item_code[i]]++;
+		if(e->item_code[i]>=256) {
+			p_freq[lh_offset_code(e->item_offset[i])]++;
+		}
+	}
+	huff_make_lengths(c_freq, BENCH_LH_NC, 16, c_len);
+	huff_make_lengths(p_freq, e->np, 16, p_len);
+
+	bw_put(&e->bw, e->nitems, 16);
+
+	if(huff_count_used(c_len, BENCH_LH_NC, &c_sym)==1) {
+		// Only one literal/length symbol. The code-lengths tree isn't used.
+		bw_put(&e->bw, 0, 5);
+		bw_put(&e->bw, 0, 5);
+		bw_put(&e->bw, 0, 9);
+		bw_put(&e->bw, c_sym, 9);
+		c_len[c_sym] = 0;
+	}
+	else {
+		c_n = BENCH_LH_NC;
+		while(c_len[c_n-1]==0) c_n--;
+
+		i = 0;
+		while(i<c_n) {
+			UI nzeros = 0;
+
+			if(c_len[i]) {
+				tok_sym[ntoks] = c_len[i]+2;
+				tok_nbits[ntoks++] = 0;
+				i++;
+				continue;
+			}
+
+			while(i+nzeros<c_n && c_len[i+nzeros]==0) nzeros++;
+			i += nzeros;
+			if(nzeros==19) {
+				tok_sym[ntoks] = 0;
+				tok_nbits[ntoks++] = 0;
+				nzeros--;
+			}
+			if(nzeros<=2) {
+				while(nzeros--) {
+					tok_sym[ntoks] = 0;
+					tok_nbits[ntoks++] = 0;
+				}
+			}
+			else if(nzeros<=18) {
+				tok_sym[ntoks] = 1;
+				tok_nbits[ntoks] = 4;
+				tok_val[ntoks++] = (u16)(nzeros-3);
+			}
+			else {
+				tok_sym[ntoks] = 2;
+				tok_nbits[ntoks] = 9;
+				tok_val[ntoks++] = (u16)(nzeros-20);
+			}
+		}
+
+		for(i=0; i<ntoks; i++) {
+			t_freq[tok_sym[i]]++;
+		}
+		huff_make_lengths(t_freq, BENCH_LH_NT, 16, t_len);
+		lh_put_simple_tree(&e->bw, t_len, BENCH_LH_NT, 5, 1);
+		lh_make_codes(t_len, BENCH_LH_NT, t_code);
+
+		bw_put(&e->bw, c_n, 9);
+		for(i=0; i<ntoks; i++) {
+			bw_put_huffcode(&e->bw, t_code[tok_sym[i]], t_len[tok_sym[i]]);
+			bw_put(&e->bw, tok_val[i], tok_nbits[i]);
+		}
+	}
+	lh_make_codes(c_len, BENCH_LH_NC, c_code);
+
+	lh_put_simple_tree(&e->bw, p_len, e->np, e->pbit, 0);
+	lh_make_codes(p_len, e->np, p_code);
+
+	for(i=0; i<e->nitems; i++) {
+		UI code = e->item_code[i];
+
+		bw_put_huffcode(&e->bw, c_code[code], c_len[code]);
+		if(code>=256) {
+			UI offset = e->item_offset[i];
+			UI ocode = lh_offset_code(offset);
+
+			bw_put_huffcode(&e->bw, p_code[ocode], p_len[ocode]);
+			if(ocode>1) {
+				bw_put(&e->bw, offset, ocode-1);
+			}
+		}
+	}
+
+	e->nitems = 0;
+}
+
+static void lh_encode_main(struct benchctx *bctx, const u8 *src, i64 len,
+	dbuf *outf, UI dicbit, UI pbit)
+{
+	struct bench_lh_enc *e;
+	struct bench_lz77 m;
+	i64 pos = 0;
+
+	e = de_malloc(bctx->c, sizeof(struct bench_lh_enc));
+	e->np = dicbit+1;
+	e->pbit = pbit;
+	e->bw.f = outf;
+	lz77_create(bctx, &m, (i64)1<<dicbit, 256);
+
+	while(pos<len) {
+		i64 dist = 0;
+		i64 matchlen;
+		i64 k;
+
+		matchlen = lz77_find_match(&m, src, pos, len, &dist);
+		if(matchlen) {
+			e->item_code[e->nitems] = (u16)(matchlen+253);
+			e->item_offset[e->nitems] = (u16)(dist-1);
+		}
+		else {
+			matchlen = 1;
+			e->item_code[e->nitems] = src[pos];
+		}
+		e->nitems++;
+		for(k=0; k<matchlen; k++) {
+			lz77_insert(&m, src, pos+k, len);
+		}
+		pos += matchlen;
+
+		if(e->nitems==BENCH_LH_BLOCK_NCODES) {
+			lh_write_block(e);
+		}
+	}
+	if(e->nitems>0) {
+		lh_write_block(e);
+	}
+	bw_flush(&e->bw);
+
+	lz77_destroy(bctx, &m);
+	de_free(bctx->c, e);
+}
+
+static void enc_lh5(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	lh_encode_main(bctx, src, len, outf, 13, 4);
+}
+
+static void enc_lh6(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	lh_encode_main(bctx, src, len, outf, 15, 5);
+}
+
+static void enc_lh7(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	lh_encode_main(bctx, src, len, outf, 16, 5);
+}
+
+static void dec_lh5x_main(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres, int fmt)
+{
+	struct de_lh5x_params lzhparams;
+
+	de_zeromem(&lzhparams, sizeof(struct de_lh5x_params));
+	lzhparams.fmt = fmt;
+	lzhparams.history_fill_val = 0x20;
+	fmtutil_decompress_lh5x(bctx->c, dcmpri, dcmpro, dres, &lzhparams);
+}
+
+static void dec_lh5(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	dec_lh5x_main(bctx, dcmpri, dcmpro, dres, DE_LH5X_FMT_LH5);
+}
+
+static void dec_lh6(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	dec_lh5x_main(bctx, dcmpri, dcmpro, dres, DE_LH5X_FMT_LH6);
+}
+
+static void dec_lh7(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	dec_lh5x_main(bctx, dcmpri, dcmpro, dres, DE_LH5X_FMT_LH7);
+}
+
+///////////////////////////////////
+// Implode (ZIP method 6), with an 8K dictionary and 3 trees
+
+#define BENCH_IMPLODE_FLAGS 0x0006
+#define BENCH_IMPLODE_MIN_LEN 3
+#define BENCH_IMPLODE_MAX_LEN (BENCH_IMPLODE_MIN_LEN+63+255)
+
+// The codes are assigned starting with the longest, and the highest symbol.
+// This mirrors the decoder's "left-aligned branches" canonical tree.
+static void implode_make_codes(const u8 *lens, UI nsyms, u32 *codes)
+{
+	u32 prev_code = 0;
+	UI prev_len = 0;
+	UI count = 0;
+	UI symlen;
+
+	for(symlen=16; symlen>=1; symlen--) {
+		UI s;
+
+		for(s=nsyms; s>0; s--) {
+			if(lens[s-1]!=symlen) continue;
+			if(count==0) {
+				codes[s-1] = 0;
+			}
+			else {
+				codes[s-1] = (prev_code>>(prev_len-symlen)) + 1;
+			}
+			prev_code = codes[s-1];
+			prev_len = symlen;
+			count++;
+		}
+	}
+}
+
+// Every symbol must have a code, and the lengths are stored as byte-aligned
+// run-length encoded (count, length) pairs.
+static void implode_make_tree(i64 *freq, UI nsyms, u8 *lens, u32 *codes, dbuf *outf)
+{
+	u8 rlebuf[256];
+	UI nrle = 0;
+	UI s;
+
+	for(s=0; s<nsyms; s++) {
+		freq[s]++;
+	}
+	huff_make_lengths(freq, nsyms, 16, lens);
+	implode_make_codes(lens, nsyms, codes);
+
+	s = 0;
+	while(s<nsyms) {
+		UI n = 1;
+
+		while(s+n<nsyms && n<16 && lens[s+n]==lens[s]) n++;
+		rlebuf[nrle++] = (u8)(((n-1)<<4) | (lens[s]-1));
+		s += n;
+	}
+	dbuf_writebyte(outf, (u8)(nrle-1));
+	dbuf_write(outf, rlebuf, (i64)nrle);
+}
+
+static void enc_implode(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	struct bench_lz77 m;
+	struct bench_bitwriter bw;
+	// For each item: a literal byte value (and matchlen==0), or a match
+	u8 *item_lit;
+	u16 *item_matchlen;
+	u16 *item_offset;
+	i64 nitems = 0;
+	i64 lit_freq[256];
+	i64 len_freq[64];
+	i64 dist_freq[64];
+	u8 lit_len[256];
+	u8 len_len[64];
+	u8 dist_len[64];
+	u32 lit_code[256];
+	u32 len_code[64];
+	u32 dist_code[64];
+	i64 pos = 0;
+	i64 i;
+
+	item_lit = de_malloc(bctx->c, len);
+	item_matchlen = de_mallocarray(bctx->c, len, sizeof(u16));
+	item_offset = de_mallocarray(bctx->c, len, sizeof(u16));
+	de_zeromem(lit_freq, sizeof(lit_freq));
+	de_zeromem(len_freq, sizeof(len_freq));
+	de_zeromem(dist_freq, sizeof(dist_freq));
+
+	lz77_create(bctx, &m, 8192, BENCH_IMPLODE_MAX_LEN);
+	while(pos<len) {
+		i64 dist = 0;
+		i64 matchlen;
+		i64 k;
+
+		matchlen = lz77_find_match(&m, src, pos, len, &dist);
+		if(matchlen) {
+			item_matchlen[nitems] = (u16)matchlen;
+			item_offset[nitems] = (u16)(dist-1);
+			len_freq[de_min_int(matchlen-BENCH_IMPLODE_MIN_LEN, 63)]++;
+			dist_freq[(dist-1)>>7]++;
+		}
+		else {
+			matchlen = 1;
+			item_lit[nitems] = src[pos];
+			lit_freq[src[pos]]++;
+		}
+		nitems++;
+		for(k=0; k<matchlen; k++) {
+			lz77_insert(&m, src, pos+k, len);
+		}
+		pos += matchlen;
+	}
+	lz77_destroy(bctx, &m);
+
+	implode_make_tree(lit_freq, 256, lit_len, lit_code, outf);
+	implode_make_tree(len_freq, 64, len_len, len_code, outf);
+	implode_make_tree(dist_freq, 64, dist_len, dist_code, outf);
+
+	de_zeromem(&bw, sizeof(struct bench_bitwriter));
+	bw.f = outf;
+	bw.is_lsb = 1;
+	for(i=0; i<nitems; i++) {
+		UI matchlen = item_matchlen[i];
+		UI offset;
+		UI lcode;
+
+		if(matchlen==0) {
+			bw_put(&bw, 1, 1);
+			bw_put_huffcode(&bw, lit_code[item_lit[i]], lit_len[item_lit[i]]);
+			continue;
+		}
+
+		offset = item_offset[i];
+		lcode = (UI)de_min_int(matchlen-BENCH_IMPLODE_MIN_LEN, 63);
+		bw_put(&bw, 0, 1);
+		bw_put(&bw, offset & 0x7f, 7);
+		bw_put_huffcode(&bw, dist_code[offset>>7], dist_len[offset>>7]);
+		bw_put_huffcode(&bw, len_code[lcode], len_len[lcode]);
+		if(lcode==63) {
+			bw_put(&bw, matchlen-BENCH_IMPLODE_MIN_LEN-63, 8);
+		}
+	}
+	bw_flush(&bw);
+
+	de_free(bctx->c, item_lit);
+	de_free(bctx->c, item_matchlen);
+	de_free(bctx->c, item_offset);
+}
+
+static void dec_implode(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	struct de_zipimplode_params implparams;
+
+	de_zeromem(&implparams, sizeof(struct de_zipimplode_params));
+	implparams.bit_flags = BENCH_IMPLODE_FLAGS;
+	fmtutil_decompress_zip_implode(bctx->c, dcmpri, dcmpro, dres, &implparams);
+}
+
+///////////////////////////////////
+// RLE90 & PackBits
+
+static i64 count_run(const u8 *src, i64 pos, i64 len, i64 maxrun)
+{
+	i64 n = 1;
+
+	while(pos+n<len && n<maxrun && src[pos+n]==src[pos]) n++;
+	return n;
+}
+
+static void enc_rle90(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	i64 pos = 0;
+
+	while(pos<len) {
+		u8 b = src[pos];
+		i64 n;
+
+		n = count_run(src, pos, len, 255);
+		dbuf_writebyte(outf, b);
+		if(b==0x90) {
+			dbuf_writebyte(outf, 0x00);
+		}
+		if(n>=3) {
+			dbuf_writebyte(outf, 0x90);
+			dbuf_writebyte(outf, (u8)n);
+		}
+		else {
+			n = 1;
+		}
+		pos += n;
+	}
+}
+
+static void dec_rle90(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	fmtutil_decompress_rle90_ex(bctx->c, dcmpri, dcmpro, dres, 0);
+}
+
+static void enc_packbits(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	i64 pos = 0;
+
+	while(pos<len) {
+		i64 n;
+		i64 litlen;
+
+		n = count_run(src, pos, len, 128);
+		if(n>=3) {
+			dbuf_writebyte(outf, (u8)(257-n));
+			dbuf_writebyte(outf, src[pos]);
+			pos += n;
+			continue;
+		}
+
+		// Literal stretch, up to the next run of 3 or more.
+		litlen = 0;
+		while(pos+litlen<len && litlen<128) {
+			if(count_run(src, pos+litlen, len, 3)>=3) break;
+			litlen++;
+		}
+		dbuf_writebyte(outf, (u8)(litlen-1));
+		dbuf_write(outf, &src[pos], litlen);
+		pos += litlen;
+	}
+}
+
+static void dec_packbits(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	fmtutil_decompress_packbits_ex(bctx->c, dcmpri, dcmpro, dres, NULL);
+}
+
+///////////////////////////////////
+// Fax (Modified Huffman, as in TIFF compression type 2)
+
+// Indices 0-63 are terminating codes for run lengths 0-63. Index 63+n is the
+// makeup code for run length 64*n. Codes up to 13 bits, but the bits before
+// the last 8 are always 0.
+static const u8 bench_fax_whitecodes[91] = {
+	0x35,0x7,0x7,0x8,0xb,0xc,0xe,0xf,0x13,0x14,0x7,0x8,0x8,0x3,0x34,0x35,
+	0x2a,0x2b,0x27,0xc,0x8,0x17,0x3,0x4,0x28,0x2b,0x13,0x24,0x18,0x2,0x3,0x1a,
+	0x1b,0x12,0x13,0x14,0x15,0x16,0x17,0x28,0x29,0x2a,0x2b,0x2c,0x2d,0x4,0x5,0xa,
+	0xb,0x52,0x53,0x54,0x55,0x24,0x25,0x58,0x59,0x5a,0x5b,0x4a,0x4b,0x32,0x33,0x34,
+	0x1b,0x12,0x17,0x37,0x36,0x37,0x64,0x65,0x68,0x67,0xcc,0xcd,0xd2,0xd3,0xd4,0xd5,
+	0xd6,0xd7,0xd8,0xd9,0xda,0xdb,0x98,0x99,0x9a,0x18,0x9b
+};
+static const u8 bench_fax_blackcodes[91] = {
+	0x37,0x2,0x3,0x2,0x3,0x3,0x2,0x3,0x5,0x4,0x4,0x5,0x7,0x4,0x7,0x18,
+	0x17,0x18,0x8,0x67,0x68,0x6c,0x37,0x28,0x17,0x18,0xca,0xcb,0xcc,0xcd,0x68,0x69,
+	0x6a,0x6b,0xd2,0xd3,0xd4,0xd5,0xd6,0xd7,0x6c,0x6d,0xda,0xdb,0x54,0x55,0x56,0x57,
+	0x64,0x65,0x52,0x53,0x24,0x37,0x38,0x27,0x28,0x58,0x59,0x2b,0x2c,0x5a,0x66,0x67,
+	0xf,0xc8,0xc9,0x5b,0x33,0x34,0x35,0x6c,0x6d,0x4a,0x4b,0x4c,0x4d,0x72,0x73,0x74,
+	0x75,0x76,0x77,0x52,0x53,0x54,0x55,0x5a,0x5b,0x64,0x65
+};
+// High 4 bits is the length of the white code.
+// Low 4 bits is the length of the black code.
+static const u8 bench_fax_codelengths[91] = {
+	0x8a,0x63,0x42,0x42,0x43,0x44,0x44,0x45,0x56,0x56,0x57,0x57,0x67,0x68,0x68,0x69,
+	0x6a,0x6a,0x7a,0x7b,0x7b,0x7b,0x7b,0x7b,0x7b,0x7b,0x7c,0x7c,0x7c,0x8c,0x8c,0x8c,
+	0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,
+	0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,
+	0x5a,0x5c,0x6c,0x7c,0x8c,0x8c,0x8c,0x8d,0x8d,0x8d,0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,
+	0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,0x6d,0x9d
+};
+
+static void fax_put_code(struct bench_bitwriter *bw, UI idx, int is_black)
+{
+	if(is_black) {
+		bw_put(bw, bench_fax_blackcodes[idx], bench_fax_codelengths[idx] & 0x0f);
+	}
+	else {
+		bw_put(bw, bench_fax_whitecodes[idx], bench_fax_codelengths[idx] >> 4);
+	}
+}
+
+static void fax_put_run(struct bench_bitwriter *bw, i64 runlen, int is_black)
+{
+	if(runlen>=64) {
+		fax_put_code(bw, 63 + (UI)(runlen/64), is_black);
+	}
+	fax_put_code(bw, (UI)(runlen%64), is_black);
+}
+
+static void enc_fax_mh(struct benchctx *bctx, const u8 *src, i64 len, dbuf *outf)
+{
+	i64 rowspan = (BENCH_FAX_WIDTH+7)/8;
+	struct bench_bitwriter bw;
+	i64 j;
+
+	de_zeromem(&bw, sizeof(struct bench_bitwriter));
+	bw.f = outf;
+	for(j=0; j<len/rowspan; j++) {
+		const u8 *row = &src[j*rowspan];
+		i64 x = 0;
+		int is_black = 0;
+
+		while(1) {
+			i64 x2 = x;
+
+			while(x2<BENCH_FAX_WIDTH &&
+				(((row[x2/8] >> (7-x2%8)) & 1) == (u8)is_black))
+			{
+				x2++;
+			}
+			fax_put_run(&bw, x2-x, is_black);
+			x = x2;
+			if(x>=BENCH_FAX_WIDTH) break;
+			is_black = !is_black;
+		}
+		bw_flush(&bw); // Rows are byte-aligned
+	}
+}
+
+static void dec_fax_mh(struct benchctx *bctx,
+	struct de_dfilter_in_params *dcmpri, struct de_dfilter_out_params *dcmpro,
+	struct de_dfilter_results *dres)
+{
+	struct de_fax34_params fax34params;
+
+	de_zeromem(&fax34params, sizeof(struct de_fax34_params));
+	fax34params.image_width = BENCH_FAX_WIDTH;
+	fax34params.image_height = bctx->fax_height;
+	fax34params.out_rowspan = (BENCH_FAX_WIDTH+7)/8;
+	fax34params.tiff_cmpr_meth = 2;
+	fmtutil_fax34_codectype1(bctx->c, dcmpri, dcmpro, dres, (void*)&fax34params);
+}
+
+///////////////////////////////////
+
+static const struct bench_codec bench_codecs[] = {
+	{ "deflate-miniz",    BENCH_DATA_TEXT,    enc_deflate,          dec_deflate_miniz },
+	{ "deflate-native",   BENCH_DATA_TEXT,    enc_deflate,          dec_deflate_native },
+	{ "lzw-unixcompress", BENCH_DATA_TEXT,    enc_lzw_unixcompress, dec_lzw_unixcompress },
+	{ "lzw-gif",          BENCH_DATA_TEXT,    enc_lzw_gif,          dec_lzw_gif },
+	{ "lzss",             BENCH_DATA_TEXT,    enc_lzss,             dec_lzss },
+	{ "squeeze",          BENCH_DATA_TEXT,    enc_squeeze,          dec_squeeze },
+	{ "lh5",              BENCH_DATA_TEXT,    enc_lh5,              dec_lh5 },
+	{ "lh6",              BENCH_DATA_TEXT,    enc_lh6,              dec_lh6 },
+	{ "lh7",              BENCH_DATA_TEXT,    enc_lh7,              dec_lh7 },
+	{ "implode",          BENCH_DATA_TEXT,    enc_implode,          dec_implode },
+	{ "rle90",            BENCH_DATA_RUNS,    enc_rle90,            dec_rle90 },
+	{ "packbits",         BENCH_DATA_RUNS,    enc_packbits,         dec_packbits },
+	{ "fax-mh",           BENCH_DATA_BILEVEL, enc_fax_mh,           dec_fax_mh }
+};
+
+static struct bench_data *get_data(struct benchctx *bctx, enum bench_data_enum dt)
+{
+	struct bench_data *d = &bctx->data[dt];
+
+	if(d->buf) return d;
+
+	// Each data type has its own seed, so that its contents don't depend on
+	// which codecs were selected.
+	bctx->prng_state = 0x9e3779b9U + (u32)dt*0x1234567U;
+	switch(dt) {
+	case BENCH_DATA_TEXT: gen_text_data(bctx, d); break;
+	case BENCH_DATA_RUNS: gen_runs_data(bctx, d); break;
+	case BENCH_DATA_BILEVEL: gen_bilevel_data(bctx, d); break;
+	default: break;
+	}
+	return d;
+}
+
+static int run_decoder_once(struct benchctx *bctx, const struct bench_codec *bc,
+	dbuf *cmprf, dbuf *outf, i64 unc_len)
+{
+	struct de_dfilter_in_params dcmpri;
+	struct de_dfilter_out_params dcmpro;
+	struct de_dfilter_results dres;
+
+	de_dfilter_init_objects(bctx->c, &dcmpri, &dcmpro, &dres);
+	dcmpri.f = cmprf;
+	dcmpri.pos = 0;
+	dcmpri.len = cmprf->len;
+	dcmpro.f = outf;
+	dcmpro.len_known = 1;
+	dcmpro.expected_len = unc_len;
+
+	dbuf_empty(outf);
+	bc->decode_fn(bctx, &dcmpri, &dcmpro, &dres);
+	if(dres.errcode) {
+		fprintf(stderr, "%s: %s\n", bc->name, de_dfilter_get_errmsg(bctx->c, &dres));
+		return 0;
+	}
+	return 1;
+}
+
+static void run_benchmark(struct benchctx *bctx, const struct bench_codec *bc)
+{
+	struct bench_data *d;
+	dbuf *cmprf = NULL;
+	dbuf *outf = NULL;
+	clock_t t0, t1;
+	double elapsed;
+	i64 iterations = 0;
+	double mbps, nspb;
+	struct de_memacct_struct *ma = bctx->c->memacct;
+	i64 base_allocs, base_bytes;
+
+	d = get_data(bctx, bc->datatype);
+	cmprf = dbuf_create_membuf(bctx->c, 0, 0);
+	bc->encode_fn(bctx, d->buf, d->len, cmprf);
+	outf = dbuf_create_membuf(bctx->c, d->len, 0);
+
+	// The first run is untimed, and checks that the decoder reproduces the
+	// original data.
+	if(!run_decoder_once(bctx, bc, cmprf, outf, d->len)) goto done;
+	if(outf->len!=d->len ||
+		de_memcmp(dbuf_get_membuf_direct_ptr(outf), d->buf, (size_t)d->len))
+	{
+		fprintf(stderr, "%s: decompressed data does not match original "
+			"(%"I64_FMT" bytes, expected %"I64_FMT")\n", bc->name, outf->len, d->len);
+		goto done;
+	}
+
+	// Memory in use now (the data buffers) is not counted as the decoder's.
+	base_allocs = ma->num_allocs + ma->num_reallocs;
+	base_bytes = ma->cur_bytes;
+	ma->peak_bytes = ma->cur_bytes;
+
+	t0 = clock();
+	do {
+		if(!run_decoder_once(bctx, bc, cmprf, outf, d->len)) goto done;
+		iterations++;
+		t1 = clock();
+		elapsed = (double)(t1-t0) / (double)CLOCKS_PER_SEC;
+	} while(elapsed < bctx->min_seconds);
+
+	if(elapsed<=0.0) elapsed = 1.0e-9;
+	mbps = ((double)d->len * (double)iterations) / elapsed / 1000000.0;
+	nspb = elapsed * 1.0e9 / ((double)d->len * (double)iterations);
+	printf("%s\t%"I64_FMT"\t%"I64_FMT"\t%"I64_FMT"\t%.3f\t%.2f\t%.3f\t%.1f\t%"I64_FMT"\n",
+		bc->name, d->len, cmprf->len, iterations, elapsed, mbps, nspb,
+		(double)(ma->num_allocs + ma->num_reallocs - base_allocs) / (double)iterations,
+		(ma->peak_bytes - base_bytes + 1023)/1024);
+	fflush(stdout);
+
+done:
+	dbuf_close(outf);
+	dbuf_close(cmprf);
+}
+
+static void print_usage(void)
+{
+	size_t i;
+
+	printf("Usage: deark-bench [-t <min-seconds>] [-s <data-size-KB>] [codec ...]\n");
+	printf("       deark-bench -e2e [-n <runs>] [-od <dir>] [-l <listfile>]\n"
+		"         [-json <file>] [-baseline <file>] [-threshold <percent>] [file ...]\n");
+	printf("       deark-bench -identify [-n <runs>] [-l <listfile>] [-json <file>]\n"
+		"         [file ...]\n");
+	printf("       deark-bench -dbuftrace [-region <size>] [-tiny <size>] <tracefile>\n");
+	printf("Codecs:");
+	for(i=0; i<DE_ARRAYCOUNT(bench_codecs); i++) {
+		printf(" %s", bench_codecs[i].name);
+	}
+	printf("\n");
+}
+
+static int run_codec_benchmarks(int argc, char **argv)
+{
+	struct benchctx *bctx = NULL;
+	deark *c;
+	int i;
+	int ncodec_args = 0;
+	size_t k;
+	int retval = 1;
+
+	c = de_create_internal();
+	de_memacct_create(c);
+	bctx = de_malloc(c, sizeof(struct benchctx));
+	bctx->c = c;
+	bctx->min_seconds = BENCH_DEFAULT_MIN_SECONDS;
+	bctx->data_size = BENCH_DEFAULT_DATA_SIZE;
+
+	for(i=1; i<argc; i++) {
+		if(!de_strcmp(argv[i], "-t") && i+1<argc) {
+			bctx->min_seconds = atof(argv[++i]);
+		}
+		else if(!de_strcmp(argv[i], "-s") && i+1<argc) {
+			bctx->data_size = de_atoi64(argv[++i]) * 1024;
+			if(bctx->data_size<1024) bctx->data_size = 1024;
+		}
+		else if(argv[i][0]=='-') {
+			print_usage();
+			goto done;
+		}
+		else {
+			ncodec_args++;
+		}
+	}
+
+	printf("# codec\tunc_bytes\tcmpr_bytes\titerations\tseconds\tMB/s\tns/byte\t"
+		"allocs\tpeak_KB\n");
+	for(k=0; k<DE_ARRAYCOUNT(bench_codecs); k++) {
+		int selected = (ncodec_args==0);
+
+		for(i=1; i<argc && !selected; i++) {
+			if(!de_strcmp(argv[i], "-t") || !de_strcmp(argv[i], "-s")) {
+				i++;
+				continue;
+			}
+			if(!de_strcmp(argv[i], bench_codecs[k].name)) selected = 1;
+		}
+		if(selected) {
+			run_benchmark(bctx, &bench_codecs[k]);
+		}
+	}
+	retval = 0;
+
+done:
+	for(k=0; k<BENCH_DATA_COUNT; k++) {
+		de_free(c, bctx->data[k].buf);
+	}
+	de_free(c, bctx);
+	de_destroy(c);
+	return retval;
+}
+
+///////////////////////////////////
+// End-to-end benchmark ("-e2e")
+//
+// Runs the whole library (format detection, module, codecs, image
+// conversion, PNG encoding, output) in-process on each input file, several
+// times, and reports timing per module.
+// By default, output files are processed as in list mode with "-opt oinfo",
+// so they are fully generated but never written to disk. With -od, they
+// are written to the given directory (a tmpfs is recommended), each input
+// file overwriting the previous one's output.
+
+#define E2E_DEFAULT_NRUNS 5
+#define E2E_DEFAULT_THRESHOLD 10.0
+// Modules faster than this (in the baseline) are too noisy to compare.
+#define E2E_MIN_COMPARE_MS 5.0
+#define E2E_MAX_MODNAME 40
+
+struct e2e_file {
+	char *fn;
+	i64 bytes_in;
+	i64 bytes_out;
+	i64 files_out;
+	i64 error_count;
+	i64 allocs; // Allocations and reallocations, in the first run
+	i64 peak_bytes; // Peak memory use, in the first run
+	char modname[E2E_MAX_MODNAME];
+	double *run_ms; // [nruns]
+};
+
+struct e2e_module {
+	char modname[E2E_MAX_MODNAME];
+	i64 nfiles;
+	i64 bytes_in;
+	i64 bytes_out;
+	i64 files_out;
+	i64 allocs;
+	i64 peak_bytes; // The highest of its files' peaks
+	double *run_ms; // [nruns] Total time of this module's files, for each run
+	double min_ms, p50_ms, p90_ms;
+};
+
+struct e2e_ctx {
+	deark *c; // For memory allocation, etc.
+	int nruns;
+	const char *output_dir;
+	const char *json_fn;
+	const char *baseline_fn;
+	double threshold;
+
+	i64 nfiles;
+	i64 files_alloc;
+	struct e2e_file *files;
+	i64 nmodules;
+	struct e2e_module *modules; // [nfiles+1]; the last used entry is the total
+
+	struct e2e_file *curr_file; // Used by the messages callback
+	int is_first_run;
+};
+
+static void e2e_add_file(struct e2e_ctx *ectx, const char *fn)
+{
+	struct e2e_file *ef;
+	dbuf *f;
+
+	// This also gets the file into the OS's cache before the timed runs.
+	f = dbuf_open_input_file(ectx->c, fn);
+	if(!f) return;
+
+	if(ectx->nfiles >= ectx->files_alloc) {
+		i64 newalloc = ectx->files_alloc ? ectx->files_alloc*2 : 64;
+
+		ectx->files = de_realloc(ectx->c, ectx->files,
+			ectx->files_alloc*(i64)sizeof(struct e2e_file),
+			newalloc*(i64)sizeof(struct e2e_file));
+		ectx->files_alloc = newalloc;
+	}
+	ef = &ectx->files[ectx->nfiles++];
+	ef->fn = de_strdup(ectx->c, fn);
+	ef->bytes_in = f->len;
+	ef->run_ms = de_mallocarray(ectx->c, ectx->nruns, sizeof(double));
+	de_strlcpy(ef->modname, "(none)", sizeof(ef->modname));
+	dbuf_close(f);
+}
+
+static void e2e_read_listfile(struct e2e_ctx *ectx, const char *listfn)
+{
+	FILE *fp;
+	char linebuf[1024];
+
+	fp = fopen(listfn, "r");
+	if(!fp) {
+		fprintf(stderr, "Can't open %s\n", listfn);
+		return;
+	}
+	while(fgets(linebuf, (int)sizeof(linebuf), fp)) {
+		size_t n = de_strlen(linebuf);
+
+		while(n>0 && (linebuf[n-1]=='\n' || linebuf[n-1]=='\r')) {
+			linebuf[--n] = '\0';
+		}
+		if(n>0) e2e_add_file(ectx, linebuf);
+	}
+	fclose(fp);
+}
+
+static void e2e_msgfn(deark *c, UI flags, const char *s)
+{
+	struct e2e_ctx *ectx = (struct e2e_ctx*)de_get_userdata(c);
+	struct e2e_file *ef = ectx->curr_file;
+	const char *p;
+
+	if(!ef || !ectx->is_first_run) return;
+
+	if(!de_strncmp(s, "Module: ", 8)) {
+		// Only record the top-level module.
+		if(!de_strcmp(ef->modname, "(none)")) {
+			de_strlcpy(ef->modname, s+8, sizeof(ef->modname));
+		}
+	}
+	else if(!de_strncmp(s, "Output file info: ", 18)) {
+		p = strstr(s, " size=");
+		if(p) {
+			ef->bytes_out += de_atoi64(p+6);
+		}
+		ef->files_out++;
+	}
+}
+
+static void e2e_run_file(struct e2e_ctx *ectx, struct e2e_file *ef, int run_idx)
+{
+	deark *c;
+	i64 t0, t1;
+
+	ectx->curr_file = ef;
+	ectx->is_first_run = (run_idx==0);
+
+	t0 = de_get_monotonic_time_ns();
+	c = de_create();
+	de_set_userdata(c, (void*)ectx);
+	de_set_messages_callback(c, e2e_msgfn);
+	de_set_std_option_int(c, DE_STDOPT_WARNINGS, 0);
+	de_set_input_filename(c, ef->fn, 0);
+	if(ectx->output_dir) {
+		de_set_output_filename_pattern(c, ectx->output_dir, "output", 0);
+	}
+	else {
+		de_set_std_option_int(c, DE_STDOPT_LISTMODE, 1);
+	}
+	de_set_ext_option(c, "oinfo", "1");
+	de_memacct_create(c);
+
+	de_run(c);
+
+	if(run_idx==0) {
+		ef->error_count = c->error_count;
+		ef->allocs = c->memacct->num_allocs + c->memacct->num_reallocs;
+		ef->peak_bytes = c->memacct->peak_bytes;
+	}
+	de_destroy(c);
+	t1 = de_get_monotonic_time_ns();
+
+	ef->run_ms[run_idx] = (double)(t1-t0) / 1000000.0;
+	ectx->curr_file = NULL;
+}
+
+static int e2e_cmp_double(const void *a, const void *b)
+{
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+
+	if(x<y) return -1;
+	if(x>y) return 1;
+	return 0;
+}
+
+// Nearest-rank percentile. Sorts the array.
+static double e2e_percentile(double *vals, int n, double pct)
+{
+	int rank;
+
+	qsort(vals, (size_t)n, sizeof(double), e2e_cmp_double);
+	rank = (int)((pct/100.0)*(double)n + 0.999999);
+	if(rank<1) rank = 1;
+	if(rank>n) rank = n;
+	return vals[rank-1];
+}
+
+static struct e2e_module *e2e_find_or_add_module(struct e2e_ctx *ectx, const char *modname)
+{
+	i64 i;
+	struct e2e_module *em;
+
+	for(i=0; i<ectx->nmodules; i++) {
+		if(!de_strcmp(ectx->modules[i].modname, modname)) return &ectx->modules[i];
+	}
+	em = &ectx->modules[ectx->nmodules++];
+	de_strlcpy(em->modname, modname, sizeof(em->modname));
+	em->run_ms = de_mallocarray(ectx->c, ectx->nruns, sizeof(double));
+	return em;
+}
+
+static void e2e_add_to_module(struct e2e_ctx *ectx, struct e2e_module *em,
+	struct e2e_file *ef)
+{
+	int r;
+
+	em->nfiles++;
+	em->bytes_in += ef->bytes_in;
+	em->bytes_out += ef->bytes_out;
+	em->files_out += ef->files_out;
+	em->allocs += ef->allocs;
+	if(ef->peak_bytes > em->peak_bytes) em->peak_bytes = ef->peak_bytes;
+	for(r=0; r<ectx->nruns; r++) {
+		em->run_ms[r] += ef->run_ms[r];
+	}
+}
+
+static int e2e_cmp_module(const void *a, const void *b)
+{
+	return de_strcmp(((const struct e2e_module*)a)->modname,
+		((const struct e2e_module*)b)->modname);
+}
+
+static void e2e_summarize(struct e2e_ctx *ectx)
+{
+	i64 i;
+	struct e2e_module *total;
+
+	ectx->modules = de_mallocarray(ectx->c, ectx->nfiles+1, sizeof(struct e2e_module));
+	for(i=0; i<ectx->nfiles; i++) {
+		e2e_add_to_module(ectx, e2e_find_or_add_module(ectx, ectx->files[i].modname),
+			&ectx->files[i]);
+	}
+	qsort(ectx->modules, (size_t)ectx->nmodules, sizeof(struct e2e_module), e2e_cmp_module);
+
+	total = &ectx->modules[ectx->nmodules];
+	de_strlcpy(total->modname, "TOTAL", sizeof(total->modname));
+	total->run_ms = de_mallocarray(ectx->c, ectx->nruns, sizeof(double));
+	for(i=0; i<ectx->nfiles; i++) {
+		e2e_add_to_module(ectx, total, &ectx->files[i]);
+	}
+
+	for(i=0; i<=ectx->nmodules; i++) {
+		struct e2e_module *em = &ectx->modules[i];
+
+		em->min_ms = e2e_percentile(em->run_ms, ectx->nruns, 0.0);
+		em->p50_ms = e2e_percentile(em->run_ms, ectx->nruns, 50.0);
+		em->p90_ms = e2e_percentile(em->run_ms, ectx->nruns, 90.0);
+	}
+}
+
+static void e2e_print_results(struct e2e_ctx *ectx)
+{
+	i64 i;
+
+	printf("# module\tfiles\tbytes_in\tbytes_out\tfiles_out\tmin_ms\tp50_ms\tp90_ms\t"
+		"MB_in/s\tfiles/s\tallocs\tpeak_KB\n");
+	for(i=0; i<=ectx->nmodules; i++) {
+		struct e2e_module *em = &ectx->modules[i];
+		double secs = em->p50_ms/1000.0;
+
+		if(secs<=0.0) secs = 1.0e-9;
+		printf("%s\t%"I64_FMT"\t%"I64_FMT"\t%"I64_FMT"\t%"I64_FMT"\t%.3f\t%.3f\t%.3f\t%.2f\t%.1f"
+			"\t%"I64_FMT"\t%"I64_FMT"\n",
+			em->modname, em->nfiles, em->bytes_in, em->bytes_out, em->files_out,
+			em->min_ms, em->p50_ms, em->p90_ms,
+			(double)em->bytes_in/secs/1000000.0, (double)em->nfiles/secs,
+			em->allocs, (em->peak_bytes+1023)/1024);
+	}
+}
+
+// The JSON has one module per line, so that e2e_read_baseline() can read it
+// without a real JSON parser.
+static void e2e_write_json(struct e2e_ctx *ectx)
+{
+	FILE *fp;
+	i64 i;
+
+	fp = fopen(ectx->json_fn, "w");
+	if(!fp) {
+		fprintf(stderr, "Can't write %s\n", ectx->json_fn);
+		return;
+	}
+	fprintf(fp, "{\n \"runs\": %d,\n \"modules\": {\n", ectx->nruns);
+	for(i=0; i<=ectx->nmodules; i++) {
+		struct e2e_module *em = &ectx->modules[i];
+
+		fprintf(fp, "  \"%s\": {\"files\": %"I64_FMT", \"bytes_in\": %"I64_FMT
+			", \"bytes_out\": %"I64_FMT", \"files_out\": %"I64_FMT
+			", \"min_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f"
+			", \"allocs\": %"I64_FMT", \"peak_bytes\": %"I64_FMT"}%s\n",
+			em->modname, em->nfiles, em->bytes_in, em->bytes_out, em->files_out,
+			em->min_ms, em->p50_ms, em->p90_ms, em->allocs, em->peak_bytes,
+			(i<ectx->nmodules)?",":"");
+	}
+	fprintf(fp, " }\n}\n");
+	fclose(fp);
+}
+
+// Reads a file written by e2e_write_json(), and compares each module's median
+// time. Returns the number of regressions.
+static int e2e_compare_to_baseline(struct e2e_ctx *ectx)
+{
+	FILE *fp;
+	char linebuf[512];
+	int nregressions = 0;
+
+	fp = fopen(ectx->baseline_fn, "r");
+	if(!fp) {
+		fprintf(stderr, "Can't open %s\n", ectx->baseline_fn);
+		return 1;
+	}
+
+	printf("# module\tbase_p50_ms\tp50_ms\tchange_pct\n");
+	while(fgets(linebuf, (int)sizeof(linebuf), fp)) {
+		char modname[E2E_MAX_MODNAME];
+		const char *p;
+		const char *q;
+		double base_ms;
+		double change_pct;
+		i64 i;
+		struct e2e_module *em = NULL;
+
+		p = strstr(linebuf, "\"");
+		if(!p) continue;
+		q = strstr(p+1, "\": {");
+		if(!q || (size_t)(q-(p+1)) >= sizeof(modname)) continue;
+		de_memcpy(modname, p+1, (size_t)(q-(p+1)));
+		modname[q-(p+1)] = '\0';
+		p = strstr(q, "\"p50_ms\": ");
+		if(!p) continue;
+		base_ms = atof(p+10);
+
+		for(i=0; i<=ectx->nmodules; i++) {
+			if(!de_strcmp(ectx->modules[i].modname, modname)) {
+				em = &ectx->modules[i];
+				break;
+			}
+		}
+		if(!em) continue;
+		if(base_ms < E2E_MIN_COMPARE_MS) continue;
+
+		change_pct = (em->p50_ms - base_ms) / base_ms * 100.0;
+		printf("%s\t%.3f\t%.3f\t%+.1f%s\n", modname, base_ms, em->p50_ms, change_pct,
+			(change_pct > ectx->threshold) ? "\tREGRESSION" : "");
+		if(change_pct > ectx->threshold) nregressions++;
+	}
+	fclose(fp);
+	return nregressions;
+}
+
+static int run_e2e_benchmark(int argc, char **argv)
+{
+	struct e2e_ctx *ectx = NULL;
+	deark *c;
+	int i;
+	int r;
+	i64 k;
+	int retval = 1;
+
+	c = de_create_internal();
+	ectx = de_malloc(c, sizeof(struct e2e_ctx));
+	ectx->c = c;
+	ectx->nruns = E2E_DEFAULT_NRUNS;
+	ectx->threshold = E2E_DEFAULT_THRESHOLD;
+
+	// The first pass is just for options that need to be set before
+	// e2e_add_file() is called.
+	for(i=2; i<argc; i++) {
+		if(!de_strcmp(argv[i], "-n") && i+1<argc) {
+			ectx->nruns = de_atoi(argv[++i]);
+			if(ectx->nruns<1) ectx->nruns = 1;
+		}
+	}
+
+	for(i=2; i<argc; i++) {
+		if(!de_strcmp(argv[i], "-n") && i+1<argc) {
+			i++;
+		}
+		else if(!de_strcmp(argv[i], "-od") && i+1<argc) {
+			ectx->output_dir = argv[++i];
+		}
+		else if(!de_strcmp(argv[i], "-l") && i+1<argc) {
+			e2e_read_listfile(ectx, argv[++i]);
+		}
+		else if(!de_strcmp(argv[i], "-json") && i+1<argc) {
+			ectx->json_fn = argv[++i];
+		}
+		else if(!de_strcmp(argv[i], "-baseline") && i+1<argc) {
+			ectx->baseline_fn = argv[++i];
+		}
+		else if(!de_strcmp(argv[i], "-threshold") && i+1<argc) {
+			ectx->threshold = atof(argv[++i]);
+		}
+		else if(argv[i][0]=='-') {
+			print_usage();
+			goto done;
+		}
+		else {
+			e2e_add_file(ectx, argv[i]);
+		}
+	}
+
+	if(ectx->nfiles<1) {
+		fprintf(stderr, "No input files\n");
+		goto done;
+	}
+
+	for(r=0; r<ectx->nruns; r++) {
+		for(k=0; k<ectx->nfiles; k++) {
+			e2e_run_file(ectx, &ectx->files[k], r);
+		}
+	}
+
+	e2e_summarize(ectx);
+	e2e_print_results(ectx);
+	if(ectx->json_fn) {
+		e2e_write_json(ectx);
+	}
+	retval = 0;
+	if(ectx->baseline_fn) {
+		if(e2e_compare_to_baseline(ectx) > 0) {
+			retval = 1;
+		}
+	}
+
+done:
+	if(ectx->modules) {
+		for(k=0; k<=ectx->nmodules; k++) {
+			de_free(c, ectx->modules[k].run_ms);
+		}
+		de_free(c, ectx->modules);
+	}
+	for(k=0; k<ectx->nfiles; k++) {
+		de_free(c, ectx->files[k].fn);
+		de_free(c, ectx->files[k].run_ms);
+	}
+	de_free(c, ectx->files);
+	de_free(c, ectx);
+	de_destroy(c);
+	return retval;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Identify-phase profiler ("-identify")
+//
+// Runs only format detection (as with "deark -id") on each input file,
+// with -stats enabled, and totals the identify-function statistics for each
+// module: time, calls, bytes read, how often the module claimed the file
+// (returned nonzero), and how often it won.
+// A module's bytes_read counts bytes it read through the dbuf functions,
+// including cached bytes. Note that the first identify function to run on
+// a file also pays for populating the input file's read cache.
+
+struct idp_module {
+	const char *name; // Static string, owned by the module
+	i64 calls;
+	i64 wall_ns;
+	i64 cpu_ns;
+	i64 bytes_read;
+	i64 hits;
+	i64 wins;
+};
+
+struct idp_ctx {
+	struct e2e_ctx *ectx; // For the list of input files
+	const char *json_fn;
+	i64 nmodules;
+	i64 modules_alloc;
+	struct idp_module *modules;
+	i64 num_unidentified;
+	i64 total_wall_ns; // Total time of all identify functions
+};
+
+static void idp_msgfn(deark *c, UI flags, const char *s)
+{
+	;
+}
+
+static struct idp_module *idp_find_or_add_module(struct idp_ctx *ictx,
+	const char *name)
+{
+	i64 i;
+
+	for(i=0; i<ictx->nmodules; i++) {
+		if(!de_strcmp(ictx->modules[i].name, name)) return &ictx->modules[i];
+	}
+	if(ictx->nmodules >= ictx->modules_alloc) {
+		i64 newalloc = ictx->modules_alloc ? ictx->modules_alloc*2 : 256;
+
+		ictx->modules = de_reallocarray(ictx->ectx->c, ictx->modules,
+			ictx->modules_alloc, sizeof(struct idp_module), newalloc);
+		ictx->modules_alloc = newalloc;
+	}
+	ictx->modules[ictx->nmodules].name = name;
+	return &ictx->modules[ictx->nmodules++];
+}
+
+static void idp_run_file(struct idp_ctx *ictx, struct e2e_file *ef)
+{
+	deark *c;
+	i64 i;
+	i64 nwins = 0;
+
+	c = de_create();
+	de_set_messages_callback(c, idp_msgfn);
+	de_set_std_option_int(c, DE_STDOPT_WARNINGS, 0);
+	de_set_std_option_int(c, DE_STDOPT_ID_MODE, 1);
+	de_set_std_option_int(c, DE_STDOPT_STATS, 1);
+	de_set_input_filename(c, ef->fn, 0);
+
+	de_run(c);
+
+	for(i=0; i<c->stats->num_items; i++) {
+		const struct de_stats_item *item = &c->stats->items[i];
+		struct idp_module *im;
+
+		if(item->category!=DE_STATSCAT_IDENTIFY) continue;
+		im = idp_find_or_add_module(ictx, item->name);
+		im->calls += item->count;
+		im->wall_ns += item->t.wall_ns;
+		im->cpu_ns += item->t.cpu_ns;
+		im->bytes_read += item->t.bytes_read;
+		im->hits += item->hits;
+		im->wins += item->wins;
+		nwins += item->wins;
+		ictx->total_wall_ns += item->t.wall_ns;
+	}
+	if(nwins==0) ictx->num_unidentified++;
+
+	// Destroy the statistics ourselves, so that de_destroy() doesn't print
+	// a report.
+	de_stats_destroy(c);
+	de_destroy(c);
+}
+
+// Sort by decreasing time
+static int idp_cmp_module(const void *a, const void *b)
+{
+	const struct idp_module *m1 = (const struct idp_module*)a;
+	const struct idp_module *m2 = (const struct idp_module*)b;
+
+	if(m1->wall_ns != m2->wall_ns) {
+		return (m1->wall_ns > m2->wall_ns) ? -1 : 1;
+	}
+	return de_strcmp(m1->name, m2->name);
+}
+
+static void idp_print_results(struct idp_ctx *ictx, int nruns)
+{
+	i64 i;
+	i64 nfiles = ictx->ectx->nfiles * (i64)nruns;
+
+	printf("# files=%"I64_FMT" runs=%d unidentified=%"I64_FMT" identify_ms=%.3f "
+		"us/file=%.2f\n", ictx->ectx->nfiles, nruns, ictx->num_unidentified,
+		(double)ictx->total_wall_ns/1000000.0,
+		nfiles ? (double)ictx->total_wall_ns/1000.0/(double)nfiles : 0.0);
+	printf("# module\tcalls\twall_ms\tcpu_ms\tpct\tns/call\tbytes_read\thits\twins\n");
+	for(i=0; i<ictx->nmodules; i++) {
+		const struct idp_module *im = &ictx->modules[i];
+
+		printf("%s\t%"I64_FMT"\t%.3f\t%.3f\t%.2f\t%.0f\t%"I64_FMT"\t%"I64_FMT"\t%"I64_FMT"\n",
+			im->name, im->calls, (double)im->wall_ns/1000000.0,
+			(double)im->cpu_ns/1000000.0,
+			ictx->total_wall_ns ? 100.0*(double)im->wall_ns/(double)ictx->total_wall_ns : 0.0,
+			im->calls ? (double)im->wall_ns/(double)im->calls : 0.0,
+			im->bytes_read, im->hits, im->wins);
+	}
+}
+
+static void idp_write_json(struct idp_ctx *ictx, int nruns)
+{
+	FILE *fp;
+	i64 i;
+
+	fp = fopen(ictx->json_fn, "w");
+	if(!fp) {
+		fprintf(stderr, "Can't write %s\n", ictx->json_fn);
+		return;
+	}
+	fprintf(fp, "{\n \"files\": %"I64_FMT",\n \"runs\": %d,\n \"unidentified\": %"I64_FMT
+		",\n \"modules\": {\n", ictx->ectx->nfiles, nruns, ictx->num_unidentified);
+	for(i=0; i<ictx->nmodules; i++) {
+		const struct idp_module *im = &ictx->modules[i];
+
+		fprintf(fp, "  \"%s\": {\"calls\": %"I64_FMT", \"wall_ms\": %.3f, \"cpu_ms\": %.3f"
+			", \"bytes_read\": %"I64_FMT", \"hits\": %"I64_FMT", \"wins\": %"I64_FMT"}%s\n",
+			im->name, im->calls, (double)im->wall_ns/1000000.0,
+			(double)im->cpu_ns/1000000.0, im->bytes_read, im->hits, im->wins,
+			(i+1<ictx->nmodules)?",":"");
+	}
+	fprintf(fp, " }\n}\n");
+	fclose(fp);
+}
+
+static int run_identify_profiler(int argc, char **argv)
+{
+	struct e2e_ctx *ectx = NULL;
+	struct idp_ctx *ictx = NULL;
+	deark *c;
+	int i;
+	int r;
+	i64 k;
+	int retval = 1;
+
+	c = de_create_internal();
+	ectx = de_malloc(c, sizeof(struct e2e_ctx));
+	ectx->c = c;
+	ectx->nruns = 1;
+	ictx = de_malloc(c, sizeof(struct idp_ctx));
+	ictx->ectx = ectx;
+
+	for(i=2; i<argc; i++) {
+		if(!de_strcmp(argv[i], "-n") && i+1<argc) {
+			ectx->nruns = de_atoi(argv[++i]);
+			if(ectx->nruns<1) ectx->nruns = 1;
+		}
+		else if(!de_strcmp(argv[i], "-l") && i+1<argc) {
+			e2e_read_listfile(ectx, argv[++i]);
+		}
+		else if(!de_strcmp(argv[i], "-json") && i+1<argc) {
+			ictx->json_fn = argv[++i];
+		}
+		else if(argv[i][0]=='-') {
+			print_usage();
+			goto done;
+		}
+		else {
+			e2e_add_file(ectx, argv[i]);
+		}
+	}
+
+	if(ectx->nfiles<1) {
+		fprintf(stderr, "No input files\n");
+		goto done;
+	}
+
+	for(r=0; r<ectx->nruns; r++) {
+		for(k=0; k<ectx->nfiles; k++) {
+			idp_run_file(ictx, &ectx->files[k]);
+		}
+	}
+	// The unidentified count is per file, not per run.
+	ictx->num_unidentified /= ectx->nruns;
+
+	if(ictx->nmodules>1) {
+		qsort(ictx->modules, (size_t)ictx->nmodules, sizeof(struct idp_module),
+			idp_cmp_module);
+	}
+	idp_print_results(ictx, ectx->nruns);
+	if(ictx->json_fn) {
+		idp_write_json(ictx, ectx->nruns);
+	}
+	retval = 0;
+
+done:
+	for(k=0; k<ectx->nfiles; k++) {
+		de_free(c, ectx->files[k].fn);
+		de_free(c, ectx->files[k].run_ms);
+	}
+	de_free(c, ectx->files);
+	de_free(c, ectx);
+	de_free(c, ictx->modules);
+	de_free(c, ictx);
+	de_destroy(c);
+	return retval;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// dbuf trace summarizer ("-dbuftrace")
+//
+// Reads a file written by "deark -opt dbuf:trace=<file>", and reports the
+// most-accessed regions of each dbuf, a histogram of seek distances between
+// consecutive reads of the same dbuf, and which modules make the most tiny
+// reads.
+// Records that only describe how a read was forwarded (src "parent" or
+// "chunked"), and requests that read nothing, are ignored.
+
+#define TRS_DEFAULT_REGION_SIZE 4096
+#define TRS_DEFAULT_TINY_SIZE   4
+#define TRS_NUM_SEEK_BUCKETS    8
+#define TRS_MAX_HOT_REGIONS     10
+#define TRS_MAX_CALLERS         20
+
+static const char *trs_seek_bucket_names[TRS_NUM_SEEK_BUCKETS] = {
+	"sequential", "backward", "+1..15", "+16..255", "+256..4K", "+4K..64K",
+	"+64K..1M", "+1M.."
+};
+
+struct trs_dbuf {
+	char type[16];
+	i64 nreads;
+	i64 bytes;
+	i64 prev_end;
+	i64 nregions;
+	i64 *region_reads; // array[nregions]
+};
+
+struct trs_caller {
+	char module[64];
+	char op[16];
+	i64 nreads;
+	i64 ntiny;
+	i64 bytes;
+};
+
+struct trs_hot_region {
+	i64 dbuf_id;
+	i64 region;
+	i64 nreads;
+};
+
+struct trs_ctx {
+	deark *c;
+	i64 region_size;
+	i64 tiny_size;
+	i64 nrecords;
+	i64 nreads;
+	i64 nwrites;
+	i64 bytes_written;
+	i64 ndbufs;
+	struct trs_dbuf *dbufs; // array[ndbufs], indexed by dbuf id
+	i64 ncallers;
+	i64 callers_alloc;
+	struct trs_caller *callers;
+	i64 seekhist[TRS_NUM_SEEK_BUCKETS];
+};
+
+static struct trs_dbuf *trs_get_dbuf(struct trs_ctx *tctx, i64 id)
+{
+	if(id>=tctx->ndbufs) {
+		i64 newn = de_max_int(id+1, tctx->ndbufs*2);
+
+		tctx->dbufs = de_reallocarray(tctx->c, tctx->dbufs, tctx->ndbufs,
+			sizeof(struct trs_dbuf), newn);
+		tctx->ndbufs = newn;
+	}
+	return &tctx->dbufs[id];
+}
+
+static struct trs_caller *trs_get_caller(struct trs_ctx *tctx,
+	const char *module, const char *op)
+{
+	i64 i;
+	struct trs_caller *cl;
+
+	for(i=0; i<tctx->ncallers; i++) {
+		cl = &tctx->callers[i];
+		if(!de_strcmp(cl->module, module) && !de_strcmp(cl->op, op)) return cl;
+	}
+	if(tctx->ncallers >= tctx->callers_alloc) {
+		i64 newalloc = tctx->callers_alloc ? tctx->callers_alloc*2 : 64;
+
+		tctx->callers = de_reallocarray(tctx->c, tctx->callers, tctx->callers_alloc,
+			sizeof(struct trs_caller), newalloc);
+		tctx->callers_alloc = newalloc;
+	}
+	cl = &tctx->callers[tctx->ncallers++];
+	de_strlcpy(cl->module, module, sizeof(cl->module));
+	de_strlcpy(cl->op, op, sizeof(cl->op));
+	return cl;
+}
+
+static UI trs_seek_bucket(i64 d)
+{
+	if(d==0) return 0;
+	if(d<0) return 1;
+	if(d<16) return 2;
+	if(d<256) return 3;
+	if(d<4096) return 4;
+	if(d<65536) return 5;
+	if(d<1048576) return 6;
+	return 7;
+}
+
+static void trs_add_read(struct trs_ctx *tctx, const char *op, i64 id,
+	const char *type, i64 pos, i64 len, const char *module)
+{
+	struct trs_dbuf *td;
+	struct trs_caller *cl;
+	i64 region;
+
+	tctx->nreads++;
+	td = trs_get_dbuf(tctx, id);
+	de_strlcpy(td->type, type, sizeof(td->type));
+	tctx->seekhist[trs_seek_bucket(pos - td->prev_end)]++;
+	td->prev_end = pos + len;
+	td->nreads++;
+	td->bytes += len;
+
+	region = pos / tctx->region_size;
+	if(region>=td->nregions) {
+		i64 newn = de_max_int(region+1, td->nregions*2);
+
+		td->region_reads = de_reallocarray(tctx->c, td->region_reads, td->nregions,
+			sizeof(i64), newn);
+		td->nregions = newn;
+	}
+	td->region_reads[region]++;
+
+	cl = trs_get_caller(tctx, module, op);
+	cl->nreads++;
+	cl->bytes += len;
+	if(len<=tctx->tiny_size) cl->ntiny++;
+}
+
+static int trs_read_tracefile(struct trs_ctx *tctx, const char *fn)
+{
+	FILE *fp;
+	char linebuf[512];
+	char op[16];
+	char type[16];
+	char src[16];
+	char module[64];
+	i64 id, pos, len;
+
+	fp = fopen(fn, "r");
+	if(!fp) {
+		fprintf(stderr, "Can't open %s\n", fn);
+		return 0;
+	}
+	while(fgets(linebuf, (int)sizeof(linebuf), fp)) {
+		if(sscanf(linebuf, "%15[^,],%"I64_FMT",%15[^,],%"I64_FMT",%"I64_FMT
+			",%15[^,],%63[^,\r\n]", op, &id, type, &pos, &len, src, module) != 7)
+		{
+			continue; // Header line, or bad record
+		}
+		tctx->nrecords++;
+		if(id<0 || pos<0 || len<1) continue;
+		if(!de_strncmp(op, "write", 5)) {
+			tctx->nwrites++;
+			tctx->bytes_written += len;
+			continue;
+		}
+		if(!de_strcmp(src, "parent") || !de_strcmp(src, "chunked") ||
+			!de_strcmp(src, "none"))
+		{
+			continue;
+		}
+		trs_add_read(tctx, op, id, type, pos, len, module);
+	}
+	fclose(fp);
+	return 1;
+}
+
+// Sort by decreasing number of reads
+static int trs_cmp_hot_region(const void *a, const void *b)
+{
+	const struct trs_hot_region *r1 = (const struct trs_hot_region*)a;
+	const struct trs_hot_region *r2 = (const struct trs_hot_region*)b;
+
+	if(r1->nreads != r2->nreads) return (r1->nreads > r2->nreads) ? -1 : 1;
+	if(r1->dbuf_id != r2->dbuf_id) return (r1->dbuf_id < r2->dbuf_id) ? -1 : 1;
+	if(r1->region != r2->region) return (r1->region < r2->region) ? -1 : 1;
+	return 0;
+}
+
+// Sort by decreasing number of tiny reads
+static int trs_cmp_caller(const void *a, const void *b)
+{
+	const struct trs_caller *c1 = (const struct trs_caller*)a;
+	const struct trs_caller *c2 = (const struct trs_caller*)b;
+
+	if(c1->ntiny != c2->ntiny) return (c1->ntiny > c2->ntiny) ? -1 : 1;
+	if(c1->nreads != c2->nreads) return (c1->nreads > c2->nreads) ? -1 : 1;
+	return de_strcmp(c1->module, c2->module);
+}
+
+static void trs_print_hot_regions(struct trs_ctx *tctx)
+{
+	struct trs_hot_region *hr = NULL;
+	i64 nhr = 0;
+	i64 i, k;
+
+	for(i=0; i<tctx->ndbufs; i++) {
+		for(k=0; k<tctx->dbufs[i].nregions; k++) {
+			if(tctx->dbufs[i].region_reads[k]) nhr++;
+		}
+	}
+	if(nhr<1) return;
+	hr = de_mallocarray(tctx->c, nhr, sizeof(struct trs_hot_region));
+	nhr = 0;
+	for(i=0; i<tctx->ndbufs; i++) {
+		for(k=0; k<tctx->dbufs[i].nregions; k++) {
+			if(!tctx->dbufs[i].region_reads[k]) continue;
+			hr[nhr].dbuf_id = i;
+			hr[nhr].region = k;
+			hr[nhr].nreads = tctx->dbufs[i].region_reads[k];
+			nhr++;
+		}
+	}
+	qsort(hr, (size_t)nhr, sizeof(struct trs_hot_region), trs_cmp_hot_region);
+
+	printf("# hot regions (%"I64_FMT" bytes each)\n", tctx->region_size);
+	printf("# dbuf\ttype\toffset\treads\n");
+	for(i=0; i<nhr && i<TRS_MAX_HOT_REGIONS; i++) {
+		printf("%"I64_FMT"\t%s\t%"I64_FMT"\t%"I64_FMT"\n", hr[i].dbuf_id,
+			tctx->dbufs[hr[i].dbuf_id].type, hr[i].region*tctx->region_size,
+			hr[i].nreads);
+	}
+	de_free(tctx->c, hr);
+}
+
+static void trs_print_results(struct trs_ctx *tctx)
+{
+	i64 i;
+	UI k;
+
+	printf("# records=%"I64_FMT" reads=%"I64_FMT" writes=%"I64_FMT
+		" bytes_written=%"I64_FMT"\n", tctx->nrecords, tctx->nreads,
+		tctx->nwrites, tctx->bytes_written);
+
+	printf("# dbuf\ttype\treads\tbytes\tbytes/read\n");
+	for(i=0; i<tctx->ndbufs; i++) {
+		const struct trs_dbuf *td = &tctx->dbufs[i];
+
+		if(td->nreads<1) continue;
+		printf("%"I64_FMT"\t%s\t%"I64_FMT"\t%"I64_FMT"\t%.1f\n", i, td->type,
+			td->nreads, td->bytes, (double)td->bytes/(double)td->nreads);
+	}
+
+	trs_print_hot_regions(tctx);
+
+	printf("# seek distance\treads\tpct\n");
+	for(k=0; k<TRS_NUM_SEEK_BUCKETS; k++) {
+		printf("%s\t%"I64_FMT"\t%.1f\n", trs_seek_bucket_names[k], tctx->seekhist[k],
+			tctx->nreads ? 100.0*(double)tctx->seekhist[k]/(double)tctx->nreads : 0.0);
+	}
+
+	if(tctx->ncallers>1) {
+		qsort(tctx->callers, (size_t)tctx->ncallers, sizeof(struct trs_caller),
+			trs_cmp_caller);
+	}
+	printf("# module\top\treads\ttiny(<=%"I64_FMT")\tbytes\tbytes/read\n",
+		tctx->tiny_size);
+	for(i=0; i<tctx->ncallers && i<TRS_MAX_CALLERS; i++) {
+		const struct trs_caller *cl = &tctx->callers[i];
+
+		printf("%s\t%s\t%"I64_FMT"\t%"I64_FMT"\t%"I64_FMT"\t%.1f\n", cl->module,
+			cl->op, cl->nreads, cl->ntiny, cl->bytes,
+			(double)cl->bytes/(double)cl->nreads);
+	}
+}
+
+static int run_trace_summarizer(int argc, char **argv)
+{
+	struct trs_ctx *tctx = NULL;
+	deark *c;
+	const char *fn = NULL;
+	int i;
+	i64 k;
+	int retval = 1;
+
+	c = de_create_internal();
+	tctx = de_malloc(c, sizeof(struct trs_ctx));
+	tctx->c = c;
+	tctx->region_size = TRS_DEFAULT_REGION_SIZE;
+	tctx->tiny_size = TRS_DEFAULT_TINY_SIZE;
+
+	for(i=2; i<argc; i++) {
+		if(!de_strcmp(argv[i], "-region") && i+1<argc) {
+			tctx->region_size = de_atoi64(argv[++i]);
+			if(tctx->region_size<1) tctx->region_size = TRS_DEFAULT_REGION_SIZE;
+		}
+		else if(!de_strcmp(argv[i], "-tiny") && i+1<argc) {
+			tctx->tiny_size = de_atoi64(argv[++i]);
+		}
+		else if(argv[i][0]=='-' || fn) {
+			print_usage();
+			goto done;
+		}
+		else {
+			fn = argv[i];
+		}
+	}
+
+	if(!fn) {
+		fprintf(stderr, "No trace file\n");
+		goto done;
+	}
+	if(!trs_read_tracefile(tctx, fn)) goto done;
+	trs_print_results(tctx);
+	retval = 0;
+
+done:
+	for(k=0; k<tctx->ndbufs; k++) {
+		de_free(c, tctx->dbufs[k].region_reads);
+	}
+	de_free(c, tctx->dbufs);
+	de_free(c, tctx->callers);
+	de_free(c, tctx);
+	de_destroy(c);
+	return retval;
+}
+
+int main(int argc, char **argv)
+{
+	if(argc>=2 && !de_strcmp(argv[1], "-e2e")) {
+		return run_e2e_benchmark(argc, argv);
+	}
+	if(argc>=2 && !de_strcmp(argv[1], "-identify")) {
+		return run_identify_profiler(argc, argv);
+	}
+	if(argc>=2 && !de_strcmp(argv[1], "-dbuftrace")) {
+		return run_trace_summarizer(argc, argv);
+	}
+	return run_codec_benchmarks(argc, argv);
+}
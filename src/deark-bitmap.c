@@ -325,12 +325,19 @@ static int bitmap16_low_bits_important(de_bitmap *imghi, de_bitmap *imglo)
 // imglo: If non-NULL, contains the low 8 bits of each sample, and a 16 bits/sample
 //     output image will potentially be written. (This is obviously a hack, but
 //     it's not worth doing anything more for such a rarely used feature.)
-void de_bitmap16_write_to_file_finfo(de_bitmap *img, de_bitmap *imglo,
-	de_finfo *fi, UI createflags)
+static void capture_writelistener(dbuf *f, void *userdata, const u8 *buf, i64 buf_len)
+{
+	dbuf_write((dbuf*)userdata, buf, buf_len);
+}
+
+// If capture is not NULL, a copy of the file is also written to it.
+static void bitmap16_write_to_file_internal(de_bitmap *img, de_bitmap *imglo,
+	de_finfo *fi, UI createflags, dbuf *capture)
 {
 	deark *c;
 	struct image_scan_opt_data optctx;
 	struct de_write_image_params wp;
+	struct de_stats_timer tmr, tmr_png;
 
 	if(!img) return;
 	c = img->c;
@@ -347,6 +354,7 @@ void de_bitmap16_write_to_file_finfo(de_bitmap *img, de_bitmap *imglo,
 		if(!valid_imglo(img, imglo)) return;
 	}
 
+	de_stats_timer_start(c, &tmr);
 	de_zeromem(&wp, sizeof(struct de_write_image_params));
 	wp.createflags = createflags;
 
@@ -386,6 +394,9 @@ void de_bitmap16_write_to_file_finfo(de_bitmap *img, de_bitmap *imglo,
 	}
 
 	wp.f = dbuf_create_output_file(c, "png", fi, createflags);
+	if(capture) {
+		dbuf_set_writelistener(wp.f, capture_writelistener, (void*)capture);
+	}
 	if(optctx.optimg) {
 		wp.img = optctx.optimg;
 	}
@@ -393,10 +404,19 @@ void de_bitmap16_write_to_file_finfo(de_bitmap *img, de_bitmap *imglo,
 		wp.img = img;
 		wp.imglo = imglo;
 	}
+	de_stats_timer_start(c, &tmr_png);
 	de_write_png(c, &wp);
 	dbuf_close(wp.f);
+	de_stats_timer_stop(c, &tmr_png, DE_STATSCAT_OUTPUT, "png_write");
 
 	if(optctx.optimg) de_bitmap_destroy(optctx.optimg);
+	de_stats_timer_stop(c, &tmr, DE_STATSCAT_OUTPUT, "bitmap_write");
+}
+
+void de_bitmap16_write_to_file_finfo(de_bitmap *img, de_bitmap *imglo,
+	de_finfo *fi, UI createflags)
+{
+	bitmap16_write_to_file_internal(img, imglo, fi, createflags, NULL);
 }
 
 void de_bitmap_write_to_file_finfo(de_bitmap *img, de_finfo *fi,
@@ -423,6 +443,239 @@ void de_bitmap_write_to_file(de_bitmap *img, const char *token,
 	}
 }
 
+struct de_frame_writer_struct {
+	deark *c;
+	u8 have_prev;
+	// A copy of the previous frame, and the PNG file it was written as
+	de_bitmap *prev_img;
+	dbuf *prev_png;
+	// The settings that were used for the previous frame, that affect the
+	// contents of the PNG file
+	UI createflags;
+	u8 have_fi;
+	u8 has_hotspot;
+	u8 linear_colorpace;
+	int hotspot_x, hotspot_y;
+	struct de_timestamp internal_mod_time;
+	struct de_density_info density;
+};
+
+// A frame writer writes the frames of an animation, each to a separate
+// image file, like de_bitmap_write_to_file_finfo() does. But if a frame has
+// the same pixels as the previous frame, the file that was generated for the
+// previous frame is reused, instead of being encoded again.
+de_frame_writer *de_frame_writer_create(deark *c)
+{
+	de_frame_writer *fw;
+
+	fw = de_malloc(c, sizeof(de_frame_writer));
+	fw->c = c;
+	fw->prev_png = dbuf_create_membuf(c, 0, 0);
+	return fw;
+}
+
+static int frame_writer_same_img(de_bitmap *img1, de_bitmap *img2)
+{
+	if(img1->width!=img2->width || img1->height!=img2->height ||
+		img1->unpadded_width!=img2->unpadded_width ||
+		img1->bytes_per_pixel!=img2->bytes_per_pixel ||
+		img1->bitmap_size!=img2->bitmap_size)
+	{
+		return 0;
+	}
+	return !de_memcmp(img1->bitmap, img2->bitmap, (size_t)img1->bitmap_size);
+}
+
+static int frame_writer_same_settings(de_frame_writer *fw, de_finfo *fi, UI createflags)
+{
+	if(createflags != fw->createflags) return 0;
+	if(!fi) return !fw->have_fi;
+	if(!fw->have_fi) return 0;
+	if(fi->has_hotspot!=fw->has_hotspot || fi->linear_colorpace!=fw->linear_colorpace) return 0;
+	if(fi->has_hotspot && (fi->hotspot_x!=fw->hotspot_x || fi->hotspot_y!=fw->hotspot_y)) return 0;
+	if(fi->internal_mod_time.is_valid!=fw->internal_mod_time.is_valid) return 0;
+	if(fi->internal_mod_time.is_valid &&
+		(fi->internal_mod_time.ts_FILETIME!=fw->internal_mod_time.ts_FILETIME ||
+		fi->internal_mod_time.tzcode!=fw->internal_mod_time.tzcode ||
+		fi->internal_mod_time.precision!=fw->internal_mod_time.precision))
+	{
+		return 0;
+	}
+	if(fi->density.code!=fw->density.code || fi->density.xdens!=fw->density.xdens ||
+		fi->density.ydens!=fw->density.ydens)
+	{
+		return 0;
+	}
+	return 1;
+}
+
+static void frame_writer_save_settings(de_frame_writer *fw, de_finfo *fi, UI createflags)
+{
+	fw->createflags = createflags;
+	fw->have_fi = (fi!=NULL);
+	if(!fi) return;
+	fw->has_hotspot = fi->has_hotspot;
+	fw->linear_colorpace = fi->linear_colorpace;
+	fw->hotspot_x = fi->hotspot_x;
+	fw->hotspot_y = fi->hotspot_y;
+	fw->internal_mod_time = fi->internal_mod_time;
+	fw->density = fi->density;
+}
+
+void de_frame_writer_write(de_frame_writer *fw, de_bitmap *img, de_finfo *fi,
+	UI createflags)
+{
+	deark *c = fw->c;
+
+	if(!img->bitmap) de_bitmap_alloc_pixels(img);
+
+	if(fw->have_prev && !img->invalid_image_flag &&
+		frame_writer_same_settings(fw, fi, createflags) &&
+		frame_writer_same_img(img, fw->prev_img))
+	{
+		dbuf *outf;
+
+		de_dbg2(c, "frame is unchanged; reusing the previous file");
+		outf = dbuf_create_output_file(c, "png", fi, createflags);
+		dbuf_copy(fw->prev_png, 0, fw->prev_png->len, outf);
+		dbuf_close(outf);
+		return;
+	}
+
+	fw->have_prev = 0;
+	dbuf_truncate(fw->prev_png, 0);
+	bitmap16_write_to_file_internal(img, NULL, fi, createflags, fw->prev_png);
+	if(img->invalid_image_flag) return;
+
+	// Reuse the pixel memory from the previous frame, if we can.
+	if(fw->prev_img && fw->prev_img->bitmap_size==img->bitmap_size) {
+		de_bitmap *tmpimg = fw->prev_img;
+		u8 *pixels = tmpimg->bitmap;
+
+		de_memcpy(tmpimg, img, sizeof(de_bitmap));
+		tmpimg->bitmap = pixels;
+		de_memcpy(tmpimg->bitmap, img->bitmap, (size_t)img->bitmap_size);
+	}
+	else {
+		de_bitmap_destroy(fw->prev_img);
+		fw->prev_img = de_bitmap_clone(img);
+	}
+	frame_writer_save_settings(fw, fi, createflags);
+	fw->have_prev = 1;
+}
+
+void de_frame_writer_destroy(de_frame_writer *fw)
+{
+	deark *c;
+
+	if(!fw) return;
+	c = fw->c;
+	de_bitmap_destroy(fw->prev_img);
+	dbuf_close(fw->prev_png);
+	de_free(c, fw);
+}
+
+// Images needing at least this many bytes of memory are streamed, by default.
+#define DE_STREAM_IMAGE_THRESHOLD (256*1048576)
+
+struct de_bitmap_writer_struct {
+	deark *c;
+	// Has the dimensions of the final image, but no pixels
+	de_bitmap *img;
+	dbuf *outf;
+	struct deark_png_encode_info *pei;
+	// Total time spent in the writer's functions, and the part of it spent
+	// in the PNG encoder
+	struct de_stats_timer tmr, tmr_png;
+};
+
+// Reports whether a module should write an image of the given dimensions
+// with a de_bitmap_writer, instead of decoding it to a whole de_bitmap,
+// assuming it knows how to.
+int de_bitmap_want_streaming(deark *c, i64 width, i64 height, int bypp)
+{
+	int opt;
+
+	opt = de_get_ext_option_bool(c, "streamimages", -1);
+	if(opt>=0) return opt;
+	if(width<1 || height<1 || bypp<1) return 0;
+	return (width*(i64)bypp >= DE_STREAM_IMAGE_THRESHOLD/height);
+}
+
+// Creates a PNG file, to which rows of pixels can be written a few at a time,
+// so that the whole image never needs to be in memory.
+// Unlike de_bitmap_write_to_file_finfo(), this can't examine the image before
+// writing it, so it doesn't try to reduce the image's depth. The caller
+// should choose the smallest suitable bypp, and may use
+// DE_CREATEFLAG_IS_BWIMG. DE_CREATEFLAG_FLIP_IMAGE is not supported.
+// Returns NULL if the dimensions are bad.
+de_bitmap_writer *de_bitmap_writer_create(deark *c, i64 npwidth, i64 pdwidth,
+	i64 height, int bypp, de_finfo *fi, UI createflags)
+{
+	de_bitmap_writer *bw = NULL;
+	struct de_write_image_params wp;
+	struct de_stats_timer tmr, tmr_png;
+
+	if(!de_good_image_dimensions(c, npwidth, height)) goto done;
+	bw = de_malloc(c, sizeof(de_bitmap_writer));
+	bw->c = c;
+	de_stats_timer_start(c, &tmr);
+	bw->img = de_bitmap_create2(c, npwidth, pdwidth, height, bypp);
+
+	de_zeromem(&wp, sizeof(struct de_write_image_params));
+	wp.createflags = createflags & ~(UI)DE_CREATEFLAG_FLIP_IMAGE;
+	if(createflags & DE_CREATEFLAG_IS_BWIMG) {
+		wp.flags2 |= 0x1;
+	}
+	if(fi && fi->linear_colorpace) {
+		wp.flags2 |= 0x2;
+	}
+	bw->outf = dbuf_create_output_file(c, "png", fi, wp.createflags);
+	wp.f = bw->outf;
+	wp.img = bw->img;
+	de_stats_timer_start(c, &tmr_png);
+	bw->pei = de_write_png_begin(c, &wp);
+	de_stats_timer_pause(c, &tmr_png, &bw->tmr_png);
+	de_stats_timer_pause(c, &tmr, &bw->tmr);
+
+done:
+	return bw;
+}
+
+// Writes the first nrows rows of img. img must have the same width
+// (pdwidth) and bypp as the writer. It can have any height.
+// Rows are written from the top of the image down.
+void de_bitmap_writer_add_rows(de_bitmap_writer *bw, de_bitmap *img, i64 nrows)
+{
+	struct de_stats_timer tmr;
+
+	if(!bw) return;
+	de_stats_timer_start(bw->c, &tmr);
+	de_write_png_rows(bw->pei, img, nrows);
+	de_stats_timer_pause(bw->c, &tmr, &bw->tmr_png);
+	de_stats_timer_pause(bw->c, &tmr, &bw->tmr);
+}
+
+// Completes the image (any missing rows are black or transparent), closes
+// the file, and destroys bw.
+void de_bitmap_writer_finish(de_bitmap_writer *bw)
+{
+	deark *c;
+	struct de_stats_timer tmr;
+
+	if(!bw) return;
+	c = bw->c;
+	de_stats_timer_start(c, &tmr);
+	de_write_png_end(bw->pei);
+	dbuf_close(bw->outf);
+	de_stats_timer_pause(c, &tmr, &bw->tmr_png);
+	de_bitmap_destroy(bw->img);
+	de_stats_timer_pause(c, &tmr, &bw->tmr);
+	de_stats_record(c, DE_STATSCAT_OUTPUT, "png_write", &bw->tmr_png);
+	de_stats_record(c, DE_STATSCAT_OUTPUT, "bitmap_write", &bw->tmr);
+	de_free(c, bw);
+}
+
 // samplenum 0=Red, 1=Green, 2=Blue, 3=Alpha
 // If img is grayscale or grayscale+alpha, samplenum 0=Gray.
 void de_bitmap_setsample(de_bitmap *img, i64 x, i64 y,
@@ -975,6 +1228,79 @@ void de_convert_image_paletted(dbuf *f, i64 fpos,
 	}
 }
 
+// Converts 8 pixels from planar to chunky format (one byte per pixel).
+// planebytes[n] is the byte from plane n, where plane 0 is the
+// least-significant plane. nplanes is at most 8.
+// pixels[0] is the pixel from the most-significant bit of each byte, or the
+// least-significant bit if flags&0x01.
+void de_planar_to_chunky8(const u8 *planebytes, UI nplanes, UI flags, u8 *pixels)
+{
+	u64 x = 0;
+	u64 t;
+	UI k;
+
+	if(nplanes>8) nplanes = 8;
+	for(k=0; k<nplanes; k++) {
+		x |= (u64)planebytes[k] << (8*k);
+	}
+
+	if(x!=0) {
+		// Transpose the 8x8 bit matrix, so that bit j of byte i moves to
+		// bit i of byte j.
+		t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+		x = x ^ t ^ (t << 7);
+		t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+		x = x ^ t ^ (t << 14);
+		t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+		x = x ^ t ^ (t << 28);
+	}
+
+	// Byte j now holds the pixel made from bit j of each plane.
+	for(k=0; k<8; k++) {
+		if(flags & 0x01) {
+			pixels[k] = (u8)(x >> (8*k));
+		}
+		else {
+			pixels[k] = (u8)(x >> (8*(7-k)));
+		}
+	}
+}
+
+// Set row ypos of img from a row of palette indices.
+static void set_row_paletted(de_bitmap *img, i64 ypos, const u8 *idxbuf,
+	const de_color *pal)
+{
+	i64 i;
+	u8 *rowptr;
+
+	if(!img->bitmap) de_bitmap_alloc_pixels(img);
+	if(!img->bitmap) return;
+	if(ypos<0 || ypos>=img->height) return;
+
+	if(img->bytes_per_pixel!=3 && img->bytes_per_pixel!=4) {
+		for(i=0; i<img->width; i++) {
+			de_bitmap_setpixel_rgba(img, i, ypos, pal[idxbuf[i]]);
+		}
+		return;
+	}
+
+	rowptr = &img->bitmap[img->width*img->bytes_per_pixel*ypos];
+	for(i=0; i<img->width; i++) {
+		de_color clr = pal[idxbuf[i]];
+
+		rowptr[0] = DE_COLOR_R(clr);
+		rowptr[1] = DE_COLOR_G(clr);
+		rowptr[2] = DE_COLOR_B(clr);
+		if(img->bytes_per_pixel==4) {
+			rowptr[3] = DE_COLOR_A(clr);
+			rowptr += 4;
+		}
+		else {
+			rowptr += 3;
+		}
+	}
+}
+
 // Decode some planar paletted images.
 // Rows and planes must be byte-aligned.
 // All image data must be in the same dbuf.
@@ -988,63 +1314,52 @@ void de_convert_image_paletted(dbuf *f, i64 fpos,
 void de_convert_image_paletted_planar(dbuf *f, i64 fpos, i64 nplanes,
 	i64 row_stride, i64 plane_stride, const de_color *pal, de_bitmap *img, UI flags)
 {
+	deark *c = img->c;
 	i64 ypos;
-	u8 bit_order_is_lsb = 0;
-	u8 plane_order_is_lsb = 0;
+	i64 n;
+	UI pn;
 	u8 pbit[8]; // [0] is for bits from the least-significant plane, etc.
 	i64 units_per_row; // num bytes per row per plane that we will process
+	u8 *planebuf = NULL; // The current row, one plane after another
+	u8 *idxbuf = NULL; // The current row's palette indices
 
 	if(nplanes<1 || nplanes>8) goto done;
+	if(img->width<1 || img->height<1) goto done;
 	de_zeromem(pbit, sizeof(pbit));
 
-	if(flags & 0x01) bit_order_is_lsb = 1;
-	if(flags & 0x02) plane_order_is_lsb = 1;
 	units_per_row = (img->width + 7)/8;
+	planebuf = de_malloc(c, units_per_row*nplanes);
+	idxbuf = de_malloc(c, units_per_row*8);
 
 	for(ypos=0; ypos<img->height; ypos++) {
-		i64 n;
+		for(pn=0; pn<(UI)nplanes; pn++) {
+			UI bufidx;
+
+			if(flags & 0x02) {
+				bufidx = pn;
+			}
+			else {
+				bufidx = (UI)nplanes-1-pn;
+			}
+			dbuf_read(f, &planebuf[units_per_row*bufidx],
+				fpos + ypos*row_stride + pn*plane_stride, units_per_row);
+		}
 
-		// Read 8 bits from each plane, then rearrange them to make 8
+		// Take 8 bits from each plane, and rearrange them to make 8
 		// output pixels.
 		for(n=0; n<units_per_row; n++) {
-			UI k;
-			UI pn;
-			u8 b;
-			i64 xpos;
-
 			for(pn=0; pn<(UI)nplanes; pn++) {
-				b = dbuf_getbyte(f, fpos + ypos*row_stride + pn*plane_stride + n);
-				if(plane_order_is_lsb) {
-					pbit[pn] = b;
-				}
-				else {
-					pbit[(UI)nplanes-1-pn] = b;
-				}
-			}
-
-			for(k=0; k<8; k++) {
-				UI palent;
-
-				palent = 0;
-				for(pn=0; pn<(UI)nplanes; pn++) {
-					if((pbit[pn] & (1U<<k))!=0) {
-						palent |= 1U<<pn;
-					}
-				}
-
-				if(bit_order_is_lsb) {
-					xpos = n*8 + (i64)k;
-				}
-				else {
-					xpos = n*8 + (i64)(7-k);
-				}
-				de_bitmap_setpixel_rgba(img, xpos, ypos, pal[palent]);
+				pbit[pn] = planebuf[units_per_row*pn + n];
 			}
+			de_planar_to_chunky8(pbit, (UI)nplanes, flags&0x01, &idxbuf[n*8]);
 		}
+
+		set_row_paletted(img, ypos, idxbuf, pal);
 	}
 
 done:
-	;
+	de_free(c, planebuf);
+	de_free(c, idxbuf);
 }
 
 void de_convert_image_rgb(dbuf *f, i64 fpos,
@@ -1177,6 +1492,13 @@ done:
 	if(imgtmp) de_bitmap_destroy(imgtmp);
 }
 
+// Narrow the range [*pa,*pb) of offsets, so that pos+offset is in [0,limit).
+static void clip_rect_range(i64 *pa, i64 *pb, i64 pos, i64 limit)
+{
+	if(*pa < -pos) *pa = -pos;
+	if(*pb > limit-pos) *pb = limit-pos;
+}
+
 // Paint a solid, solid-color rectangle onto an image.
 // (Pixels will be replaced, not merged.)
 void de_bitmap_rect(de_bitmap *img,
@@ -1184,9 +1506,15 @@ void de_bitmap_rect(de_bitmap *img,
 	de_color clr, unsigned int flags)
 {
 	i64 i, j;
+	i64 i1, i2, j1, j2;
+
+	i1 = 0; i2 = width;
+	j1 = 0; j2 = height;
+	clip_rect_range(&i1, &i2, xpos, img->width);
+	clip_rect_range(&j1, &j2, ypos, img->height);
 
-	for(j=0; j<height; j++) {
-		for(i=0; i<width; i++) {
+	for(j=j1; j<j2; j++) {
+		for(i=i1; i<i2; i++) {
 			de_bitmap_setpixel_rgba(img, xpos+i, ypos+j, clr);
 		}
 	}
@@ -1202,11 +1530,72 @@ void de_bitmap_copy_rect(de_bitmap *srcimg, de_bitmap *dstimg,
 	i64 dstxpos, i64 dstypos, unsigned int flags)
 {
 	i64 i, j;
+	i64 i1, i2, j1, j2;
 	de_color dst_clr, src_clr, clr;
 	de_colorsample src_a;
+	u8 src_in_bounds;
+
+	// Only visit the pixels that can affect dstimg. Pixels outside of dstimg
+	// are ignored. When merging, so are pixels outside of srcimg, because
+	// they are transparent.
+	i1 = 0; i2 = width;
+	j1 = 0; j2 = height;
+	clip_rect_range(&i1, &i2, dstxpos, dstimg->width);
+	clip_rect_range(&j1, &j2, dstypos, dstimg->height);
+	if(flags&DE_BITMAPFLAG_MERGE) {
+		clip_rect_range(&i1, &i2, srcxpos, srcimg->width);
+		clip_rect_range(&j1, &j2, srcypos, srcimg->height);
+	}
+	if(i1>=i2 || j1>=j2) return;
+
+	if(!dstimg->bitmap) de_bitmap_alloc_pixels(dstimg);
+	src_in_bounds = (srcimg->bitmap && srcxpos+i1>=0 && srcypos+j1>=0 &&
+		srcxpos+i2<=srcimg->width && srcypos+j2<=srcimg->height);
+
+	// Fast paths for common cases
+	if(src_in_bounds && dstimg->bitmap && !dstimg->invalid_image_flag) {
+		i64 src_bypp = (i64)srcimg->bytes_per_pixel;
+		i64 dst_bypp = (i64)dstimg->bytes_per_pixel;
+		i64 src_rowspan = srcimg->width * src_bypp;
+		i64 dst_rowspan = dstimg->width * dst_bypp;
+
+		if(src_bypp==dst_bypp && !(flags&DE_BITMAPFLAG_MERGE)) {
+			for(j=j1; j<j2; j++) {
+				de_memcpy(&dstimg->bitmap[(dstypos+j)*dst_rowspan + (dstxpos+i1)*dst_bypp],
+					&srcimg->bitmap[(srcypos+j)*src_rowspan + (srcxpos+i1)*src_bypp],
+					(size_t)((i2-i1)*src_bypp));
+			}
+			return;
+		}
+
+		if(dst_bypp==4 && (src_bypp==3 || (src_bypp==4 && (flags&DE_BITMAPFLAG_MERGE)))) {
+			for(j=j1; j<j2; j++) {
+				const u8 *sp = &srcimg->bitmap[(srcypos+j)*src_rowspan + (srcxpos+i1)*src_bypp];
+				u8 *dp = &dstimg->bitmap[(dstypos+j)*dst_rowspan + (dstxpos+i1)*dst_bypp];
+
+				for(i=i1; i<i2; i++) {
+					if(src_bypp==3) {
+						dp[0] = sp[0];
+						dp[1] = sp[1];
+						dp[2] = sp[2];
+						dp[3] = 0xff;
+					}
+					else if(sp[3]>0) {
+						dp[0] = sp[0];
+						dp[1] = sp[1];
+						dp[2] = sp[2];
+						dp[3] = sp[3];
+					}
+					sp += src_bypp;
+					dp += 4;
+				}
+			}
+			return;
+		}
+	}
 
-	for(j=0; j<height; j++) {
-		for(i=0; i<width; i++) {
+	for(j=j1; j<j2; j++) {
+		for(i=i1; i<i2; i++) {
 			src_clr = de_bitmap_getpixel(srcimg, srcxpos+i, srcypos+j);
 			if(!(flags&DE_BITMAPFLAG_MERGE)) {
 				clr = src_clr;
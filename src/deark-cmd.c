@@ -395,7 +395,7 @@ enum opt_id_enum {
  DE_OPT_MP,
  DE_OPT_NOINFO, DE_OPT_NOWARN,
  DE_OPT_NOBOM, DE_OPT_NODENS, DE_OPT_ASCIIHTML, DE_OPT_NONAMES,
- DE_OPT_PADPIX,
+ DE_OPT_PADPIX, DE_OPT_STATS,
  DE_OPT_NOOVERWRITE, DE_OPT_MODTIME, DE_OPT_NOMODTIME,
  DE_OPT_Q, DE_OPT_VERSION, DE_OPT_HELP, DE_OPT_LICENSE, DE_OPT_ID,
  DE_OPT_MAINONLY, DE_OPT_AUXONLY, DE_OPT_EXTRACTALL, DE_OPT_ZIP, DE_OPT_TAR,
@@ -405,7 +405,7 @@ enum opt_id_enum {
  DE_OPT_START, DE_OPT_SIZE, DE_OPT_M, DE_OPT_MODCODES, DE_OPT_O, DE_OPT_OD,
  DE_OPT_K, DE_OPT_K2, DE_OPT_K3, DE_OPT_KA, DE_OPT_KA2, DE_OPT_KA3,
  DE_OPT_T, DE_OPT_ARCFN, DE_OPT_GET, DE_OPT_FIRSTFILE, DE_OPT_MAXFILES,
- DE_OPT_MAXFILESIZE, DE_OPT_MAXTOTALSIZE, DE_OPT_MAXIMGDIM,
+ DE_OPT_MAXFILESIZE, DE_OPT_MAXTOTALSIZE, DE_OPT_MAXIMGDIM, DE_OPT_MAXMEM,
  DE_OPT_PRINTMODULES, DE_OPT_DPREFIX, DE_OPT_EXTRLIST,
  DE_OPT_ONLYMODS, DE_OPT_DISABLEMODS, DE_OPT_ONLYDETECT, DE_OPT_NODETECT,
  DE_OPT_COLORMODE, DE_OPT_TSOPTS
@@ -434,6 +434,7 @@ static const struct opt_struct option_array[] = {
 	{ "modtime",      DE_OPT_MODTIME,      0 },
 	{ "nomodtime",    DE_OPT_NOMODTIME,    0 },
 	{ "padpix",       DE_OPT_PADPIX,       0 },
+	{ "stats",        DE_OPT_STATS,        0 },
 	{ "q",            DE_OPT_Q,            0 },
 	{ "version",      DE_OPT_VERSION,      0 },
 	{ "h",            DE_OPT_HELP,         0 },
@@ -481,6 +482,7 @@ static const struct opt_struct option_array[] = {
 	{ "maxfilesize",  DE_OPT_MAXFILESIZE,  1 },
 	{ "maxtotalsize", DE_OPT_MAXTOTALSIZE, 1 },
 	{ "maxdim",       DE_OPT_MAXIMGDIM,    1 },
+	{ "maxmem",       DE_OPT_MAXMEM,       1 },
 	{ "dprefix",      DE_OPT_DPREFIX,      1 },
 	{ "extrlist",     DE_OPT_EXTRLIST,     1 },
 	{ "onlymods",     DE_OPT_ONLYMODS,     1 },
@@ -743,6 +745,9 @@ static void parse_cmdline(deark *c, struct cmdctx *cc, int argc, char **argv)
 			case DE_OPT_PADPIX:
 				de_set_std_option_int(c, DE_STDOPT_PADPIX, 1);
 				break;
+			case DE_OPT_STATS:
+				de_set_std_option_int(c, DE_STDOPT_STATS, 1);
+				break;
 			case DE_OPT_NOOVERWRITE:
 				de_set_std_option_int(c, DE_STDOPT_OVERWRITE_MODE, DE_OVERWRITEMODE_NEVER);
 				break;
@@ -904,6 +909,9 @@ static void parse_cmdline(deark *c, struct cmdctx *cc, int argc, char **argv)
 			case DE_OPT_MAXIMGDIM:
 				de_set_max_image_dimension(c, de_atoi64(argv[i+1]));
 				break;
+			case DE_OPT_MAXMEM:
+				de_set_max_memory_usage(c, de_atoi64(argv[i+1]));
+				break;
 			case DE_OPT_DPREFIX:
 				de_set_dprefix(c, argv[i+1]);
 				break;
@@ -13,10 +13,30 @@
 #define DE_DUMMY_MAX_FILE_SIZE (1LL<<56)
 #define DE_MAX_MEMBUF_SIZE 2000000000
 #define DE_RCACHE_SIZE 262144
+// The write buffer starts out small, and grows as it fills up, to at most
+// DE_WBUFFER_MAX_SIZE.
 #define DE_WBUFFER_SIZE 512
+#define DE_WBUFFER_MAX_SIZE 65536
+#define DE_BCACHE_DEFAULT_MEM 4194304
 // Support at least this many virtual bytes before or after the actual file.
 #define DE_ALLOWED_VIRTUAL_BYTES 16384
 
+struct de_dbuftrace_struct {
+	FILE *fp;
+	i64 num_dbufs;
+};
+
+static const char *btype_names[] = {
+	"null", "ifile", "ofile", "membuf", "idbuf", "stdout", "stdin", "fifo",
+	"odbuf", "custom"
+};
+
+const char *dbuf_get_btype_name(int btype)
+{
+	if(btype<0 || btype>=(int)DE_ARRAYCOUNT(btype_names)) return "unknown";
+	return btype_names[btype];
+}
+
 // Fill the cache that remembers the first part of the file.
 // TODO: We should probably use memory-mapped files instead when possible,
 // but this is simple and portable, and does most of what we need.
@@ -36,6 +56,11 @@ static void populate_rcache(dbuf *f)
 	de_fseek(f->fp, 0, SEEK_SET);
 	bytes_read = fread(f->rcache, 1, (size_t)bytes_to_read, f->fp);
 	f->rcache_bytes_used = bytes_read;
+	if(f->c->stats) {
+		f->c->stats->num_fseeks++;
+		f->c->stats->num_freads++;
+		f->c->stats->fread_bytes += bytes_read;
+	}
 	f->file_pos_known = 0;
 }
 
@@ -76,6 +101,10 @@ static void populate_rcache_from_pipe(dbuf *f)
 		if(bytes_to_read<1) break; // Shouldn't happen
 
 		bytes_read = fread(&f->rcache[f->rcache_bytes_used], 1, (size_t)bytes_to_read, fp);
+		if(f->c->stats) {
+			f->c->stats->num_freads++;
+			if(bytes_read>0) f->c->stats->fread_bytes += bytes_read;
+		}
 		if(bytes_read<1 || bytes_read>bytes_to_read) break;
 		f->rcache_bytes_used += bytes_read;
 		if(feof(fp) || ferror(fp)) break;
@@ -88,6 +117,7 @@ static void populate_rcache_from_pipe(dbuf *f)
 // Returns 0 if we changed *plen.
 int dbuf_constrain_offset(dbuf *f, i64 *ppos)
 {
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 	return de_constrain_int(ppos, 0, f->len);
 }
 
@@ -99,6 +129,7 @@ int dbuf_constrain_length(dbuf *f, i64 pos, i64 *plen)
 {
 	i64 maxlen;
 
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 	if(*plen < 0 || pos < 0 || pos > f->len ) {
 		*plen = 0;
 		return 0;
@@ -113,12 +144,232 @@ int dbuf_constrain_length(dbuf *f, i64 pos, i64 *plen)
 	return 1;
 }
 
+// Low-level read function used by dbuf_read(). Caller must supply valid
+// pos and n. Returns the number of bytes read.
+static i64 dbuf_read_uncached(dbuf *f, u8 *buf, i64 pos, i64 n)
+{
+	i64 bytes_read = 0;
+	deark *c = f->c;
+
+	switch(f->btype) {
+	case DBUF_TYPE_IFILE:
+		if(!f->fp) {
+			de_internal_err_fatal(c, "File not open");
+			break;
+		}
+
+		// For performance reasons, don't call fseek if we're already at the
+		// right position.
+		if(!f->file_pos_known || f->file_pos!=pos) {
+			de_fseek(f->fp, pos, SEEK_SET);
+			if(c->stats) c->stats->num_fseeks++;
+		}
+
+		bytes_read = fread(buf, 1, (size_t)n, f->fp);
+		if(c->stats) {
+			c->stats->num_freads++;
+			c->stats->fread_bytes += bytes_read;
+		}
+
+		f->file_pos = pos + bytes_read;
+		f->file_pos_known = 1;
+		break;
+
+	case DBUF_TYPE_IDBUF:
+		// Recursive call to the parent dbuf.
+		dbuf_read(f->parent_dbuf, buf, f->offset_into_parent_dbuf+pos, n);
+
+		// The parent dbuf always writes 'n' bytes.
+		bytes_read = n;
+		break;
+
+	case DBUF_TYPE_MEMBUF:
+		de_memcpy(buf, &f->membuf_buf[pos], (size_t)n);
+		bytes_read = n;
+		break;
+
+	default:
+		de_internal_err_fatal(c, "getbytes from this I/O type not implemented");
+	}
+
+	return bytes_read;
+}
+
+// Returns a pointer to the cached copy of block #blknum, reading it if needed.
+static const u8 *bcache_get_block(dbuf *f, i64 blknum)
+{
+	i64 slot;
+	i64 blkpos;
+	i64 n;
+	i64 bytes_read;
+	u8 *ptr;
+
+	slot = blknum % f->bcache_nblocks;
+	ptr = &f->bcache[slot * f->bcache_blksize];
+	if(f->bcache_blknum[slot]==blknum) return ptr;
+
+	blkpos = blknum * f->bcache_blksize;
+	n = f->len - blkpos;
+	if(n > f->bcache_blksize) n = f->bcache_blksize;
+	bytes_read = dbuf_read_uncached(f, ptr, blkpos, n);
+	if(bytes_read < f->bcache_blksize) {
+		de_zeromem(ptr+bytes_read, (size_t)(f->bcache_blksize - bytes_read));
+	}
+	f->bcache_blknum[slot] = blknum;
+	return ptr;
+}
+
+// Caller must supply valid pos and n, with n no larger than the block size.
+static void bcache_read(dbuf *f, u8 *buf, i64 pos, i64 n)
+{
+	while(n>0) {
+		i64 blknum;
+		i64 offs_in_blk;
+		i64 amt;
+		const u8 *blk;
+
+		blknum = pos / f->bcache_blksize;
+		offs_in_blk = pos % f->bcache_blksize;
+		amt = f->bcache_blksize - offs_in_blk;
+		if(amt > n) amt = n;
+		blk = bcache_get_block(f, blknum);
+		de_memcpy(buf, &blk[offs_in_blk], (size_t)amt);
+		buf += amt;
+		pos += amt;
+		n -= amt;
+	}
+}
+
+// Enable a cache of recently-used fixed-size blocks, for input files whose
+// small reads are scattered around the file (e.g. disk images).
+// blksize is typically the sector size. max_mem is the memory budget for the
+// cache; 0 for the default. The cache is never larger than the file.
+// Only has an effect on some types of input dbufs. If the cache is already
+// enabled, this is a no-op.
+void dbuf_enable_block_cache(dbuf *f, i64 blksize, i64 max_mem)
+{
+	i64 i;
+
+	if(f->bcache) return;
+	if(f->btype!=DBUF_TYPE_IFILE && f->btype!=DBUF_TYPE_IDBUF) return;
+	if(blksize<1 || blksize>DE_RCACHE_SIZE) return;
+	if(max_mem<=0) max_mem = DE_BCACHE_DEFAULT_MEM;
+
+	f->bcache_blksize = blksize;
+	f->bcache_nblocks = max_mem / blksize;
+	// No point in having more blocks than the file has.
+	f->bcache_nblocks = de_min_int(f->bcache_nblocks, de_pad_to_n(f->len, blksize)/blksize);
+	if(f->bcache_nblocks<2) f->bcache_nblocks = 2;
+	f->bcache = de_mallocarray(f->c, f->bcache_nblocks, (size_t)blksize);
+	f->bcache_blknum = de_mallocarray(f->c, f->bcache_nblocks, sizeof(i64));
+	for(i=0; i<f->bcache_nblocks; i++) {
+		f->bcache_blknum[i] = -1;
+	}
+}
+
+// A hint that the given range of bytes is about to be read. If the block
+// cache is enabled, reads as much of it as fits into the cache.
+void dbuf_prefetch(dbuf *f, i64 pos, i64 len)
+{
+	i64 blknum;
+	i64 first_blk, last_blk;
+
+	if(!f->bcache) return;
+	if(pos<0) {
+		len += pos;
+		pos = 0;
+	}
+	if(pos+len > f->len) len = f->len - pos;
+	if(len<1) return;
+	if(pos+len <= f->rcache_bytes_used) return;
+
+	first_blk = pos / f->bcache_blksize;
+	last_blk = (pos+len-1) / f->bcache_blksize;
+	if(last_blk-first_blk >= f->bcache_nblocks) {
+		last_blk = first_blk + f->bcache_nblocks - 1;
+	}
+
+	for(blknum=first_blk; blknum<=last_blk; blknum++) {
+		(void)bcache_get_block(f, blknum);
+	}
+}
+
+// The dbuf:trace option writes a CSV file with one record per read or write
+// request:
+//   op: read, getbyte, memcmp, directptr, bufread, write, or write_at
+//   dbuf: A number that identifies the dbuf (0 if created before tracing began)
+//   pos, len: The position and size of the request
+//   src: Where the data came from: rcache, bcache, membuf, fread, parent,
+//     chunked, or none.
+//   module: The module making the request
+// Reads from a dbuf with src "parent" are also traced as reads from the
+// parent dbuf. A "bufread" with src "chunked" is also traced as a series of
+// reads from the same dbuf.
+// Only the fast paths of getbyte, memcmp, and directptr are traced as such. In
+// other cases, they are traced as one or more "read"s.
+// Writes are traced after write buffering, so "write" records may not
+// correspond to dbuf_write() calls.
+void de_dbuftrace_start(deark *c, const char *fn)
+{
+	FILE *fp;
+	char msgbuf[200];
+
+	if(c->dbuftrace) return;
+	fp = de_fopen_for_write(c, fn, msgbuf, sizeof(msgbuf),
+		DE_OVERWRITEMODE_STANDARD, 0);
+	if(!fp) {
+		de_err(c, "Failed to write %s: %s", fn, msgbuf);
+		c->serious_error_flag = 1;
+		return;
+	}
+	c->dbuftrace = de_malloc(c, sizeof(struct de_dbuftrace_struct));
+	c->dbuftrace->fp = fp;
+	fprintf(fp, "op,dbuf,type,pos,len,src,module\n");
+}
+
+void de_dbuftrace_end(deark *c)
+{
+	if(!c->dbuftrace) return;
+	fclose(c->dbuftrace->fp);
+	de_free(c, c->dbuftrace);
+	c->dbuftrace = NULL;
+}
+
+static void dbuf_trace(dbuf *f, const char *op, i64 pos, i64 len,
+	const char *src)
+{
+	deark *c = f->c;
+
+	fprintf(c->dbuftrace->fp, "%s,%"I64_FMT",%s,%"I64_FMT",%"I64_FMT",%s,%s\n",
+		op, f->trace_id, dbuf_get_btype_name(f->btype), pos, len, src,
+		c->curr_module_id ? c->curr_module_id : "-");
+}
+
+// The "src" name for data read by dbuf_read_uncached().
+static const char *uncached_src_name(dbuf *f)
+{
+	switch(f->btype) {
+	case DBUF_TYPE_IFILE: return "fread";
+	case DBUF_TYPE_IDBUF: return "parent";
+	case DBUF_TYPE_MEMBUF: return "membuf";
+	}
+	return "none";
+}
+
+// For -stats. Counts bytes that were read without calling dbuf_read().
+static void dbuf_stats_count_read(dbuf *f, i64 n)
+{
+	f->c->stats->dbuf_bytes_read[f->btype] += n;
+	f->c->stats->bytes_read += n;
+}
+
 // Read len bytes, starting at file position pos, into buf.
 // Unread bytes will be set to 0.
 void dbuf_read(dbuf *f, u8 *buf, i64 pos, i64 len)
 {
 	i64 bytes_read = 0;
 	i64 bytes_to_read;
+	const char *src = "none";
 	deark *c;
 
 	c = f->c;
@@ -144,6 +395,7 @@ void dbuf_read(dbuf *f, u8 *buf, i64 pos, i64 len)
 		pos = 0;
 	}
 
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 	bytes_to_read = len;
 	if(pos >= f->len) {
 		bytes_to_read = 0;
@@ -163,47 +415,34 @@ void dbuf_read(dbuf *f, u8 *buf, i64 pos, i64 len)
 	{
 		de_memcpy(buf, &f->rcache[pos], (size_t)bytes_to_read);
 		bytes_read = bytes_to_read;
+		src = "rcache";
 		goto done_read;
 	}
 
-	switch(f->btype) {
-	case DBUF_TYPE_IFILE:
-		if(!f->fp) {
-			de_internal_err_fatal(c, "File not open");
-			goto done_read;
-		}
-
-		// For performance reasons, don't call fseek if we're already at the
-		// right position.
-		if(!f->file_pos_known || f->file_pos!=pos) {
-			de_fseek(f->fp, pos, SEEK_SET);
-		}
-
-		bytes_read = fread(buf, 1, (size_t)bytes_to_read, f->fp);
-
-		f->file_pos = pos + bytes_read;
-		f->file_pos_known = 1;
-		break;
-
-	case DBUF_TYPE_IDBUF:
-		// Recursive call to the parent dbuf.
-		dbuf_read(f->parent_dbuf, buf, f->offset_into_parent_dbuf+pos, bytes_to_read);
-
-		// The parent dbuf always writes 'bytes_to_read' bytes.
-		bytes_read = bytes_to_read;
-		break;
-
-	case DBUF_TYPE_MEMBUF:
-		de_memcpy(buf, &f->membuf_buf[pos], (size_t)bytes_to_read);
+	if(f->bcache && bytes_to_read<=f->bcache_blksize) {
+		bcache_read(f, buf, pos, bytes_to_read);
 		bytes_read = bytes_to_read;
-		break;
-
-	default:
-		de_internal_err_fatal(c, "getbytes from this I/O type not implemented");
+		src = "bcache";
 		goto done_read;
 	}
 
+	if(c->dbuftrace) {
+		// Trace this before the parent dbuf's read, if any.
+		dbuf_trace(f, "read", pos, len, uncached_src_name(f));
+	}
+	bytes_read = dbuf_read_uncached(f, buf, pos, bytes_to_read);
+	src = NULL;
+
 done_read:
+	if(c->dbuftrace && src) {
+		dbuf_trace(f, "read", pos, len, src);
+	}
+	if(c->stats && bytes_read>0) {
+		c->stats->dbuf_bytes_read[f->btype] += bytes_read;
+		if(f->btype!=DBUF_TYPE_IDBUF) {
+			c->stats->bytes_read += bytes_read;
+		}
+	}
 	// Zero out any requested bytes that were not read.
 	if(bytes_read < len) {
 		de_zeromem(buf+bytes_read, (size_t)(len - bytes_read));
@@ -217,6 +456,7 @@ i64 dbuf_standard_read(dbuf *f, u8 *buf, i64 n, i64 *fpos)
 {
 	i64 amt_to_read;
 
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 	if(*fpos < 0 || *fpos >= f->len) return 0;
 
 	amt_to_read = n;
@@ -226,16 +466,22 @@ i64 dbuf_standard_read(dbuf *f, u8 *buf, i64 n, i64 *fpos)
 	return amt_to_read;
 }
 
+
 u8 dbuf_getbyte(dbuf *f, i64 pos)
 {
 	u8 b;
 
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 	if(pos<0 || pos>=f->len) return 0x00;
 
 	if(pos<f->rcache_bytes_used) {
+		if(f->c->stats) dbuf_stats_count_read(f, 1);
+		if(f->c->dbuftrace) dbuf_trace(f, "getbyte", pos, 1, "rcache");
 		return f->rcache[pos];
 	}
 	if(f->btype==DBUF_TYPE_MEMBUF) {
+		if(f->c->stats) dbuf_stats_count_read(f, 1);
+		if(f->c->dbuftrace) dbuf_trace(f, "getbyte", pos, 1, "membuf");
 		return f->membuf_buf[pos];
 	}
 
@@ -731,20 +977,12 @@ static int copy_cbfn(struct de_bufferedreadctx *brctx, const u8 *buf,
 void dbuf_copy(dbuf *inf, i64 input_offset, i64 input_len, dbuf *outf)
 {
 	u8 tmpbuf[256];
+	const u8 *mem;
 
-	// Fast paths, if the data to copy is all in memory
-
-	if(inf->rcache &&
-		(input_offset>=0) && (input_offset+input_len<=inf->rcache_bytes_used))
-	{
-		dbuf_write(outf, &inf->rcache[input_offset], input_len);
-		return;
-	}
-
-	if(inf->btype==DBUF_TYPE_MEMBUF &&
-		(input_offset>=0) && (input_offset+input_len<=inf->len))
-	{
-		dbuf_write(outf, &inf->membuf_buf[input_offset], input_len);
+	// Fast path, if the data to copy is all in memory
+	mem = dbuf_get_direct_ptr(inf, input_offset, input_len);
+	if(mem) {
+		dbuf_write(outf, mem, input_len);
 		return;
 	}
 
@@ -825,6 +1063,7 @@ struct de_stringreaderdata *dbuf_read_string(dbuf *f, i64 pos,
 
 	srd = de_malloc(c, sizeof(struct de_stringreaderdata));
 	srd->str = ucstring_create(c);
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 	if(max_bytes_to_scan<0) max_bytes_to_scan = 0;
 	if(max_bytes_to_keep<0) max_bytes_to_keep = 0;
 
@@ -1002,6 +1241,8 @@ int dbuf_memcmp(dbuf *f, i64 pos, const void *s, size_t n)
 		pos + (i64)n <= f->rcache_bytes_used)
 	{
 		// Fastest path: Compare directly to cache.
+		if(f->c->stats) dbuf_stats_count_read(f, (i64)n);
+		if(f->c->dbuftrace) dbuf_trace(f, "memcmp", pos, (i64)n, "rcache");
 		return de_memcmp(s, &f->rcache[pos], n);
 	}
 
@@ -1015,17 +1256,6 @@ int dbuf_memcmp(dbuf *f, i64 pos, const void *s, size_t n)
 	return !dbuf_buffered_read(f, pos, n, dbufmemcmp_cbfn, (void*)s);
 }
 
-int dbuf_create_file_from_slice(dbuf *inf, i64 pos, i64 data_size,
-	const char *ext, de_finfo *fi, UI createflags)
-{
-	dbuf *f;
-	f = dbuf_create_output_file(inf->c, ext, fi, createflags);
-	if(!f) return 0;
-	dbuf_copy(inf, pos, data_size, f);
-	dbuf_close(f);
-	return 1;
-}
-
 static void finfo_shallow_copy(deark *c, de_finfo *src, de_finfo *dst)
 {
 	UI k;
@@ -1055,9 +1285,44 @@ static dbuf *create_dbuf_lowlevel(deark *c)
 	f = de_malloc(c, sizeof(dbuf));
 	f->c = c;
 	f->file_id = -1;
+	if(c->dbuftrace) {
+		f->trace_id = ++c->dbuftrace->num_dbufs;
+	}
+	if(c->tracked_allocs) {
+		f->is_tracked = 1;
+		f->tracked_next = c->tracked_dbufs;
+		if(f->tracked_next) f->tracked_next->tracked_prev = f;
+		c->tracked_dbufs = f;
+	}
 	return f;
 }
 
+static void untrack_dbuf(dbuf *f)
+{
+	if(f->tracked_prev) f->tracked_prev->tracked_next = f->tracked_next;
+	else f->c->tracked_dbufs = f->tracked_next;
+	if(f->tracked_next) f->tracked_next->tracked_prev = f->tracked_prev;
+	f->is_tracked = 0;
+}
+
+// For use after a fatal error: Closes the files of any dbufs that are still
+// open, without flushing or otherwise finishing them. Their memory is left
+// for de_memtrack_destroy() to free.
+void dbuf_close_tracked_files(deark *c)
+{
+	while(c->tracked_dbufs) {
+		dbuf *f = c->tracked_dbufs;
+
+		if(f->btype==DBUF_TYPE_IFILE || f->btype==DBUF_TYPE_OFILE ||
+			f->btype==DBUF_TYPE_FIFO)
+		{
+			de_fclose(f->fp);
+			f->fp = NULL;
+		}
+		untrack_dbuf(f);
+	}
+}
+
 // Create or open a file for writing, that is *not* one of the usual
 // "output.000.ext" files we extract from the input file.
 //
@@ -1123,17 +1388,25 @@ static void sanitize_ext(const char *ext1, char *ext, size_t extlen)
 }
 
 // Allow small writes to be coalesced, for more efficient callbacks, etc.
-// This may make writes less efficient in general, though, since FILE* I/O is
-// already buffered, and our membufs don't need caching.
+// This is done automatically for managed output files.
 //
-// Warning - Do not use unless the this file is going to be written
-// strictly sequentially (no write_at()...), and you call
-// dbuf_flush() when needed.
+// The dbuf functions flush the buffer when needed (before reading, write_at(),
+// etc.), but note that f->len does not include the buffered bytes. Use
+// dbuf_get_length(), or call dbuf_flush() before accessing f->len.
 void dbuf_enable_wbuffer(dbuf *f)
+{
+	dbuf_enable_wbuffer_ex(f, DE_WBUFFER_SIZE);
+}
+
+// Like dbuf_enable_wbuffer(), but the buffer starts at the given size, instead
+// of starting small and growing.
+void dbuf_enable_wbuffer_ex(dbuf *f, i64 initial_size)
 {
 	if(f->c->disable_wbuffer) return; // Feature is disabled globally
 	if(f->wbuffer) return;
-	f->wbuffer = de_malloc(f->c, DE_WBUFFER_SIZE);
+	if(initial_size<DE_WBUFFER_SIZE) initial_size = DE_WBUFFER_SIZE;
+	f->wbuffer = de_malloc(f->c, initial_size);
+	f->wbuffer_size = initial_size;
 }
 
 void dbuf_disable_wbuffer(dbuf *f)
@@ -1142,6 +1415,7 @@ void dbuf_disable_wbuffer(dbuf *f)
 	dbuf_flush(f);
 	de_free(f->c, f->wbuffer);
 	f->wbuffer = NULL;
+	f->wbuffer_size = 0;
 }
 
 dbuf *dbuf_create_output_file(deark *c, const char *ext1, de_finfo *fi,
@@ -1314,11 +1588,6 @@ dbuf *dbuf_create_output_file(deark *c, const char *ext1, de_finfo *fi,
 		dbuf_flush_lowlevel(c->extrlist_dbuf);
 	}
 
-	if(c->enable_wbuffer_test && !(createflags & DE_CREATEFLAG_NO_WBUFFER))
-	{
-		dbuf_enable_wbuffer(f);
-	}
-
 	if(c->enable_oinfo) {
 		f->crco_for_oinfo = de_crcobj_create(c, DE_CRCOBJ_CRC32_IEEE);
 	}
@@ -1335,12 +1604,16 @@ dbuf *dbuf_create_output_file(deark *c, const char *ext1, de_finfo *fi,
 	}
 
 	if(c->output_style==DE_OUTPUTSTYLE_ARCHIVE && c->archive_fmt==DE_ARCHIVEFMT_TAR) {
+		struct de_stats_timer tmr;
+
 		de_info(c, "Adding %s to TAR file", f->name);
 		f->btype = DBUF_TYPE_ODBUF;
 		// A dummy max_len_hard value. The parent will do the checking.
 		f->max_len_hard = DE_DUMMY_MAX_FILE_SIZE;
 		f->writing_to_tar_archive = 1;
+		de_stats_timer_start(c, &tmr);
 		de_tar_start_member_file(c, f);
+		de_stats_timer_stop(c, &tmr, DE_STATSCAT_OUTPUT, "tar_start_member");
 	}
 	else if(c->output_style==DE_OUTPUTSTYLE_ARCHIVE) { // ZIP
 		i64 initial_alloc;
@@ -1378,6 +1651,10 @@ dbuf *dbuf_create_output_file(deark *c, const char *ext1, de_finfo *fi,
 		}
 	}
 
+	if(f->btype!=DBUF_TYPE_NULL && !(createflags & DE_CREATEFLAG_NO_WBUFFER)) {
+		dbuf_enable_wbuffer(f);
+	}
+
 done:
 	de_free(c, name_from_finfo);
 	return f;
@@ -1414,6 +1691,69 @@ dbuf *dbuf_create_membuf(deark *c, i64 initialsize, UI flags)
 	return f;
 }
 
+// If f's memory is borrowed, replace it with a private copy, so that it can
+// be modified.
+static void membuf_unborrow(dbuf *f)
+{
+	u8 *newbuf;
+	i64 new_alloc_size;
+
+	if(!f->membuf_is_borrowed) return;
+	new_alloc_size = de_max_int(f->len, 1024);
+	newbuf = de_malloc(f->c, new_alloc_size);
+	de_memcpy(newbuf, f->membuf_buf, (size_t)f->len);
+	f->membuf_buf = newbuf;
+	f->membuf_alloc = new_alloc_size;
+	f->membuf_is_borrowed = 0;
+}
+
+// Things to do for all data written to f, before f->len is updated.
+static void account_for_write(dbuf *f, const u8 *m, i64 len)
+{
+	if(f->crco_for_oinfo) {
+		de_crcobj_addbuf(f->crco_for_oinfo, m, len);
+	}
+	if(f->writelistener_cb) {
+		f->writelistener_cb(f, f->userdata_for_writelistener, m, len);
+	}
+	if(f->c->stats) {
+		f->c->stats->dbuf_bytes_written[f->btype] += len;
+	}
+	if(f->c->dbuftrace) {
+		dbuf_trace(f, "write", f->len, len, "none");
+	}
+}
+
+// Make the (empty) membuf f contain the bytes at m, without copying them.
+// The caller must keep the memory valid, and unchanged, for as long as f is
+// open. If f is written to again, it makes a private copy first.
+// Falls back to dbuf_write() if necessary.
+static void membuf_write_borrowed(dbuf *f, const u8 *m, i64 len)
+{
+	if(f->btype!=DBUF_TYPE_MEMBUF || f->len!=0 || f->wbuffer_bytes_used!=0 ||
+		f->has_len_limit || len<=0)
+	{
+		dbuf_write(f, m, len);
+		return;
+	}
+
+	if(len > f->max_len_hard) {
+		do_on_dbuf_size_exceeded(f);
+	}
+	account_for_write(f, m, len);
+	if(f->c->debug_level>=4 && f->name) {
+		de_dbgx(f->c, 4, "borrowing %"I64_FMT" bytes for membuf %s", len, f->name);
+	}
+
+	if(!f->membuf_is_borrowed) {
+		de_free(f->c, f->membuf_buf);
+	}
+	f->membuf_buf = (u8*)m;
+	f->membuf_alloc = len;
+	f->membuf_is_borrowed = 1;
+	f->len = len;
+}
+
 static void membuf_append(dbuf *f, const u8 *m, i64 mlen)
 {
 	i64 new_alloc_size;
@@ -1425,6 +1765,7 @@ static void membuf_append(dbuf *f, const u8 *m, i64 mlen)
 	}
 
 	if(mlen<=0) return;
+	membuf_unborrow(f);
 
 	if(mlen > f->membuf_alloc - f->len) {
 		// Need to allocate more space
@@ -1438,7 +1779,9 @@ static void membuf_append(dbuf *f, const u8 *m, i64 mlen)
 		if(f->len + mlen > f->max_len_hard) {
 			do_on_dbuf_size_exceeded(f);
 		}
-		f->membuf_buf = de_realloc(f->c, f->membuf_buf, f->membuf_alloc, new_alloc_size);
+		// The new bytes are about to be written (or are beyond f->len, where
+		// they are never read), so don't bother zeroing them.
+		f->membuf_buf = de_realloc(f->c, f->membuf_buf, new_alloc_size, new_alloc_size);
 		f->membuf_alloc = new_alloc_size;
 	}
 
@@ -1446,6 +1789,33 @@ static void membuf_append(dbuf *f, const u8 *m, i64 mlen)
 	f->len += mlen;
 }
 
+// Tell f that about n more bytes are going to be written to it, so that it
+// can allocate the memory all at once. This is only a hint, and it's okay if
+// it is wrong.
+// Currently does nothing unless f is a membuf.
+void dbuf_reserve(dbuf *f, i64 n)
+{
+	i64 new_alloc_size;
+
+	if(f->btype!=DBUF_TYPE_MEMBUF || f->membuf_is_borrowed) return;
+	if(n<=0) return;
+
+	new_alloc_size = f->len + f->wbuffer_bytes_used + n;
+	if(f->has_len_limit && new_alloc_size > f->len_limit) {
+		new_alloc_size = f->len_limit;
+	}
+	if(new_alloc_size > f->max_len_hard) new_alloc_size = f->max_len_hard;
+	if(new_alloc_size > DE_MAX_MALLOC) new_alloc_size = DE_MAX_MALLOC;
+	if(new_alloc_size <= f->membuf_alloc) return;
+
+	if(f->c->debug_level>=4) {
+		de_dbgx(f->c, 4, "reserving membuf size %"I64_FMT" -> %"I64_FMT,
+			f->membuf_alloc, new_alloc_size);
+	}
+	f->membuf_buf = de_realloc(f->c, f->membuf_buf, new_alloc_size, new_alloc_size);
+	f->membuf_alloc = new_alloc_size;
+}
+
 // Not to be called directly. Used only by dbuf_write/dbuf_flush.
 static void dbuf_write_unbuffered(dbuf *f, const u8 *m, i64 len)
 {
@@ -1453,13 +1823,7 @@ static void dbuf_write_unbuffered(dbuf *f, const u8 *m, i64 len)
 	if(f->len + len > f->max_len_hard) {
 		do_on_dbuf_size_exceeded(f);
 	}
-
-	if(f->crco_for_oinfo) {
-		de_crcobj_addbuf(f->crco_for_oinfo, m, len);
-	}
-	if(f->writelistener_cb) {
-		f->writelistener_cb(f, f->userdata_for_writelistener, m, len);
-	}
+	account_for_write(f, m, len);
 
 	switch(f->btype) {
 	case DBUF_TYPE_OFILE:
@@ -1469,6 +1833,7 @@ static void dbuf_write_unbuffered(dbuf *f, const u8 *m, i64 len)
 			de_dbgx(f->c, 4, "writing %"I64_FMT" bytes to %s", len, f->name);
 		}
 		fwrite(m, 1, (size_t)len, f->fp);
+		if(f->c->stats) f->c->stats->num_fwrites++;
 		f->len += len;
 		return;
 	case DBUF_TYPE_MEMBUF:
@@ -1504,6 +1869,19 @@ void dbuf_flush(dbuf *f)
 	f->wbuffer_bytes_used = 0;
 }
 
+// Flush the write buffer, which is assumed to be full. If it's not already
+// at its maximum size, make it bigger.
+static void dbuf_flush_and_grow_wbuffer(dbuf *f)
+{
+	i64 new_size;
+
+	dbuf_flush(f);
+	if(f->wbuffer_size >= DE_WBUFFER_MAX_SIZE) return;
+	new_size = de_min_int(f->wbuffer_size*2, DE_WBUFFER_MAX_SIZE);
+	f->wbuffer = de_realloc(f->c, f->wbuffer, new_size, new_size);
+	f->wbuffer_size = new_size;
+}
+
 void dbuf_write(dbuf *f, const u8 *m, i64 len)
 {
 	if(!f->wbuffer) {
@@ -1513,7 +1891,7 @@ void dbuf_write(dbuf *f, const u8 *m, i64 len)
 
 	if(len<=0) return;
 
-	if(len > DE_WBUFFER_SIZE/2) {
+	if(len > f->wbuffer_size/2) {
 		// This item doesn't fit in the buffer, even by itself, or we
 		// consider it "large".
 		// Flush the buffer, write the item, done.
@@ -1524,11 +1902,11 @@ void dbuf_write(dbuf *f, const u8 *m, i64 len)
 		return;
 	}
 
-	if(f->wbuffer_bytes_used + len > DE_WBUFFER_SIZE) {
+	if(f->wbuffer_bytes_used + len > f->wbuffer_size) {
 		// This item fits in the buffer by itself, but currently the buffer
 		// is too full.
 		// Flush the buffer, copy the item to the buffer, done.
-		dbuf_flush(f);
+		dbuf_flush_and_grow_wbuffer(f);
 		de_memcpy(f->wbuffer, m, (size_t)len);
 		f->wbuffer_bytes_used = len;
 		return;
@@ -1539,10 +1917,34 @@ void dbuf_write(dbuf *f, const u8 *m, i64 len)
 	f->wbuffer_bytes_used += len;
 }
 
+int dbuf_create_file_from_slice(dbuf *inf, i64 pos, i64 data_size,
+	const char *ext, de_finfo *fi, UI createflags)
+{
+	dbuf *f;
+	const u8 *mem;
+
+	f = dbuf_create_output_file(inf->c, ext, fi, createflags);
+	if(!f) return 0;
+
+	// If the output file is a membuf (e.g. it's going into a ZIP archive), and
+	// the data is already in memory, let the output file borrow the memory
+	// instead of making a copy of it. This is safe only because we close the
+	// output file before returning.
+	mem = dbuf_get_direct_ptr(inf, pos, data_size);
+	if(mem && f->btype==DBUF_TYPE_MEMBUF) {
+		membuf_write_borrowed(f, mem, data_size);
+	}
+	else {
+		dbuf_copy(inf, pos, data_size, f);
+	}
+	dbuf_close(f);
+	return 1;
+}
+
 void dbuf_writebyte(dbuf *f, u8 n)
 {
 	// Optimization
-	if(f->wbuffer && f->wbuffer_bytes_used<DE_WBUFFER_SIZE) {
+	if(f->wbuffer_bytes_used<f->wbuffer_size) {
 		f->wbuffer[f->wbuffer_bytes_used++] = n;
 		return;
 	}
@@ -1561,9 +1963,19 @@ void dbuf_write_at(dbuf *f, i64 pos, const u8 *m, i64 len)
 		do_on_dbuf_size_exceeded(f);
 	}
 
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
+	if(f->c->stats) {
+		f->c->stats->dbuf_bytes_written[f->btype] += len;
+	}
+	if(f->c->dbuftrace) {
+		dbuf_trace(f, "write_at", pos, len, "none");
+	}
+
 	if(f->btype==DBUF_TYPE_MEMBUF) {
 		i64 amt_overwrite, amt_newzeroes, amt_append;
 
+		membuf_unborrow(f);
+
 		if(pos+len <= f->len) { // entirely within the current file
 			amt_overwrite = len;
 			amt_newzeroes = 0;
@@ -1585,6 +1997,7 @@ void dbuf_write_at(dbuf *f, i64 pos, const u8 *m, i64 len)
 		}
 		if(amt_newzeroes>0) {
 			dbuf_write_zeroes(f, amt_newzeroes);
+			dbuf_flush(f);
 		}
 		if(amt_append>0) {
 			membuf_append(f, &m[amt_overwrite], amt_append);
@@ -1594,8 +2007,10 @@ void dbuf_write_at(dbuf *f, i64 pos, const u8 *m, i64 len)
 		i64 curpos = de_ftell(f->fp);
 		if(pos != curpos) {
 			de_fseek(f->fp, pos, SEEK_SET);
+			if(f->c->stats) f->c->stats->num_fseeks++;
 		}
 		fwrite(m, 1, (size_t)len, f->fp);
+		if(f->c->stats) f->c->stats->num_fwrites++;
 		if(pos+len > f->len) {
 			f->len = pos+len;
 		}
@@ -1612,7 +2027,7 @@ void dbuf_write_at(dbuf *f, i64 pos, const u8 *m, i64 len)
 
 void dbuf_writebyte_at(dbuf *f, i64 pos, u8 n)
 {
-	if(f->btype==DBUF_TYPE_MEMBUF && pos>=0 && pos<f->len) {
+	if(f->btype==DBUF_TYPE_MEMBUF && pos>=0 && pos<f->len && !f->membuf_is_borrowed) {
 		// Fast path when overwriting a byte in a membuf
 		f->membuf_buf[pos] = n;
 		return;
@@ -1628,6 +2043,14 @@ void dbuf_write_run(dbuf *f, u8 n, i64 len)
 	i64 amt_to_write;
 
 	if(len<=0) return;
+
+	// Optimization: If the run fits in the write buffer, put it there directly.
+	if(f->wbuffer_bytes_used + len <= f->wbuffer_size) {
+		de_memset(&f->wbuffer[f->wbuffer_bytes_used], n, (size_t)len);
+		f->wbuffer_bytes_used += len;
+		return;
+	}
+
 	de_memset(buf, n, (size_t)len<sizeof(buf) ? (size_t)len : sizeof(buf));
 	amt_left = len;
 	while(amt_left > 0) {
@@ -1640,6 +2063,38 @@ void dbuf_write_run(dbuf *f, u8 n, i64 len)
 	}
 }
 
+// Write count copies of the unitsize-byte sequence at unit.
+void dbuf_write_unit_run(dbuf *f, const u8 *unit, i64 unitsize, i64 count)
+{
+	u8 buf[1024];
+	i64 units_per_buf;
+	i64 k;
+
+	if(count<=0 || unitsize<=0) return;
+	if(unitsize==1) {
+		dbuf_write_run(f, unit[0], count);
+		return;
+	}
+	if(unitsize > (i64)sizeof(buf)) {
+		for(k=0; k<count; k++) {
+			dbuf_write(f, unit, unitsize);
+		}
+		return;
+	}
+
+	units_per_buf = de_min_int((i64)sizeof(buf)/unitsize, count);
+	for(k=0; k<units_per_buf; k++) {
+		de_memcpy(&buf[k*unitsize], unit, (size_t)unitsize);
+	}
+	while(count>0) {
+		i64 n;
+
+		n = de_min_int(count, units_per_buf);
+		dbuf_write(f, buf, n*unitsize);
+		count -= n;
+	}
+}
+
 void dbuf_write_zeroes(dbuf *f, i64 len)
 {
 	dbuf_write_run(f, 0, len);
@@ -1875,6 +2330,18 @@ dbuf *dbuf_open_input_stdin(deark *c)
 	return f;
 }
 
+// Open a read-only dbuf whose contents are the given bytes, without copying
+// them. The caller must keep the memory valid, and unchanged, until the dbuf
+// is closed.
+dbuf *dbuf_open_input_mem(deark *c, const u8 *mem, i64 len)
+{
+	dbuf *f;
+
+	f = dbuf_create_membuf(c, 0, 0);
+	membuf_write_borrowed(f, mem, len);
+	return f;
+}
+
 dbuf *dbuf_open_input_subfile(dbuf *parent, i64 offset, i64 size)
 {
 	dbuf *f;
@@ -2029,13 +2496,21 @@ void dbuf_close(dbuf *f)
 	}
 
 	if(f->btype==DBUF_TYPE_MEMBUF && f->write_memfile_to_zip_archive) {
+		struct de_stats_timer tmr;
+
+		de_stats_timer_start(c, &tmr);
 		de_zip_add_file_to_archive(c, f);
+		de_stats_timer_stop(c, &tmr, DE_STATSCAT_OUTPUT, "zip_add_member");
 		if(f->name) {
 			de_dbg3(c, "closing memfile %s", f->name);
 		}
 	}
 	else if(f->writing_to_tar_archive) {
+		struct de_stats_timer tmr;
+
+		de_stats_timer_start(c, &tmr);
 		de_tar_end_member_file(c, f);
+		de_stats_timer_stop(c, &tmr, DE_STATSCAT_OUTPUT, "tar_end_member");
 	}
 
 	switch(f->btype) {
@@ -2079,12 +2554,17 @@ void dbuf_close(dbuf *f)
 		de_internal_err_nonfatal(c, "Don't know how to close this type of file (%d)", f->btype);
 	}
 
-	de_free(c, f->membuf_buf);
+	if(!f->membuf_is_borrowed) {
+		de_free(c, f->membuf_buf);
+	}
 	de_free(c, f->name);
 	de_free(c, f->rcache);
+	de_free(c, f->bcache);
+	de_free(c, f->bcache_blknum);
 	de_free(c, f->wbuffer);
 	if(f->crco_for_oinfo) de_crcobj_destroy(f->crco_for_oinfo);
 	if(f->fi_copy) de_finfo_destroy(c, f->fi_copy);
+	if(f->is_tracked) untrack_dbuf(f);
 	de_free(c, f);
 
 	if(c->total_output_size > c->max_total_output_size) {
@@ -2111,9 +2591,40 @@ void dbuf_empty(dbuf *f)
 const u8 *dbuf_get_membuf_direct_ptr(dbuf *f)
 {
 	if(f->btype != DBUF_TYPE_MEMBUF) return NULL;
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 	return f->membuf_buf;
 }
 
+// If bytes pos through pos+len-1 of f are all available in a contiguous block
+// of memory, returns a (read-only) pointer to them. Otherwise returns NULL.
+// This works for membufs, for the cached part of input files, and for input
+// subfiles of those things.
+// The memory is still owned by f (or its parent), and is only valid until
+// f is next modified or closed.
+const u8 *dbuf_get_direct_ptr(dbuf *f, i64 pos, i64 len)
+{
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
+	if(pos<0 || len<0 || pos+len>f->len) return NULL;
+
+	if(f->rcache && pos+len<=f->rcache_bytes_used) {
+		if(f->c->stats) dbuf_stats_count_read(f, len);
+		if(f->c->dbuftrace) dbuf_trace(f, "directptr", pos, len, "rcache");
+		return &f->rcache[pos];
+	}
+
+	switch(f->btype) {
+	case DBUF_TYPE_MEMBUF:
+		if(!f->membuf_buf) return NULL;
+		if(f->c->stats) dbuf_stats_count_read(f, len);
+		if(f->c->dbuftrace) dbuf_trace(f, "directptr", pos, len, "membuf");
+		return &f->membuf_buf[pos];
+	case DBUF_TYPE_IDBUF:
+		if(f->c->dbuftrace) dbuf_trace(f, "directptr", pos, len, "parent");
+		return dbuf_get_direct_ptr(f->parent_dbuf, f->offset_into_parent_dbuf+pos, len);
+	}
+	return NULL;
+}
+
 // Search a section of a dbuf for a given byte.
 // 'haystack_len' is the number of bytes to search.
 // Returns 0 if not found.
@@ -2150,14 +2661,22 @@ static int search_cbfn(struct de_bufferedreadctx *brctx, const u8 *buf,
 	if(buf_len < sctx->needle_len) return 0;
 	num_starting_positions_to_check = buf_len + 1 - sctx->needle_len;
 
-	for(i=0; i<num_starting_positions_to_check; i++) {
-		if(sctx->needle[0]==buf[i] &&
-			!de_memcmp(sctx->needle, &buf[i], (size_t)sctx->needle_len))
-		{
+	i = 0;
+	while(i<num_starting_positions_to_check) {
+		const u8 *p;
+
+		// Let memchr find candidates for the first byte; it's usually much
+		// faster than a simple loop.
+		p = de_memchr(&buf[i], (int)sctx->needle[0],
+			(size_t)(num_starting_positions_to_check-i));
+		if(!p) break;
+		i = (i64)(p-buf);
+		if(!de_memcmp(sctx->needle, &buf[i], (size_t)sctx->needle_len)) {
 			sctx->foundpos_rel = brctx->offset+i;
 			sctx->foundflag = 1;
 			return 0;
 		}
+		i++;
 	}
 
 	if(brctx->eof_flag) return 0;
@@ -2184,6 +2703,7 @@ int dbuf_search(dbuf *f, const u8 *needle, i64 needle_len,
 	struct search_ctx sctx;
 
 	*foundpos = 0;
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 
 	if(startpos < 0) {
 		haystack_len += startpos;
@@ -2259,6 +2779,7 @@ int dbuf_find_line(dbuf *f, i64 pos1, i64 *pcontent_len, i64 *ptotal_len)
 
 	*pcontent_len = 0;
 	*ptotal_len = 0;
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 	if(pos1<0 || pos1>=f->len) {
 		return 0;
 	}
@@ -2317,6 +2838,7 @@ i64 dbuf_get_length(dbuf *f)
 // May be valid only for memory buffers.
 void dbuf_set_length_limit(dbuf *f, i64 max_len)
 {
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 	f->has_len_limit = 1;
 	f->len_limit = max_len;
 }
@@ -2515,6 +3037,7 @@ int dbuf_buffered_read(dbuf *f, i64 pos1, i64 len,
 
 	brctx.c = f->c;
 	brctx.userdata = userdata;
+	if(f->wbuffer_bytes_used!=0) dbuf_flush(f);
 
 	if((pos1 < -DE_ALLOWED_VIRTUAL_BYTES) ||
 		(pos1 > f->len+DE_ALLOWED_VIRTUAL_BYTES) ||
@@ -2525,20 +3048,24 @@ int dbuf_buffered_read(dbuf *f, i64 pos1, i64 len,
 	}
 
 	if(len<=0) { // Get this special case out of the way.
+		if(f->c->dbuftrace) dbuf_trace(f, "bufread", pos1, 0, "none");
 		return buffered_read_zero_len(&brctx, cbfn);
 	}
 
 	// Use an optimized routine if all the data we need to read is already in memory.
 	if(f->rcache && (pos1>=0) && (pos1+len<=f->rcache_bytes_used)) {
+		if(f->c->dbuftrace) dbuf_trace(f, "bufread", pos1, len, "rcache");
 		return buffered_read_from_mem(&brctx, f, f->rcache, pos1, len, cbfn);
 	}
 
 	// Not an "optimization", since we promise this behavior for MEMBUFs.
 	if(f->btype==DBUF_TYPE_MEMBUF && (pos1>=0) && (pos1+len<=f->len)) {
+		if(f->c->dbuftrace) dbuf_trace(f, "bufread", pos1, len, "membuf");
 		return buffered_read_from_mem(&brctx, f, f->membuf_buf, pos1, len, cbfn);
 	}
 
 	// The general case:
+	if(f->c->dbuftrace) dbuf_trace(f, "bufread", pos1, len, "chunked");
 	return buffered_read_internal(&brctx, f, pos1, len, cbfn);
 }
 
@@ -2709,7 +3236,7 @@ void dbuf_copy_slice_convert_to_utf8(dbuf *inf, i64 pos, i64 len,
 	de_encconv_init(&tcctx.es, input_ee);
 	tcctx.tmpstr = ucstring_create(c);
 
-	if(c->write_bom && outf->len==0) {
+	if(c->write_bom && dbuf_get_length(outf)==0) {
 		if((flags & 0x3)!=0) {
 			already_has_BOM = slice_has_BOM(inf, pos, len, enc);
 		}
@@ -2784,6 +3311,31 @@ void de_bitbuf_lowlevel_empty(struct de_bitbuf_lowlevel *bbll)
 	bbll->nbits_in_bitbuf = 0;
 }
 
+// Returns the byte at pos, which must be less than bitrd->endpos.
+// Reads from f several bytes at a time, to avoid the overhead of
+// dbuf_getbyte().
+static u8 bitreader_getbyte_at(struct de_bitreader *bitrd, i64 pos)
+{
+	i64 n;
+
+	if(pos>=bitrd->readahead_pos &&
+		pos<bitrd->readahead_pos+(i64)bitrd->readahead_nbytes)
+	{
+		return bitrd->readahead[pos-bitrd->readahead_pos];
+	}
+
+	n = de_min_int(bitrd->endpos, bitrd->f->len) - pos;
+	if(n > (i64)sizeof(bitrd->readahead)) n = (i64)sizeof(bitrd->readahead);
+	if(n<1) {
+		bitrd->readahead_nbytes = 0;
+		return dbuf_getbyte(bitrd->f, pos);
+	}
+	dbuf_read(bitrd->f, bitrd->readahead, pos, n);
+	bitrd->readahead_pos = pos;
+	bitrd->readahead_nbytes = (UI)n;
+	return bitrd->readahead[0];
+}
+
 u64 de_bitreader_getbits(struct de_bitreader *bitrd, UI nbits)
 {
 	if(bitrd->eof_flag) return 0;
@@ -2804,13 +3356,53 @@ u64 de_bitreader_getbits(struct de_bitreader *bitrd, UI nbits)
 			bitrd->eof_flag = 1;
 			return 0;
 		}
-		b = dbuf_getbyte_p(bitrd->f, &bitrd->curpos);
+		b = bitreader_getbyte_at(bitrd, bitrd->curpos);
+		bitrd->curpos++;
 		de_bitbuf_lowlevel_add_byte(&bitrd->bbll, b);
 	}
 
 	return de_bitbuf_lowlevel_get_bits(&bitrd->bbll, nbits);
 }
 
+// Sets *pval to the value that de_bitreader_getbits(bitrd, nbits) would
+// return, without changing the state of the bitreader.
+// Returns 0 if there are not enough bits left, or on error.
+int de_bitreader_peekbits(struct de_bitreader *bitrd, UI nbits, u64 *pval)
+{
+	u64 v;
+	UI n;
+	i64 pos;
+
+	if(bitrd->eof_flag) return 0;
+	if(nbits==0 || nbits>48) return 0;
+
+	v = bitrd->bbll.bit_buf;
+	n = bitrd->bbll.nbits_in_bitbuf;
+	pos = bitrd->curpos;
+	while(n < nbits) {
+		u8 b;
+
+		if(pos >= bitrd->endpos) return 0;
+		b = bitreader_getbyte_at(bitrd, pos);
+		pos++;
+		if(bitrd->bbll.is_lsb) {
+			v |= (u64)b << n;
+		}
+		else {
+			v = (v<<8) | b;
+		}
+		n += 8;
+	}
+
+	if(bitrd->bbll.is_lsb) {
+		*pval = v & (((u64)1<<nbits)-1);
+	}
+	else {
+		*pval = (v>>(n-nbits)) & (((u64)1<<nbits)-1);
+	}
+	return 1;
+}
+
 // Empty the bitbuffer, and set ->curpos to the position of the next byte with
 // entirely unprocessed bits.
 // In other words, make it okay for the caller to read or change the ->curpos
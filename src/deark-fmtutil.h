@@ -206,6 +206,8 @@ struct de_dfilter_ctx {
 	dfilter_codec_command_type codec_command_fn;
 	dfilter_codec_finish_type codec_finish_fn;
 	dfilter_codec_destroy_type codec_destroy_fn;
+	const char *codec_name; // Optional, used by -stats
+	struct de_stats_timer stats_time;
 };
 
 enum de_lzwfmt_enum {
@@ -646,6 +648,8 @@ const char *de_dfilter_get_errmsg(deark *c, struct de_dfilter_results *dres);
 void de_dfilter_results_clear(deark *c, struct de_dfilter_results *dres);
 void de_dfilter_init_objects(deark *c, struct de_dfilter_in_params *dcmpri,
 	struct de_dfilter_out_params *dcmpro, struct de_dfilter_results *dres);
+void de_dfilter_reserve_output(deark *c, struct de_dfilter_in_params *dcmpri,
+	struct de_dfilter_out_params *dcmpro);
 
 struct de_riscos_file_attrs {
 	u8 file_type_known;
@@ -728,10 +732,15 @@ int fmtutil_huffman_make_canonical_code(deark *c, struct fmtutil_huffman_codeboo
 	struct fmtutil_huffman_code_builder *builder, UI flags, const char *title);
 
 typedef void (*fmtutil_lz77buffer_cb_type)(struct de_lz77buffer *rb, u8 n);
+typedef void (*fmtutil_lz77buffer_bufcb_type)(struct de_lz77buffer *rb,
+	const u8 *buf, UI n);
 
 struct de_lz77buffer {
 	void *userdata;
 	fmtutil_lz77buffer_cb_type writebyte_cb;
+	// Optional. If set, it is used instead of writebyte_cb when a run of
+	// bytes is copied from the history.
+	fmtutil_lz77buffer_bufcb_type writebuf_cb;
 	UI curpos; // Must be kept valid at all times (0...bufsize-1)
 	UI mask;
 	UI bufsize; // Required to be a power of 2
@@ -816,6 +825,8 @@ void fmtutil_detect_specialexe(deark *c, struct fmtutil_exe_info *ei,
 	struct fmtutil_specialexe_detection_data *edd);
 int fmtutil_scan_for_arj_data(dbuf *f, i64 startpos, i64 max_skip,
 	UI flags, i64 *pfoundpos);
+int fmtutil_detect_jpeg_len(deark *c, dbuf *f, i64 pos1, i64 len,
+	i64 *pjpeg_len, u8 *pis_jpegls);
 void fmtutil_get_std_jpeg_qtable(UI tbl_id, u8 tbl[64]);
 void fmtutil_write_std_jpeg_dht(dbuf *outf, UI tbl_id);
 UI fmtutil_detect_pklite_by_exe_ep(deark *c, const u8 *mem, i64 mem_len, UI flags);
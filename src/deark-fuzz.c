@@ -0,0 +1,226 @@
+// This file is part of Deark.
+// Copyright (C) 2026 Jason Summers
+// See the file COPYING for terms of use.
+
+// In-process fuzzing harness ("make deark-fuzz").
+// This is a developer tool. It is not part of the deark program.
+//
+// Each input is processed by a new deark object, in list mode, with messages
+// suppressed. The input file is read from memory, and output files are
+// discarded. A fatal error abandons the current input, instead of exiting.
+// Resource tracking is enabled, so that de_destroy() releases the memory and
+// files that were in use at the time.
+//
+// If DE_FUZZ_LIBFUZZER is defined, this provides LLVMFuzzerTestOneInput(),
+// for libFuzzer. Otherwise, it provides a main() that, with no arguments,
+// processes the input from stdin, or from AFL's persistent loop if built with
+// afl-clang-fast. With arguments, it replays the given files, and prints the
+// time taken by each one.
+// Set the environment variable DEARK_FUZZ_MODULE to run a specific module,
+// instead of autodetecting the format.
+
+#define DE_NOT_IN_MODULE
+#include "deark-config.h"
+#include "deark-private.h"
+#include "deark-user.h"
+#include <setjmp.h>
+
+#define FUZZ_MAX_INPUT_SIZE (16*1024*1024)
+
+struct fuzzctx {
+	const char *modname;
+	jmp_buf jbuf;
+	i64 num_fatal_errors;
+};
+
+static void fuzz_msgfn(deark *c, UI flags, const char *s)
+{
+	;
+}
+
+static void fuzz_fatalerrorfn(deark *c)
+{
+	struct fuzzctx *fctx = (struct fuzzctx*)de_get_userdata(c);
+
+	longjmp(fctx->jbuf, 1);
+}
+
+static void fuzz_init(struct fuzzctx *fctx)
+{
+	de_zeromem(fctx, sizeof(struct fuzzctx));
+	fctx->modname = getenv("DEARK_FUZZ_MODULE");
+	if(fctx->modname && !fctx->modname[0]) fctx->modname = NULL;
+}
+
+static void fuzz_run_one(struct fuzzctx *fctx, const u8 *data, i64 len)
+{
+	deark *c;
+
+	c = de_create();
+	de_set_userdata(c, (void*)fctx);
+	de_set_messages_callback(c, fuzz_msgfn);
+	de_set_fatalerror_callback(c, fuzz_fatalerrorfn);
+	de_set_std_option_int(c, DE_STDOPT_LISTMODE, 1);
+	de_set_std_option_int(c, DE_STDOPT_WARNINGS, 0);
+	de_set_std_option_int(c, DE_STDOPT_INFOMESSAGES, 0);
+	de_set_track_resources(c, 1);
+	if(fctx->modname) {
+		de_set_input_format(c, fctx->modname);
+	}
+	de_set_input_memory(c, data, len);
+
+	if(setjmp(fctx->jbuf)==0) {
+		de_run(c);
+	}
+	else {
+		fctx->num_fatal_errors++;
+	}
+	de_destroy(c);
+}
+
+#ifdef DE_FUZZ_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const u8 *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const u8 *data, size_t size)
+{
+	static struct fuzzctx *fctx = NULL;
+
+	if(!fctx) {
+		fctx = de_malloc(NULL, sizeof(struct fuzzctx));
+		fuzz_init(fctx);
+	}
+	fuzz_run_one(fctx, data, (i64)size);
+	return 0;
+}
+
+#else
+
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+__AFL_FUZZ_INIT();
+#endif
+
+// Reads at most FUZZ_MAX_INPUT_SIZE bytes. The caller must free the
+// returned buffer.
+static u8 *fuzz_read_file(FILE *fp, i64 *plen)
+{
+	u8 *buf;
+	i64 len = 0;
+	i64 alloc = 65536;
+
+	buf = de_malloc(NULL, alloc);
+	while(1) {
+		size_t n;
+
+		if(len >= alloc) {
+			if(alloc >= FUZZ_MAX_INPUT_SIZE) break;
+			buf = de_realloc(NULL, buf, alloc, alloc*2);
+			alloc *= 2;
+		}
+		n = fread(&buf[len], 1, (size_t)(alloc-len), fp);
+		if(n==0) break;
+		len += (i64)n;
+	}
+	*plen = len;
+	return buf;
+}
+
+static int fuzz_replay(struct fuzzctx *fctx, int argc, char **argv)
+{
+	int i;
+	int r;
+	int nruns = 1;
+	int retval = 0;
+
+	for(i=1; i<argc; i++) {
+		FILE *fp;
+		u8 *buf;
+		i64 len;
+		i64 t0, t1;
+
+		if(!de_strcmp(argv[i], "-n") && i+1<argc) {
+			nruns = de_atoi(argv[++i]);
+			if(nruns<1) nruns = 1;
+			continue;
+		}
+		if(!de_strcmp(argv[i], "-m") && i+1<argc) {
+			fctx->modname = argv[++i];
+			continue;
+		}
+
+		fp = fopen(argv[i], "rb");
+		if(!fp) {
+			fprintf(stderr, "Can't open %s\n", argv[i]);
+			retval = 1;
+			continue;
+		}
+		buf = fuzz_read_file(fp, &len);
+		fclose(fp);
+
+		fctx->num_fatal_errors = 0;
+		t0 = de_get_monotonic_time_ns();
+		for(r=0; r<nruns; r++) {
+			fuzz_run_one(fctx, buf, len);
+		}
+		t1 = de_get_monotonic_time_ns();
+		printf("%s\t%"I64_FMT"\t%.3f ms%s\n", argv[i], len,
+			(double)(t1-t0)/1000000.0/(double)nruns,
+			fctx->num_fatal_errors ? "\tfatal error" : "");
+		de_free(NULL, buf);
+	}
+	return retval;
+}
+
+int main(int argc, char **argv)
+{
+	struct fuzzctx *fctx;
+	int retval = 0;
+
+	fctx = de_malloc(NULL, sizeof(struct fuzzctx));
+	fuzz_init(fctx);
+
+	if(argc>1) {
+		retval = fuzz_replay(fctx, argc, argv);
+		goto done;
+	}
+
+#ifdef __AFL_HAVE_MANUAL_CONTROL
+	__AFL_INIT();
+#endif
+
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+	// AFL persistent mode, with the input in shared memory
+	{
+		const u8 *buf = __AFL_FUZZ_TESTCASE_BUF;
+
+		while(__AFL_LOOP(10000)) {
+			fuzz_run_one(fctx, buf, (i64)__AFL_FUZZ_TESTCASE_LEN);
+		}
+	}
+#else
+	{
+		u8 *buf;
+		i64 len;
+
+#ifdef __AFL_LOOP
+		// AFL persistent mode, with the input from stdin
+		while(__AFL_LOOP(10000)) {
+			clearerr(stdin);
+			buf = fuzz_read_file(stdin, &len);
+			fuzz_run_one(fctx, buf, len);
+			de_free(NULL, buf);
+		}
+#else
+		buf = fuzz_read_file(stdin, &len);
+		fuzz_run_one(fctx, buf, len);
+		de_free(NULL, buf);
+#endif
+	}
+#endif
+
+done:
+	de_free(NULL, fctx);
+	return retval;
+}
+
+#endif
@@ -396,6 +396,7 @@ DE_MODULE(de_module_d64)
 DE_MODULE(de_module_base64)
 DE_MODULE(de_module_base16)
 DE_MODULE(de_module_jpegscan)
+DE_MODULE(de_module_carve)
 DE_MODULE(de_module_ole1)
 DE_MODULE(de_module_olepropset)
 DE_MODULE(de_module_officeart)
@@ -24,6 +24,12 @@
 #define CODE_tEXt 0x74455874U
 #define CODE_tIME 0x74494d45U
 
+struct IDAT_write_userdata_struct {
+	struct deark_png_encode_info *pei;
+	dbuf *cdbuf;
+	int IDAT_count;
+};
+
 struct deark_png_encode_info {
 	deark *c;
 	dbuf *outf;
@@ -48,6 +54,12 @@ struct deark_png_encode_info {
 	struct de_crcobj *crco;
 	size_t dst_rowspan;
 	u8 *tmprow;
+	// Things that persist between the "begin" and "end" phases
+	dbuf *cdbuf;
+	dbuf *outf_IDAT;
+	struct fmtutil_tdefl_ctx *tdctx;
+	struct IDAT_write_userdata_struct iwu;
+	int rows_written;
 };
 
 static void write_png_chunk_from_mem(struct deark_png_encode_info *pei,
@@ -165,12 +177,6 @@ static void write_png_chunk_tEXt(struct deark_png_encode_info *pei,
 	write_png_chunk_from_cdbuf(pei, cdbuf, CODE_tEXt);
 }
 
-struct IDAT_write_userdata_struct {
-	struct deark_png_encode_info *pei;
-	dbuf *cdbuf;
-	int IDAT_count;
-};
-
 static void my_IDAT_write_cb(dbuf *f, void *userdata,
 	const u8 *mem_orig, i64 memsize_orig)
 {
@@ -210,10 +216,13 @@ static void my_IDAT_write_cb(dbuf *f, void *userdata,
 	}
 }
 
-static void compress_png_row(struct deark_png_encode_info *pei, struct fmtutil_tdefl_ctx *tdctx,
-	int y)
+// img (and imglo, if used) must have the same width and bytes/pixel as the
+// image being written. Row y of it is the next row to be written.
+static void compress_png_row(struct deark_png_encode_info *pei,
+	de_bitmap *img, de_bitmap *imglo, int y)
 {
 	static const char nulbyte = '\0';
+	struct fmtutil_tdefl_ctx *tdctx = pei->tdctx;
 
 	// Filter byte
 	fmtutil_tdefl_compress_buffer(tdctx, &nulbyte, 1, FMTUTIL_TDEFL_NO_FLUSH);
@@ -232,7 +241,7 @@ static void compress_png_row(struct deark_png_encode_info *pei, struct fmtutil_t
 			u8 k;
 
 			// We just use the red sample, like DE_COLOR_K().
-			k = pei->img->bitmap[y*pei->src_rowspan + x*pei->img->bytes_per_pixel];
+			k = img->bitmap[y*pei->src_rowspan + x*img->bytes_per_pixel];
 			if(k>=0x80) {
 				pei->tmprow[x/8] |= 1U<<(7-x%8);
 			}
@@ -240,7 +249,7 @@ static void compress_png_row(struct deark_png_encode_info *pei, struct fmtutil_t
 
 		fmtutil_tdefl_compress_buffer(tdctx, pei->tmprow, pei->dst_rowspan, FMTUTIL_TDEFL_NO_FLUSH);
 	}
-	else if(pei->imglo) {
+	else if(imglo) {
 		int x;
 
 		if(pei->tmprow) {
@@ -251,38 +260,51 @@ static void compress_png_row(struct deark_png_encode_info *pei, struct fmtutil_t
 		}
 
 		for(x=0; x<pei->samples_per_row; x++) {
-			pei->tmprow[x*2] = pei->img->bitmap[y*pei->src_rowspan + x];
-			pei->tmprow[x*2+1] = pei->imglo->bitmap[y*pei->src_rowspan + x];
+			pei->tmprow[x*2] = img->bitmap[y*pei->src_rowspan + x];
+			pei->tmprow[x*2+1] = imglo->bitmap[y*pei->src_rowspan + x];
 		}
 
 		fmtutil_tdefl_compress_buffer(tdctx, pei->tmprow, pei->dst_rowspan, FMTUTIL_TDEFL_NO_FLUSH);
 	}
 	else {
-		fmtutil_tdefl_compress_buffer(tdctx, &pei->img->bitmap[y*pei->src_rowspan],
+		fmtutil_tdefl_compress_buffer(tdctx, &img->bitmap[y*pei->src_rowspan],
 			pei->dst_rowspan, FMTUTIL_TDEFL_NO_FLUSH);
 	}
+	pei->rows_written++;
 }
 
-static int write_png_chunk_IDATs(struct deark_png_encode_info *pei, dbuf *cdbuf)
+// For rows that the caller never supplied.
+static void compress_png_blank_row(struct deark_png_encode_info *pei)
+{
+	static const char nulbyte = '\0';
+
+	if(pei->tmprow) {
+		de_zeromem(pei->tmprow, pei->dst_rowspan);
+	}
+	else {
+		pei->tmprow = de_malloc(pei->c, pei->dst_rowspan);
+	}
+
+	fmtutil_tdefl_compress_buffer(pei->tdctx, &nulbyte, 1, FMTUTIL_TDEFL_NO_FLUSH);
+	fmtutil_tdefl_compress_buffer(pei->tdctx, pei->tmprow, pei->dst_rowspan,
+		FMTUTIL_TDEFL_NO_FLUSH);
+	pei->rows_written++;
+}
+
+static void start_png_chunk_IDATs(struct deark_png_encode_info *pei)
 {
-	int y;
-	int retval = 0;
 	deark *c = pei->c;
-	struct fmtutil_tdefl_ctx *tdctx = NULL;
 	static const unsigned int my_s_tdefl_num_probes[11] = { 0, 1, 6, 32,  16, 32, 128, 256,  512, 768, 1500 };
-	dbuf *outf_IDAT = NULL;
-	struct IDAT_write_userdata_struct iwu;
 
-	de_zeromem(&iwu, sizeof(struct IDAT_write_userdata_struct));
-	iwu.pei = pei;
-	iwu.cdbuf = cdbuf;
+	pei->iwu.pei = pei;
+	pei->iwu.cdbuf = pei->cdbuf;
 
-	outf_IDAT = dbuf_create_custom_dbuf(c, 0, 0);
-	outf_IDAT->userdata_for_customwrite = (void*)&iwu;
-	outf_IDAT->customwrite_fn = my_IDAT_write_cb;
+	pei->outf_IDAT = dbuf_create_custom_dbuf(c, 0, 0);
+	pei->outf_IDAT->userdata_for_customwrite = (void*)&pei->iwu;
+	pei->outf_IDAT->customwrite_fn = my_IDAT_write_cb;
 
 	// compress image data
-	tdctx = fmtutil_tdefl_create(c, outf_IDAT,
+	pei->tdctx = fmtutil_tdefl_create(c, pei->outf_IDAT,
 		my_s_tdefl_num_probes[MY_MZ_MIN(10, pei->level)] | MY_TDEFL_WRITE_ZLIB_HEADER);
 
 	if(pei->encode_as_bwimg) {
@@ -292,37 +314,36 @@ static int write_png_chunk_IDATs(struct deark_png_encode_info *pei, dbuf *cdbuf)
 		pei->dst_rowspan = (size_t)pei->width * (size_t)pei->num_chans;
 		if(pei->imglo) pei->dst_rowspan *= 2;
 	}
+}
 
-	for (y = 0; y<pei->height; y++) {
-		compress_png_row(pei, tdctx, (pei->flip ? (pei->height - 1 - y) : y));
+static int finish_png_chunk_IDATs(struct deark_png_encode_info *pei)
+{
+	while(pei->rows_written < pei->height) {
+		compress_png_blank_row(pei);
 	}
 
-	if (fmtutil_tdefl_compress_buffer(tdctx, NULL, 0, FMTUTIL_TDEFL_FINISH) !=
+	if (fmtutil_tdefl_compress_buffer(pei->tdctx, NULL, 0, FMTUTIL_TDEFL_FINISH) !=
 		FMTUTIL_TDEFL_STATUS_DONE)
 	{
-		goto done;
+		return 0;
 	}
 
-	if(cdbuf->len>0 || iwu.IDAT_count==0) {
-		write_png_chunk_from_cdbuf(pei, cdbuf, CODE_IDAT);
+	if(pei->cdbuf->len>0 || pei->iwu.IDAT_count==0) {
+		write_png_chunk_from_cdbuf(pei, pei->cdbuf, CODE_IDAT);
 	}
 
-	retval = 1;
-
-done:
-	fmtutil_tdefl_destroy(tdctx);
-	dbuf_close(outf_IDAT);
-	return retval;
+	return 1;
 }
 
-static int do_generate_png(struct deark_png_encode_info *pei, const u8 *src_pixels)
+// Writes everything that comes before the pixel data.
+static void start_generate_png(struct deark_png_encode_info *pei)
 {
 	static const u8 pngsig[8] = { 0x89,0x50,0x4e,0x47,0x0d,0x0a,0x1a,0x0a };
-	dbuf *cdbuf = NULL;
-	int retval = 0;
+	dbuf *cdbuf;
 
 	// A membuf that we'll use and reuse for each chunk's data
-	cdbuf = dbuf_create_membuf(pei->c, 64, 0);
+	pei->cdbuf = dbuf_create_membuf(pei->c, 64, 0);
+	cdbuf = pei->cdbuf;
 
 	dbuf_write(pei->outf, pngsig, 8);
 
@@ -354,29 +375,46 @@ static int do_generate_png(struct deark_png_encode_info *pei, const u8 *src_pixe
 	}
 
 	dbuf_truncate(cdbuf, 0);
-	if(!write_png_chunk_IDATs(pei, cdbuf)) goto done;
+	start_png_chunk_IDATs(pei);
+}
 
-	dbuf_truncate(cdbuf, 0);
-	write_png_chunk_from_cdbuf(pei, cdbuf, CODE_IEND);
-	retval = 1;
+static int finish_generate_png(struct deark_png_encode_info *pei)
+{
+	if(!finish_png_chunk_IDATs(pei)) return 0;
 
-done:
-	dbuf_close(cdbuf);
-	return retval;
+	dbuf_truncate(pei->cdbuf, 0);
+	write_png_chunk_from_cdbuf(pei, pei->cdbuf, CODE_IEND);
+	return 1;
+}
+
+static void destroy_pei(deark *c, struct deark_png_encode_info *pei)
+{
+	if(!pei) return;
+	fmtutil_tdefl_destroy(pei->tdctx);
+	dbuf_close(pei->outf_IDAT);
+	dbuf_close(pei->cdbuf);
+	de_crcobj_destroy(pei->crco);
+	de_free(c, pei->tmprow);
+	de_free(c, pei);
 }
 
+// Starts writing a PNG image, up to the point where the pixel data begins.
+// wp->img supplies the dimensions and bytes/pixel. Its pixels are not used,
+// and need not be allocated.
+// The pixels are then supplied by de_write_png_rows(), and the image is
+// completed by de_write_png_end().
+// Returns NULL if there is nothing to write (including when the image is
+// invalid, and in list mode). The other functions accept NULL, and do
+// nothing.
 // wp->flags2:
 //   0x1 = image can be encoded as bi-level, black&white, opaque
 //   0x2 = linear colorspace
-int de_write_png(deark *c, struct de_write_image_params *wp)
+struct deark_png_encode_info *de_write_png_begin(deark *c,
+	struct de_write_image_params *wp)
 {
 	const char *opt_level;
-	int retval = 0;
 	struct deark_png_encode_info *pei = NULL;
 
-	pei = de_malloc(c, sizeof(struct deark_png_encode_info));
-	pei->c = c;
-
 	if(wp->img->invalid_image_flag) {
 		goto done;
 	}
@@ -389,6 +427,9 @@ int de_write_png(deark *c, struct de_write_image_params *wp)
 		goto done;
 	}
 
+	pei = de_malloc(c, sizeof(struct deark_png_encode_info));
+	pei->c = c;
+
 	pei->img = wp->img;
 	pei->imglo = wp->imglo;
 	if(wp->flags2 & 0x1) {
@@ -474,18 +515,63 @@ int de_write_png(deark *c, struct de_write_image_params *wp)
 
 	pei->crco = de_crcobj_create(c, DE_CRCOBJ_CRC32_IEEE);
 
-	if(!do_generate_png(pei, wp->img->bitmap)) {
+	start_generate_png(pei);
+
+done:
+	return pei;
+}
+
+// Compresses the first nrows rows of img, which must have the same width and
+// bytes/pixel as the image passed to de_write_png_begin(). Rows are written
+// in top-down order. Flipping is not supported. Excess rows are ignored.
+void de_write_png_rows(struct deark_png_encode_info *pei, de_bitmap *img,
+	i64 nrows)
+{
+	i64 y;
+
+	if(!pei) return;
+	if(!img->bitmap) return;
+	if(img->width!=pei->img->width || img->bytes_per_pixel!=pei->num_chans) return;
+	if(pei->imglo) return; // 16-bit images are not supported
+
+	for(y=0; y<nrows && y<img->height; y++) {
+		if(pei->rows_written >= pei->height) break;
+		compress_png_row(pei, img, NULL, (int)y);
+	}
+}
+
+// Any rows that were not supplied are written as zero bytes.
+// Also destroys pei.
+int de_write_png_end(struct deark_png_encode_info *pei)
+{
+	deark *c;
+	int retval = 0;
+
+	if(!pei) return 0;
+	c = pei->c;
+	if(!finish_generate_png(pei)) {
 		de_err(c, "PNG write failed");
 		goto done;
 	}
-
 	retval = 1;
 
 done:
-	if(pei) {
-		de_crcobj_destroy(pei->crco);
-		de_free(c, pei->tmprow);
-		de_free(c, pei);
-	}
+	destroy_pei(c, pei);
 	return retval;
 }
+
+int de_write_png(deark *c, struct de_write_image_params *wp)
+{
+	struct deark_png_encode_info *pei;
+	int y;
+
+	pei = de_write_png_begin(c, wp);
+	if(!pei) return 0;
+
+	for(y=0; y<pei->height; y++) {
+		compress_png_row(pei, pei->img, pei->imglo,
+			(pei->flip ? (pei->height - 1 - y) : y));
+	}
+
+	return de_write_png_end(pei);
+}
@@ -90,6 +90,12 @@ typedef int (*de_module_identify_fn)(deark *c);
 
 typedef void (*de_module_help_fn)(deark *c);
 
+// Called by the "carve" module when the module's carve_sig is found at
+// sigpos. If there seems to be a file of this format there, sets *ppos and
+// *plen to its location (which need not start at sigpos), and returns nonzero.
+typedef int (*de_module_carve_fn)(deark *c, dbuf *f, i64 sigpos,
+	i64 *ppos, i64 *plen);
+
 struct deark_module_info {
 	const char *id;
 	const char *desc;
@@ -110,6 +116,16 @@ struct deark_module_info {
 	u32 unique_id; // or 0. Rarely used.
 #define DE_MAX_MODULE_ALIASES 2
 	const char *id_alias[DE_MAX_MODULE_ALIASES];
+	// Optional support for finding embedded files of this format (see the
+	// "carve" module): a signature that every such file contains, and a
+	// function to find the file's location. If carve_extract is set, such
+	// files are extracted as-is, instead of being decoded by this module
+	// (for modules that don't extract the file itself).
+#define DE_MAX_CARVE_SIGLEN 8
+	const char *carve_sig;
+	u8 carve_siglen;
+	u8 carve_extract;
+	de_module_carve_fn carve_fn;
 };
 typedef void (*de_module_getinfo_fn)(deark *c, struct deark_module_info *mi);
 
@@ -180,6 +196,7 @@ struct dbuf_struct {
 	i64 file_pos;
 
 	i64 wbuffer_bytes_used;
+	i64 wbuffer_size; // Allocated size of wbuffer
 	u8 *wbuffer;
 
 	struct dbuf_struct *parent_dbuf; // used for DBUF_TYPE_DBUF
@@ -189,10 +206,12 @@ struct dbuf_struct {
 	u8 writing_to_tar_archive;
 	u8 is_output_archive;
 	int file_id; // if managed
+	i64 trace_id; // Used with the dbuf:trace option
 	char *name; // used for DBUF_TYPE_OFILE (utf-8)
 
 	i64 membuf_alloc;
 	u8 *membuf_buf;
+	u8 membuf_is_borrowed; // membuf_buf is owned by some other object
 
 	struct de_crcobj *crco_for_oinfo;
 
@@ -209,8 +228,19 @@ struct dbuf_struct {
 	i64 rcache_bytes_used;
 	u8 *rcache; // first 'cache_bytes_used' bytes of the file
 
+	// Optional cache of recently-used blocks (see dbuf_enable_block_cache()).
+	i64 bcache_blksize;
+	i64 bcache_nblocks;
+	i64 *bcache_blknum; // The block number in each slot, or -1
+	u8 *bcache;
+
 	// Things copied from the de_finfo object at file creation
 	de_finfo *fi_copy;
+
+	// Links in c->tracked_dbufs
+	u8 is_tracked;
+	struct dbuf_struct *tracked_prev;
+	struct dbuf_struct *tracked_next;
 };
 
 // Image density (resolution) settings
@@ -292,6 +322,7 @@ struct de_detection_data_struct {
 	u8 SAUCE_detection_attempted;
 	u8 zip_eocd_looked_for;
 	u8 zip_eocd_found;
+	dbuf *zip_eocd_f; // The file that the zip_eocd_* fields refer to
 	i64 zip_eocd_pos; // valid if zip_eocd_found
 	struct de_SAUCE_detection_data sauce;
 	struct de_ID3_detection_data id3;
@@ -355,6 +386,88 @@ struct de_mp_data {
 	struct de_mp_item *item; // array[alloc]
 };
 
+// Performance statistics, for the -stats option. Allocated only if
+// statistics were requested, so the usual test is "if(c->stats)".
+#define DE_STATS_NUM_DBUF_TYPES 10
+#define DE_STATSCAT_IDENTIFY 1 // identify_fn, by module
+#define DE_STATSCAT_MODULE   2 // run_fn, by module
+#define DE_STATSCAT_LEVEL    3 // run_fn, by module nesting level
+#define DE_STATSCAT_CODEC    4 // decompressors
+#define DE_STATSCAT_OUTPUT   5 // image conversion, and archive writers
+
+struct de_stats_timer {
+	i64 wall_ns;
+	i64 cpu_ns;
+	i64 bytes_read;
+};
+
+struct de_stats_item {
+	UI category; // DE_STATSCAT_*
+	const char *name; // Static string, not owned by this struct
+	i64 count;
+	struct de_stats_timer t;
+	i64 hits; // DE_STATSCAT_IDENTIFY: Number of times the module claimed the file
+	i64 wins; // DE_STATSCAT_IDENTIFY: Number of times the module was chosen
+	int level; // DE_STATSCAT_LEVEL: The module nesting level
+	i64 hash_next; // 1 + index of the next item in the same hash chain, or 0
+};
+
+struct de_dbuftrace_struct;
+
+// Memory allocation accounting, used by -stats and -maxmem.
+// Allocations made with a NULL deark object are not counted.
+#define DE_MEMACCT_NUM_BIG_ALLOCS 10
+
+struct de_memacct_module {
+	const char *name; // Module id, or "(none)"
+	i64 num_allocs; // Including reallocations
+	i64 bytes_allocated; // Total size of allocations, and growth by realloc
+	i64 largest; // Largest single allocation
+	i64 peak_bytes; // Highest memory use when this module allocated memory
+};
+
+struct de_memacct_big_alloc {
+	const char *module;
+	i64 size;
+	u8 is_realloc;
+};
+
+struct de_memacct_struct {
+	i64 max_bytes; // The memory limit (-maxmem). 0 = no limit.
+	i64 cur_bytes;
+	i64 peak_bytes;
+	i64 num_allocs;
+	i64 num_reallocs;
+	i64 num_frees;
+	i64 nmodules;
+	i64 modules_alloc;
+	struct de_memacct_module *modules; // array[modules_alloc]
+	i64 curr_module_idx; // The module we last looked up, or -1
+	// Sorted by decreasing size
+	struct de_memacct_big_alloc big_allocs[DE_MEMACCT_NUM_BIG_ALLOCS];
+};
+
+#define DE_STATS_HASH_SIZE 256
+
+struct de_stats_struct {
+	struct de_stats_timer start_time;
+	i64 num_items;
+	i64 items_alloc;
+	struct de_stats_item *items; // array[items_alloc]
+	// 1 + index of the first item in each hash chain, or 0. Indexed by
+	// (category, name) hash.
+	i64 hash[DE_STATS_HASH_SIZE];
+	// Bytes read by dbuf_read() etc., not counting reads that are passed on
+	// to a parent dbuf.
+	i64 bytes_read;
+	i64 dbuf_bytes_read[DE_STATS_NUM_DBUF_TYPES]; // Indexed by DBUF_TYPE_*
+	i64 dbuf_bytes_written[DE_STATS_NUM_DBUF_TYPES];
+	i64 num_fseeks;
+	i64 num_freads;
+	i64 fread_bytes;
+	i64 num_fwrites;
+};
+
 #define DE_FONTFMT_AUTO 1
 #define DE_FONTFMT_FONT 2
 #define DE_FONTFMT_IMAGE 3
@@ -366,6 +479,10 @@ struct deark_struct {
 	////////////////////////////////////////////////////
 	int module_nesting_level;
 
+	// The module that is running, or whose identify() function is running.
+	// Used for diagnostics. Can be NULL.
+	const char *curr_module_id;
+
 	// Data specific to the current module.
 
 	// TODO: There really ought to be a stack of standard-module-local data
@@ -399,6 +516,8 @@ struct deark_struct {
 	u8 serious_error_flag;
 
 	const char *input_filename;
+	const u8 *input_mem; // Used if input_style==DE_INPUTSTYLE_MEMORY
+	i64 input_mem_len;
 	const char *input_format_req; // Format requested
 	const char *modcodes_req;
 	i64 slice_start_req; // Used if we're only to look at part of the file.
@@ -457,12 +576,12 @@ struct deark_struct {
 	de_msgfn_type msgfn; // Caller's message output function
 	de_specialmsgfn_type specialmsgfn;
 	de_fatalerrorfn_type fatalerrorfn;
+	u8 fatal_error_occurred; // Set by de_fatalerror()
 	const char *dprefix;
 
 	u8 deflate_decoder_id;
 	u8 tmpflag1;
 	u8 tmpflag2;
-	u8 enable_wbuffer_test;
 	u8 disable_wbuffer;
 	u8 pngcprlevel_valid;
 	UI pngcmprlevel;
@@ -481,6 +600,12 @@ struct deark_struct {
 	const char *nodetectmods_string;
 
 	struct de_timestamp current_time;
+	struct de_stats_struct *stats;
+	struct de_dbuftrace_struct *dbuftrace; // Used with the dbuf:trace option
+	struct de_memacct_struct *memacct;
+	// Resource tracking (see de_set_track_resources()). NULL if not enabled.
+	struct de_memhdr *tracked_allocs;
+	dbuf *tracked_dbufs; // Open dbufs that were created with tracking enabled
 
 	de_module_register_fn_type module_register_fn;
 
@@ -515,6 +640,26 @@ int de_run_module_by_id_on_slice2(deark *c, const char *id, const char *codes,
 	dbuf *f, i64 pos, i64 len);
 int de_get_module_idx_by_id(deark *c, const char *module_id);
 struct deark_module_info *de_get_module_by_id(deark *c, const char *module_id);
+int de_identify_module_on_slice(deark *c, struct deark_module_info *mi,
+	dbuf *f, i64 pos, i64 len);
+
+void de_stats_create(deark *c);
+void de_stats_destroy(deark *c);
+void de_stats_report(deark *c);
+void de_stats_timer_start(deark *c, struct de_stats_timer *tmr);
+void de_stats_timer_pause(deark *c, const struct de_stats_timer *tmr,
+	struct de_stats_timer *total);
+void de_stats_record(deark *c, UI category, const char *name,
+	const struct de_stats_timer *elapsed);
+void de_stats_timer_stop(deark *c, const struct de_stats_timer *tmr,
+	UI category, const char *name);
+void de_stats_add_identify_counts(deark *c, const char *name, i64 nhits,
+	i64 nwins);
+
+void de_memacct_create(deark *c);
+void de_memacct_destroy(deark *c);
+void de_memtrack_create(deark *c);
+void de_memtrack_destroy(deark *c, int free_blocks);
 
 void de_strlcpy(char *dst, const char *src, size_t dstlen);
 char *de_strchr(const char *s, int c);
@@ -547,6 +692,26 @@ void de_dbg3(deark *c, const char *fmt, ...)
   de_gnuc_attribute ((format (printf, 2, 3)));
 void de_dbgx(deark *c, int lv, const char *fmt, ...)
   de_gnuc_attribute ((format (printf, 3, 4)));
+
+// Debug messages above this level are compiled out, to the extent possible.
+// E.g., build with -DDE_MAX_DEBUG_LEVEL=2 to remove the "-d3" messages.
+#ifndef DE_MAX_DEBUG_LEVEL
+#define DE_MAX_DEBUG_LEVEL 99
+#endif
+
+// Nonzero if debug messages of level lv are to be printed.
+#define de_dbg_enabled(c, lv) ((lv)<=DE_MAX_DEBUG_LEVEL && (c)->debug_level>=(lv))
+
+// DE_DBG, DE_DBG2, DE_DBG3: Same as de_dbg, etc., except that the arguments
+// are not evaluated unless the message will be printed. Use these in
+// frequently-executed code, and when an argument is expensive to compute.
+// c must not be NULL.
+#define DE_DBG(c, ...) \
+	do { if(de_dbg_enabled((c), 1)) de_dbg((c), __VA_ARGS__); } while(0)
+#define DE_DBG2(c, ...) \
+	do { if(de_dbg_enabled((c), 2)) de_dbg2((c), __VA_ARGS__); } while(0)
+#define DE_DBG3(c, ...) \
+	do { if(de_dbg_enabled((c), 3)) de_dbg3((c), __VA_ARGS__); } while(0)
 void de_info(deark *c, const char *fmt, ...)
   de_gnuc_attribute ((format (printf, 2, 3)));
 void de_msg(deark *c, const char *fmt, ...)
@@ -641,6 +806,12 @@ struct de_write_image_params { // internal use
 	UI flags2;
 };
 int de_write_png(deark *c, struct de_write_image_params *wp);
+struct deark_png_encode_info;
+struct deark_png_encode_info *de_write_png_begin(deark *c,
+	struct de_write_image_params *wp);
+void de_write_png_rows(struct deark_png_encode_info *pei, de_bitmap *img,
+	i64 nrows);
+int de_write_png_end(struct deark_png_encode_info *pei);
 
 ///////////////////////////////////////////
 
@@ -658,6 +829,8 @@ u64 de_getu64be_direct(const u8 *m);
 u64 de_getu64le_direct(const u8 *m);
 
 void dbuf_read(dbuf *f, u8 *buf, i64 pos, i64 len);
+void dbuf_enable_block_cache(dbuf *f, i64 blksize, i64 max_mem);
+void dbuf_prefetch(dbuf *f, i64 pos, i64 len);
 i64 dbuf_standard_read(dbuf *f, u8 *buf, i64 n, i64 *fpos);
 
 u8 dbuf_getbyte(dbuf *f, i64 pos);
@@ -758,6 +931,7 @@ dbuf *dbuf_open_input_file_ex(deark *c, const char *fn, UI flags);
 dbuf *dbuf_create_unmanaged_file_stdout(deark *c, const char *name);
 dbuf *dbuf_open_input_file(deark *c, const char *fn);
 dbuf *dbuf_open_input_stdin(deark *c);
+dbuf *dbuf_open_input_mem(deark *c, const u8 *mem, i64 len);
 dbuf *dbuf_open_input_subfile(dbuf *parent, i64 offset, i64 size);
 dbuf *dbuf_create_custom_dbuf(deark *c, i64 apparent_size, UI flags);
 
@@ -767,8 +941,14 @@ dbuf *dbuf_create_membuf(deark *c, i64 initialsize, UI flags);
 
 // If f is NULL, this is a no-op.
 void dbuf_close(dbuf *f);
+void dbuf_close_tracked_files(deark *c);
+
+const char *dbuf_get_btype_name(int btype);
+void de_dbuftrace_start(deark *c, const char *fn);
+void de_dbuftrace_end(deark *c);
 
 void dbuf_enable_wbuffer(dbuf *f);
+void dbuf_enable_wbuffer_ex(dbuf *f, i64 initial_size);
 void dbuf_disable_wbuffer(dbuf *f);
 void dbuf_set_writelistener(dbuf *f, de_writelistener_cb_type fn, void *userdata);
 void de_writelistener_for_crc(dbuf *f, void *userdata, const u8 *buf, i64 buf_len);
@@ -778,6 +958,7 @@ void dbuf_write_at(dbuf *f, i64 pos, const u8 *m, i64 len);
 void dbuf_write_zeroes(dbuf *f, i64 len);
 void dbuf_truncate(dbuf *f, i64 len);
 void dbuf_write_run(dbuf *f, u8 n, i64 len);
+void dbuf_write_unit_run(dbuf *f, const u8 *unit, i64 unitsize, i64 count);
 
 void de_writeu16le_direct(u8 *m, i64 n);
 void de_writeu16be_direct(u8 *m, i64 n);
@@ -844,7 +1025,9 @@ void dbuf_empty(dbuf *f);
 
 i64 dbuf_get_length(dbuf *f);
 void dbuf_set_length_limit(dbuf *f, i64 max_len);
+void dbuf_reserve(dbuf *f, i64 n);
 const u8 *dbuf_get_membuf_direct_ptr(dbuf *f);
+const u8 *dbuf_get_direct_ptr(dbuf *f, i64 pos, i64 len);
 int dbuf_search_byte(dbuf *f, const u8 b, i64 startpos, i64 haystack_len,
 	i64 *foundpos);
 int dbuf_search(dbuf *f, const u8 *needle, i64 needle_len, i64 startpos,
@@ -908,8 +1091,14 @@ struct de_bitreader {
 	i64 endpos;
 	u8 eof_flag;
 	struct de_bitbuf_lowlevel bbll;
+	// Private copy of some bytes from f, starting at readahead_pos.
+	// Not part of the logical state; curpos is not affected by it.
+	UI readahead_nbytes;
+	i64 readahead_pos;
+	u8 readahead[16];
 };
 u64 de_bitreader_getbits(struct de_bitreader *bitrd, UI nbits);
+int de_bitreader_peekbits(struct de_bitreader *bitrd, UI nbits, u64 *pval);
 void de_bitreader_skip_to_byte_boundary(struct de_bitreader *bitrd);
 char *de_bitbuf_describe_curpos(struct de_bitbuf_lowlevel *bbll, i64 pos,
 	char *buf, size_t buf_len);
@@ -922,6 +1111,19 @@ void de_bitmap_write_to_file_finfo(de_bitmap *img, de_finfo *fi, UI createflags)
 void de_bitmap16_write_to_file_finfo(de_bitmap *img, de_bitmap *imglo,
 	de_finfo *fi, UI createflags);
 
+typedef struct de_bitmap_writer_struct de_bitmap_writer;
+int de_bitmap_want_streaming(deark *c, i64 width, i64 height, int bypp);
+de_bitmap_writer *de_bitmap_writer_create(deark *c, i64 npwidth, i64 pdwidth,
+	i64 height, int bypp, de_finfo *fi, UI createflags);
+void de_bitmap_writer_add_rows(de_bitmap_writer *bw, de_bitmap *img, i64 nrows);
+void de_bitmap_writer_finish(de_bitmap_writer *bw);
+
+typedef struct de_frame_writer_struct de_frame_writer;
+de_frame_writer *de_frame_writer_create(deark *c);
+void de_frame_writer_write(de_frame_writer *fw, de_bitmap *img, de_finfo *fi,
+	UI createflags);
+void de_frame_writer_destroy(de_frame_writer *fw);
+
 void de_bitmap_setsample(de_bitmap *img, i64 x, i64 y,
 	i64 samplenum, de_colorsample v);
 
@@ -1001,6 +1203,7 @@ void de_convert_image_paletted(dbuf *f, i64 fpos,
 void de_convert_image_paletted_planar(dbuf *f, i64 fpos, i64 nplanes,
 	i64 row_stride, i64 plane_stride, const de_color *pal,
 	de_bitmap *img, UI flags);
+void de_planar_to_chunky8(const u8 *planebytes, UI nplanes, UI flags, u8 *pixels);
 
 void de_convert_image_rgb(dbuf *f, i64 fpos,
 	i64 rowspan, i64 pixelspan, de_bitmap *img, unsigned int flags);
@@ -1375,4 +1578,6 @@ char *de_dbg_timestamp_to_string(deark *c, const struct de_timestamp *ts,
 	char *buf, size_t buf_len, UI flags);
 void de_gmtime(const struct de_timestamp *ts, struct de_struct_tm *tm2);
 void de_current_time_to_timestamp(struct de_timestamp *ts);
+i64 de_get_monotonic_time_ns(void);
+i64 de_get_peak_memory_usage(void);
 void de_cached_current_time_to_timestamp(deark *c, struct de_timestamp *ts);
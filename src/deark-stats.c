@@ -0,0 +1,440 @@
+// This file is part of Deark.
+// Copyright (C) 2026 Jason Summers
+// See the file COPYING for terms of use.
+
+// deark-stats.c: Performance statistics (the -stats option)
+//
+// Times are inclusive. For example, the time for a module includes the time
+// spent in its submodules, decompressors, and output functions.
+// CPU time is process CPU time, as reported by clock().
+
+#define DE_NOT_IN_MODULE
+#include "deark-config.h"
+#include "deark-private.h"
+#include <time.h>
+
+#define DE_STATS_MAX_LEVEL_NAMES 12
+#define DE_STATS_TEXT_MAX_IDENTIFY_ITEMS 10
+#define DE_STATS_TEXT_MAX_MEMACCT_MODULES 10
+
+static const char *level_names[DE_STATS_MAX_LEVEL_NAMES] = {
+	"0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11+"
+};
+
+static i64 get_cpu_time_ns(void)
+{
+	clock_t t;
+
+	t = clock();
+	if(t==(clock_t)-1) return 0;
+	return (i64)((double)t * (1000000000.0 / (double)CLOCKS_PER_SEC));
+}
+
+void de_stats_create(deark *c)
+{
+	if(c->stats) return;
+	c->stats = de_malloc(c, sizeof(struct de_stats_struct));
+	c->stats->start_time.wall_ns = de_get_monotonic_time_ns();
+	c->stats->start_time.cpu_ns = get_cpu_time_ns();
+	c->stats->start_time.bytes_read = 0;
+}
+
+void de_stats_destroy(deark *c)
+{
+	if(!c->stats) return;
+	de_free(c, c->stats->items);
+	de_free(c, c->stats);
+	c->stats = NULL;
+}
+
+void de_stats_timer_start(deark *c, struct de_stats_timer *tmr)
+{
+	if(!c->stats) return;
+	tmr->wall_ns = de_get_monotonic_time_ns();
+	tmr->cpu_ns = get_cpu_time_ns();
+	tmr->bytes_read = c->stats->bytes_read;
+}
+
+// Adds the time elapsed (and bytes read) since de_stats_timer_start(tmr)
+// to *total.
+void de_stats_timer_pause(deark *c, const struct de_stats_timer *tmr,
+	struct de_stats_timer *total)
+{
+	if(!c->stats) return;
+	total->wall_ns += de_get_monotonic_time_ns() - tmr->wall_ns;
+	total->cpu_ns += get_cpu_time_ns() - tmr->cpu_ns;
+	total->bytes_read += c->stats->bytes_read - tmr->bytes_read;
+}
+
+static UI item_hash(UI category, const char *name)
+{
+	UI h = category;
+
+	while(*name) {
+		h = h*31 + (UI)(u8)*name;
+		name++;
+	}
+	return h % DE_STATS_HASH_SIZE;
+}
+
+static void add_item_to_hash(struct de_stats_struct *st, i64 idx)
+{
+	struct de_stats_item *item = &st->items[idx];
+	UI h;
+
+	h = item_hash(item->category, item->name);
+	item->hash_next = st->hash[h];
+	st->hash[h] = idx+1;
+}
+
+// Needed after the items are reordered.
+static void rebuild_hash(struct de_stats_struct *st)
+{
+	i64 i;
+
+	de_zeromem(st->hash, sizeof(st->hash));
+	for(i=0; i<st->num_items; i++) {
+		add_item_to_hash(st, i);
+	}
+}
+
+// There can be an item for each module (DE_STATSCAT_IDENTIFY), so they are
+// looked up in a hash table.
+static struct de_stats_item *find_or_add_item(deark *c, UI category,
+	const char *name)
+{
+	struct de_stats_struct *st = c->stats;
+	struct de_stats_item *item;
+	i64 n;
+
+	for(n=st->hash[item_hash(category, name)]; n; n=item->hash_next) {
+		item = &st->items[n-1];
+		// Names are usually static strings, so a pointer comparison usually
+		// suffices.
+		if(item->category==category &&
+			(item->name==name || !de_strcmp(item->name, name)))
+		{
+			return item;
+		}
+	}
+
+	if(st->num_items >= st->items_alloc) {
+		i64 new_alloc;
+
+		new_alloc = st->items_alloc*2;
+		if(new_alloc<64) new_alloc = 64;
+		st->items = de_reallocarray(c, st->items, st->items_alloc,
+			sizeof(struct de_stats_item), new_alloc);
+		st->items_alloc = new_alloc;
+	}
+
+	item = &st->items[st->num_items];
+	de_zeromem(item, sizeof(struct de_stats_item));
+	item->category = category;
+	item->name = name;
+	add_item_to_hash(st, st->num_items);
+	st->num_items++;
+	return item;
+}
+
+// Records one call of the given type, taking the given amount of time.
+// For DE_STATSCAT_LEVEL, name is ignored, and the current module nesting
+// level is used.
+void de_stats_record(deark *c, UI category, const char *name,
+	const struct de_stats_timer *elapsed)
+{
+	struct de_stats_item *item;
+	int level = 0;
+
+	if(!c->stats) return;
+	if(category==DE_STATSCAT_LEVEL) {
+		level = c->module_nesting_level;
+		if(level<0) level = 0;
+		if(level>=DE_STATS_MAX_LEVEL_NAMES) level = DE_STATS_MAX_LEVEL_NAMES-1;
+		name = level_names[level];
+	}
+	if(!name) name = "other";
+
+	item = find_or_add_item(c, category, name);
+	item->level = level;
+	item->count++;
+	item->t.wall_ns += elapsed->wall_ns;
+	item->t.cpu_ns += elapsed->cpu_ns;
+	item->t.bytes_read += elapsed->bytes_read;
+}
+
+void de_stats_timer_stop(deark *c, const struct de_stats_timer *tmr,
+	UI category, const char *name)
+{
+	struct de_stats_timer elapsed;
+
+	if(!c->stats) return;
+	de_zeromem(&elapsed, sizeof(struct de_stats_timer));
+	de_stats_timer_pause(c, tmr, &elapsed);
+	de_stats_record(c, category, name, &elapsed);
+}
+
+// nhits: Number of times the module's identify function returned nonzero.
+// nwins: Number of times the module was selected.
+void de_stats_add_identify_counts(deark *c, const char *name, i64 nhits,
+	i64 nwins)
+{
+	struct de_stats_item *item;
+
+	if(!c->stats) return;
+	item = find_or_add_item(c, DE_STATSCAT_IDENTIFY, name);
+	item->hits += nhits;
+	item->wins += nwins;
+}
+
+static const char *category_name(UI category)
+{
+	switch(category) {
+	case DE_STATSCAT_IDENTIFY: return "identify";
+	case DE_STATSCAT_MODULE: return "module";
+	case DE_STATSCAT_LEVEL: return "level";
+	case DE_STATSCAT_CODEC: return "codec";
+	case DE_STATSCAT_OUTPUT: return "output";
+	}
+	return "other";
+}
+
+// Sort by category, then by decreasing wall time. Levels are sorted by level.
+static int item_cmp(const void *a, const void *b)
+{
+	const struct de_stats_item *m1 = (const struct de_stats_item *)a;
+	const struct de_stats_item *m2 = (const struct de_stats_item *)b;
+
+	if(m1->category != m2->category) {
+		return (m1->category < m2->category) ? -1 : 1;
+	}
+	if(m1->category==DE_STATSCAT_LEVEL) {
+		return (m1->level < m2->level) ? -1 : ((m1->level > m2->level) ? 1 : 0);
+	}
+	if(m1->t.wall_ns != m2->t.wall_ns) {
+		return (m1->t.wall_ns > m2->t.wall_ns) ? -1 : 1;
+	}
+	return de_strcmp(m1->name, m2->name);
+}
+
+static double ns_to_ms(i64 n)
+{
+	return (double)n / 1000000.0;
+}
+
+// Sort by decreasing bytes allocated
+static int memacct_module_cmp(const void *a, const void *b)
+{
+	const struct de_memacct_module *m1 = (const struct de_memacct_module *)a;
+	const struct de_memacct_module *m2 = (const struct de_memacct_module *)b;
+
+	if(m1->bytes_allocated != m2->bytes_allocated) {
+		return (m1->bytes_allocated > m2->bytes_allocated) ? -1 : 1;
+	}
+	return de_strcmp(m1->name, m2->name);
+}
+
+static void sort_memacct_modules(struct de_memacct_struct *ma)
+{
+	if(ma->nmodules>1) {
+		qsort(ma->modules, (size_t)ma->nmodules, sizeof(struct de_memacct_module),
+			memacct_module_cmp);
+	}
+	ma->curr_module_idx = -1;
+}
+
+static void report_memacct_text(deark *c, struct de_memacct_struct *ma)
+{
+	i64 i;
+
+	de_msg(c, " heap: peak %"I64_FMT" KB, allocs %"I64_FMT", reallocs %"I64_FMT
+		", frees %"I64_FMT, ma->peak_bytes/1024, ma->num_allocs, ma->num_reallocs,
+		ma->num_frees);
+	de_msg(c, " %-22s %10s %14s %12s %12s", "heap by module", "allocs",
+		"bytes_alloc", "largest", "peak_heap");
+	for(i=0; i<ma->nmodules && i<DE_STATS_TEXT_MAX_MEMACCT_MODULES; i++) {
+		const struct de_memacct_module *mm = &ma->modules[i];
+
+		de_msg(c, "   %-20s %10"I64_FMT" %14"I64_FMT" %12"I64_FMT" %12"I64_FMT,
+			mm->name, mm->num_allocs, mm->bytes_allocated, mm->largest,
+			mm->peak_bytes);
+	}
+	de_msg(c, " %-22s %14s", "largest allocations", "size");
+	for(i=0; i<DE_MEMACCT_NUM_BIG_ALLOCS; i++) {
+		const struct de_memacct_big_alloc *ba = &ma->big_allocs[i];
+
+		if(ba->size==0) break;
+		de_msg(c, "   %-20s %14"I64_FMT"%s", ba->module, ba->size,
+			ba->is_realloc?" (realloc)":"");
+	}
+}
+
+static void report_memacct_json(deark *c, struct de_memacct_struct *ma)
+{
+	i64 i;
+
+	de_msg(c, ",\"heap\":{\"peak\":%"I64_FMT",\"allocs\":%"I64_FMT",\"reallocs\":%"
+		I64_FMT",\"frees\":%"I64_FMT",\"modules\":{", ma->peak_bytes,
+		ma->num_allocs, ma->num_reallocs, ma->num_frees);
+	for(i=0; i<ma->nmodules; i++) {
+		const struct de_memacct_module *mm = &ma->modules[i];
+
+		de_msg(c, "%s\"%s\":{\"allocs\":%"I64_FMT",\"bytes_alloc\":%"I64_FMT
+			",\"largest\":%"I64_FMT",\"peak_heap\":%"I64_FMT"}",
+			(i?",":""), mm->name, mm->num_allocs, mm->bytes_allocated,
+			mm->largest, mm->peak_bytes);
+	}
+	de_msg(c, "},\"largest\":[");
+	for(i=0; i<DE_MEMACCT_NUM_BIG_ALLOCS; i++) {
+		const struct de_memacct_big_alloc *ba = &ma->big_allocs[i];
+
+		if(ba->size==0) break;
+		de_msg(c, "%s{\"module\":\"%s\",\"size\":%"I64_FMT",\"realloc\":%s}",
+			(i?",":""), ba->module, ba->size, ba->is_realloc?"true":"false");
+	}
+	de_msg(c, "]}");
+}
+
+static void report_text(deark *c, const struct de_stats_timer *total,
+	i64 peak_mem)
+{
+	struct de_stats_struct *st = c->stats;
+	UI prev_category = 0;
+	i64 num_in_category = 0;
+	i64 i;
+	int k;
+
+	de_msg(c, "Statistics:");
+	de_msg(c, " total: wall %.3f ms, cpu %.3f ms", ns_to_ms(total->wall_ns),
+		ns_to_ms(total->cpu_ns));
+	if(peak_mem>=0) {
+		de_msg(c, " peak memory: %"I64_FMT" KB", peak_mem/1024);
+	}
+
+	for(i=0; i<st->num_items; i++) {
+		const struct de_stats_item *item = &st->items[i];
+
+		if(item->category != prev_category) {
+			de_msg(c, " %-22s %10s %12s %12s %12s%s", category_name(item->category),
+				"calls", "wall_ms", "cpu_ms", "bytes_read",
+				(item->category==DE_STATSCAT_IDENTIFY)?"       hits       wins":"");
+			prev_category = item->category;
+			num_in_category = 0;
+		}
+		num_in_category++;
+		if(item->category==DE_STATSCAT_IDENTIFY) {
+			if(num_in_category>DE_STATS_TEXT_MAX_IDENTIFY_ITEMS) continue;
+			de_msg(c, "   %-20s %10"I64_FMT" %12.3f %12.3f %12"I64_FMT" %10"I64_FMT
+				" %10"I64_FMT, item->name, item->count,
+				ns_to_ms(item->t.wall_ns), ns_to_ms(item->t.cpu_ns),
+				item->t.bytes_read, item->hits, item->wins);
+		}
+		else {
+			de_msg(c, "   %-20s %10"I64_FMT" %12.3f %12.3f %12"I64_FMT, item->name,
+				item->count, ns_to_ms(item->t.wall_ns), ns_to_ms(item->t.cpu_ns),
+				item->t.bytes_read);
+		}
+	}
+
+	de_msg(c, " %-22s %14s %14s", "dbuf type", "bytes_read", "bytes_written");
+	for(k=0; k<DE_STATS_NUM_DBUF_TYPES; k++) {
+		if(st->dbuf_bytes_read[k]==0 && st->dbuf_bytes_written[k]==0) continue;
+		de_msg(c, "   %-20s %14"I64_FMT" %14"I64_FMT, dbuf_get_btype_name(k),
+			st->dbuf_bytes_read[k], st->dbuf_bytes_written[k]);
+	}
+	de_msg(c, " fseek: %"I64_FMT", fread: %"I64_FMT" (%"I64_FMT" bytes), fwrite: %"I64_FMT,
+		st->num_fseeks, st->num_freads, st->fread_bytes, st->num_fwrites);
+	if(c->memacct) {
+		report_memacct_text(c, c->memacct);
+	}
+}
+
+// Names are internal identifiers, so they do not need to be escaped.
+static void report_json(deark *c, const struct de_stats_timer *total,
+	i64 peak_mem)
+{
+	struct de_stats_struct *st = c->stats;
+	UI prev_category = 0;
+	i64 i;
+	int k;
+	int first;
+	char extra[80];
+
+	de_msg(c, "{\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"peak_memory\":%"I64_FMT",",
+		ns_to_ms(total->wall_ns), ns_to_ms(total->cpu_ns), peak_mem);
+
+	for(i=0; i<st->num_items; i++) {
+		const struct de_stats_item *item = &st->items[i];
+
+		if(item->category != prev_category) {
+			de_msg(c, "%s\"%s\":{", (prev_category?"},":""),
+				category_name(item->category));
+			prev_category = item->category;
+			first = 1;
+		}
+		else {
+			first = 0;
+		}
+		if(item->category==DE_STATSCAT_IDENTIFY) {
+			de_snprintf(extra, sizeof(extra), ",\"hits\":%"I64_FMT",\"wins\":%"I64_FMT,
+				item->hits, item->wins);
+		}
+		else {
+			extra[0] = '\0';
+		}
+		de_msg(c, "%s\"%s\":{\"calls\":%"I64_FMT",\"wall_ms\":%.3f,\"cpu_ms\":%.3f,"
+			"\"bytes_read\":%"I64_FMT"%s}",
+			(first?"":","), item->name, item->count,
+			ns_to_ms(item->t.wall_ns), ns_to_ms(item->t.cpu_ns),
+			item->t.bytes_read, extra);
+	}
+	if(prev_category) {
+		de_msg(c, "},");
+	}
+
+	de_msg(c, "\"dbuf\":{");
+	first = 1;
+	for(k=0; k<DE_STATS_NUM_DBUF_TYPES; k++) {
+		if(st->dbuf_bytes_read[k]==0 && st->dbuf_bytes_written[k]==0) continue;
+		de_msg(c, "%s\"%s\":{\"bytes_read\":%"I64_FMT",\"bytes_written\":%"I64_FMT"}",
+			(first?"":","), dbuf_get_btype_name(k),
+			st->dbuf_bytes_read[k], st->dbuf_bytes_written[k]);
+		first = 0;
+	}
+	de_msg(c, "},");
+
+	de_msg(c, "\"fseek\":%"I64_FMT",\"fread\":%"I64_FMT",\"fread_bytes\":%"I64_FMT
+		",\"fwrite\":%"I64_FMT,
+		st->num_fseeks, st->num_freads, st->fread_bytes, st->num_fwrites);
+	if(c->memacct) {
+		report_memacct_json(c, c->memacct);
+	}
+	de_msg(c, "}");
+}
+
+void de_stats_report(deark *c)
+{
+	struct de_stats_timer total;
+	i64 peak_mem;
+
+	if(!c->stats) return;
+	de_zeromem(&total, sizeof(struct de_stats_timer));
+	de_stats_timer_pause(c, &c->stats->start_time, &total);
+	peak_mem = de_get_peak_memory_usage();
+
+	if(c->stats->num_items>1) {
+		qsort(c->stats->items, (size_t)c->stats->num_items,
+			sizeof(struct de_stats_item), item_cmp);
+		rebuild_hash(c->stats);
+	}
+	if(c->memacct) {
+		sort_memacct_modules(c->memacct);
+	}
+
+	if(de_get_ext_option_bool(c, "stats:json", 0)) {
+		report_json(c, &total, peak_mem);
+	}
+	else {
+		report_text(c, &total, peak_mem);
+	}
+}
@@ -12,6 +12,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/resource.h>
+#include <time.h>
 #include <unistd.h>
 #include <utime.h>
 #include <errno.h>
@@ -317,6 +319,43 @@ void de_current_time_to_timestamp(struct de_timestamp *ts)
 	de_timestamp_set_subsec(ts, ((double)tv.tv_usec)/1000000.0);
 }
 
+// Returns a reading of a high-resolution clock, in nanoseconds, for measuring
+// elapsed time. The starting point is unspecified.
+// Note: Need to keep this function in sync with the implementation in deark-win.c.
+i64 de_get_monotonic_time_ns(void)
+{
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+
+	if(clock_gettime(CLOCK_MONOTONIC, &ts)==0) {
+		return (i64)ts.tv_sec*1000000000 + (i64)ts.tv_nsec;
+	}
+#endif
+	{
+		struct timeval tv;
+
+		de_zeromem(&tv, sizeof(struct timeval));
+		(void)gettimeofday(&tv, NULL);
+		return (i64)tv.tv_sec*1000000000 + (i64)tv.tv_usec*1000;
+	}
+}
+
+// Returns the peak resident memory usage of this process, in bytes, or -1 if
+// unknown.
+// Note: Need to keep this function in sync with the implementation in deark-win.c.
+i64 de_get_peak_memory_usage(void)
+{
+	struct rusage ru;
+
+	de_zeromem(&ru, sizeof(struct rusage));
+	if(getrusage(RUSAGE_SELF, &ru)!=0) return -1;
+#ifdef __APPLE__
+	return (i64)ru.ru_maxrss; // bytes
+#else
+	return (i64)ru.ru_maxrss * 1024; // KB
+#endif
+}
+
 void de_exitprocess(int s)
 {
 	exit(s?EXIT_FAILURE:EXIT_SUCCESS);
@@ -26,6 +26,7 @@ static struct deark_module_info *detect_module_for_file(deark *c, int *errflag)
 	int result;
 	int orig_errcount;
 	struct deark_module_info *best_module = NULL;
+	struct de_stats_timer tmr;
 
 	*errflag = 0;
 	if(!c->detection_data) {
@@ -50,7 +51,16 @@ static struct deark_module_info *detect_module_for_file(deark *c, int *errflag)
 			continue;
 		}
 
-		result = c->module_info[i].identify_fn(c);
+		c->curr_module_id = c->module_info[i].id;
+		if(c->stats) {
+			de_stats_timer_start(c, &tmr);
+			result = c->module_info[i].identify_fn(c);
+			de_stats_timer_stop(c, &tmr, DE_STATSCAT_IDENTIFY, c->module_info[i].id);
+		}
+		else {
+			result = c->module_info[i].identify_fn(c);
+		}
+		c->curr_module_id = NULL;
 
 		if(c->error_count > orig_errcount) {
 			// Detection routines don't normally produce errors. If one does,
@@ -64,6 +74,10 @@ static struct deark_module_info *detect_module_for_file(deark *c, int *errflag)
 			continue;
 		}
 
+		if(c->stats && result>0) {
+			de_stats_add_identify_counts(c, c->module_info[i].id, 1, 0);
+		}
+
 		if(result <= c->detection_data->best_confidence_so_far) continue;
 
 		// This is the best result so far.
@@ -72,6 +86,9 @@ static struct deark_module_info *detect_module_for_file(deark *c, int *errflag)
 		if(c->detection_data->best_confidence_so_far>=100) break;
 	}
 
+	if(c->stats && best_module) {
+		de_stats_add_identify_counts(c, best_module->id, 0, 1);
+	}
 	return best_module;
 }
 
@@ -278,7 +295,6 @@ int de_run(deark *c)
 	int moddisp;
 	int subdirs_opt;
 	int keepdirentries_opt;
-	int tmp_opt;
 	de_module_params *mparams = NULL;
 	de_ucstring *friendly_infn = NULL;
 
@@ -294,11 +310,24 @@ int de_run(deark *c)
 		if(c->serious_error_flag) goto done;
 	}
 
+	{
+		const char *s_opt;
+
+		s_opt = de_get_ext_option(c, "dbuf:trace");
+		if(s_opt) {
+			de_dbuftrace_start(c, s_opt);
+			if(c->serious_error_flag) goto done;
+		}
+	}
+
 	friendly_infn = ucstring_create(c);
 
 	if(c->input_style==DE_INPUTSTYLE_STDIN) {
 		ucstring_append_sz(friendly_infn, "[stdin]", DE_ENCODING_LATIN1);
 	}
+	else if(c->input_style==DE_INPUTSTYLE_MEMORY) {
+		ucstring_append_sz(friendly_infn, "[memory]", DE_ENCODING_LATIN1);
+	}
 	else if(c->input_filename) {
 		ucstring_append_sz(friendly_infn, c->input_filename, DE_ENCODING_UTF8);
 	}
@@ -338,6 +367,9 @@ int de_run(deark *c)
 	if(c->input_style==DE_INPUTSTYLE_STDIN) {
 		orig_ifile = dbuf_open_input_stdin(c);
 	}
+	else if(c->input_style==DE_INPUTSTYLE_MEMORY) {
+		orig_ifile = dbuf_open_input_mem(c, c->input_mem, c->input_mem_len);
+	}
 	else {
 		orig_ifile = dbuf_open_input_file_ex(c, c->input_filename, 0x1);
 
@@ -499,12 +531,7 @@ int de_run(deark *c)
 		c->enable_oinfo = 1;
 	}
 
-	tmp_opt = de_get_ext_option_bool(c, "wbuffer", -1);
-	if(tmp_opt>0) {
-		// For testing(?), enable wbuffer feature automatically in some cases.
-		c->enable_wbuffer_test = 1;
-	}
-	else if(tmp_opt==0) {
+	if(de_get_ext_option_bool(c, "wbuffer", 1)==0) {
 		// Always disable wbuffer, even if a module wants to use it.
 		c->disable_wbuffer = 1;
 	}
@@ -591,10 +618,25 @@ deark *de_create_internal(void)
 void de_destroy(deark *c)
 {
 	int i;
+	struct de_stats_timer tmr;
 
 	if(!c) return;
-	if(c->zip_data) { de_zip_close_file(c); }
-	if(c->tar_data) { de_tar_close_file(c); }
+	if(c->zip_data) {
+		de_stats_timer_start(c, &tmr);
+		de_zip_close_file(c);
+		de_stats_timer_stop(c, &tmr, DE_STATSCAT_OUTPUT, "zip_close");
+	}
+	if(c->tar_data) {
+		de_stats_timer_start(c, &tmr);
+		de_tar_close_file(c);
+		de_stats_timer_stop(c, &tmr, DE_STATSCAT_OUTPUT, "tar_close");
+	}
+	de_dbuftrace_end(c);
+	if(c->stats) {
+		de_stats_report(c);
+		de_stats_destroy(c);
+	}
+	de_memacct_destroy(c);
 	if(c->extrlist_dbuf) { dbuf_close(c->extrlist_dbuf); }
 	for(i=0; i<c->num_ext_options; i++) {
 		de_free(c, c->ext_option[i].name);
@@ -619,6 +661,12 @@ void de_destroy(deark *c)
 		}
 	}
 	de_free(c, c->module_info);
+	if(c->tracked_allocs) {
+		if(c->fatal_error_occurred) {
+			dbuf_close_tracked_files(c);
+		}
+		de_memtrack_destroy(c, (int)c->fatal_error_occurred);
+	}
 	de_free(NULL,c);
 }
 
@@ -647,6 +695,13 @@ void de_set_fatalerror_callback(deark *c, de_fatalerrorfn_type fn)
 	c->fatalerrorfn = fn;
 }
 
+void de_set_track_resources(deark *c, int x)
+{
+	if(x) {
+		de_memtrack_create(c);
+	}
+}
+
 static int is_pathsep(de_rune ch)
 {
 	if(ch=='/') return 1;
@@ -901,6 +956,9 @@ void de_set_std_option_int(deark *c, enum de_stdoptions_enum o, int x)
 	switch(o) {
 	case DE_STDOPT_DEBUG_LEVEL:
 		c->debug_level = x;
+		if(c->debug_level > DE_MAX_DEBUG_LEVEL) {
+			c->debug_level = DE_MAX_DEBUG_LEVEL;
+		}
 		break;
 	case DE_STDOPT_EXTRACT_POLICY:
 		c->extract_policy = x;
@@ -947,6 +1005,15 @@ void de_set_std_option_int(deark *c, enum de_stdoptions_enum o, int x)
 	case DE_STDOPT_PADPIX:
 		c->padpix = (u8)x;
 		break;
+	case DE_STDOPT_STATS:
+		if(x) {
+			de_stats_create(c);
+			de_memacct_create(c);
+		}
+		else {
+			de_stats_destroy(c);
+		}
+		break;
 	default:
 		de_internal_err_fatal(c, "set_std_option");
 	}
@@ -957,6 +1024,13 @@ void de_set_input_style(deark *c, int x)
 	c->input_style = x;
 }
 
+void de_set_input_memory(deark *c, const u8 *mem, i64 len)
+{
+	c->input_style = DE_INPUTSTYLE_MEMORY;
+	c->input_mem = mem;
+	c->input_mem_len = len;
+}
+
 // Notes on the multipart input file feature:
 // The module tests c->mp_data != NULL to see if there are additional
 // input files after the first.
@@ -1099,6 +1173,18 @@ void de_set_max_total_output_size(deark *c, i64 n)
 	c->max_total_output_size = n;
 }
 
+// n: The approximate maximum number of bytes of memory to allocate.
+// 0 = no limit.
+void de_set_max_memory_usage(deark *c, i64 n)
+{
+	if(n<=0) {
+		if(c->memacct) c->memacct->max_bytes = 0;
+		return;
+	}
+	de_memacct_create(c);
+	c->memacct->max_bytes = n;
+}
+
 void de_set_max_image_dimension(deark *c, i64 n)
 {
 	if(n<0) n=0;
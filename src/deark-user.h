@@ -36,15 +36,21 @@ enum de_stdoptions_enum {
 	// ..._STANDARD = Do whatever fopen() normally does (overwrite, and follow symlinks).
 	DE_STDOPT_OVERWRITE_MODE,
 
-	DE_STDOPT_PADPIX
+	DE_STDOPT_PADPIX,
+	DE_STDOPT_STATS // Collect performance statistics, and report them at the end
 };
 
 void de_set_std_option_int(deark *c, enum de_stdoptions_enum o, int x);
 
 #define DE_INPUTSTYLE_FILE    0
 #define DE_INPUTSTYLE_STDIN   1
+#define DE_INPUTSTYLE_MEMORY  2 // Set by de_set_input_memory()
 void de_set_input_style(deark *c, int x);
 
+// Read the input file from memory. The memory must remain valid, and
+// unchanged, until de_destroy() is called.
+void de_set_input_memory(deark *c, const u8 *mem, i64 len);
+
 void de_set_input_filename(deark *c, const char *fn, UI flags);
 int de_set_input_encoding(deark *c, const char *encname, int reserved);
 void de_set_input_timezone(deark *c, i64 tzoffs_seconds);
@@ -66,6 +72,7 @@ void de_set_max_output_files(deark *c, i64 n);
 void de_set_max_output_file_size(deark *c, i64 n);
 void de_set_max_total_output_size(deark *c, i64 n);
 void de_set_max_image_dimension(deark *c, i64 n);
+void de_set_max_memory_usage(deark *c, i64 n);
 
 void de_set_preserve_file_times(deark *c, int setting, int x);
 
@@ -77,6 +84,11 @@ void de_set_special_messages_callback(deark *c, de_specialmsgfn_type fn);
 // The caller's fatalerror callback is not expected to return.
 void de_set_fatalerror_callback(deark *c, de_fatalerrorfn_type fn);
 
+// If set, and a fatal error callback did not return (e.g. because it used
+// longjmp()), de_destroy() frees the memory, and closes the files, that were
+// left in use. Only resources allocated after this call are tracked.
+void de_set_track_resources(deark *c, int x);
+
 void de_set_input_format(deark *c, const char *fmtname);
 void de_set_module_init_codes(deark *c, const char *codes);
 
@@ -289,6 +289,7 @@ void de_dbg3(deark *c, const char *fmt, ...)
 {
 	va_list ap;
 
+	if(DE_MAX_DEBUG_LEVEL<3) return;
 	if(c && c->debug_level<3) return;
 	va_start(ap, fmt);
 	de_vdbg_internal(c, fmt, ap);
@@ -299,6 +300,7 @@ void de_dbgx(deark *c, int lv, const char *fmt, ...)
 {
 	va_list ap;
 
+	if(lv>DE_MAX_DEBUG_LEVEL) return;
 	if(c && c->debug_level<lv) return;
 	va_start(ap, fmt);
 	de_vdbg_internal(c, fmt, ap);
@@ -530,6 +532,7 @@ void de_dbg_hexdump(deark *c, dbuf *f, i64 pos1,
 {
 	struct hexdump_ctx hctx;
 
+	if(!de_dbg_enabled(c, 1)) return;
 	hctx.flags = flags;
 	hctx.prefix = (prefix1) ? prefix1 : "data";
 	hctx.printlinefn = hexdump_printline_dbg;
@@ -700,6 +703,9 @@ void de_msg(deark *c, const char *fmt, ...)
 // c can be NULL.
 void de_fatalerror(deark *c)
 {
+	if(c) {
+		c->fatal_error_occurred = 1;
+	}
 	if(c && c->fatalerrorfn) {
 		c->fatalerrorfn(c);
 	}
@@ -729,6 +735,197 @@ void de_internal_err_nonfatal(deark *c, const char *fmt, ...)
 	de_err(c, "Internal: %s", buf);
 }
 
+// Memory allocation accounting (see struct de_memacct_struct).
+// The accounting data itself is allocated with a NULL deark object, so that
+// it does not count itself.
+// Every block returned by de_malloc() or de_realloc() is preceded by a
+// header, which records the number of bytes that the accounting charged for
+// it (0 if the block was not counted). That is what is subtracted when the
+// block is freed.
+// The header also links the block into c->tracked_allocs, if resource
+// tracking was enabled when it was allocated (see de_memtrack_create()).
+
+// The header size must preserve malloc's alignment.
+#define DE_MEMHDR_SIZE 32
+
+struct de_memhdr {
+	i64 counted_size;
+	// Links in a circular list, or NULL if the block is not tracked.
+	// The list can be updated without knowing which deark object it
+	// belongs to.
+	struct de_memhdr *prev;
+	struct de_memhdr *next;
+};
+
+#define DE_MEMHDR(m) ((struct de_memhdr*)(((u8*)(m)) - DE_MEMHDR_SIZE))
+
+static const char *memacct_no_module_name = "(none)";
+
+// Resource tracking: If enabled, every block allocated with c is kept in a
+// list, so that de_memtrack_destroy() can free the blocks that were never
+// freed, e.g. because a fatal error callback used longjmp().
+// c->tracked_allocs is the list's sentinel node, allocated with calloc().
+void de_memtrack_create(deark *c)
+{
+	struct de_memhdr *s;
+
+	if(c->tracked_allocs) return;
+	s = calloc(1, sizeof(struct de_memhdr));
+	if(!s) {
+		de_err(c, "Out of memory");
+		de_fatalerror(c);
+		return;
+	}
+	s->prev = s;
+	s->next = s;
+	c->tracked_allocs = s;
+}
+
+// If free_blocks is set, frees all tracked blocks that are still allocated.
+// Otherwise, they are presumed to be real memory leaks, and are only
+// removed from the list, so that leak checkers can still find them.
+void de_memtrack_destroy(deark *c, int free_blocks)
+{
+	struct de_memhdr *s = c->tracked_allocs;
+
+	if(!s) return;
+	while(s->next != s) {
+		struct de_memhdr *hdr = s->next;
+
+		s->next = hdr->next;
+		if(free_blocks) {
+			free(hdr);
+		}
+		else {
+			hdr->prev = NULL;
+			hdr->next = NULL;
+		}
+	}
+	free(s);
+	c->tracked_allocs = NULL;
+}
+
+static void memtrack_link(deark *c, struct de_memhdr *hdr)
+{
+	struct de_memhdr *s = c->tracked_allocs;
+
+	hdr->prev = s;
+	hdr->next = s->next;
+	s->next->prev = hdr;
+	s->next = hdr;
+}
+
+static void memtrack_unlink(struct de_memhdr *hdr)
+{
+	hdr->prev->next = hdr->next;
+	hdr->next->prev = hdr->prev;
+}
+
+void de_memacct_create(deark *c)
+{
+	if(c->memacct) return;
+	c->memacct = de_malloc(NULL, sizeof(struct de_memacct_struct));
+	c->memacct->curr_module_idx = -1;
+}
+
+void de_memacct_destroy(deark *c)
+{
+	struct de_memacct_struct *ma = c->memacct;
+
+	if(!ma) return;
+	c->memacct = NULL;
+	de_free(NULL, ma->modules);
+	de_free(NULL, ma);
+}
+
+static struct de_memacct_module *memacct_get_module(struct de_memacct_struct *ma,
+	const char *name)
+{
+	i64 i;
+
+	if(ma->curr_module_idx>=0 && ma->modules[ma->curr_module_idx].name==name) {
+		return &ma->modules[ma->curr_module_idx];
+	}
+
+	for(i=0; i<ma->nmodules; i++) {
+		if(ma->modules[i].name==name || !de_strcmp(ma->modules[i].name, name)) {
+			goto done;
+		}
+	}
+
+	if(ma->nmodules >= ma->modules_alloc) {
+		i64 new_alloc = ma->modules_alloc ? ma->modules_alloc*2 : 32;
+
+		ma->modules = de_reallocarray(NULL, ma->modules, ma->modules_alloc,
+			sizeof(struct de_memacct_module), new_alloc);
+		ma->modules_alloc = new_alloc;
+	}
+	i = ma->nmodules++;
+	ma->modules[i].name = name;
+
+done:
+	ma->curr_module_idx = i;
+	return &ma->modules[i];
+}
+
+static void memacct_add_big_alloc(struct de_memacct_struct *ma, const char *name,
+	i64 size, u8 is_realloc)
+{
+	int i;
+
+	if(size <= ma->big_allocs[DE_MEMACCT_NUM_BIG_ALLOCS-1].size) return;
+	i = DE_MEMACCT_NUM_BIG_ALLOCS-1;
+	while(i>0 && ma->big_allocs[i-1].size < size) {
+		ma->big_allocs[i] = ma->big_allocs[i-1];
+		i--;
+	}
+	ma->big_allocs[i].module = name;
+	ma->big_allocs[i].size = size;
+	ma->big_allocs[i].is_realloc = is_realloc;
+}
+
+// Called before allocating n more bytes.
+static void memacct_check_limit(deark *c, i64 n)
+{
+	struct de_memacct_struct *ma = c->memacct;
+
+	if(ma->cur_bytes + n <= ma->max_bytes) return;
+	// Disable the limit, so we don't fail again while reporting the error.
+	ma->max_bytes = 0;
+	de_err(c, "Memory limit exceeded (%"I64_FMT" bytes in use, %"I64_FMT
+		" more requested by %s)", ma->cur_bytes, n,
+		c->curr_module_id ? c->curr_module_id : memacct_no_module_name);
+	de_fatalerror(c);
+}
+
+// size: The requested size
+// growth: The change in memory use
+static void memacct_record_alloc(deark *c, i64 size, i64 growth, u8 is_realloc)
+{
+	struct de_memacct_struct *ma = c->memacct;
+	struct de_memacct_module *mm;
+
+	ma->cur_bytes += growth;
+	if(ma->cur_bytes > ma->peak_bytes) ma->peak_bytes = ma->cur_bytes;
+	if(is_realloc) ma->num_reallocs++;
+	else ma->num_allocs++;
+
+	mm = memacct_get_module(ma,
+		c->curr_module_id ? c->curr_module_id : memacct_no_module_name);
+	mm->num_allocs++;
+	if(growth>0) mm->bytes_allocated += growth;
+	if(size > mm->largest) mm->largest = size;
+	if(ma->cur_bytes > mm->peak_bytes) mm->peak_bytes = ma->cur_bytes;
+	memacct_add_big_alloc(ma, mm->name, size, is_realloc);
+}
+
+static void memacct_record_free(deark *c, struct de_memhdr *hdr)
+{
+	if(hdr->counted_size==0) return;
+	c->memacct->num_frees++;
+	c->memacct->cur_bytes -= hdr->counted_size;
+}
+
 // TODO: Make de_malloc use de_mallocarray internally, instead of vice versa.
 void *de_mallocarray(deark *c, i64 nmemb, size_t membsize)
 {
@@ -747,7 +944,7 @@ void *de_mallocarray(deark *c, i64 nmemb, size_t membsize)
 // Always succeeds (or ends the program); never returns NULL.
 void *de_malloc(deark *c, i64 n)
 {
-	void *m;
+	struct de_memhdr *hdr;
 
 	if(n==0) n=1;
 	if(n<0 || n>DE_MAX_MALLOC) {
@@ -757,9 +954,22 @@ void *de_malloc(deark *c, i64 n)
 		n = 1;
 	}
 
+	if(c && c->memacct && c->memacct->max_bytes) {
+		memacct_check_limit(c, n+DE_MEMHDR_SIZE);
+	}
+
 	while(1) {
-		m = calloc((size_t)n, 1);
-		if(m) return m;
+		hdr = calloc((size_t)(n+DE_MEMHDR_SIZE), 1);
+		if(hdr) {
+			if(c && c->tracked_allocs) {
+				memtrack_link(c, hdr);
+			}
+			if(c && c->memacct) {
+				hdr->counted_size = n+DE_MEMHDR_SIZE;
+				memacct_record_alloc(c, n, hdr->counted_size, 0);
+			}
+			return (void*)(((u8*)hdr) + DE_MEMHDR_SIZE);
+		}
 
 		de_err(c, "Memory allocation failed (%"I64_FMT" bytes)", n);
 		de_fatalerror(c);
@@ -788,31 +998,67 @@ void *de_reallocarray(deark *c, void *m, i64 oldnmemb, size_t membsize,
 void *de_realloc(deark *c, void *oldmem, i64 oldsize, i64 newsize)
 {
 	void *newmem;
+	struct de_memhdr *hdr;
+	i64 old_counted_size;
 
 	if(!oldmem) {
 		return de_malloc(c, newsize);
 	}
+	if(newsize<0 || newsize>DE_MAX_MALLOC) {
+		de_err(c,"Out of memory (%"I64_FMT" bytes requested)", newsize);
+		de_fatalerror(c);
+		// NOTREACHED
+		return de_malloc(c, 1);
+	}
+
+	hdr = DE_MEMHDR(oldmem);
+	old_counted_size = hdr->counted_size;
+	if(c && c->memacct && c->memacct->max_bytes &&
+		newsize+DE_MEMHDR_SIZE > old_counted_size)
+	{
+		memacct_check_limit(c, newsize+DE_MEMHDR_SIZE-old_counted_size);
+	}
 
-	newmem = realloc(oldmem, (size_t)newsize);
-	if(!newmem) {
+	hdr = realloc(hdr, (size_t)(newsize+DE_MEMHDR_SIZE));
+	if(!hdr) {
 		de_err(c, "Memory reallocation failed (%"I64_FMT" bytes)", newsize);
-		free(oldmem);
+		de_free(c, oldmem);
 		de_fatalerror(c);
 		// NOTREACHED
 		return de_malloc(c, newsize);
 	}
+	if(hdr->next) {
+		// The block may have moved. Its list neighbors still point to the
+		// old location.
+		hdr->prev->next = hdr;
+		hdr->next->prev = hdr;
+	}
+	newmem = (void*)(((u8*)hdr) + DE_MEMHDR_SIZE);
 
 	if(oldsize<newsize) {
 		// zero out any newly-allocated bytes
 		de_zeromem(&((u8*)newmem)[oldsize], (size_t)(newsize-oldsize));
 	}
 
+	if(c && c->memacct) {
+		// If the old block was not counted, this counts the whole new block.
+		hdr->counted_size = newsize+DE_MEMHDR_SIZE;
+		memacct_record_alloc(c, newsize, hdr->counted_size-old_counted_size, 1);
+	}
+
 	return newmem;
 }
 
 void de_free(deark *c, void *m)
 {
-	free(m);
+	if(!m) return;
+	if(c && c->memacct) {
+		memacct_record_free(c, DE_MEMHDR(m));
+	}
+	if(DE_MEMHDR(m)->next) {
+		memtrack_unlink(DE_MEMHDR(m));
+	}
+	free(DE_MEMHDR(m));
 }
 
 // The extent to which strdup() is available as a standard-ish function is
@@ -865,6 +1111,7 @@ int de_run_module(deark *c, struct deark_module_info *mi, de_module_params *mpar
 	enum de_moddisp_enum old_moddisp;
 	struct de_detection_data_struct *old_detection_data;
 	struct de_mp_data *old_mp_data;
+	const char *old_module_id;
 
 	if(!mi) return 0;
 	if(!mi->run_fn) {
@@ -899,7 +1146,20 @@ int de_run_module(deark *c, struct deark_module_info *mi, de_module_params *mpar
 		de_dbg3(c, "[using %s module]", mi->id);
 	}
 	c->module_nesting_level++;
-	mi->run_fn(c, mparams);
+	old_module_id = c->curr_module_id;
+	c->curr_module_id = mi->id;
+	if(c->stats) {
+		struct de_stats_timer tmr;
+
+		de_stats_timer_start(c, &tmr);
+		mi->run_fn(c, mparams);
+		de_stats_timer_stop(c, &tmr, DE_STATSCAT_MODULE, mi->id);
+		de_stats_timer_stop(c, &tmr, DE_STATSCAT_LEVEL, NULL);
+	}
+	else {
+		mi->run_fn(c, mparams);
+	}
+	c->curr_module_id = old_module_id;
 	c->module_nesting_level--;
 	c->module_disposition = old_moddisp;
 	c->detection_data = old_detection_data;
@@ -958,6 +1218,35 @@ int de_run_module_by_id_on_slice2(deark *c, const char *id, const char *codes,
 	return ret;
 }
 
+// Runs a module's identification function on a slice of a file, and
+// returns its confidence level (0 if the module has no such function).
+int de_identify_module_on_slice(deark *c, struct deark_module_info *mi,
+	dbuf *f, i64 pos, i64 len)
+{
+	dbuf *old_ifile;
+	struct de_detection_data_struct *old_detection_data;
+	const char *old_module_id;
+	int ret;
+
+	if(!mi->identify_fn) return 0;
+
+	old_ifile = c->infile;
+	old_detection_data = c->detection_data;
+	old_module_id = c->curr_module_id;
+	c->infile = dbuf_open_input_subfile(f, pos, len);
+	c->detection_data = de_malloc(c, sizeof(struct de_detection_data_struct));
+	c->curr_module_id = mi->id;
+
+	ret = mi->identify_fn(c);
+
+	de_free(c, c->detection_data);
+	dbuf_close(c->infile);
+	c->infile = old_ifile;
+	c->detection_data = old_detection_data;
+	c->curr_module_id = old_module_id;
+	return ret;
+}
+
 const char *de_get_ext_option(deark *c, const char *name)
 {
 	int i;
@@ -2027,44 +2316,41 @@ struct de_crcobj {
 	crcobj_continue_fn continue_fn;
 };
 
-// Persistent items will be freed automatically when the 'deark' object
-// is destroyed. This feature is not used enough to make it worth doing
-// anything to coordinate the use of them.
-#define DE_PERSISTENT_ITEM_CRC32_TBL 0
-#define DE_PERSISTENT_ITEM_CRC16ARC_TBL 1
-#define DE_PERSISTENT_ITEM_CRC16XMODEM_TBL 2
-#define DE_PERSISTENT_ITEM_CRC16SDLC_TBL 3
-#define DE_PERSISTENT_ITEM_CP932_TBL 4
-
-static const u32 *get_crc32_table(deark *c)
-{
-	UI i, j;
-	u32 *tbl;
-
-	if(c->persistent_item[DE_PERSISTENT_ITEM_CRC32_TBL]) {
-		goto done;
-	}
-
-	c->persistent_item[DE_PERSISTENT_ITEM_CRC32_TBL] = de_mallocarray(c, 256, sizeof(u32));
-	tbl = (u32*)c->persistent_item[DE_PERSISTENT_ITEM_CRC32_TBL];
-
-	for(i=0; i<256; i++) {
-		u32 k = (u32)i;
-
-		for(j=0; j<8; j++) {
-			if(k & 1) {
-				k = (k>>1) ^ 0xedb88320U;
-			}
-			else {
-				k >>= 1;
-			}
-		}
-		tbl[i] = k;
-	}
-
-done:
-	return (const u32*)c->persistent_item[DE_PERSISTENT_ITEM_CRC32_TBL];
-}
+// CRC-32 (poly 0xedb88320, reflected)
+static const u32 crc32_table[256] = {
+	0x00000000,0x77073096,0xee0e612c,0x990951ba,0x076dc419,0x706af48f,0xe963a535,0x9e6495a3,
+	0x0edb8832,0x79dcb8a4,0xe0d5e91e,0x97d2d988,0x09b64c2b,0x7eb17cbd,0xe7b82d07,0x90bf1d91,
+	0x1db71064,0x6ab020f2,0xf3b97148,0x84be41de,0x1adad47d,0x6ddde4eb,0xf4d4b551,0x83d385c7,
+	0x136c9856,0x646ba8c0,0xfd62f97a,0x8a65c9ec,0x14015c4f,0x63066cd9,0xfa0f3d63,0x8d080df5,
+	0x3b6e20c8,0x4c69105e,0xd56041e4,0xa2677172,0x3c03e4d1,0x4b04d447,0xd20d85fd,0xa50ab56b,
+	0x35b5a8fa,0x42b2986c,0xdbbbc9d6,0xacbcf940,0x32d86ce3,0x45df5c75,0xdcd60dcf,0xabd13d59,
+	0x26d930ac,0x51de003a,0xc8d75180,0xbfd06116,0x21b4f4b5,0x56b3c423,0xcfba9599,0xb8bda50f,
+	0x2802b89e,0x5f058808,0xc60cd9b2,0xb10be924,0x2f6f7c87,0x58684c11,0xc1611dab,0xb6662d3d,
+	0x76dc4190,0x01db7106,0x98d220bc,0xefd5102a,0x71b18589,0x06b6b51f,0x9fbfe4a5,0xe8b8d433,
+	0x7807c9a2,0x0f00f934,0x9609a88e,0xe10e9818,0x7f6a0dbb,0x086d3d2d,0x91646c97,0xe6635c01,
+	0x6b6b51f4,0x1c6c6162,0x856530d8,0xf262004e,0x6c0695ed,0x1b01a57b,0x8208f4c1,0xf50fc457,
+	0x65b0d9c6,0x12b7e950,0x8bbeb8ea,0xfcb9887c,0x62dd1ddf,0x15da2d49,0x8cd37cf3,0xfbd44c65,
+	0x4db26158,0x3ab551ce,0xa3bc0074,0xd4bb30e2,0x4adfa541,0x3dd895d7,0xa4d1c46d,0xd3d6f4fb,
+	0x4369e96a,0x346ed9fc,0xad678846,0xda60b8d0,0x44042d73,0x33031de5,0xaa0a4c5f,0xdd0d7cc9,
+	0x5005713c,0x270241aa,0xbe0b1010,0xc90c2086,0x5768b525,0x206f85b3,0xb966d409,0xce61e49f,
+	0x5edef90e,0x29d9c998,0xb0d09822,0xc7d7a8b4,0x59b33d17,0x2eb40d81,0xb7bd5c3b,0xc0ba6cad,
+	0xedb88320,0x9abfb3b6,0x03b6e20c,0x74b1d29a,0xead54739,0x9dd277af,0x04db2615,0x73dc1683,
+	0xe3630b12,0x94643b84,0x0d6d6a3e,0x7a6a5aa8,0xe40ecf0b,0x9309ff9d,0x0a00ae27,0x7d079eb1,
+	0xf00f9344,0x8708a3d2,0x1e01f268,0x6906c2fe,0xf762575d,0x806567cb,0x196c3671,0x6e6b06e7,
+	0xfed41b76,0x89d32be0,0x10da7a5a,0x67dd4acc,0xf9b9df6f,0x8ebeeff9,0x17b7be43,0x60b08ed5,
+	0xd6d6a3e8,0xa1d1937e,0x38d8c2c4,0x4fdff252,0xd1bb67f1,0xa6bc5767,0x3fb506dd,0x48b2364b,
+	0xd80d2bda,0xaf0a1b4c,0x36034af6,0x41047a60,0xdf60efc3,0xa867df55,0x316e8eef,0x4669be79,
+	0xcb61b38c,0xbc66831a,0x256fd2a0,0x5268e236,0xcc0c7795,0xbb0b4703,0x220216b9,0x5505262f,
+	0xc5ba3bbe,0xb2bd0b28,0x2bb45a92,0x5cb36a04,0xc2d7ffa7,0xb5d0cf31,0x2cd99e8b,0x5bdeae1d,
+	0x9b64c2b0,0xec63f226,0x756aa39c,0x026d930a,0x9c0906a9,0xeb0e363f,0x72076785,0x05005713,
+	0x95bf4a82,0xe2b87a14,0x7bb12bae,0x0cb61b38,0x92d28e9b,0xe5d5be0d,0x7cdcefb7,0x0bdbdf21,
+	0x86d3d2d4,0xf1d4e242,0x68ddb3f8,0x1fda836e,0x81be16cd,0xf6b9265b,0x6fb077e1,0x18b74777,
+	0x88085ae6,0xff0f6a70,0x66063bca,0x11010b5c,0x8f659eff,0xf862ae69,0x616bffd3,0x166ccf45,
+	0xa00ae278,0xd70dd2ee,0x4e048354,0x3903b3c2,0xa7672661,0xd06016f7,0x4969474d,0x3e6e77db,
+	0xaed16a4a,0xd9d65adc,0x40df0b66,0x37d83bf0,0xa9bcae53,0xdebb9ec5,0x47b2cf7f,0x30b5ffe9,
+	0xbdbdf21c,0xcabac28a,0x53b39330,0x24b4a3a6,0xbad03605,0xcdd70693,0x54de5729,0x23d967bf,
+	0xb3667a2e,0xc4614ab8,0x5d681b02,0x2a6f2b94,0xb40bbe37,0xc30c8ea1,0x5a05df1b,0x2d02ef8d
+};
 
 static void de_crc32_continue(struct de_crcobj *crco, const u8 *buf, i64 buf_len)
 {
@@ -2090,30 +2376,31 @@ static void adler32_continue(struct de_crcobj *crco, const u8 *buf, i64 buf_len)
 	crco->val = (s2 << 16) + s1;
 }
 
-static const u16 *get_crc16xmodem_table(deark *c)
-{
-	const UI poly = 0x1021;
-	const UI pi_idx = DE_PERSISTENT_ITEM_CRC16XMODEM_TBL;
-	u16 *tbl;
-	UI i;
-
-	if(c->persistent_item[pi_idx]) {
-		goto done;
-	}
-
-	c->persistent_item[pi_idx] = de_mallocarray(c, 256, sizeof(u16));
-	tbl = (u16*)c->persistent_item[pi_idx];
-
-	for(i=0; i<128; i++) {
-		UI carry = tbl[i] & 0x8000;
-		UI temp = (tbl[i] << 1) & 0xffff;
-		tbl[i * 2 + (carry ? 0 : 1)] = temp ^ poly;
-		tbl[i * 2 + (carry ? 1 : 0)] = temp;
-	}
-
-done:
-	return (const u16*)c->persistent_item[pi_idx];
-}
+// CRC-16/XMODEM (poly 0x1021)
+static const u16 crc16xmodem_table[256] = {
+	0x0000,0x1021,0x2042,0x3063,0x4084,0x50a5,0x60c6,0x70e7,0x8108,0x9129,0xa14a,0xb16b,
+	0xc18c,0xd1ad,0xe1ce,0xf1ef,0x1231,0x0210,0x3273,0x2252,0x52b5,0x4294,0x72f7,0x62d6,
+	0x9339,0x8318,0xb37b,0xa35a,0xd3bd,0xc39c,0xf3ff,0xe3de,0x2462,0x3443,0x0420,0x1401,
+	0x64e6,0x74c7,0x44a4,0x5485,0xa56a,0xb54b,0x8528,0x9509,0xe5ee,0xf5cf,0xc5ac,0xd58d,
+	0x3653,0x2672,0x1611,0x0630,0x76d7,0x66f6,0x5695,0x46b4,0xb75b,0xa77a,0x9719,0x8738,
+	0xf7df,0xe7fe,0xd79d,0xc7bc,0x48c4,0x58e5,0x6886,0x78a7,0x0840,0x1861,0x2802,0x3823,
+	0xc9cc,0xd9ed,0xe98e,0xf9af,0x8948,0x9969,0xa90a,0xb92b,0x5af5,0x4ad4,0x7ab7,0x6a96,
+	0x1a71,0x0a50,0x3a33,0x2a12,0xdbfd,0xcbdc,0xfbbf,0xeb9e,0x9b79,0x8b58,0xbb3b,0xab1a,
+	0x6ca6,0x7c87,0x4ce4,0x5cc5,0x2c22,0x3c03,0x0c60,0x1c41,0xedae,0xfd8f,0xcdec,0xddcd,
+	0xad2a,0xbd0b,0x8d68,0x9d49,0x7e97,0x6eb6,0x5ed5,0x4ef4,0x3e13,0x2e32,0x1e51,0x0e70,
+	0xff9f,0xefbe,0xdfdd,0xcffc,0xbf1b,0xaf3a,0x9f59,0x8f78,0x9188,0x81a9,0xb1ca,0xa1eb,
+	0xd10c,0xc12d,0xf14e,0xe16f,0x1080,0x00a1,0x30c2,0x20e3,0x5004,0x4025,0x7046,0x6067,
+	0x83b9,0x9398,0xa3fb,0xb3da,0xc33d,0xd31c,0xe37f,0xf35e,0x02b1,0x1290,0x22f3,0x32d2,
+	0x4235,0x5214,0x6277,0x7256,0xb5ea,0xa5cb,0x95a8,0x8589,0xf56e,0xe54f,0xd52c,0xc50d,
+	0x34e2,0x24c3,0x14a0,0x0481,0x7466,0x6447,0x5424,0x4405,0xa7db,0xb7fa,0x8799,0x97b8,
+	0xe75f,0xf77e,0xc71d,0xd73c,0x26d3,0x36f2,0x0691,0x16b0,0x6657,0x7676,0x4615,0x5634,
+	0xd94c,0xc96d,0xf90e,0xe92f,0x99c8,0x89e9,0xb98a,0xa9ab,0x5844,0x4865,0x7806,0x6827,
+	0x18c0,0x08e1,0x3882,0x28a3,0xcb7d,0xdb5c,0xeb3f,0xfb1e,0x8bf9,0x9bd8,0xabbb,0xbb9a,
+	0x4a75,0x5a54,0x6a37,0x7a16,0x0af1,0x1ad0,0x2ab3,0x3a92,0xfd2e,0xed0f,0xdd6c,0xcd4d,
+	0xbdaa,0xad8b,0x9de8,0x8dc9,0x7c26,0x6c07,0x5c64,0x4c45,0x3ca2,0x2c83,0x1ce0,0x0cc1,
+	0xef1f,0xff3e,0xcf5d,0xdf7c,0xaf9b,0xbfba,0x8fd9,0x9ff8,0x6e17,0x7e36,0x4e55,0x5e74,
+	0x2e93,0x3eb2,0x0ed1,0x1ef0
+};
 
 static void de_crc16xmodem_continue(struct de_crcobj *crco, const u8 *buf, i64 buf_len)
 {
@@ -2150,35 +2437,57 @@ static void cksum_u16_continue(struct de_crcobj *crco, const u8 *buf, i64 buf_le
 	}
 }
 
-static const u16 *get_crc16arc_table(deark *c, u16 poly)
-{
-	UI i, k;
-	u16 *tbl;
-	UI pi_idx;
-
-	if(poly==0x8408) {
-		pi_idx = DE_PERSISTENT_ITEM_CRC16SDLC_TBL;
-	}
-	else {
-		pi_idx = DE_PERSISTENT_ITEM_CRC16ARC_TBL;
-	}
-
-	if(c->persistent_item[pi_idx]) {
-		goto done;
-	}
-
-	c->persistent_item[pi_idx] = de_mallocarray(c, 256, sizeof(u16));
-	tbl = (u16*)c->persistent_item[pi_idx];
-
-	for(i=0; i<256; i++) {
-		tbl[i] = i;
-		for(k=0; k<8; k++)
-			tbl[i] = (tbl[i]>>1) ^ ((tbl[i] & 1) ? poly : 0);
-	}
+// CRC-16/ARC (poly 0xa001, reflected)
+static const u16 crc16arc_table[256] = {
+	0x0000,0xc0c1,0xc181,0x0140,0xc301,0x03c0,0x0280,0xc241,0xc601,0x06c0,0x0780,0xc741,
+	0x0500,0xc5c1,0xc481,0x0440,0xcc01,0x0cc0,0x0d80,0xcd41,0x0f00,0xcfc1,0xce81,0x0e40,
+	0x0a00,0xcac1,0xcb81,0x0b40,0xc901,0x09c0,0x0880,0xc841,0xd801,0x18c0,0x1980,0xd941,
+	0x1b00,0xdbc1,0xda81,0x1a40,0x1e00,0xdec1,0xdf81,0x1f40,0xdd01,0x1dc0,0x1c80,0xdc41,
+	0x1400,0xd4c1,0xd581,0x1540,0xd701,0x17c0,0x1680,0xd641,0xd201,0x12c0,0x1380,0xd341,
+	0x1100,0xd1c1,0xd081,0x1040,0xf001,0x30c0,0x3180,0xf141,0x3300,0xf3c1,0xf281,0x3240,
+	0x3600,0xf6c1,0xf781,0x3740,0xf501,0x35c0,0x3480,0xf441,0x3c00,0xfcc1,0xfd81,0x3d40,
+	0xff01,0x3fc0,0x3e80,0xfe41,0xfa01,0x3ac0,0x3b80,0xfb41,0x3900,0xf9c1,0xf881,0x3840,
+	0x2800,0xe8c1,0xe981,0x2940,0xeb01,0x2bc0,0x2a80,0xea41,0xee01,0x2ec0,0x2f80,0xef41,
+	0x2d00,0xedc1,0xec81,0x2c40,0xe401,0x24c0,0x2580,0xe541,0x2700,0xe7c1,0xe681,0x2640,
+	0x2200,0xe2c1,0xe381,0x2340,0xe101,0x21c0,0x2080,0xe041,0xa001,0x60c0,0x6180,0xa141,
+	0x6300,0xa3c1,0xa281,0x6240,0x6600,0xa6c1,0xa781,0x6740,0xa501,0x65c0,0x6480,0xa441,
+	0x6c00,0xacc1,0xad81,0x6d40,0xaf01,0x6fc0,0x6e80,0xae41,0xaa01,0x6ac0,0x6b80,0xab41,
+	0x6900,0xa9c1,0xa881,0x6840,0x7800,0xb8c1,0xb981,0x7940,0xbb01,0x7bc0,0x7a80,0xba41,
+	0xbe01,0x7ec0,0x7f80,0xbf41,0x7d00,0xbdc1,0xbc81,0x7c40,0xb401,0x74c0,0x7580,0xb541,
+	0x7700,0xb7c1,0xb681,0x7640,0x7200,0xb2c1,0xb381,0x7340,0xb101,0x71c0,0x7080,0xb041,
+	0x5000,0x90c1,0x9181,0x5140,0x9301,0x53c0,0x5280,0x9241,0x9601,0x56c0,0x5780,0x9741,
+	0x5500,0x95c1,0x9481,0x5440,0x9c01,0x5cc0,0x5d80,0x9d41,0x5f00,0x9fc1,0x9e81,0x5e40,
+	0x5a00,0x9ac1,0x9b81,0x5b40,0x9901,0x59c0,0x5880,0x9841,0x8801,0x48c0,0x4980,0x8941,
+	0x4b00,0x8bc1,0x8a81,0x4a40,0x4e00,0x8ec1,0x8f81,0x4f40,0x8d01,0x4dc0,0x4c80,0x8c41,
+	0x4400,0x84c1,0x8581,0x4540,0x8701,0x47c0,0x4680,0x8641,0x8201,0x42c0,0x4380,0x8341,
+	0x4100,0x81c1,0x8081,0x4040
+};
 
-done:
-	return (const u16*)c->persistent_item[pi_idx];
-}
+// CRC-16/IBM-SDLC (poly 0x8408, reflected)
+static const u16 crc16sdlc_table[256] = {
+	0x0000,0x1189,0x2312,0x329b,0x4624,0x57ad,0x6536,0x74bf,0x8c48,0x9dc1,0xaf5a,0xbed3,
+	0xca6c,0xdbe5,0xe97e,0xf8f7,0x1081,0x0108,0x3393,0x221a,0x56a5,0x472c,0x75b7,0x643e,
+	0x9cc9,0x8d40,0xbfdb,0xae52,0xdaed,0xcb64,0xf9ff,0xe876,0x2102,0x308b,0x0210,0x1399,
+	0x6726,0x76af,0x4434,0x55bd,0xad4a,0xbcc3,0x8e58,0x9fd1,0xeb6e,0xfae7,0xc87c,0xd9f5,
+	0x3183,0x200a,0x1291,0x0318,0x77a7,0x662e,0x54b5,0x453c,0xbdcb,0xac42,0x9ed9,0x8f50,
+	0xfbef,0xea66,0xd8fd,0xc974,0x4204,0x538d,0x6116,0x709f,0x0420,0x15a9,0x2732,0x36bb,
+	0xce4c,0xdfc5,0xed5e,0xfcd7,0x8868,0x99e1,0xab7a,0xbaf3,0x5285,0x430c,0x7197,0x601e,
+	0x14a1,0x0528,0x37b3,0x263a,0xdecd,0xcf44,0xfddf,0xec56,0x98e9,0x8960,0xbbfb,0xaa72,
+	0x6306,0x728f,0x4014,0x519d,0x2522,0x34ab,0x0630,0x17b9,0xef4e,0xfec7,0xcc5c,0xddd5,
+	0xa96a,0xb8e3,0x8a78,0x9bf1,0x7387,0x620e,0x5095,0x411c,0x35a3,0x242a,0x16b1,0x0738,
+	0xffcf,0xee46,0xdcdd,0xcd54,0xb9eb,0xa862,0x9af9,0x8b70,0x8408,0x9581,0xa71a,0xb693,
+	0xc22c,0xd3a5,0xe13e,0xf0b7,0x0840,0x19c9,0x2b52,0x3adb,0x4e64,0x5fed,0x6d76,0x7cff,
+	0x9489,0x8500,0xb79b,0xa612,0xd2ad,0xc324,0xf1bf,0xe036,0x18c1,0x0948,0x3bd3,0x2a5a,
+	0x5ee5,0x4f6c,0x7df7,0x6c7e,0xa50a,0xb483,0x8618,0x9791,0xe32e,0xf2a7,0xc03c,0xd1b5,
+	0x2942,0x38cb,0x0a50,0x1bd9,0x6f66,0x7eef,0x4c74,0x5dfd,0xb58b,0xa402,0x9699,0x8710,
+	0xf3af,0xe226,0xd0bd,0xc134,0x39c3,0x284a,0x1ad1,0x0b58,0x7fe7,0x6e6e,0x5cf5,0x4d7c,
+	0xc60c,0xd785,0xe51e,0xf497,0x8028,0x91a1,0xa33a,0xb2b3,0x4a44,0x5bcd,0x6956,0x78df,
+	0x0c60,0x1de9,0x2f72,0x3efb,0xd68d,0xc704,0xf59f,0xe416,0x90a9,0x8120,0xb3bb,0xa232,
+	0x5ac5,0x4b4c,0x79d7,0x685e,0x1ce1,0x0d68,0x3ff3,0x2e7a,0xe70e,0xf687,0xc41c,0xd595,
+	0xa12a,0xb0a3,0x8238,0x93b1,0x6b46,0x7acf,0x4854,0x59dd,0x2d62,0x3ceb,0x0e70,0x1ff9,
+	0xf78f,0xe606,0xd49d,0xc514,0xb1ab,0xa022,0x92b9,0x8330,0x7bc7,0x6a4e,0x58d5,0x495c,
+	0x3de3,0x2c6a,0x1ef1,0x0f78
+};
 
 static void de_crc16arc_continue(struct de_crcobj *crco, const u8 *buf, i64 buf_len)
 {
@@ -2205,7 +2514,7 @@ struct de_crcobj *de_crcobj_create(deark *c, UI type_and_flags)
 	case DE_CRCOBJ_CRC32_JAMCRC:
 		// "PL" is a placeholder name. I don't know a good name for this variant.
 	case DE_CRCOBJ_CRC32_PL:
-		crco->table32s = get_crc32_table(crco->c);
+		crco->table32s = crc32_table;
 		crco->continue_fn = de_crc32_continue;
 		break;
 	case DE_CRCOBJ_ADLER32:
@@ -2215,20 +2524,20 @@ struct de_crcobj *de_crcobj_create(deark *c, UI type_and_flags)
 		// "XMODEM" is the CRC-16 algorithm used in MacBinary.
 		// The CRC RevEng catalogue calls it "CRC-16/XMODEM".
 	case DE_CRCOBJ_CRC16_IBM3740:
-		crco->table16s = get_crc16xmodem_table(crco->c);
+		crco->table16s = crc16xmodem_table;
 		crco->continue_fn = de_crc16xmodem_continue;
 		break;
 	case DE_CRCOBJ_CRC16_ARC:
 		// This is the CRC-16 algorithm used in ARC, LHA, ZOO, etc.
 		// The CRC RevEng catalogue calls it "CRC-16/ARC".
-		crco->table16s = get_crc16arc_table(crco->c, 0xa001);
+		crco->table16s = crc16arc_table;
 		crco->continue_fn = de_crc16arc_continue;
 		break;
 	case DE_CRCOBJ_CRC16_IBMSDLC:
 		// This is the CRC-16 algorithm used in ar001.
 		// I'm pretty sure it is equivalent to the one the CRC RevEng catalogue
 		// calls "CRC-16/IBM-SDLC".
-		crco->table16s = get_crc16arc_table(crco->c, 0x8408);
+		crco->table16s = crc16sdlc_table;
 		crco->continue_fn = de_crc16arc_continue;
 		break;
 	case DE_CRCOBJ_SUM_BYTES:
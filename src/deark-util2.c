@@ -52,6 +52,9 @@ int de_decompress_zlib_mem2mem(deark *c,
 
 #include "../foreign/cp932data.h"
 
+// Persistent items will be freed automatically when the 'deark' object
+// is destroyed. This feature is not used enough to make it worth doing
+// anything to coordinate the use of them.
 #define DE_PERSISTENT_ITEM_CP932_TBL 4
 
 static void make_cp932_table(deark *c)
@@ -543,6 +543,27 @@ void de_current_time_to_timestamp(struct de_timestamp *ts)
 	de_FILETIME_to_timestamp(ft, ts, 0x1);
 }
 
+// Note: Need to keep this function in sync with the implementation in deark-unix.c.
+i64 de_get_monotonic_time_ns(void)
+{
+	LARGE_INTEGER freq, count;
+
+	if(!QueryPerformanceFrequency(&freq) || freq.QuadPart<=0) return 0;
+	if(!QueryPerformanceCounter(&count)) return 0;
+	return (i64)(count.QuadPart / freq.QuadPart) * 1000000000 +
+		(i64)(count.QuadPart % freq.QuadPart) * 1000000000 / (i64)freq.QuadPart;
+}
+
+// Returns the peak resident memory usage of this process, in bytes, or -1 if
+// unknown.
+// Note: Need to keep this function in sync with the implementation in deark-unix.c.
+i64 de_get_peak_memory_usage(void)
+{
+	// TODO: GetProcessMemoryInfo() would work, but requires psapi.lib on
+	// older versions of Windows.
+	return -1;
+}
+
 void de_exitprocess(int s)
 {
 	exit(s?EXIT_FAILURE:EXIT_SUCCESS);
@@ -9,6 +9,10 @@
 #include "deark-private.h"
 #include "deark-fmtutil.h"
 
+// Limits for de_dfilter_reserve_output()
+#define DE_DFILTER_MAX_RESERVE (4*1024*1024)
+#define DE_DFILTER_MAX_RESERVE_RATIO 8
+
 // Returns a message that is valid until the next operation on dres.
 const char *de_dfilter_get_errmsg(deark *c, struct de_dfilter_results *dres)
 {
@@ -42,6 +46,24 @@ void de_dfilter_init_objects(deark *c, struct de_dfilter_in_params *dcmpri,
 		de_dfilter_results_clear(c, dres);
 }
 
+// Codecs can call this when they start, so that the output dbuf can
+// allocate the memory it will need all at once.
+// The expected length comes from the file, so it is only trusted to a
+// point. Larger outputs will have to grow as usual.
+// dcmpri can be NULL if the input size is unknown.
+void de_dfilter_reserve_output(deark *c, struct de_dfilter_in_params *dcmpri,
+	struct de_dfilter_out_params *dcmpro)
+{
+	i64 n;
+
+	if(!dcmpro || !dcmpro->f || !dcmpro->len_known) return;
+	n = de_min_int(dcmpro->expected_len, DE_DFILTER_MAX_RESERVE);
+	if(dcmpri) {
+		n = de_min_int(n, dcmpri->len * DE_DFILTER_MAX_RESERVE_RATIO);
+	}
+	dbuf_reserve(dcmpro->f, n);
+}
+
 void de_dfilter_set_errorf(deark *c, struct de_dfilter_results *dres, const char *modname,
 	const char *fmt, ...)
 {
@@ -87,6 +109,7 @@ struct de_dfilter_ctx *de_dfilter_create(deark *c,
 	dfctx->c = c;
 	dfctx->dres = dres;
 	dfctx->dcmpro = dcmpro;
+	de_dfilter_reserve_output(c, NULL, dcmpro);
 
 	if(codec_init_fn) {
 		codec_init_fn(dfctx, codec_private_params);
@@ -102,7 +125,16 @@ void de_dfilter_addbuf(struct de_dfilter_ctx *dfctx,
 	if(dfctx->finished_flag) return;
 
 	if(dfctx->codec_addbuf_fn && (buf_len>0)) {
-		dfctx->codec_addbuf_fn(dfctx, buf, buf_len);
+		if(dfctx->c->stats) {
+			struct de_stats_timer tmr;
+
+			de_stats_timer_start(dfctx->c, &tmr);
+			dfctx->codec_addbuf_fn(dfctx, buf, buf_len);
+			de_stats_timer_pause(dfctx->c, &tmr, &dfctx->stats_time);
+		}
+		else {
+			dfctx->codec_addbuf_fn(dfctx, buf, buf_len);
+		}
 
 		if(dfctx->dres->errcode) {
 			dfctx->finished_flag = 1;
@@ -145,7 +177,16 @@ void de_dfilter_command(struct de_dfilter_ctx *dfctx, int cmd, UI flags)
 void de_dfilter_finish(struct de_dfilter_ctx *dfctx)
 {
 	if(dfctx->codec_finish_fn) {
-		dfctx->codec_finish_fn(dfctx);
+		if(dfctx->c->stats) {
+			struct de_stats_timer tmr;
+
+			de_stats_timer_start(dfctx->c, &tmr);
+			dfctx->codec_finish_fn(dfctx);
+			de_stats_timer_pause(dfctx->c, &tmr, &dfctx->stats_time);
+		}
+		else {
+			dfctx->codec_finish_fn(dfctx);
+		}
 	}
 }
 
@@ -155,6 +196,9 @@ void de_dfilter_destroy(struct de_dfilter_ctx *dfctx)
 
 	if(!dfctx) return;
 	c = dfctx->c;
+	if(c->stats) {
+		de_stats_record(c, DE_STATSCAT_CODEC, dfctx->codec_name, &dfctx->stats_time);
+	}
 	if(dfctx->codec_destroy_fn) {
 		dfctx->codec_destroy_fn(dfctx);
 	}
@@ -297,7 +341,9 @@ void fmtutil_lzss1_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 	struct de_lzss1_params *params = (struct de_lzss1_params*)codec_private_params;
 	struct lzss_ctx *sctx = NULL;
 	UI hst_startpos_from_end;
+	struct de_stats_timer tmr;
 
+	de_stats_timer_start(c, &tmr);
 	sctx = de_malloc(c, sizeof(struct lzss_ctx));
 	sctx->dcmpri = dcmpri;
 	sctx->dcmpro = dcmpro;
@@ -347,7 +393,7 @@ void fmtutil_lzss1_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 
 			if(sctx->cur_ipos+1 > sctx->endpos) goto unc_done;
 			b = dbuf_getbyte_p(dcmpri->f, &sctx->cur_ipos);
-			if(c->debug_level>=4) {
+			if(de_dbg_enabled(c, 4)) {
 				de_dbg(c, "bpos=%u lit %u", sctx->ringbuf->curpos, (UI)b);
 			}
 			de_lz77buffer_add_literal_byte(sctx->ringbuf, b);
@@ -363,7 +409,7 @@ void fmtutil_lzss1_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 			x1 = (UI)dbuf_getbyte_p(dcmpri->f, &sctx->cur_ipos);
 			matchpos = ((x1 & 0xf0) << 4) | x0;
 			matchlen = (x1 & 0x0f) + 3;
-			if(c->debug_level>=4) {
+			if(de_dbg_enabled(c, 4)) {
 				UI mpos_rel; // # bytes back from curpos
 
 				mpos_rel = (UI)((sctx->ringbuf->curpos-matchpos)&(LZSS_BUFSIZE-1));
@@ -381,6 +427,7 @@ unc_done:
 	dres->bytes_consumed = sctx->cur_ipos - dcmpri->pos;
 	de_lz77buffer_destroy(c, sctx->ringbuf);
 	de_free(c, sctx);
+	de_stats_timer_stop(c, &tmr, DE_STATSCAT_CODEC, "lzss1");
 }
 
 // ==============================================
@@ -420,7 +467,7 @@ void fmtutil_lzssmmfw_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 
 				if(sctx->cur_ipos+1 > sctx->endpos) goto unc_done;
 				b = dbuf_getbyte_p(dcmpri->f, &sctx->cur_ipos);
-				if(c->debug_level>=4) {
+				if(de_dbg_enabled(c, 4)) {
 					de_dbg(c, "bpos=%u lit %02x", sctx->ringbuf->curpos, (UI)b);
 				}
 				de_lz77buffer_add_literal_byte(sctx->ringbuf, b);
@@ -436,7 +483,7 @@ void fmtutil_lzssmmfw_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 				x1 = (UI)dbuf_getbyte_p(dcmpri->f, &sctx->cur_ipos);
 				matchpos = ((x0 & 0x03)<<8) | x1;
 				matchlen = ((x0 & 0xfc)>>2) + 3;
-				if(c->debug_level>=4) {
+				if(de_dbg_enabled(c, 4)) {
 					de_dbg(c, "bpos=%u match mpos=%u(%u) len=%u", sctx->ringbuf->curpos,
 						matchpos, (UI)((LZSSMMFW_BUFSIZE-1)&(sctx->ringbuf->curpos-matchpos)),
 						matchlen);
@@ -516,9 +563,15 @@ unc_done:
 
 //========================================================
 
+// Size of the write buffer between the two codecs. This is the most data
+// that is passed to codec2 at once.
+#define DE_2LAYER_WBUFFER_SIZE 65536
+
 struct my_2layer_userdata {
+	struct de_dfilter_ctx *dfctx_codec1; // NULL if codec1 is not pushable
 	struct de_dfilter_ctx *dfctx_codec2;
 	i64 intermediate_nbytes;
+	u8 codec2_failed;
 };
 
 static void my_2layer_write_cb(dbuf *f, void *userdata,
@@ -526,8 +579,25 @@ static void my_2layer_write_cb(dbuf *f, void *userdata,
 {
 	struct my_2layer_userdata *u = (struct my_2layer_userdata*)userdata;
 
+	if(u->codec2_failed) return;
 	de_dfilter_addbuf(u->dfctx_codec2, buf, size);
 	u->intermediate_nbytes += size;
+
+	if(u->dfctx_codec2->dres->errcode) {
+		// The rest of codec1's output will be discarded. If codec1 is
+		// pushable, my_2layer_codec1_cbfn() stops feeding it input.
+		u->codec2_failed = 1;
+	}
+}
+
+static int my_2layer_codec1_cbfn(struct de_bufferedreadctx *brctx, const u8 *buf,
+	i64 buf_len)
+{
+	struct my_2layer_userdata *u = (struct my_2layer_userdata*)brctx->userdata;
+
+	de_dfilter_addbuf(u->dfctx_codec1, buf, buf_len);
+	if(u->dfctx_codec1->finished_flag || u->codec2_failed) return 0;
+	return 1;
 }
 
 // If src indicates error and dst does not, copy the error from src to dst.
@@ -567,7 +637,7 @@ void de_dfilter_decompress_two_layer(deark *c, struct de_dcmpr_two_layer_params
 	// Make a custom dbuf. The output from the first decompressor will be written
 	// to it, and it will relay that output to the second decompressor.
 	outf_codec1 = dbuf_create_custom_dbuf(c, 0, 0);
-	dbuf_enable_wbuffer(outf_codec1);
+	dbuf_enable_wbuffer_ex(outf_codec1, DE_2LAYER_WBUFFER_SIZE);
 	outf_codec1->userdata_for_customwrite = (void*)&u;
 	outf_codec1->customwrite_fn = my_2layer_write_cb;
 
@@ -584,17 +654,30 @@ void de_dfilter_decompress_two_layer(deark *c, struct de_dcmpr_two_layer_params
 	dfctx_codec2 = de_dfilter_create(c, tlp->codec2, tlp->codec2_private_params, tlp->dcmpro, &dres_codec2);
 	u.dfctx_codec2 = dfctx_codec2;
 
-	// The first codec in the chain does not need the advanced (de_dfilter_create) API.
 	if(tlp->codec1_type1) {
 		tlp->codec1_type1(c, tlp->dcmpri, &dcmpro_codec1, tlp->dres, tlp->codec1_private_params);
 	}
 	else {
-		de_dfilter_decompress_oneshot(c, tlp->codec1_pushable, tlp->codec1_private_params,
-			tlp->dcmpri, &dcmpro_codec1, tlp->dres);
+		// (Like de_dfilter_decompress_oneshot(), but we can stop early if
+		// codec2 fails.)
+		u.dfctx_codec1 = de_dfilter_create(c, tlp->codec1_pushable, tlp->codec1_private_params,
+			&dcmpro_codec1, tlp->dres);
+		u.dfctx_codec1->input_file_offset = tlp->dcmpri->pos;
+		dbuf_buffered_read(tlp->dcmpri->f, tlp->dcmpri->pos, tlp->dcmpri->len,
+			my_2layer_codec1_cbfn, (void*)&u);
+		// If codec1 was stopped early, finishing it could only report that its
+		// input was cut short. Any error it found before that is kept.
+		if(!u.codec2_failed) {
+			de_dfilter_finish(u.dfctx_codec1);
+		}
+		de_dfilter_destroy(u.dfctx_codec1);
+		u.dfctx_codec1 = NULL;
 	}
 	dbuf_flush(outf_codec1);
 	de_dfilter_finish(dfctx_codec2);
 
+	// An error in codec1 takes precedence, since it may have caused the error
+	// in codec2.
 	if(tlp->dres->errcode) goto done;
 	de_dbg2(c, "size after intermediate decompression: %"I64_FMT, u.intermediate_nbytes);
 
@@ -654,9 +737,36 @@ void de_lz77buffer_copy_from_hist(struct de_lz77buffer *rb,
 	UI i;
 
 	frompos = startpos & rb->mask;
-	for(i=0; i<count; i++) {
-		de_lz77buffer_add_literal_byte(rb, rb->buf[frompos]);
-		frompos = (frompos+1) & rb->mask;
+
+	if(!rb->writebuf_cb) {
+		for(i=0; i<count; i++) {
+			de_lz77buffer_add_literal_byte(rb, rb->buf[frompos]);
+			frompos = (frompos+1) & rb->mask;
+		}
+		return;
+	}
+
+	// Copy in pieces that don't wrap around the end of the buffer.
+	while(count>0) {
+		UI n = count;
+
+		if(n > rb->bufsize - rb->curpos) n = rb->bufsize - rb->curpos;
+		if(n > rb->bufsize - frompos) n = rb->bufsize - frompos;
+
+		if(frompos < rb->curpos && rb->curpos - frompos < n) {
+			// Overlapping; the copied bytes have to repeat.
+			for(i=0; i<n; i++) {
+				rb->buf[rb->curpos+i] = rb->buf[frompos+i];
+			}
+		}
+		else {
+			de_memmove(&rb->buf[rb->curpos], &rb->buf[frompos], (size_t)n);
+		}
+
+		rb->writebuf_cb(rb, &rb->buf[rb->curpos], n);
+		rb->curpos = (rb->curpos+n) & rb->mask;
+		frompos = (frompos+n) & rb->mask;
+		count -= n;
 	}
 }
 
@@ -712,7 +822,7 @@ static void squeeze_interpret_dval(struct squeeze_ctx *sqctx,
 		//  ...
 		//  -1   => 0   (byte value)
 		adj_value = -(((fmtutil_huffman_valtype)dval)+1);
-		if(sqctx->c->debug_level>=3) {
+		if(de_dbg_enabled(sqctx->c, 3)) {
 			de_dbg3(sqctx->c, "code: \"%s\" = %d",
 				de_print_base2_fixed(b2buf, sizeof(b2buf), currcode, currcode_nbits),
 				(int)adj_value);
@@ -749,7 +859,7 @@ static int squeeze_process_nodetable(deark *c, struct squeeze_ctx *sqctx)
 	squeeze_interpret_node(sqctx, 0, 0, 0);
 	de_dbg_indent(c, -1);
 
-	if(c->debug_level>=4) {
+	if(de_dbg_enabled(c, 4)) {
 		fmtutil_huffman_dump(c, sqctx->ht);
 	}
 
@@ -776,7 +886,7 @@ static int squeeze_read_nodetable(deark *c, struct squeeze_ctx *sqctx)
 	for(k=0; k<sqctx->nodecount; k++) {
 		sqctx->tmpnodes[k].child[0].dval = (i16)dbuf_geti16le_p(sqctx->dcmpri->f, &sqctx->bitrd.curpos);
 		sqctx->tmpnodes[k].child[1].dval = (i16)dbuf_geti16le_p(sqctx->dcmpri->f, &sqctx->bitrd.curpos);
-		if(c->debug_level >= 2) {
+		if(de_dbg_enabled(c, 2)) {
 			de_dbg2(c, "nodetable[%d]: %d %d", (int)k, (int)sqctx->tmpnodes[k].child[0].dval,
 				(int)sqctx->tmpnodes[k].child[1].dval);
 		}
@@ -844,7 +954,9 @@ void fmtutil_huff_squeeze_codectype1(deark *c, struct de_dfilter_in_params *dcmp
 {
 	struct squeeze_ctx *sqctx = NULL;
 	int ok = 0;
+	struct de_stats_timer tmr;
 
+	de_stats_timer_start(c, &tmr);
 	sqctx = de_malloc(c, sizeof(struct squeeze_ctx));
 	sqctx->c = c;
 	sqctx->modname = "unsqueeze";
@@ -877,6 +989,7 @@ done:
 		fmtutil_huffman_destroy_decoder(c, sqctx->ht);
 		de_free(c, sqctx);
 	}
+	de_stats_timer_stop(c, &tmr, DE_STATSCAT_CODEC, "unsqueeze");
 }
 
 ///////////////////////////////////
@@ -916,7 +1029,7 @@ static void sit_huff_read_tree(struct sit_huffctx *hctx, u64 curr_code, UI curr_
 		fmtutil_huffman_valtype val;
 
 		val = (fmtutil_huffman_valtype)de_bitreader_getbits(&hctx->bitrd, 8);
-		if(hctx->c->debug_level>=2) {
+		if(de_dbg_enabled(hctx->c, 2)) {
 			char b2buf[72];
 
 			de_dbg(hctx->c, "code: \"%s\" = %d",
@@ -959,7 +1072,7 @@ void fmtutil_huff_packit_codectype1(deark *c, struct de_dfilter_in_params *dcmpr
 	sit_huff_read_tree(hctx, 0, 0);
 	de_dbg_indent(c, -1);
 	if(hctx->errflag) goto done;
-	if(c->debug_level>=4) {
+	if(de_dbg_enabled(c, 4)) {
 		fmtutil_huffman_dump(c, hctx->ht);
 	}
 	if(fmtutil_huffman_get_max_bits(hctx->ht->bk)<1) {
@@ -1240,7 +1353,7 @@ static void do_xpk_chunk(deark *c, struct xpkc_ctx *xc)
 		d2o.expected_len = chk->ulen;
 		d2o.len_known = 1;
 
-		old_olen = xc->dcmpro->f->len;
+		old_olen = dbuf_get_length(xc->dcmpro->f);
 
 		de_dbg(c, "[decompressing chunk]");
 		de_dbg_indent(c, 1);
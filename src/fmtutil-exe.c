@@ -1200,15 +1200,10 @@ static void detect_exesfx_zip(deark *c,
 	i64 foundpos = 0;
 
 	if(!edd->zip_eocd_looked_for) {
-		if(c->infile==ei->f && c->detection_data && c->detection_data->zip_eocd_looked_for) {
-			edd->zip_eocd_looked_for = 1;
-			edd->zip_eocd_found = c->detection_data->zip_eocd_found;
-			edd->zip_eocd_pos = c->detection_data->zip_eocd_pos;
-		}
-		else {
-			edd->zip_eocd_found = (u8)fmtutil_find_zip_eocd(c, c->infile, 0, &edd->zip_eocd_pos);
-			edd->zip_eocd_looked_for = 1;
-		}
+		// (If ei->f is the main input file, this search may have already been
+		// done, and cached, during format detection.)
+		edd->zip_eocd_found = (u8)fmtutil_find_zip_eocd(c, ei->f, 0, &edd->zip_eocd_pos);
+		edd->zip_eocd_looked_for = 1;
 	}
 
 	if(!edd->zip_eocd_found) goto done;
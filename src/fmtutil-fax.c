@@ -9,11 +9,6 @@
 #include "deark-private.h"
 #include "deark-fmtutil.h"
 
-struct fax34_huffman_tree {
-	struct fmtutil_huffman_decoder *htwb[2]; // [0]=white, [1]=black
-	struct fmtutil_huffman_decoder *_2d_codes;
-};
-
 struct fax_ctx {
 	struct de_dfilter_in_params *dcmpri;
 	struct de_dfilter_out_params *dcmpro;
@@ -26,13 +21,28 @@ struct fax_ctx {
 	i64 image_width, image_height;
 
 	i64 nbytes_written;
-	struct de_bitreader bitrd;
 
-	u8 *curr_row; // array[image_width]
-	u8 *prev_row; // array[image_width]
+	// Bit reader. The unread bits are left-aligned in bit_buf, in the order
+	// they are to be decoded (bytes are bit-reversed when they are read, if
+	// is_lsb is set).
+	i64 inf_curpos;
+	i64 inf_endpos;
+	u32 bit_buf;
+	UI nbits_in_bitbuf;
+	u8 eof_flag;
+	UI inbuf_nbytes;
+	UI inbuf_idx;
+	u8 inbuf[256];
 
 	i64 rowspan_final;
-	u8 *tmp_row_packed; // array[rowspan_final]
+	u8 *curr_row; // array[rowspan_final]. 1 bit/pixel, white=0, black=1.
+
+	// The "changing elements" of the previous row, i.e. the positions at which
+	// the color changes. Starts with a change from white to black, and
+	// alternates from there. Only used by the 2-d decoder.
+	i64 *prev_ch; // array[image_width]
+	i64 num_prev_ch;
+	i64 prev_ch_idx; // Where find_b1() starts looking
 
 	i64 pending_run_len;
 	UI f2d_h_codes_remaining;
@@ -54,175 +64,314 @@ struct fax_ctx {
 #define FAX2D_EXTENSION  3
 #define FAX2D_V_BIAS     100
 
-static const u8 fax34_2dvals[11] = {
-	FAX2D_7ZEROES, // EOFB, etc...
-	FAX2D_EXTENSION, // Extension...
-	FAX2D_V_BIAS-3, // VL3
-	FAX2D_V_BIAS+3, // VR3
-	FAX2D_V_BIAS-2, // VL2
-	FAX2D_V_BIAS+2, // VR2
-	FAX2D_P, // P
-	FAX2D_H, // H...
-	FAX2D_V_BIAS-1, // VL1
-	FAX2D_V_BIAS+1, // VR1
-	FAX2D_V_BIAS // V0
-};
+// The codes beginning with 8 zeroes. Generally, this will be the start of an
+// EOL or sync code, the remainder of which will be handled with special logic.
+#define FAX1D_8ZEROES (-1)
 
-static const u8 fax34_2dcodes[11] = {
-	0x00, // 0000000
-	0x01, // 0000001
-	0x02, // 0000010
-	0x03, // 0000011
-	0x02, // 000010
-	0x03, // 000011
-	0x1,  // 0001
-	0x1,  // 001
-	0x2,  // 010
-	0x3,  // 011
-	0x1   // 1
+// Decoding tables. The first 2^n entries (n=8 for the white and black tables,
+// n=7 for the 2-d mode table) are indexed by the next n bits of input. An
+// entry is either a code (code length in the low 4 bits, value in the rest),
+// or a pointer to a subtable for codes longer than n bits (low 4 bits = 0,
+// next 3 bits = number of additional bits to look at, rest = offset of the
+// subtable).
+// For white and black codes, the value is the run length, or FX_8Z for the
+// 8-zeroes code. For 2-d codes, it's one of the FAX2D_* values.
+#define FX(v, n) (u16)(((v)<<4)|(n))
+#define FXSUB(ofs, n) (u16)(((ofs)<<7)|((n)<<4))
+#define FX_8Z 0xfff
+
+static const u16 fax34_white_tbl[288] = {
+	FX(FX_8Z,8), FXSUB(256,4), FX(29,8), FX(30,8), FX(45,8), FX(46,8), FX(22,7), FX(22,7),
+	FX(23,7), FX(23,7), FX(47,8), FX(48,8), FX(13,6), FX(13,6), FX(13,6), FX(13,6),
+	FX(20,7), FX(20,7), FX(33,8), FX(34,8), FX(35,8), FX(36,8), FX(37,8), FX(38,8),
+	FX(19,7), FX(19,7), FX(31,8), FX(32,8), FX(1,6), FX(1,6), FX(1,6), FX(1,6), FX(12,6),
+	FX(12,6), FX(12,6), FX(12,6), FX(53,8), FX(54,8), FX(26,7), FX(26,7), FX(39,8),
+	FX(40,8), FX(41,8), FX(42,8), FX(43,8), FX(44,8), FX(21,7), FX(21,7), FX(28,7),
+	FX(28,7), FX(61,8), FX(62,8), FX(63,8), FX(0,8), FX(320,8), FX(384,8), FX(10,5),
+	FX(10,5), FX(10,5), FX(10,5), FX(10,5), FX(10,5), FX(10,5), FX(10,5), FX(11,5),
+	FX(11,5), FX(11,5), FX(11,5), FX(11,5), FX(11,5), FX(11,5), FX(11,5), FX(27,7),
+	FX(27,7), FX(59,8), FX(60,8), FXSUB(272,1), FXSUB(274,1), FX(18,7), FX(18,7),
+	FX(24,7), FX(24,7), FX(49,8), FX(50,8), FX(51,8), FX(52,8), FX(25,7), FX(25,7),
+	FX(55,8), FX(56,8), FX(57,8), FX(58,8), FX(192,6), FX(192,6), FX(192,6), FX(192,6),
+	FX(1664,6), FX(1664,6), FX(1664,6), FX(1664,6), FX(448,8), FX(512,8), FXSUB(276,1),
+	FX(640,8), FX(576,8), FXSUB(278,1), FXSUB(280,1), FXSUB(282,1), FXSUB(284,1),
+	FXSUB(286,1), FX(256,7), FX(256,7), FX(2,4), FX(2,4), FX(2,4), FX(2,4), FX(2,4),
+	FX(2,4), FX(2,4), FX(2,4), FX(2,4), FX(2,4), FX(2,4), FX(2,4), FX(2,4), FX(2,4),
+	FX(2,4), FX(2,4), FX(3,4), FX(3,4), FX(3,4), FX(3,4), FX(3,4), FX(3,4), FX(3,4),
+	FX(3,4), FX(3,4), FX(3,4), FX(3,4), FX(3,4), FX(3,4), FX(3,4), FX(3,4), FX(3,4),
+	FX(128,5), FX(128,5), FX(128,5), FX(128,5), FX(128,5), FX(128,5), FX(128,5),
+	FX(128,5), FX(8,5), FX(8,5), FX(8,5), FX(8,5), FX(8,5), FX(8,5), FX(8,5), FX(8,5),
+	FX(9,5), FX(9,5), FX(9,5), FX(9,5), FX(9,5), FX(9,5), FX(9,5), FX(9,5), FX(16,6),
+	FX(16,6), FX(16,6), FX(16,6), FX(17,6), FX(17,6), FX(17,6), FX(17,6), FX(4,4),
+	FX(4,4), FX(4,4), FX(4,4), FX(4,4), FX(4,4), FX(4,4), FX(4,4), FX(4,4), FX(4,4),
+	FX(4,4), FX(4,4), FX(4,4), FX(4,4), FX(4,4), FX(4,4), FX(5,4), FX(5,4), FX(5,4),
+	FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4),
+	FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(14,6), FX(14,6), FX(14,6), FX(14,6), FX(15,6),
+	FX(15,6), FX(15,6), FX(15,6), FX(64,5), FX(64,5), FX(64,5), FX(64,5), FX(64,5),
+	FX(64,5), FX(64,5), FX(64,5), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4),
+	FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4),
+	FX(6,4), FX(7,4), FX(7,4), FX(7,4), FX(7,4), FX(7,4), FX(7,4), FX(7,4), FX(7,4),
+	FX(7,4), FX(7,4), FX(7,4), FX(7,4), FX(7,4), FX(7,4), FX(7,4), FX(7,4), FX(1792,11),
+	FX(1792,11), FX(1984,12), FX(2048,12), FX(2112,12), FX(2176,12), FX(2240,12),
+	FX(2304,12), FX(1856,11), FX(1856,11), FX(1920,11), FX(1920,11), FX(2368,12),
+	FX(2432,12), FX(2496,12), FX(2560,12), FX(1472,9), FX(1536,9), FX(1600,9), FX(1728,9),
+	FX(704,9), FX(768,9), FX(832,9), FX(896,9), FX(960,9), FX(1024,9), FX(1088,9),
+	FX(1152,9), FX(1216,9), FX(1280,9), FX(1344,9), FX(1408,9)
 };
 
-static const u8 fax34_2dcodelengths[11] = {
-	7, 7, 7, 7, 6, 6, 4, 3, 3, 3, 1
+static const u16 fax34_black_tbl[400] = {
+	FX(FX_8Z,8), FXSUB(256,4), FXSUB(272,5), FXSUB(304,5), FX(13,8), FXSUB(336,4),
+	FXSUB(352,4), FX(14,8), FX(10,7), FX(10,7), FX(11,7), FX(11,7), FXSUB(368,4),
+	FXSUB(384,4), FX(12,7), FX(12,7), FX(9,6), FX(9,6), FX(9,6), FX(9,6), FX(8,6),
+	FX(8,6), FX(8,6), FX(8,6), FX(7,5), FX(7,5), FX(7,5), FX(7,5), FX(7,5), FX(7,5),
+	FX(7,5), FX(7,5), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4),
+	FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4), FX(6,4),
+	FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4),
+	FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(5,4), FX(1,3), FX(1,3),
+	FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3),
+	FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3),
+	FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3), FX(1,3),
+	FX(1,3), FX(1,3), FX(1,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3),
+	FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3),
+	FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3),
+	FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(4,3), FX(3,2),
+	FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2),
+	FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2),
+	FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2),
+	FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2),
+	FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2),
+	FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2),
+	FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2), FX(3,2),
+	FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2),
+	FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2),
+	FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2),
+	FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2),
+	FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2),
+	FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2),
+	FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2), FX(2,2),
+	FX(2,2), FX(1792,11), FX(1792,11), FX(1984,12), FX(2048,12), FX(2112,12), FX(2176,12),
+	FX(2240,12), FX(2304,12), FX(1856,11), FX(1856,11), FX(1920,11), FX(1920,11),
+	FX(2368,12), FX(2432,12), FX(2496,12), FX(2560,12), FX(18,10), FX(18,10), FX(18,10),
+	FX(18,10), FX(18,10), FX(18,10), FX(18,10), FX(18,10), FX(52,12), FX(52,12),
+	FX(640,13), FX(704,13), FX(768,13), FX(832,13), FX(55,12), FX(55,12), FX(56,12),
+	FX(56,12), FX(1280,13), FX(1344,13), FX(1408,13), FX(1472,13), FX(59,12), FX(59,12),
+	FX(60,12), FX(60,12), FX(1536,13), FX(1600,13), FX(24,11), FX(24,11), FX(24,11),
+	FX(24,11), FX(25,11), FX(25,11), FX(25,11), FX(25,11), FX(1664,13), FX(1728,13),
+	FX(320,12), FX(320,12), FX(384,12), FX(384,12), FX(448,12), FX(448,12), FX(512,13),
+	FX(576,13), FX(53,12), FX(53,12), FX(54,12), FX(54,12), FX(896,13), FX(960,13),
+	FX(1024,13), FX(1088,13), FX(1152,13), FX(1216,13), FX(64,10), FX(64,10), FX(64,10),
+	FX(64,10), FX(64,10), FX(64,10), FX(64,10), FX(64,10), FX(23,11), FX(23,11),
+	FX(50,12), FX(51,12), FX(44,12), FX(45,12), FX(46,12), FX(47,12), FX(57,12),
+	FX(58,12), FX(61,12), FX(256,12), FX(16,10), FX(16,10), FX(16,10), FX(16,10),
+	FX(17,10), FX(17,10), FX(17,10), FX(17,10), FX(48,12), FX(49,12), FX(62,12),
+	FX(63,12), FX(30,12), FX(31,12), FX(32,12), FX(33,12), FX(40,12), FX(41,12),
+	FX(22,11), FX(22,11), FX(15,9), FX(15,9), FX(15,9), FX(15,9), FX(15,9), FX(15,9),
+	FX(15,9), FX(15,9), FX(128,12), FX(192,12), FX(26,12), FX(27,12), FX(28,12),
+	FX(29,12), FX(19,11), FX(19,11), FX(20,11), FX(20,11), FX(34,12), FX(35,12),
+	FX(36,12), FX(37,12), FX(38,12), FX(39,12), FX(21,11), FX(21,11), FX(42,12),
+	FX(43,12), FX(0,10), FX(0,10), FX(0,10), FX(0,10)
 };
 
-static void create_fax34_huffman_tree2d(deark *c, struct fax34_huffman_tree *f34ht)
-{
-	size_t i;
+static const u16 fax34_2d_tbl[128] = {
+	FX(0,7), FX(3,7), FX(97,7), FX(103,7), FX(98,6), FX(98,6), FX(102,6), FX(102,6),
+	FX(1,4), FX(1,4), FX(1,4), FX(1,4), FX(1,4), FX(1,4), FX(1,4), FX(1,4), FX(2,3),
+	FX(2,3), FX(2,3), FX(2,3), FX(2,3), FX(2,3), FX(2,3), FX(2,3), FX(2,3), FX(2,3),
+	FX(2,3), FX(2,3), FX(2,3), FX(2,3), FX(2,3), FX(2,3), FX(99,3), FX(99,3), FX(99,3),
+	FX(99,3), FX(99,3), FX(99,3), FX(99,3), FX(99,3), FX(99,3), FX(99,3), FX(99,3),
+	FX(99,3), FX(99,3), FX(99,3), FX(99,3), FX(99,3), FX(101,3), FX(101,3), FX(101,3),
+	FX(101,3), FX(101,3), FX(101,3), FX(101,3), FX(101,3), FX(101,3), FX(101,3),
+	FX(101,3), FX(101,3), FX(101,3), FX(101,3), FX(101,3), FX(101,3), FX(100,1),
+	FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1),
+	FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1),
+	FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1),
+	FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1),
+	FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1),
+	FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1),
+	FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1),
+	FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1),
+	FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1), FX(100,1)
+};
 
-	f34ht->_2d_codes = fmtutil_huffman_create_decoder(c, 11, 11);
 
-	// Note that this tree could be constructed using
-	//  fmtutil_huffman_make_canonical_tree(..., FMTUTIL_MCTFLAG_LEFT_ALIGN_BRANCHES),
-	// so we don't actually need the fax34_2dcodes table. But it's not worth it, to
-	// get rid of an 11-byte table.
+#undef FX
+#undef FXSUB
 
-	for(i=0; i<DE_ARRAYCOUNT(fax34_2dcodes); i++) {
-		fmtutil_huffman_add_code(c, f34ht->_2d_codes->bk, (u64)fax34_2dcodes[i],
-			(UI)fax34_2dcodelengths[i], (fmtutil_huffman_valtype)fax34_2dvals[i]);
-	}
+static u8 fax34_reverse_bits(u8 b)
+{
+	b = (u8)((b>>4) | (b<<4));
+	b = (u8)(((b&0xcc)>>2) | ((b&0x33)<<2));
+	b = (u8)(((b&0xaa)>>1) | ((b&0x55)<<1));
+	return b;
 }
 
-// To make a well-formed Huffman tree, we need to account for all the codes
-// beginning with 8 zeroes. Generally, this will be the start of an EOL or sync
-// code, the remainder of which will be handled with special logic.
-#define FAX1D_8ZEROES (-1)
+static void fax34_init_bitreader(struct fax_ctx *fc)
+{
+	fc->inf_curpos = fc->dcmpri->pos;
+	fc->inf_endpos = fc->dcmpri->pos + fc->dcmpri->len;
+	fc->bit_buf = 0;
+	fc->nbits_in_bitbuf = 0;
+	fc->eof_flag = 0;
+	fc->inbuf_nbytes = 0;
+	fc->inbuf_idx = 0;
+}
 
-// Same for both white & black codes. 0 <= i <= 104
-static fmtutil_huffman_valtype getfax34val(size_t i)
+// Make bit_buf contain at least 25 bits, unless we're near the end of the
+// input.
+static void fax34_fill_bitbuf(struct fax_ctx *fc)
 {
-	if(i<=64) {
-		return (fmtutil_huffman_valtype)i;
-	}
-	else if(i<=103) {
-		return (fmtutil_huffman_valtype)((i-63)*64);
+	while(fc->nbits_in_bitbuf <= 24) {
+		if(fc->inbuf_idx >= fc->inbuf_nbytes) {
+			i64 n;
+			UI i;
+
+			n = de_min_int(fc->inf_endpos - fc->inf_curpos, (i64)sizeof(fc->inbuf));
+			if(n<1) return;
+			dbuf_read(fc->dcmpri->f, fc->inbuf, fc->inf_curpos, n);
+			fc->inf_curpos += n;
+			fc->inbuf_nbytes = (UI)n;
+			fc->inbuf_idx = 0;
+			if(fc->fax34params->is_lsb) {
+				for(i=0; i<fc->inbuf_nbytes; i++) {
+					fc->inbuf[i] = fax34_reverse_bits(fc->inbuf[i]);
+				}
+			}
+		}
+		fc->bit_buf |= (u32)fc->inbuf[fc->inbuf_idx++] << (24-fc->nbits_in_bitbuf);
+		fc->nbits_in_bitbuf += 8;
 	}
-	return FAX1D_8ZEROES; // i==104, presumably
 }
 
-// Some codes in the next two tables are up to 13 bits in size, but bits before the
-// last 8 are always 0, so we can use an 8-bit integer type.
-static const u8 fax34whitecodes[105] = {
-	0x35,0x7,0x7,0x8,0xb,0xc,0xe,0xf,0x13,0x14,0x7,0x8,0x8,0x3,0x34,0x35,0x2a,0x2b,0x27,
-	0xc,0x8,0x17,0x3,0x4,0x28,0x2b,0x13,0x24,0x18,0x2,0x3,0x1a,0x1b,0x12,0x13,0x14,0x15,
-	0x16,0x17,0x28,0x29,0x2a,0x2b,0x2c,0x2d,0x4,0x5,0xa,0xb,0x52,0x53,0x54,0x55,0x24,0x25,
-	0x58,0x59,0x5a,0x5b,0x4a,0x4b,0x32,0x33,0x34,0x1b,0x12,0x17,0x37,0x36,0x37,0x64,0x65,
-	0x68,0x67,0xcc,0xcd,0xd2,0xd3,0xd4,0xd5,0xd6,0xd7,0xd8,0xd9,0xda,0xdb,0x98,0x99,0x9a,
-	0x18,0x9b,0x8,0xc,0xd,0x12,0x13,0x14,0x15,0x16,0x17,0x1c,0x1d,0x1e,0x1f,0
-};
-static const u8 fax34blackcodes[105] = {
-	0x37,0x2,0x3,0x2,0x3,0x3,0x2,0x3,0x5,0x4,0x4,0x5,0x7,0x4,0x7,0x18,0x17,0x18,0x8,0x67,
-	0x68,0x6c,0x37,0x28,0x17,0x18,0xca,0xcb,0xcc,0xcd,0x68,0x69,0x6a,0x6b,0xd2,0xd3,0xd4,
-	0xd5,0xd6,0xd7,0x6c,0x6d,0xda,0xdb,0x54,0x55,0x56,0x57,0x64,0x65,0x52,0x53,0x24,0x37,
-	0x38,0x27,0x28,0x58,0x59,0x2b,0x2c,0x5a,0x66,0x67,0xf,0xc8,0xc9,0x5b,0x33,0x34,0x35,
-	0x6c,0x6d,0x4a,0x4b,0x4c,0x4d,0x72,0x73,0x74,0x75,0x76,0x77,0x52,0x53,0x54,0x55,0x5a,
-	0x5b,0x64,0x65,0x8,0xc,0xd,0x12,0x13,0x14,0x15,0x16,0x17,0x1c,0x1d,0x1e,0x1f,0
-};
-
-// High 4 bits is the length of the white code.
-// Low 4 bits is the length of the black code.
-static const u8 fax34codelengths[105] = {
-	0x8a,0x63,0x42,0x42,0x43,0x44,0x44,0x45,0x56,0x56,0x57,0x57,0x67,0x68,0x68,0x69,
-	0x6a,0x6a,0x7a,0x7b,0x7b,0x7b,0x7b,0x7b,0x7b,0x7b,0x7c,0x7c,0x7c,0x8c,0x8c,0x8c,
-	0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,
-	0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,0x8c,
-	0x5a,0x5c,0x6c,0x7c,0x8c,0x8c,0x8c,0x8d,0x8d,0x8d,0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,
-	0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,0x9d,0x6d,0x9d,0xbb,0xbb,0xbb,0xcc,0xcc,
-	0xcc,0xcc,0xcc,0xcc,0xcc,0xcc,0xcc,0xcc,0x88
-};
+static void fax34_skip_bits(struct fax_ctx *fc, UI nbits)
+{
+	fc->bit_buf <<= nbits;
+	fc->nbits_in_bitbuf -= nbits;
+}
 
-static UI getfax34codelength(UI isblack, size_t i)
+// nbits must be from 1 to 24.
+static UI fax34_getbits(struct fax_ctx *fc, UI nbits)
 {
-	if(i<105) {
-		if(isblack)
-			return (UI)(fax34codelengths[i] & 0x0f);
-		return (UI)(fax34codelengths[i] >> 4);
+	UI n;
+
+	if(fc->eof_flag) return 0;
+	if(fc->nbits_in_bitbuf < nbits) {
+		fax34_fill_bitbuf(fc);
+		if(fc->nbits_in_bitbuf < nbits) {
+			fc->eof_flag = 1;
+			return 0;
+		}
 	}
-	return 0;
+	n = (UI)(fc->bit_buf >> (32-nbits));
+	fax34_skip_bits(fc, nbits);
+	return n;
 }
 
-static struct fax34_huffman_tree *create_fax34_huffman_tree(deark *c, int need_2d)
+// Discard the rest of the current byte
+static void fax34_skip_to_byte_boundary(struct fax_ctx *fc)
 {
-	struct fax34_huffman_tree *f34ht;
-	size_t i;
-	static const size_t num_white_codes = DE_ARRAYCOUNT(fax34whitecodes);
-	static const size_t num_black_codes = DE_ARRAYCOUNT(fax34blackcodes);
+	fax34_skip_bits(fc, fc->nbits_in_bitbuf % 8);
+}
+
+// Read and decode a code, using one of the fax34_*_tbl tables.
+// Returns 0 if there are not enough bits left (all the code sets are complete,
+// so that's the only thing that can go wrong).
+static int fax34_read_code(struct fax_ctx *fc, const u16 *tbl, UI tbl_nbits,
+	int *pval)
+{
+	UI e;
+	UI code_len;
+
+	if(fc->eof_flag) return 0;
+	fax34_fill_bitbuf(fc);
+
+	e = (UI)tbl[fc->bit_buf >> (32-tbl_nbits)];
+	if((e & 0x0f)==0) {
+		UI sub_nbits = (e>>4) & 0x07;
 
-	f34ht = de_malloc(c, sizeof(struct fax34_huffman_tree));
-	f34ht->htwb[0] = fmtutil_huffman_create_decoder(c, (i64)num_white_codes+10, 0);
-	f34ht->htwb[1] = fmtutil_huffman_create_decoder(c, (i64)num_black_codes+10, 0);
+		e = (UI)tbl[(e>>7) + ((fc->bit_buf >> (32-tbl_nbits-sub_nbits)) &
+			((1U<<sub_nbits)-1))];
+	}
 
-	if(need_2d) {
-		create_fax34_huffman_tree2d(c, f34ht);
+	code_len = e & 0x0f;
+	if(code_len > fc->nbits_in_bitbuf) {
+		fc->eof_flag = 1;
+		return 0;
 	}
+	fax34_skip_bits(fc, code_len);
 
-	for(i=0; i<num_white_codes; i++) {
-		fmtutil_huffman_add_code(c, f34ht->htwb[0]->bk, (u64)fax34whitecodes[i],
-			getfax34codelength(0, i), getfax34val(i));
+	if((e>>4)==FX_8Z) {
+		*pval = FAX1D_8ZEROES;
 	}
-	for(i=0; i<num_black_codes; i++) {
-		fmtutil_huffman_add_code(c, f34ht->htwb[1]->bk, (u64)fax34blackcodes[i],
-			getfax34codelength(1, i), getfax34val(i));
+	else {
+		*pval = (int)(e>>4);
 	}
+	return 1;
+}
+
+// Sets pixels x0 through x1-1 of fc->curr_row to black.
+static void fax34_fill_black(struct fax_ctx *fc, i64 x0, i64 x1)
+{
+	i64 byte0, byte1;
+	u8 mask0, mask1;
 
-	return f34ht;
+	if(x1<=x0) return;
+	byte0 = x0/8;
+	byte1 = (x1-1)/8;
+	mask0 = (u8)(0xff >> (UI)(x0%8));
+	mask1 = (u8)(0xff << (UI)(7-(x1-1)%8));
+
+	if(byte0==byte1) {
+		fc->curr_row[byte0] |= mask0 & mask1;
+		return;
+	}
+	fc->curr_row[byte0] |= mask0;
+	if(byte1 > byte0+1) {
+		de_memset(&fc->curr_row[byte0+1], 0xff, (size_t)(byte1-byte0-1));
+	}
+	fc->curr_row[byte1] |= mask1;
 }
 
-static void destroy_fax34_huffman_tree(deark *c, struct fax34_huffman_tree *f34ht)
+// Record the changing elements of fc->curr_row in fc->prev_ch.
+static void fax34_find_changing_elements(struct fax_ctx *fc)
 {
-	if(!f34ht) return;
-	fmtutil_huffman_destroy_decoder(c, f34ht->htwb[0]);
-	fmtutil_huffman_destroy_decoder(c, f34ht->htwb[1]);
-	if(f34ht->_2d_codes) fmtutil_huffman_destroy_decoder(c, f34ht->_2d_codes);
-	de_free(c, f34ht);
+	i64 k;
+	i64 nbytes = (fc->image_width+7)/8;
+	u8 color = 0; // Color of the last pixel processed
+	i64 n = 0;
+
+	for(k=0; k<nbytes; k++) {
+		u8 b = fc->curr_row[k];
+		u8 d;
+		UI j;
+
+		if(b == (color ? 0xff : 0x00)) continue;
+
+		// Bits that differ from the bit to their left
+		d = b ^ (u8)((b>>1) | (color<<7));
+		for(j=0; j<8; j++) {
+			if(d & (0x80>>j)) {
+				if(k*8+(i64)j >= fc->image_width) break;
+				fc->prev_ch[n++] = k*8+(i64)j;
+			}
+		}
+		color = b & 0x01;
+	}
+	fc->num_prev_ch = n;
 }
 
 static void fax34_on_eol(deark *c, struct fax_ctx *fc, int is_real)
 {
-	i64 i;
-
 	de_dbg3(c, "%sEOL", is_real?"":"implicit ");
 
 	if(fc->ypos >= fc->image_height) goto done;
 
-	// [Pack curr_row into bits (tmp_row_packed)]
-	de_zeromem(fc->tmp_row_packed, (size_t)fc->rowspan_final);
-	for(i=0; i<fc->image_width; i++) {
-		if(fc->curr_row[i]) {
-			fc->tmp_row_packed[i/8] |= 1U<<(7-i%8);
-		}
-	}
-
-	// [Write tmp_row_packed to fc->dcmpro]
-	dbuf_write(fc->dcmpro->f, fc->tmp_row_packed, fc->rowspan_final);
+	dbuf_write(fc->dcmpro->f, fc->curr_row, fc->rowspan_final);
 	fc->nbytes_written += fc->rowspan_final;
 
 	if(fc->is_2d) {
-		de_memcpy(fc->prev_row, fc->curr_row, (size_t)fc->image_width);
+		fax34_find_changing_elements(fc);
 	}
 
-	// initialize curr_row
-	de_zeromem(fc->curr_row, (size_t)fc->image_width);
+	de_zeromem(fc->curr_row, (size_t)fc->rowspan_final);
 
 	fc->ypos++;
 done:
@@ -231,6 +380,7 @@ done:
 	fc->pending_run_len = 0;
 	fc->f2d_h_codes_remaining = 0;
 	fc->have_read_tag_bit = 0;
+	fc->prev_ch_idx = 0;
 }
 
 // Record run_len pixels as fc0->a0_color, updating fc->a0.
@@ -239,10 +389,9 @@ done:
 static void fax34_record_run(deark *c, struct fax_ctx *fc, i64 run_len,
 	int respect_negative_a0)
 {
-	i64 i;
-	u8 color = fc->a0_color;
-
-	de_dbg3(c, "run c=%u len=%d", (UI)color, (int)run_len);
+	if(de_dbg_enabled(c, 3)) {
+		de_dbg3(c, "run c=%u len=%d", (UI)fc->a0_color, (int)run_len);
+	}
 
 	if(fc->a0<0) {
 		if(respect_negative_a0) {
@@ -251,12 +400,16 @@ static void fax34_record_run(deark *c, struct fax_ctx *fc, i64 run_len,
 		fc->a0 = 0;
 	}
 
-	if(color==0) { // Pixels are initialized to 0, don't need to set them.
+	if(fc->a0_color==0) { // Pixels are initialized to 0, don't need to set them.
 		fc->a0 += run_len;
 	}
 	else {
-		for(i=0; (i<run_len) && (fc->a0 < fc->image_width); i++) {
-			fc->curr_row[fc->a0++] = color;
+		i64 a1;
+
+		a1 = de_min_int(fc->a0 + run_len, fc->image_width);
+		if(a1 > fc->a0) {
+			fax34_fill_black(fc, fc->a0, a1);
+			fc->a0 = a1;
 		}
 	}
 
@@ -265,15 +418,6 @@ static void fax34_record_run(deark *c, struct fax_ctx *fc, i64 run_len,
 	}
 }
 
-static void init_fax34_bitreader(deark *c, struct fax_ctx *fc)
-{
-	de_zeromem(&fc->bitrd, sizeof(struct de_bitreader));
-	fc->bitrd.f = fc->dcmpri->f;
-	fc->bitrd.curpos = fc->dcmpri->pos;
-	fc->bitrd.endpos = fc->dcmpri->pos + fc->dcmpri->len;
-	fc->bitrd.bbll.is_lsb = fc->fax34params->is_lsb;
-}
-
 // Read up to and including the next '1' bit
 static int fax34_finish_sync(deark *c, struct fax_ctx *fc, i64 max_bits_to_search,
 	i64 *pnbits_read)
@@ -282,14 +426,14 @@ static int fax34_finish_sync(deark *c, struct fax_ctx *fc, i64 max_bits_to_searc
 	int retval = 0;
 
 	while(1) {
-		u64 n;
+		UI n;
 
 		if(nbits_searched >= max_bits_to_search) {
 			goto done;
 		}
 
-		n = de_bitreader_getbits(&fc->bitrd, 1);
-		if(fc->bitrd.eof_flag) goto done;
+		n = fax34_getbits(fc, 1);
+		if(fc->eof_flag) goto done;
 		nbits_searched++;
 		if(n!=0) {
 			retval = 1;
@@ -309,13 +453,13 @@ static int fax34_full_sync(deark *c, struct fax_ctx *fc, i64 max_bits_to_search)
 	int retval = 0;
 
 	while(1) {
-		u64 n;
+		UI n;
 
 		if(nbits_searched >= max_bits_to_search) {
 			goto done;
 		}
-		n = de_bitreader_getbits(&fc->bitrd, 1);
-		if(fc->bitrd.eof_flag) goto done;
+		n = fax34_getbits(fc, 1);
+		if(fc->eof_flag) goto done;
 		nbits_searched++;
 
 		if(n!=0) {
@@ -334,61 +478,45 @@ done:
 	return retval;
 }
 
-// Sets fc->b1 appropriately, according to fc->a0 and fc->prev_row and
-// fc->image_width.
-static void find_b1(struct fax_ctx *fc)
+// Sets fc->b1 appropriately, according to fc->a0 and the previous row.
+// b1 is the first changing element to the right of a0 whose color is opposite
+// to a0_color. Returns its index in fc->prev_ch (or a value >= fc->num_prev_ch).
+static i64 find_b1(struct fax_ctx *fc)
 {
-	i64 i;
+	i64 k = fc->prev_ch_idx;
 
-	for(i=fc->a0+1; i<fc->image_width; i++) {
-		if(i<0) continue;
+	// a0 usually moves to the right, so we can usually pick up where we left
+	// off. But it can move left, if the data is strange.
+	while(k>0 && fc->prev_ch[k-1] > fc->a0) k--;
+	while(k<fc->num_prev_ch && fc->prev_ch[k] <= fc->a0) k++;
+	fc->prev_ch_idx = k;
 
-		// first prev_row pixel to the right of a0, of opposite color to a0_color
-		if(fc->prev_row[i]==fc->a0_color) continue;
+	// Even-numbered elements are changes to black, odd are changes to white.
+	if((UI)(k%2) != (UI)fc->a0_color) k++;
 
-		// Looking for a "changing element". I.e. if both it and the pixel to the left
-		// exist, they must have different colors.
-		if(i==0) {
-			// Leftmost pixel is "changing" if it is black
-			if(fc->prev_row[i]==0) continue;
-		}
-		else {
-			if(fc->prev_row[i-1] == fc->prev_row[i]) continue;
-		}
-
-		fc->b1 = i;
-		return;
-	}
-	fc->b1 = fc->image_width;
+	fc->b1 = (k < fc->num_prev_ch) ? fc->prev_ch[k] : fc->image_width;
+	return k;
 }
 
 static void find_b1_and_b2(struct fax_ctx *fc)
 {
-	i64 i;
+	i64 k;
 
-	find_b1(fc);
-
-	for(i=fc->b1+1; i<fc->image_width; i++) {
-		// Looking for a "changing element", i.e. one having a different color from
-		// the pixel to its left.
-		if(fc->prev_row[i-1] == fc->prev_row[i]) continue;
-		fc->b2 = i;
-		return;
-	}
-	fc->b2 = fc->image_width;
+	k = find_b1(fc);
+	// b2 is the next changing element after b1.
+	fc->b2 = (k+1 < fc->num_prev_ch) ? fc->prev_ch[k+1] : fc->image_width;
 }
 
-static void do_decompress_fax34(deark *c, struct fax_ctx *fc,
-	struct fax34_huffman_tree *f34ht)
+static void do_decompress_fax34(deark *c, struct fax_ctx *fc)
 {
 	char errmsg[100];
 	static const char errmsg_UNEXPECTEDEOD[] = "Unexpected end of compressed data";
-	static const char errmsg_HUFFDECODEERR[] = "Huffman decode error";
 	static const char errmsg_NOEOL[] = "Failed to find EOL mark";
+	static const char errmsg_HUFFDECODEERR[] = "Huffman decode error";
 	static const char errmsg_UNSUPPEXT[] = "Decoding error or unsupported Fax extension";
 
 	errmsg[0] = '\0';
-	init_fax34_bitreader(c, fc);
+	fax34_init_bitreader(fc);
 
 	if(fc->has_eol_codes) {
 		if(!fax34_full_sync(c, fc, 1024)) {
@@ -396,7 +524,7 @@ static void do_decompress_fax34(deark *c, struct fax_ctx *fc,
 				de_dbg(c, "[no sync mark found, trying to compensate]");
 				fc->has_eol_codes = 0;
 				fc->rows_padded_to_next_byte = 0;
-				init_fax34_bitreader(c, fc);
+				fax34_init_bitreader(fc);
 			}
 			else {
 				de_strlcpy(errmsg, "Failed to find sync mark", sizeof(errmsg));
@@ -413,9 +541,8 @@ static void do_decompress_fax34(deark *c, struct fax_ctx *fc,
 	fc->have_read_tag_bit = 0;
 
 	while(1) {
-		int ret;
 		int in_2d_mode;
-		fmtutil_huffman_valtype val = 0;
+		int val = 0;
 
 		if(fc->ypos >= fc->image_height ||
 			((fc->ypos == fc->image_height-1) && (fc->a0 >= fc->image_width)))
@@ -426,20 +553,20 @@ static void do_decompress_fax34(deark *c, struct fax_ctx *fc,
 			goto done; // Sufficient output
 		}
 
-		if(fc->bitrd.eof_flag) {
+		if(fc->eof_flag) {
 			de_strlcpy(errmsg, errmsg_UNEXPECTEDEOD, sizeof(errmsg));
 			goto done;
 		}
 
 		if(!fc->has_eol_codes && (fc->a0 >= fc->image_width) && fc->f2d_h_codes_remaining==0) {
 			if(fc->rows_padded_to_next_byte) {
-				de_bitbuf_lowlevel_empty(&fc->bitrd.bbll);
+				fax34_skip_to_byte_boundary(fc);
 			}
 			fax34_on_eol(c, fc, 0);
 		}
 
 		if(fc->is_2d && fc->fax34params->tiff_cmpr_meth==3 && !fc->have_read_tag_bit) {
-			fc->tag_bit = (u8)de_bitreader_getbits(&fc->bitrd, 1);
+			fc->tag_bit = (u8)fax34_getbits(fc, 1);
 			fc->have_read_tag_bit = 1;
 		}
 
@@ -458,23 +585,21 @@ static void do_decompress_fax34(deark *c, struct fax_ctx *fc,
 		}
 
 		if(in_2d_mode) {
-			ret = fmtutil_huffman_read_next_value(f34ht->_2d_codes->bk, &fc->bitrd, &val, NULL);
-			if(!ret) {
-				if(fc->bitrd.eof_flag) {
-					de_strlcpy(errmsg, errmsg_UNEXPECTEDEOD, sizeof(errmsg));
-				}
-				else {
-					de_strlcpy(errmsg, errmsg_HUFFDECODEERR, sizeof(errmsg));
-				}
+			if(!fax34_read_code(fc, fax34_2d_tbl, 7, &val)) {
+				de_strlcpy(errmsg, errmsg_UNEXPECTEDEOD, sizeof(errmsg));
 				goto done;
 			}
-			de_dbg3(c, "val: %d", (int)val);
+			if(de_dbg_enabled(c, 3)) {
+				de_dbg3(c, "val: %d", val);
+			}
 
 			if(val>=FAX2D_V_BIAS-3 && val<=FAX2D_V_BIAS+3) { // VL(3), ..., V(0), ..., VR(3)
 				i64 run_len;
 
 				find_b1(fc);
-				de_dbg3(c, "at %d b1=%d", (int)fc->a0, (int)fc->b1);
+				if(de_dbg_enabled(c, 3)) {
+					de_dbg3(c, "at %d b1=%d", (int)fc->a0, (int)fc->b1);
+				}
 				run_len = fc->b1 - fc->a0 + ((i64)val-FAX2D_V_BIAS);
 
 				fax34_record_run(c, fc, run_len, 1);
@@ -504,7 +629,11 @@ static void do_decompress_fax34(deark *c, struct fax_ctx *fc,
 			else if(val==FAX2D_EXTENSION) {
 				UI extnum;
 
-				extnum = (UI)de_bitreader_getbits(&fc->bitrd, 3);
+				extnum = fax34_getbits(fc, 3);
+				if(fc->fax34params->is_lsb) {
+					// Report the bits in the order a generic LSB-first bitreader would
+					extnum = ((extnum&0x1)<<2) | (extnum&0x2) | ((extnum&0x4)>>2);
+				}
 				// TODO?: Support uncompressed mode
 				de_snprintf(errmsg, sizeof(errmsg), "%s (%u)", errmsg_UNSUPPEXT, extnum);
 				goto done;
@@ -514,14 +643,10 @@ static void do_decompress_fax34(deark *c, struct fax_ctx *fc,
 			}
 		}
 		else {
-			ret = fmtutil_huffman_read_next_value(f34ht->htwb[(UI)fc->a0_color]->bk, &fc->bitrd, &val, NULL);
-			if(!ret) {
-				if(fc->bitrd.eof_flag) {
-					de_strlcpy(errmsg, errmsg_UNEXPECTEDEOD, sizeof(errmsg));
-				}
-				else {
-					de_strlcpy(errmsg, errmsg_HUFFDECODEERR, sizeof(errmsg));
-				}
+			if(!fax34_read_code(fc, fc->a0_color ? fax34_black_tbl : fax34_white_tbl,
+				8, &val))
+			{
+				de_strlcpy(errmsg, errmsg_UNEXPECTEDEOD, sizeof(errmsg));
 				goto done;
 			}
 
@@ -581,8 +706,9 @@ void fmtutil_fax34_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 	void *codec_private_params)
 {
 	struct fax_ctx *fc = NULL;
-	struct fax34_huffman_tree *f34ht = NULL;
+	struct de_stats_timer tmr;
 
+	de_stats_timer_start(c, &tmr);
 	fc = de_malloc(c, sizeof(struct fax_ctx));
 	fc->modname = "fax_decode";
 	fc->fax34params = (struct de_fax34_params*)codec_private_params;
@@ -617,19 +743,18 @@ void fmtutil_fax34_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 		fc->rowspan_final = fc->fax34params->out_rowspan;
 	}
 
-	fc->curr_row = de_malloc(c, fc->image_width);
-	fc->prev_row = de_malloc(c, fc->image_width);
-	fc->tmp_row_packed = de_malloc(c, fc->rowspan_final);
+	fc->curr_row = de_malloc(c, fc->rowspan_final);
+	if(fc->is_2d) {
+		fc->prev_ch = de_mallocarray(c, fc->image_width, sizeof(i64));
+	}
 
-	f34ht = create_fax34_huffman_tree(c, (int)fc->is_2d);
-	do_decompress_fax34(c, fc, f34ht);
+	do_decompress_fax34(c, fc);
 
 done:
-	destroy_fax34_huffman_tree(c, f34ht);
 	if(fc) {
 		de_free(c, fc->curr_row);
-		de_free(c, fc->prev_row);
-		de_free(c, fc->tmp_row_packed);
+		de_free(c, fc->prev_ch);
 		de_free(c, fc);
 	}
+	de_stats_timer_stop(c, &tmr, DE_STATSCAT_CODEC, "fax_decode");
 }
@@ -11,6 +11,12 @@
 #define NODE_REF_TYPE u32
 #define MAX_MAX_NODES  66000
 
+// Codes up to this many bits long can be decoded with a single table lookup.
+#define HUFFMAN_FAST_BITS  10
+// Don't bother making the lookup table until the codebook has been used this
+// many times without being changed.
+#define HUFFMAN_FAST_MIN_READS 32
+
 struct huffman_nval_pointer_data {
 	NODE_REF_TYPE noderef;
 };
@@ -32,6 +38,11 @@ struct huffman_node {
 	union huffman_nval_data child[2];
 };
 
+struct huffman_fast_tbl_entry {
+	fmtutil_huffman_valtype val;
+	u8 nbits; // 0 = Not in the table (code is too long, or invalid)
+};
+
 struct huffman_lengths_arr_item {
 	fmtutil_huffman_valtype val;
 	UI len;
@@ -57,6 +68,14 @@ struct fmtutil_huffman_codebook {
 
 	i64 num_codes;
 	UI max_bits;
+
+	// Lookup table, indexed by the next fast_tbl_nbits bits of input (in
+	// the order in which they will be read).
+	u8 fast_tbl_valid;
+	u8 fast_tbl_is_lsb;
+	UI fast_tbl_nbits;
+	UI nreads_since_change;
+	struct huffman_fast_tbl_entry *fast_tbl; // array[1<<HUFFMAN_FAST_BITS]
 };
 
 // Ensure that at least n nodes are allocated (0 through n-1)
@@ -132,6 +151,8 @@ int fmtutil_huffman_add_code(deark *c, struct fmtutil_huffman_codebook *bk,
 	NODE_REF_TYPE curr_noderef = 0; // Note that this may temporarily point to an unallocated node
 	int retval = 0;
 
+	bk->fast_tbl_valid = 0;
+	bk->nreads_since_change = 0;
 	if(code_nbits>FMTUTIL_HUFFMAN_MAX_CODE_LENGTH) goto done;
 
 	if(code_nbits<1) {
@@ -228,6 +249,90 @@ done:
 	return retval;
 }
 
+static void huffman_fast_tbl_set_entries(struct fmtutil_huffman_codebook *bk,
+	u32 path, UI depth, fmtutil_huffman_valtype val)
+{
+	u32 idx;
+	u32 j;
+	UI k;
+	UI nfree = bk->fast_tbl_nbits - depth;
+
+	if(bk->fast_tbl_is_lsb) {
+		// The first bit read will be the low bit of the index.
+		idx = 0;
+		for(k=0; k<depth; k++) {
+			idx |= ((path>>(depth-1-k))&0x1)<<k;
+		}
+		for(j=0; j<((u32)1<<nfree); j++) {
+			bk->fast_tbl[idx | (j<<depth)].val = val;
+			bk->fast_tbl[idx | (j<<depth)].nbits = (u8)depth;
+		}
+	}
+	else {
+		// The first bit read will be the high bit of the index.
+		idx = path<<nfree;
+		for(j=0; j<((u32)1<<nfree); j++) {
+			bk->fast_tbl[idx + j].val = val;
+			bk->fast_tbl[idx + j].nbits = (u8)depth;
+		}
+	}
+}
+
+// Add the codes in the subtree at noderef to the lookup table.
+// path = the bits (first bit read = high bit) that lead to noderef.
+static void huffman_fast_tbl_add_subtree(struct fmtutil_huffman_codebook *bk,
+	NODE_REF_TYPE noderef, u32 path, UI depth)
+{
+	UI child_idx;
+
+	// (Same validity tests as in fmtutil_huffman_decode_bit().)
+	if(noderef >= bk->nodes_alloc) return;
+	if(noderef >= bk->next_avail_node) return;
+
+	for(child_idx=0; child_idx<2; child_idx++) {
+		u8 status = bk->nodes[noderef].child_status[child_idx];
+
+		if(status==CHILDSTATUS_VALUE) {
+			huffman_fast_tbl_set_entries(bk, (path<<1)|child_idx, depth+1,
+				bk->nodes[noderef].child[child_idx].hnvd.value);
+		}
+		else if(status==CHILDSTATUS_POINTER && depth+1 < bk->fast_tbl_nbits) {
+			huffman_fast_tbl_add_subtree(bk, bk->nodes[noderef].child[child_idx].hnpd.noderef,
+				(path<<1)|child_idx, depth+1);
+		}
+	}
+}
+
+static void huffman_make_fast_tbl(deark *c, struct fmtutil_huffman_codebook *bk, u8 is_lsb)
+{
+	if(!bk->fast_tbl) {
+		bk->fast_tbl = de_mallocarray(c, (i64)1<<HUFFMAN_FAST_BITS,
+			sizeof(struct huffman_fast_tbl_entry));
+	}
+	bk->fast_tbl_nbits = de_min_int(bk->max_bits, HUFFMAN_FAST_BITS);
+	bk->fast_tbl_is_lsb = is_lsb;
+	de_zeromem(bk->fast_tbl, ((size_t)1<<bk->fast_tbl_nbits) *
+		sizeof(struct huffman_fast_tbl_entry));
+	huffman_fast_tbl_add_subtree(bk, 0, 0, 0);
+	bk->fast_tbl_valid = 1;
+}
+
+// Look at the next bk->fast_tbl_nbits bits of input, without consuming them,
+// and look up the code they start with.
+// Returns the number of bits in the code, or 0 if the table can't be used.
+static UI huffman_fast_lookup(struct fmtutil_huffman_codebook *bk,
+	struct de_bitreader *bitrd, fmtutil_huffman_valtype *pval)
+{
+	u64 v = 0;
+	struct huffman_fast_tbl_entry *e;
+
+	if(!de_bitreader_peekbits(bitrd, bk->fast_tbl_nbits, &v)) return 0;
+	e = &bk->fast_tbl[v];
+	if(e->nbits==0) return 0;
+	*pval = e->val;
+	return (UI)e->nbits;
+}
+
 // Read the next Huffman code from a bitreader, and decode it.
 // *pval will always be written to. On error, it will be set to 0.
 // pnbits returns the number of bits read. Can be NULL.
@@ -251,6 +356,25 @@ int fmtutil_huffman_read_next_value(struct fmtutil_huffman_codebook *bk,
 		goto done;
 	}
 
+	if(bk->nreads_since_change < HUFFMAN_FAST_MIN_READS) {
+		bk->nreads_since_change++;
+	}
+	else if(bk->max_bits>0) {
+		UI nbits;
+
+		if(!bk->fast_tbl_valid || bk->fast_tbl_is_lsb!=bitrd->bbll.is_lsb) {
+			huffman_make_fast_tbl(bitrd->f->c, bk, bitrd->bbll.is_lsb);
+		}
+		nbits = huffman_fast_lookup(bk, bitrd, pval);
+		if(nbits) {
+			(void)de_bitreader_getbits(bitrd, nbits);
+			bitcount = (int)nbits;
+			retval = 1;
+			goto done;
+		}
+		// Otherwise, fall back to reading one bit at a time.
+	}
+
 	while(1) {
 		int ret;
 		u8 b;
@@ -388,7 +512,7 @@ static int fmtutil_huffman_make_canonical_tree1(deark *c, struct fmtutil_huffman
 			prev_code_bit_length = symlen;
 			codes_count_total++;
 
-			if(c->debug_level>=3) {
+			if(de_dbg_enabled(c, 3)) {
 				de_dbg3(c, "code: \"%s\" = %d",
 					de_print_base2_fixed(b2buf, sizeof(b2buf), thiscode, symlen),
 					(int)builder->lengths_arr[k].val);
@@ -439,7 +563,7 @@ static int fmtutil_huffman_make_canonical_tree2(deark *c, struct fmtutil_huffman
 			prev_code_bit_length = symlen;
 			codes_count_total++;
 
-			if(c->debug_level>=3) {
+			if(de_dbg_enabled(c, 3)) {
 				de_dbg3(c, "code: \"%s\" = %d",
 					de_print_base2_fixed(b2buf, sizeof(b2buf), this_code, symlen),
 					(int)builder->lengths_arr[k].val);
@@ -557,6 +681,7 @@ static void huffman_destroy_codebook(deark *c, struct fmtutil_huffman_codebook *
 {
 	if(!bk) return;
 	de_free(c, bk->nodes);
+	de_free(c, bk->fast_tbl);
 	de_free(c, bk);
 }
 
@@ -127,7 +127,7 @@ static int de_fmtutil_default_iff_chunk_handler(struct de_iffctx *ictx)
 	}
 
 	if(!ictx->handled) {
-		if(c->debug_level>=3) {
+		if(de_dbg_enabled(c, 3)) {
 			de_dbg_hexdump(c, ictx->f, ictx->chunkctx->dpos, ictx->chunkctx->dlen,
 				256, NULL, 0x1);
 		}
@@ -102,6 +102,7 @@ void dfilter_lh1_codec(struct de_dfilter_ctx *dfctx, void *codec_private_params)
 	dfctx->codec_finish_fn = my_lh1_codec_finish;
 	dfctx->codec_command_fn = my_lh1_codec_command;
 	dfctx->codec_destroy_fn = my_lh1_codec_destroy;
+	dfctx->codec_name = cctx->modname;
 
 	if(codec_private_params) {
 		// Use params from caller, if present.
@@ -18,6 +18,7 @@ struct lzh_ctx {
 	struct de_dfilter_out_params *dcmpro;
 	struct de_dfilter_results *dres;
 	const char *modname;
+	struct de_stats_timer stats_time;
 
 	i64 nbytes_written;
 	int err_flag;
@@ -41,6 +42,10 @@ struct lzh_ctx {
 	struct lzh_tree_wrapper literals_tree; // Literals+lengths, or just literals
 	struct lzh_tree_wrapper offsets_tree;
 	struct lzh_tree_wrapper matchlengths_tree; // Used if literals and lengths are separate
+	// Deflate's fixed Huffman codes. Made when first needed, and reused for
+	// every block that uses them.
+	struct lzh_tree_wrapper deflate_fixed_literals_tree;
+	struct lzh_tree_wrapper deflate_fixed_offsets_tree;
 
 	u8 implode_8k_buffer;
 	u8 implode_3_trees;
@@ -58,7 +63,14 @@ static void destroy_lzh_ctx(struct lzh_ctx *cctx)
 
 	if(!cctx) return;
 	c = cctx->c;
+	de_stats_timer_stop(c, &cctx->stats_time, DE_STATSCAT_CODEC, cctx->modname);
 	lzh_destroy_trees(cctx);
+	if(cctx->deflate_fixed_literals_tree.ht) {
+		fmtutil_huffman_destroy_decoder(c, cctx->deflate_fixed_literals_tree.ht);
+	}
+	if(cctx->deflate_fixed_offsets_tree.ht) {
+		fmtutil_huffman_destroy_decoder(c, cctx->deflate_fixed_offsets_tree.ht);
+	}
 	if(cctx->ringbuf && !cctx->ringbuf_owned_by_caller) {
 		de_lz77buffer_destroy(c, cctx->ringbuf);
 		cctx->ringbuf = NULL;
@@ -99,7 +111,7 @@ static void lzh_make_tree_from_bytearrays(struct lzh_ctx *cctx,
 		nbits = (UI)lengths[n];
 		code = (u64)codes[n];
 
-		if(dbgtitle && c->debug_level>=3) {
+		if(dbgtitle && de_dbg_enabled(c, 3)) {
 			de_dbg3(c, "code: \"%s\" = %d",
 				de_print_base2_fixed(b2buf, sizeof(b2buf), code, nbits), (int)n);
 		}
@@ -470,7 +482,7 @@ static void lh5x_do_lzh_block(struct lzh_ctx *cctx, int blk_idx)
 		if(cctx->bitrd.eof_flag) goto done;
 
 		if(code < 256) { // literal
-			if(c->debug_level>=4) {
+			if(de_dbg_enabled(c, 4)) {
 				de_dbg(c, "lit %u", code);
 			}
 			de_lz77buffer_add_literal_byte(cctx->ringbuf, (u8)code);
@@ -526,7 +538,7 @@ static void lh5x_do_lzh_block(struct lzh_ctx *cctx, int blk_idx)
 				}
 			}
 
-			if(c->debug_level>=4) {
+			if(de_dbg_enabled(c, 4)) {
 				de_dbg(c, "match d=%u l=%u", offset+1, length);
 			}
 			de_lz77buffer_copy_from_hist(cctx->ringbuf,
@@ -573,6 +585,22 @@ static void lzh_lz77buf_writebytecb(struct de_lz77buffer *rb, u8 n)
 	cctx->nbytes_written++;
 }
 
+static void lzh_lz77buf_writebufcb(struct de_lz77buffer *rb, const u8 *buf, UI n)
+{
+	struct lzh_ctx *cctx = (struct lzh_ctx*)rb->userdata;
+	i64 nbytes_to_write = (i64)n;
+
+	if(cctx->dcmpro->len_known) {
+		if(cctx->nbytes_written + nbytes_to_write > cctx->dcmpro->expected_len) {
+			nbytes_to_write = cctx->dcmpro->expected_len - cctx->nbytes_written;
+		}
+	}
+	if(nbytes_to_write<1) return;
+	dbuf_write(cctx->dcmpro->f, buf, nbytes_to_write);
+	if(cctx->crco) de_crcobj_addbuf(cctx->crco, buf, nbytes_to_write);
+	cctx->nbytes_written += nbytes_to_write;
+}
+
 static void lzh_lz77buf_writebytecb_flagerrors(struct de_lz77buffer *rb, u8 n)
 {
 	struct lzh_ctx *cctx = (struct lzh_ctx*)rb->userdata;
@@ -627,6 +655,7 @@ static void decompress_lh5x_internal(struct lzh_ctx *cctx, struct de_lh5x_params
 	cctx->ringbuf = de_lz77buffer_create(cctx->c, rb_size);
 	cctx->ringbuf->userdata = (void*)cctx;
 	cctx->ringbuf->writebyte_cb = lzh_lz77buf_writebytecb;
+	cctx->ringbuf->writebuf_cb = lzh_lz77buf_writebufcb;
 	if(lzhp->history_fill_val!=0x00) {
 		de_lz77buffer_clear(cctx->ringbuf, lzhp->history_fill_val);
 	}
@@ -651,10 +680,12 @@ void fmtutil_decompress_lh5x(deark *c, struct de_dfilter_in_params *dcmpri,
 
 	cctx = de_malloc(c, sizeof(struct lzh_ctx));
 	cctx->modname = "unlzh";
+	de_stats_timer_start(c, &cctx->stats_time);
 	cctx->c = c;
 	cctx->dcmpri = dcmpri;
 	cctx->dcmpro = dcmpro;
 	cctx->dres = dres;
+	de_dfilter_reserve_output(c, dcmpri, dcmpro);
 
 	cctx->bitrd.f = dcmpri->f;
 	cctx->bitrd.curpos = dcmpri->pos;
@@ -729,14 +760,15 @@ done:
 	return length;
 }
 
-static UI deflate_read_and_decode_distance(deark *c, struct lzh_ctx *cctx)
+static UI deflate_read_and_decode_distance(deark *c, struct lzh_ctx *cctx,
+	struct lzh_tree_wrapper *offsets_tree)
 {
 	UI dist_code;
 	UI dist = 0;
 	UI more_bits_count;
 	UI more_bits_val;
 
-	dist_code = read_next_code_using_tree(cctx, &cctx->offsets_tree);
+	dist_code = read_next_code_using_tree(cctx, offsets_tree);
 	if(dist_code<=3) {
 		dist = dist_code;
 		more_bits_count = 0;
@@ -776,25 +808,32 @@ static int huffman_record_len_for_range(deark *c, struct fmtutil_huffman_decoder
 
 static int deflate_block_type1_make_fixed_trees(deark *c, struct lzh_ctx *cctx)
 {
+	struct lzh_tree_wrapper *lit_tree = &cctx->deflate_fixed_literals_tree;
+	struct lzh_tree_wrapper *dist_tree = &cctx->deflate_fixed_offsets_tree;
 	int retval = 0;
 
-	cctx->literals_tree.ht =  fmtutil_huffman_create_decoder(c, 288, 288);
-	huffman_record_len_for_range(c, cctx->literals_tree.ht, 0, 144, 8); // 0..143
-	huffman_record_len_for_range(c, cctx->literals_tree.ht, 144, 112, 9); // 144..255
-	huffman_record_len_for_range(c, cctx->literals_tree.ht, 256, 24, 7); // 256..279
-	huffman_record_len_for_range(c, cctx->literals_tree.ht, 280, 8, 8); // 280..287
-	if(!fmtutil_huffman_make_canonical_code(c, cctx->literals_tree.ht->bk,
-		cctx->literals_tree.ht->builder, 0, "lit/len codebook"))
+	if(lit_tree->ht && dist_tree->ht) {
+		retval = 1;
+		goto done;
+	}
+
+	lit_tree->ht =  fmtutil_huffman_create_decoder(c, 288, 288);
+	huffman_record_len_for_range(c, lit_tree->ht, 0, 144, 8); // 0..143
+	huffman_record_len_for_range(c, lit_tree->ht, 144, 112, 9); // 144..255
+	huffman_record_len_for_range(c, lit_tree->ht, 256, 24, 7); // 256..279
+	huffman_record_len_for_range(c, lit_tree->ht, 280, 8, 8); // 280..287
+	if(!fmtutil_huffman_make_canonical_code(c, lit_tree->ht->bk,
+		lit_tree->ht->builder, 0, "lit/len codebook"))
 	{
 		goto done;
 	}
 
 	// This is a trivial Huffman tree -- We could do without it and just read
 	// 5 bits directly, though we'd have to reverse the order of the bits.
-	cctx->offsets_tree.ht =  fmtutil_huffman_create_decoder(c, 32, 32);
-	huffman_record_len_for_range(c, cctx->offsets_tree.ht, 0, 32, 5);
-	if(!fmtutil_huffman_make_canonical_code(c, cctx->offsets_tree.ht->bk,
-		cctx->offsets_tree.ht->builder, 0, "offsets codebook"))
+	dist_tree->ht =  fmtutil_huffman_create_decoder(c, 32, 32);
+	huffman_record_len_for_range(c, dist_tree->ht, 0, 32, 5);
+	if(!fmtutil_huffman_make_canonical_code(c, dist_tree->ht->bk,
+		dist_tree->ht->builder, 0, "offsets codebook"))
 	{
 		goto done;
 	}
@@ -847,7 +886,7 @@ static int deflate_block_type2_read_trees(deark *c, struct lzh_ctx *cctx)
 	for(i=0; i<num_bit_length_codes; i++) {
 		n = (UI)lzh_getbits(cctx, 3);
 		cll[(UI)cll_order[i]] = n;
-		if(c->debug_level>=3) {
+		if(de_dbg_enabled(c, 3)) {
 			de_dbg3(c, "%u. length[%u] = %u", i, (UI)cll_order[i], n);
 		}
 	}
@@ -977,13 +1016,19 @@ done:
 
 static int lzh_do_deflate_block_type1_2(deark *c, struct lzh_ctx *cctx, UI blktype)
 {
+	struct lzh_tree_wrapper *lit_tree;
+	struct lzh_tree_wrapper *dist_tree;
 	int retval = 0;
 
 	if(blktype==1) {
 		if(!deflate_block_type1_make_fixed_trees(c, cctx)) goto done;
+		lit_tree = &cctx->deflate_fixed_literals_tree;
+		dist_tree = &cctx->deflate_fixed_offsets_tree;
 	}
 	else {
 		if(!deflate_block_type2_read_trees(c, cctx)) goto done;
+		lit_tree = &cctx->literals_tree;
+		dist_tree = &cctx->offsets_tree;
 	}
 
 	while(1) {
@@ -991,24 +1036,24 @@ static int lzh_do_deflate_block_type1_2(deark *c, struct lzh_ctx *cctx, UI blkty
 
 		if(cctx->bitrd.eof_flag || cctx->err_flag) break;
 
-		code = read_next_code_using_tree(cctx, &cctx->literals_tree);
+		code = read_next_code_using_tree(cctx, lit_tree);
 		if(code<=255) {
-			if(cctx->c->debug_level>=4) {
+			if(de_dbg_enabled(cctx->c, 4)) {
 				de_dbg(c, "%u lit", code);
 			}
 			de_lz77buffer_add_literal_byte(cctx->ringbuf, (u8)code);
 		}
 		else if(code>=257 && code<=285) { // beginning of a match
 			UI length = deflate_decode_length(c, cctx, code);
-			UI dist = deflate_read_and_decode_distance(c, cctx);
-			if(cctx->c->debug_level>=4) {
+			UI dist = deflate_read_and_decode_distance(c, cctx, dist_tree);
+			if(de_dbg_enabled(cctx->c, 4)) {
 				de_dbg(c, "%u match d=%u l=%u", code, dist+1, length);
 			}
 			de_lz77buffer_copy_from_hist(cctx->ringbuf,
 				(UI)(cctx->ringbuf->curpos-1-dist), length);
 		}
 		else if(code==256) { // end of block
-			if(cctx->c->debug_level>=4) {
+			if(de_dbg_enabled(cctx->c, 4)) {
 				de_dbg(c, "%u stop", code);
 			}
 			retval = 1;
@@ -1208,6 +1253,7 @@ static void fmtutil_deflate_codectype1_native(deark *c, struct de_dfilter_in_par
 
 	cctx = de_malloc(c, sizeof(struct lzh_ctx));
 	cctx->modname = "deflate-native";
+	de_stats_timer_start(c, &cctx->stats_time);
 	cctx->c = c;
 	cctx->dcmpri = dcmpri;
 	cctx->dcmpro = dcmpro;
@@ -1237,11 +1283,13 @@ static void fmtutil_deflate_codectype1_native(deark *c, struct de_dfilter_in_par
 
 	cctx->ringbuf->userdata = (void*)cctx;
 	cctx->ringbuf->writebyte_cb = lzh_lz77buf_writebytecb;
+	cctx->ringbuf->writebuf_cb = lzh_lz77buf_writebufcb;
 
 	decompress_deflate_internal(cctx);
 
 	cctx->ringbuf->userdata = NULL;
 	cctx->ringbuf->writebyte_cb = NULL;
+	cctx->ringbuf->writebuf_cb = NULL;
 
 	if(!cctx->err_flag && is_zlib) {
 		if(!lzh_read_zlib_trailer(c, cctx)) goto done;
@@ -1274,6 +1322,7 @@ void fmtutil_deflate_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 	int must_use_native = 0;
 
 	if(!deflparams) return;
+	de_dfilter_reserve_output(c, dcmpri, dcmpro);
 
 	if(deflparams->ringbuf_to_use || (deflparams->flags & DE_DEFLATEFLAG_DEFLATE64)) {
 		must_use_native = 1;
@@ -1460,6 +1509,7 @@ static void decompress_implode_internal(struct lzh_ctx *cctx)
 	cctx->ringbuf = de_lz77buffer_create(c, rb_size);
 	cctx->ringbuf->userdata = (void*)cctx;
 	cctx->ringbuf->writebyte_cb = lzh_lz77buf_writebytecb;
+	cctx->ringbuf->writebuf_cb = lzh_lz77buf_writebufcb;
 
 	if(!implode_read_trees(cctx)) {
 		cctx->err_flag = 1;
@@ -1485,7 +1535,7 @@ static void decompress_implode_internal(struct lzh_ctx *cctx)
 			else {
 				b = (u8)lzh_getbits(cctx, 8);
 			}
-			if(cctx->c->debug_level>=4) {
+			if(de_dbg_enabled(cctx->c, 4)) {
 				de_dbg(c, "lit %u", (UI)b);
 			}
 			de_lz77buffer_add_literal_byte(cctx->ringbuf, b);
@@ -1507,7 +1557,7 @@ static void decompress_implode_internal(struct lzh_ctx *cctx)
 				matchlen = cctx->implode_min_match_len + matchlen_code;
 			}
 
-			if(c->debug_level>=4) {
+			if(de_dbg_enabled(c, 4)) {
 				de_dbg(c, "match d=%u l=%u", offset+1, matchlen);
 			}
 			de_lz77buffer_copy_from_hist(cctx->ringbuf,
@@ -1530,10 +1580,12 @@ void fmtutil_decompress_zip_implode(deark *c, struct de_dfilter_in_params *dcmpr
 
 	cctx = de_malloc(c, sizeof(struct lzh_ctx));
 	cctx->modname = "implode";
+	de_stats_timer_start(c, &cctx->stats_time);
 	cctx->c = c;
 	cctx->dcmpri = dcmpri;
 	cctx->dcmpro = dcmpro;
 	cctx->dres = dres;
+	de_dfilter_reserve_output(c, dcmpri, dcmpro);
 
 	cctx->bitrd.bbll.is_lsb = 1;
 	cctx->bitrd.f = dcmpri->f;
@@ -1680,7 +1732,7 @@ static void dclimplode_internal(struct lzh_ctx *cctx)
 			else {
 				b = (u8)lzh_getbits(cctx, 8);
 			}
-			if(cctx->c->debug_level>=4) {
+			if(de_dbg_enabled(cctx->c, 4)) {
 				de_dbg(c, "lit %u", (UI)b);
 			}
 			de_lz77buffer_add_literal_byte(cctx->ringbuf, b);
@@ -1720,7 +1772,7 @@ static void dclimplode_internal(struct lzh_ctx *cctx)
 			more_bits = (UI)lzh_getbits(cctx, more_bits_count);
 			offset = (offset_code << more_bits_count) + more_bits;
 
-			if(cctx->c->debug_level>=4) {
+			if(de_dbg_enabled(cctx->c, 4)) {
 				de_dbg(c, "match d=%u l=%u", offset+1, matchlen);
 			}
 			de_lz77buffer_copy_from_hist(cctx->ringbuf,
@@ -1740,6 +1792,7 @@ void fmtutil_dclimplode_codectype1(deark *c, struct de_dfilter_in_params *dcmpri
 
 	cctx = de_malloc(c, sizeof(struct lzh_ctx));
 	cctx->modname = "dclimplode";
+	de_stats_timer_start(c, &cctx->stats_time);
 	cctx->c = c;
 	cctx->dcmpri = dcmpri;
 	cctx->dcmpro = dcmpro;
@@ -1807,7 +1860,7 @@ static void distilled_interpret_dval(struct distilled_nodetable_decoder *ntd,
 		fmtutil_huffman_valtype adj_value;
 
 		adj_value = (fmtutil_huffman_valtype)(dval - ntd->nodecount);
-		if(ntd->c->debug_level>=3) {
+		if(de_dbg_enabled(ntd->c, 3)) {
 			de_dbg3(ntd->c, "code: \"%s\" = %d",
 				de_print_base2_fixed(ntd->b2buf, sizeof(ntd->b2buf), currcode, currcode_nbits),
 				(int)adj_value);
@@ -1941,7 +1994,7 @@ static void distilled_make_offsets_tree(deark *c, struct lzh_ctx *cctx)
 		nbits = get_lzhuf_p_len(n);
 		code = (u64)distilled_offsetcodes[n];
 
-		if(c->debug_level>=3) {
+		if(de_dbg_enabled(c, 3)) {
 			de_dbg3(c, "code: \"%s\" = %d",
 				de_print_base2_fixed(b2buf, sizeof(b2buf), code, nbits), (int)n);
 		}
@@ -2013,6 +2066,7 @@ void fmtutil_distilled_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 
 	cctx = de_malloc(c, sizeof(struct lzh_ctx));
 	cctx->modname = "distilled";
+	de_stats_timer_start(c, &cctx->stats_time);
 	cctx->c = c;
 	cctx->dcmpri = dcmpri;
 	cctx->dcmpro = dcmpro;
@@ -2026,6 +2080,7 @@ void fmtutil_distilled_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 	cctx->ringbuf = de_lz77buffer_create(cctx->c, 8192);
 	cctx->ringbuf->userdata = (void*)cctx;
 	cctx->ringbuf->writebyte_cb = lzh_lz77buf_writebytecb;
+	cctx->ringbuf->writebuf_cb = lzh_lz77buf_writebufcb;
 	de_lz77buffer_clear(cctx->ringbuf, 0x20);
 
 	distilled_read_nodetable(c, cctx);
@@ -2078,7 +2133,7 @@ static void lzstac_decompress_block(struct lzh_ctx *cctx)
 			u8 b;
 
 			b = (u8)lzh_getbits(cctx, 8);
-			if(cctx->c->debug_level>=4) {
+			if(de_dbg_enabled(cctx->c, 4)) {
 				de_dbg(c, "lit %u", (UI)b);
 			}
 			de_lz77buffer_add_literal_byte(cctx->ringbuf, b);
@@ -2102,7 +2157,7 @@ static void lzstac_decompress_block(struct lzh_ctx *cctx)
 			else { // 7-bit offset, or stop code
 				offset_code = (UI)lzh_getbits(cctx, 7);
 				if(offset_code==0) {
-					if(cctx->c->debug_level>=4) {
+					if(de_dbg_enabled(cctx->c, 4)) {
 						de_dbg(c, "stop code");
 					}
 					goto done;
@@ -2138,7 +2193,7 @@ static void lzstac_decompress_block(struct lzh_ctx *cctx)
 				}
 			}
 
-			if(cctx->c->debug_level>=4) {
+			if(de_dbg_enabled(cctx->c, 4)) {
 				de_dbg(c, "match d=%u l=%u", offset+1, matchlen);
 			}
 			de_lz77buffer_copy_from_hist(cctx->ringbuf,
@@ -2178,6 +2233,7 @@ void fmtutil_lzstac_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 
 	cctx = de_malloc(c, sizeof(struct lzh_ctx));
 	cctx->modname = "LZStac";
+	de_stats_timer_start(c, &cctx->stats_time);
 	cctx->c = c;
 	cctx->dcmpri = dcmpri;
 	cctx->dcmpro = dcmpro;
@@ -2350,7 +2406,7 @@ static void mash_main(deark *c, struct lzh_ctx *cctx)
 					return;
 				}
 				ib = dbuf_getbyte_p(cctx->dcmpri->f, &cctx->bitrd.curpos);
-				if(c->debug_level>=4) {
+				if(de_dbg_enabled(c, 4)) {
 					de_dbg(c, "lit %u", (UI)ib);
 				}
 				de_lz77buffer_add_literal_byte(cctx->ringbuf, ib);
@@ -2387,7 +2443,7 @@ static void mash_main(deark *c, struct lzh_ctx *cctx)
 			offset = mash_read_offset(cctx);
 		}
 
-		if(c->debug_level>=4) {
+		if(de_dbg_enabled(c, 4)) {
 			de_dbg(c, "match d=%u l=%u", offset, matchlen);
 		}
 
@@ -2432,6 +2488,7 @@ void fmtutil_xpkMASH_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 
 	cctx = de_malloc(c, sizeof(struct lzh_ctx));
 	cctx->modname = "mash";
+	de_stats_timer_start(c, &cctx->stats_time);
 	cctx->c = c;
 	cctx->dcmpri = dcmpri;
 	cctx->dcmpro = dcmpro;
@@ -2665,7 +2722,7 @@ static void ic1_internal(struct lzh_ctx *cctx)
 	while(1) {
 		UI matchlencode;
 
-		if(c->debug_level>=4) {
+		if(de_dbg_enabled(c, 4)) {
 			de_bitreader_describe_curpos(&cctx->bitrd, descr, sizeof(descr));
 			de_dbg(c, "at %s mode=%u", descr, (UI)mode);
 		}
@@ -2679,7 +2736,7 @@ static void ic1_internal(struct lzh_ctx *cctx)
 
 		if(cctx->nbytes_written >= next_special_outpos) {
 			de_bitreader_skip_to_byte_boundary(&cctx->bitrd);
-			if(c->debug_level>=3) {
+			if(de_dbg_enabled(c, 3)) {
 				de_dbg(c, "segment data at at %"I64_FMT, cctx->bitrd.curpos);
 			}
 			(void)lzh_getbits(cctx, 32);
@@ -2708,7 +2765,7 @@ static void ic1_internal(struct lzh_ctx *cctx)
 				goto done;
 			}
 
-			if(c->debug_level>=4) {
+			if(de_dbg_enabled(c, 4)) {
 				de_dbg(c, "op=%"I64_FMT" match d=%u l=%u", cctx->nbytes_written,
 					offset+1, matchlen);
 			}
@@ -2722,7 +2779,7 @@ static void ic1_internal(struct lzh_ctx *cctx)
 			UI litlen;
 
 			litlen = ic1_read_litlen(cctx);
-			if(c->debug_level>=4) {
+			if(de_dbg_enabled(c, 4)) {
 				de_dbg(c, "op=%"I64_FMT" lit_run %u", cctx->nbytes_written,
 					litlen);
 			}
@@ -2748,6 +2805,7 @@ void fmtutil_ic1_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 
 	cctx = de_malloc(c, sizeof(struct lzh_ctx));
 	cctx->modname = "instacomp1";
+	de_stats_timer_start(c, &cctx->stats_time);
 	cctx->c = c;
 	cctx->dcmpri = dcmpri;
 	cctx->dcmpro = dcmpro;
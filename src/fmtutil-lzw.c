@@ -21,6 +21,7 @@ typedef struct delzwctx_struct delzwctx;
 struct delzw_tableentry {
 	DELZW_CODE_MINRANGE parent;
 	u8 value;
+	u8 firstvalue; // Valid only if len>0
 #define DELZW_CODETYPE_INVALID     0x00
 #define DELZW_CODETYPE_STATIC      0x01
 #define DELZW_CODETYPE_DYN_UNUSED  0x02
@@ -31,6 +32,10 @@ struct delzw_tableentry {
 #define DELZW_CODETYPE_SPECIAL     0x0f
 	u8 codetype;
 	u8 flags;
+	// The length of the code's translation, if it is known to be valid.
+	// 0 if unknown, in which case the parent links have to be followed to
+	// figure it out.
+	DELZW_CODE len;
 };
 
 struct delzw_tableentry2 {
@@ -66,6 +71,7 @@ struct delzwctx_struct {
 	u8 early_codesize_inc;
 	u8 has_partial_clearing;
 	u8 is_hashed;
+	u8 use_cached_lens;
 
 	// Informational:
 	u8 header_unixcompress_mode;
@@ -119,6 +125,11 @@ struct delzwctx_struct {
 	size_t valbuf_capacity;
 	u8 *valbuf;
 
+	// Output is collected here, and written in large pieces.
+	size_t outbuf_capacity;
+	size_t outbuf_nbytes_used;
+	u8 *outbuf;
+
 	char errmsg[80];
 };
 
@@ -183,6 +194,13 @@ static void delzw_set_error(delzwctx *dc, int errcode, const char *msg)
 	de_strlcpy(dc->errmsg, msg, sizeof(dc->errmsg));
 }
 
+static void delzw_flush(delzwctx *dc)
+{
+	if(dc->outbuf_nbytes_used==0) return;
+	dbuf_write(dc->dfctx->dcmpro->f, dc->outbuf, (i64)dc->outbuf_nbytes_used);
+	dc->outbuf_nbytes_used = 0;
+}
+
 static void delzw_write(delzwctx *dc, const u8 *buf, size_t n1)
 {
 	i64 n;
@@ -196,12 +214,17 @@ static void delzw_write(delzwctx *dc, const u8 *buf, size_t n1)
 		}
 	}
 	if(n<1) return;
-	if(n==1) {
-		dbuf_writebyte(dc->dfctx->dcmpro->f, buf[0]);
+
+	if(dc->outbuf_nbytes_used + (size_t)n > dc->outbuf_capacity) {
+		delzw_flush(dc);
 	}
-	else {
+	if((size_t)n > dc->outbuf_capacity) {
 		dbuf_write(dc->dfctx->dcmpro->f, buf, n);
 	}
+	else {
+		de_memcpy(&dc->outbuf[dc->outbuf_nbytes_used], buf, (size_t)n);
+		dc->outbuf_nbytes_used += (size_t)n;
+	}
 	dc->uncmpr_nbytes_written += n;
 }
 
@@ -274,6 +297,42 @@ static int delzw_code_is_in_table(delzwctx *dc, DELZW_CODE code)
 	return 0;
 }
 
+// Fast version of delzw_emit_code(), for codes whose length is known.
+// The values are written directly to the output buffer, last one first.
+// Returns 0 if it can't be used for this code.
+static int delzw_emit_code_cached(delzwctx *dc, DELZW_CODE code)
+{
+	DELZW_CODE len;
+	DELZW_CODE i;
+	u8 *dst;
+
+	if(code >= dc->ct_capacity) return 0;
+	len = dc->ct[code].len;
+	if(len==0) return 0;
+	if(dc->errcode) return 1;
+	if(dc->output_len_known &&
+		(dc->uncmpr_nbytes_written + (i64)len > dc->output_expected_len))
+	{
+		return 0;
+	}
+
+	if(dc->outbuf_nbytes_used + (size_t)len > dc->outbuf_capacity) {
+		delzw_flush(dc);
+	}
+	dst = &dc->outbuf[dc->outbuf_nbytes_used];
+
+	dc->last_value = dc->ct[code].firstvalue;
+	for(i=len-1; i>0; i--) {
+		dst[i] = dc->ct[code].value;
+		code = dc->ct[code].parent;
+	}
+	dst[0] = dc->last_value;
+
+	dc->outbuf_nbytes_used += (size_t)len;
+	dc->uncmpr_nbytes_written += (i64)len;
+	return 1;
+}
+
 // Decode an LZW code to one or more values, and write the values.
 // Updates dc->last_value.
 static void delzw_emit_code(delzwctx *dc, DELZW_CODE code1)
@@ -281,6 +340,8 @@ static void delzw_emit_code(delzwctx *dc, DELZW_CODE code1)
 	DELZW_CODE code = code1;
 	size_t valbuf_pos = dc->valbuf_capacity; // = First entry that's used
 
+	if(dc->use_cached_lens && delzw_emit_code_cached(dc, code1)) return;
+
 	while(1) {
 		if(code >= dc->ct_capacity) {
 			delzw_set_errorf(dc, DELZW_ERRCODE_GENERIC_ERROR, "Bad LZW code (%d)", (int)code);
@@ -526,6 +587,10 @@ static void delzw_add_to_dict(delzwctx *dc, DELZW_CODE parent, u8 value)
 	dc->ct[newpos].parent = (DELZW_CODE_MINRANGE)parent;
 	dc->ct[newpos].value = value;
 	dc->ct[newpos].codetype = DELZW_CODETYPE_DYN_USED;
+	if(dc->use_cached_lens && parent<dc->ct_capacity && dc->ct[parent].len>0) {
+		dc->ct[newpos].len = dc->ct[parent].len + 1;
+		dc->ct[newpos].firstvalue = dc->ct[parent].firstvalue;
+	}
 	dc->ct_code_count++;
 	dc->last_code_added = newpos;
 	dc->free_code_search_start = newpos+1;
@@ -603,6 +668,7 @@ static void delzw_clear_one_dynamic_code(delzwctx *dc, DELZW_CODE code)
 	dc->ct[code].codetype = DELZW_CODETYPE_DYN_UNUSED;
 	dc->ct[code].parent = 0;
 	dc->ct[code].value = 0;
+	dc->ct[code].len = 0;
 }
 
 static void delzw_clear(delzwctx *dc)
@@ -937,6 +1003,9 @@ static void delzw_on_codes_start(delzwctx *dc)
 	}
 	dc->valbuf_capacity = dc->ct_capacity;
 	dc->valbuf = de_malloc(dc->c, dc->valbuf_capacity);
+	// (Must be at least ct_capacity, the maximum length of a code's translation.)
+	dc->outbuf_capacity = dc->ct_capacity + 16384;
+	dc->outbuf = de_malloc(dc->c, dc->outbuf_capacity);
 
 	if(dc->fmt==DE_LZWFMT_UNIXCOMPRESS) {
 		set_std_static_codes(dc);
@@ -1032,6 +1101,19 @@ static void delzw_on_codes_start(delzwctx *dc)
 		}
 	}
 
+	// With partial clearing, a code's ancestors can change after it is
+	// added, so its length can't be remembered. The hashed format is rare,
+	// and isn't worth the trouble.
+	if(!dc->has_partial_clearing && !dc->is_hashed) {
+		dc->use_cached_lens = 1;
+		for(i=0; i<dc->first_dynamic_code; i++) {
+			if(dc->ct[i].codetype==DELZW_CODETYPE_STATIC) {
+				dc->ct[i].len = 1;
+				dc->ct[i].firstvalue = dc->ct[i].value;
+			}
+		}
+	}
+
 	dc->bbll.is_lsb = dc->is_lsb;
 	de_bitbuf_lowlevel_empty(&dc->bbll);
 done:
@@ -1126,6 +1208,8 @@ static void delzw_addbuf(delzwctx *dc, const u8 *buf, i64 buf_len)
 		delzw_process_byte(dc, buf[i]);
 		dc->total_nbytes_processed++;
 	}
+
+	delzw_flush(dc);
 }
 
 static void delzw_finish(delzwctx *dc)
@@ -1203,6 +1287,7 @@ static void my_lzw_codec_destroy(struct de_dfilter_ctx *dfctx)
 	de_free(c, dc->ct);
 	if(dc->ct2) de_free(c, dc->ct2);
 	de_free(c, dc->valbuf);
+	de_free(c, dc->outbuf);
 
 	de_free(c, dc);
 	dfctx->codec_private = NULL;
@@ -1224,6 +1309,7 @@ void dfilter_lzw_codec(struct de_dfilter_ctx *dfctx, void *codec_private_params)
 	dfctx->codec_destroy_fn = my_lzw_codec_destroy;
 	dfctx->codec_addbuf_fn = my_lzw_codec_addbuf;
 	dfctx->codec_command_fn = my_lzw_codec_command;
+	dfctx->codec_name = "delzw";
 
 	dc->output_len_known = dfctx->dcmpro->len_known;
 	dc->output_expected_len = dfctx->dcmpro->expected_len;
@@ -192,6 +192,7 @@ void dfilter_deflate_codec_miniz(struct de_dfilter_ctx *dfctx, void *codec_priva
 	dfctx->codec_addbuf_fn = my_deflate_codec_addbuf;
 	dfctx->codec_finish_fn = my_deflate_codec_finish;
 	dfctx->codec_destroy_fn = my_deflate_codec_destroy;
+	dfctx->codec_name = dc->modname;
 
 	deflate_codec_init(dfctx);
 }
@@ -31,10 +31,32 @@ struct packbitsctx {
 	const char *modname;
 };
 
+// Returns the number of bytes we may still write, or -1 if unlimited.
+static i64 rle_get_output_budget(struct de_dfilter_out_params *dcmpro, i64 nbytes_written)
+{
+	if(!dcmpro->len_known) return -1;
+	if(nbytes_written >= dcmpro->expected_len) return 0;
+	return dcmpro->expected_len - nbytes_written;
+}
+
+// Write a run of count bytes with value n, truncated to the output budget.
+// Returns the number of bytes written.
+static i64 rle_emit_run(struct de_dfilter_out_params *dcmpro, i64 nbytes_written,
+	u8 n, i64 count)
+{
+	i64 budget;
+
+	budget = rle_get_output_budget(dcmpro, nbytes_written);
+	if(budget>=0 && count>budget) count = budget;
+	if(count<=0) return 0;
+	dbuf_write_run(dcmpro->f, n, count);
+	return count;
+}
+
 static void my_packbits_codec_addbuf(struct de_dfilter_ctx *dfctx,
 	const u8 *buf, i64 buf_len)
 {
-	int i;
+	i64 i;
 	u8 b;
 	struct packbitsctx *rctx = (struct packbitsctx*)dfctx->codec_private;
 
@@ -69,29 +91,47 @@ static void my_packbits_codec_addbuf(struct de_dfilter_ctx *dfctx,
 			// tell us what to do when code 128 is encountered.
 			break;
 		case PACKBITS_STATE_COPYING_LITERAL: // This byte is uncompressed
-			dbuf_writebyte(dfctx->dcmpro->f, b);
-			rctx->nbytes_written++;
-			rctx->nliteral_bytes_remaining--;
+			{
+				i64 amt;
+				i64 budget;
+
+				// Copy as much of the literal run as we have, all at once.
+				amt = de_min_int(rctx->nliteral_bytes_remaining, buf_len-i);
+				budget = rle_get_output_budget(dfctx->dcmpro, rctx->nbytes_written);
+				if(budget>=0 && amt>budget) amt = budget;
+				dbuf_write(dfctx->dcmpro->f, &buf[i], amt);
+				rctx->nbytes_written += amt;
+				rctx->nliteral_bytes_remaining -= amt;
+				// (One byte was already counted.)
+				rctx->total_nbytes_processed += amt-1;
+				i += amt-1;
+			}
 			if(rctx->nliteral_bytes_remaining<=0) {
 				rctx->state = PACKBITS_STATE_NEUTRAL;
 			}
 			break;
 		case PACKBITS_STATE_READING_UNIT_TO_REPEAT:
 			if(rctx->nbytes_per_unit==1) { // Optimization for standard PackBits
-				dbuf_write_run(dfctx->dcmpro->f, b, rctx->repeat_count);
-				rctx->nbytes_written += rctx->repeat_count;
+				rctx->nbytes_written += rle_emit_run(dfctx->dcmpro, rctx->nbytes_written,
+					b, rctx->repeat_count);
 				rctx->state = PACKBITS_STATE_NEUTRAL;
 			}
 			else {
 				rctx->unitbuf[rctx->nbytes_in_unitbuf++] = b;
 				if(rctx->nbytes_in_unitbuf >= rctx->nbytes_per_unit) {
-					i64 k;
-
-					for(k=0; k<rctx->repeat_count; k++) {
-						dbuf_write(dfctx->dcmpro->f, rctx->unitbuf, (i64)rctx->nbytes_per_unit);
+					i64 budget;
+					i64 count = rctx->repeat_count;
+
+					// Truncate to the output budget, rounded up to a whole unit.
+					budget = rle_get_output_budget(dfctx->dcmpro, rctx->nbytes_written);
+					if(budget>=0) {
+						count = de_min_int(count,
+							(budget + (i64)rctx->nbytes_per_unit - 1) / (i64)rctx->nbytes_per_unit);
 					}
+					dbuf_write_unit_run(dfctx->dcmpro->f, rctx->unitbuf,
+						(i64)rctx->nbytes_per_unit, count);
 					rctx->nbytes_in_unitbuf = 0;
-					rctx->nbytes_written += rctx->repeat_count * (i64)rctx->nbytes_per_unit;
+					rctx->nbytes_written += count * (i64)rctx->nbytes_per_unit;
 					rctx->state = PACKBITS_STATE_NEUTRAL;
 				}
 			}
@@ -151,6 +191,7 @@ void dfilter_packbits_codec(struct de_dfilter_ctx *dfctx, void *codec_private_pa
 	dfctx->codec_finish_fn = my_packbits_codec_finish;
 	dfctx->codec_command_fn = my_packbits_codec_command;
 	dfctx->codec_destroy_fn = my_packbits_codec_destroy;
+	dfctx->codec_name = rctx->modname;
 
 	rctx->nbytes_per_unit = 1;
 	if(pbparams) {
@@ -223,7 +264,7 @@ struct rle90ctx {
 static void my_rle90_codec_addbuf(struct de_dfilter_ctx *dfctx,
 	const u8 *buf, i64 buf_len)
 {
-	int i;
+	i64 i;
 	u8 b;
 	struct rle90ctx *rctx = (struct rle90ctx*)dfctx->codec_private;
 
@@ -253,13 +294,8 @@ static void my_rle90_codec_addbuf(struct de_dfilter_ctx *dfctx,
 			// RLE. We already emitted one byte (because the byte to repeat
 			// comes before the repeat count), so write countcode-1 bytes.
 			count = (i64)(b-1);
-			if(dfctx->dcmpro->len_known &&
-				(rctx->nbytes_written+count > dfctx->dcmpro->expected_len))
-			{
-				count = dfctx->dcmpro->expected_len - rctx->nbytes_written;
-			}
-			dbuf_write_run(dfctx->dcmpro->f, rctx->last_output_byte, count);
-			rctx->nbytes_written += count;
+			rctx->nbytes_written += rle_emit_run(dfctx->dcmpro, rctx->nbytes_written,
+				rctx->last_output_byte, count);
 
 			rctx->countcode_pending = 0;
 		}
@@ -267,9 +303,22 @@ static void my_rle90_codec_addbuf(struct de_dfilter_ctx *dfctx,
 			rctx->countcode_pending = 1;
 		}
 		else {
-			dbuf_writebyte(dfctx->dcmpro->f, b);
-			rctx->nbytes_written++;
-			rctx->last_output_byte = b;
+			i64 amt;
+			i64 budget;
+			const u8 *p;
+
+			// Write everything up to the next 0x90 byte, all at once.
+			amt = buf_len - i;
+			budget = rle_get_output_budget(dfctx->dcmpro, rctx->nbytes_written);
+			if(budget>=0 && amt>budget) amt = budget;
+			p = de_memchr(&buf[i], 0x90, (size_t)amt);
+			if(p) amt = (i64)(p - &buf[i]);
+
+			dbuf_write(dfctx->dcmpro->f, &buf[i], amt);
+			rctx->nbytes_written += amt;
+			rctx->last_output_byte = buf[i+amt-1];
+			rctx->total_nbytes_processed += amt-1;
+			i += amt-1;
 		}
 	}
 }
@@ -305,6 +354,7 @@ void dfilter_rle90_codec(struct de_dfilter_ctx *dfctx, void *codec_private_param
 	dfctx->codec_addbuf_fn = my_rle90_codec_addbuf;
 	dfctx->codec_finish_fn = my_rle90_codec_finish;
 	dfctx->codec_destroy_fn = my_rle90_codec_destroy;
+	dfctx->codec_name = "rle90";
 }
 
 ///////////////////////////////////
@@ -488,9 +538,9 @@ void fmtutil_pcpaintrle_codectype1(deark *c, struct de_dfilter_in_params *dcmpri
 			}
 
 			x = dbuf_getbyte_p(dcmpri->f, &inf_pos);
-			dbuf_write_run(dcmpro->f, x, count);
+			// (The block's size check uses the run's full length.)
 			blk.nbytes_decompressed_this_block += count;
-			nbytes_decompressed += count;
+			nbytes_decompressed += rle_emit_run(dcmpro, nbytes_decompressed, x, count);
 		}
 		else { // A non-compressed part of the image
 			dbuf_writebyte(dcmpro->f, x);
@@ -535,8 +585,7 @@ void fmtutil_pcxrle_codectype1(deark *c, struct de_dfilter_in_params *dcmpri,
 		if(b0 >= 0xc0) {
 			count = (i64)b0 - 0xc0;
 			b1 = dbuf_getbyte_p(dcmpri->f, &inf_pos);
-			dbuf_write_run(dcmpro->f, b1, count);
-			nbytes_decompressed += count;
+			nbytes_decompressed += rle_emit_run(dcmpro, nbytes_decompressed, b1, count);
 		}
 		else {
 			dbuf_writebyte(dcmpro->f, b0);
@@ -74,6 +74,7 @@ void fmtutil_decompress_zip_reduce(deark *c, struct de_dfilter_in_params *dcmpri
 	static const char *modname = "unreduce";
 
 	if(!dcmpro->len_known) goto done;
+	de_dfilter_reserve_output(c, dcmpri, dcmpro);
 
 	de_zeromem(&uctx, sizeof(struct ozXX_udatatype));
 	uctx.c = c;
@@ -538,7 +538,7 @@ static int do_box(deark *c, struct de_boxesctx *bctx, i64 pos, i64 len,
 		bctx->identify_box_fn(c, bctx);
 	}
 
-	if(c->debug_level>0) {
+	if(de_dbg_enabled(c, 1)) {
 		if(curbox->box_name) {
 			de_snprintf(pctx->name_str, sizeof(pctx->name_str), " (%s)", curbox->box_name);
 		}
@@ -813,12 +813,16 @@ static unsigned int spectrum512_FindIndex(i64 x, unsigned int c)
 static int decode_atari_image_paletted(deark *c, struct atari_img_decode_data *adata)
 {
 	i64 i, j;
+	i64 n;
 	i64 plane;
 	i64 rowspan;
-	u8 b;
 	u32 v;
 	i64 planespan;
 	i64 ncolors;
+	i64 units_per_row;
+	u8 *rowbuf = NULL;
+	u8 pbytes[8];
+	u8 pixels[8];
 
 	planespan = 2*((adata->w+15)/16);
 	rowspan = planespan*adata->bpp;
@@ -826,50 +830,42 @@ static int decode_atari_image_paletted(deark *c, struct atari_img_decode_data *a
 		ncolors = adata->ncolors;
 	else
 		ncolors = ((i64)1)<<adata->bpp;
+	units_per_row = (adata->w+7)/8;
+	rowbuf = de_malloc(c, rowspan);
 
 	for(j=0; j<adata->h; j++) {
-		for(i=0; i<adata->w; i++) {
-			v = 0;
+		dbuf_read(adata->unc_pixels, rowbuf, j*rowspan, rowspan);
 
+		// Process 8 pixels at a time
+		for(n=0; n<units_per_row; n++) {
 			for(plane=0; plane<adata->bpp; plane++) {
 				if(adata->was_compressed==0) {
-					// TODO: Simplify this.
-					if(adata->bpp==1) {
-						b = de_get_bits_symbol(adata->unc_pixels, 1, j*rowspan, i);
-					}
-					else if(adata->bpp==2) {
-						b = de_get_bits_symbol(adata->unc_pixels, 1,
-							j*rowspan + 2*plane + (i/16)*2, i);
-					}
-					else if(adata->bpp==4) {
-						b = de_get_bits_symbol(adata->unc_pixels, 1,
-							j*rowspan + 2*plane + (i/2-(i/2)%16)+8*((i%32)/16), i%16);
-					}
-					else if(adata->bpp==8) {
-						b = de_get_bits_symbol(adata->unc_pixels, 1,
-							j*rowspan + 2*plane + (i-i%16), i%16);
-					}
-					else {
-						b = 0;
-					}
+					// Each group of 16 pixels is stored as one 16-bit word per
+					// plane.
+					pbytes[plane] = rowbuf[(n/2)*2*adata->bpp + 2*plane + n%2];
 				}
 				else {
-					b = de_get_bits_symbol(adata->unc_pixels, 1, j*rowspan + plane*planespan, i);
+					pbytes[plane] = rowbuf[plane*planespan + n];
 				}
-				if(b) v |= 1<<plane;
 			}
-
-			if(adata->is_spectrum512) {
-				v = spectrum512_FindIndex(i, v);
-				if(j>0) {
-					v += (unsigned int)(48*(j));
+			de_planar_to_chunky8(pbytes, (UI)adata->bpp, 0, pixels);
+
+			for(i=n*8; i<n*8+8 && i<adata->w; i++) {
+				v = (u32)pixels[i%8];
+				if(adata->is_spectrum512) {
+					v = spectrum512_FindIndex(i, v);
+					if(j>0) {
+						v += (unsigned int)(48*(j));
+					}
 				}
-			}
-			if(v>=(unsigned int)ncolors) v=(unsigned int)(ncolors-1);
+				if(v>=(unsigned int)ncolors) v=(unsigned int)(ncolors-1);
 
-			de_bitmap_setpixel_rgb(adata->img, i, j, adata->pal[v]);
+				de_bitmap_setpixel_rgb(adata->img, i, j, adata->pal[v]);
+			}
 		}
 	}
+
+	de_free(c, rowbuf);
 	return 1;
 }
 
@@ -996,14 +992,41 @@ const char *fmtutil_get_windows_cb_data_type_name(unsigned int ty)
 
 #define CODE_PK36 0x504b0306U // RESOF
 #define CODE_PK56 0x504b0506U
+#define CODE_PK66 0x504b0606U
 #define CODE_PK67 0x504b0607U
 
+// The Zip64 EOCD locator is a fixed-size record that immediately precedes the
+// EOCD. If we find one, test whether it plausibly points to a Zip64 EOCD
+// record.
+static int is_sane_zip64_locator(dbuf *f, i64 eocd_pos)
+{
+	u8 buf[20];
+	i64 disk_num_with_zip64_eocd;
+	i64 zip64_eocd_pos;
+	i64 num_disks;
+
+	dbuf_read(f, buf, eocd_pos-20, 20);
+	disk_num_with_zip64_eocd = de_getu32le_direct(&buf[4]);
+	zip64_eocd_pos = de_geti64le_direct(&buf[8]);
+	num_disks = de_getu32le_direct(&buf[16]);
+
+	if(num_disks > 1000) return 0;
+	if(disk_num_with_zip64_eocd > num_disks) return 0;
+	if(num_disks > 1) {
+		// The Zip64 EOCD may be in a different segment.
+		return 1;
+	}
+	// Zip64 EOCD is at least 56 bytes, followed by the 20-byte locator.
+	if(zip64_eocd_pos<0 || zip64_eocd_pos+56 > eocd_pos-20) return 0;
+	return ((u32)dbuf_getu32be(f, zip64_eocd_pos) == CODE_PK66);
+}
+
 // We're don't really want to validate the EOCD, we just want to figure out
 // if this probably *is* an EOCD, and not a false positive.
 // Unfortunately, this has turned out to be messy to do.
-// TODO: Maybe this should accept a byte array, instead of a dbuf
-// (at this time, we really need both).
-static int is_sane_zip_eocd(dbuf *f, i64 pos)
+// 'm' points to the 22-byte fixed part of the EOCD record, at file position
+// 'pos'.
+static int is_sane_zip_eocd(dbuf *f, i64 pos, const u8 *m)
 {
 	i64 this_disk_num;
 	i64 disk_num_with_central_dir_start;
@@ -1011,47 +1034,93 @@ static int is_sane_zip_eocd(dbuf *f, i64 pos)
 	i64 central_dir_byte_size;
 	i64 central_dir_offset;
 
-	// Validating Zip64 would take more work.
-	if(dbuf_getu32be(f, pos-20) == CODE_PK67) return 1;
+	if(pos>=20 && dbuf_getu32be(f, pos-20) == CODE_PK67) {
+		if(is_sane_zip64_locator(f, pos)) return 1;
+		// Otherwise, just test the EOCD as if it were not Zip64.
+	}
 
-	this_disk_num = dbuf_getu16le(f, pos+4);
-	disk_num_with_central_dir_start = dbuf_getu16le(f, pos+6);
+	this_disk_num = de_getu16le_direct(&m[4]);
+	disk_num_with_central_dir_start = de_getu16le_direct(&m[6]);
 
 	if(this_disk_num > 100) return 0;
 	if(disk_num_with_central_dir_start > this_disk_num) return 0;
 	if(disk_num_with_central_dir_start < this_disk_num-1) return 0;
 
-	central_dir_num_entries = dbuf_getu16le(f, pos+10);
-	central_dir_byte_size = dbuf_getu32le(f, pos+12);
+	central_dir_num_entries = de_getu16le_direct(&m[10]);
+	central_dir_byte_size = de_getu32le_direct(&m[12]);
 
 	if(central_dir_byte_size < 46*central_dir_num_entries) return 0;
 
 	if(this_disk_num==disk_num_with_central_dir_start) {
 		if(central_dir_byte_size > f->len) return 0;
-		central_dir_offset = dbuf_getu32le(f, pos+16);
+		central_dir_offset = de_getu32le_direct(&m[16]);
 		if(central_dir_offset > f->len) return 0;
 	}
 
 	return 1;
 }
 
+// Scan buf[0] through buf[buf_len-1] backward, for the EOCD signature.
+// Returns the index of the last match at or before buf[start_idx], or -1.
+// The bytes are examined a word at a time: A 0x06 byte has to appear at the
+// end of every match, so we can skip quickly over data that has none.
+static i64 zip_eocd_search_backward(const u8 *buf, i64 start_idx)
+{
+	i64 i = start_idx;
+
+	while(i>=0) {
+		if(i>=7) {
+			u64 w;
+			u64 x;
+
+			// Load buf[i-4]...buf[i+3]: the last bytes of the candidate
+			// signatures from buf[i-7] to buf[i].
+			w = de_getu64le_direct(&buf[i-4]);
+			// Set the high bit of each byte that is 0x06.
+			x = w ^ 0x0606060606060606ULL;
+			x = (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+			if(x==0) {
+				i -= 8;
+				continue;
+			}
+		}
+
+		if(buf[i+3]==0x06 && buf[i+2]==0x05 && buf[i+1]=='K' && buf[i]=='P') {
+			return i;
+		}
+		i--;
+	}
+	return -1;
+}
+
 // Search for the ZIP "end of central directory" object.
 // Also useful for detecting hybrid ZIP files, such as self-extracting EXE.
+// The result is cached in c->detection_data, if f is the current input file.
 // flags:
 //   0x1 - Only do minimal "fast" tests
 int fmtutil_find_zip_eocd(deark *c, dbuf *f, UI flags, i64 *foundpos)
 {
 	u32 bof_sig;
-	u32 sig;
 	int skip_sanity_check = 0;
 	u8 *buf = NULL;
 	int retval = 0;
-	i64 buf_offset;
-	i64 buf_size;
-	i64 pos;
-	i64 i;
+	i64 search_start;
+	i64 chunk_hi;
+	struct de_detection_data_struct *dd = NULL;
+	u8 m[22];
 
 	*foundpos = 0;
+
+	if(c->detection_data && f==c->infile) {
+		dd = c->detection_data;
+		if(dd->zip_eocd_looked_for && dd->zip_eocd_f==f) {
+			if(dd->zip_eocd_found) {
+				*foundpos = dd->zip_eocd_pos;
+			}
+			return (int)dd->zip_eocd_found;
+		}
+	}
+
 	if(f->len < 22) goto done;
 
 	bof_sig = (u32)dbuf_getu32be(f, 0);
@@ -1060,10 +1129,11 @@ int fmtutil_find_zip_eocd(deark *c, dbuf *f, UI flags, i64 *foundpos)
 	}
 
 	// End-of-central-dir record usually starts 22 bytes from EOF. Try that first.
-	pos = f->len - 22;
-	sig = (u32)dbuf_getu32be(f, pos);
-	if(sig==CODE_PK56 && (skip_sanity_check || is_sane_zip_eocd(f, pos))) {
-		*foundpos = pos;
+	dbuf_read(f, m, f->len-22, 22);
+	if((u32)de_getu32be_direct(m)==CODE_PK56 &&
+		(skip_sanity_check || is_sane_zip_eocd(f, f->len-22, m)))
+	{
+		*foundpos = f->len-22;
 		retval = 1;
 		goto done;
 	}
@@ -1074,26 +1144,52 @@ int fmtutil_find_zip_eocd(deark *c, dbuf *f, UI flags, i64 *foundpos)
 	// The end-of-central-directory record could theoretically appear anywhere
 	// in the file. We'll follow Info-Zip/UnZip's lead and search the last 66000
 	// bytes.
+	// We read the file in aligned blocks, working backward from the end, so
+	// that the usual case of a short comment or a little trailing junk only
+	// reads one or two blocks.
 #define MAX_ZIP_EOCD_SEARCH 66000
-	buf_size = f->len;
-	if(buf_size > MAX_ZIP_EOCD_SEARCH) buf_size = MAX_ZIP_EOCD_SEARCH;
-
-	buf = de_malloc(c, buf_size);
-	buf_offset = f->len - buf_size;
-	dbuf_read(f, buf, buf_offset, buf_size);
-
-	for(i=buf_size-22; i>=0; i--) {
-		if(buf[i]=='P' && buf[i+1]=='K' && buf[i+2]==5 && buf[i+3]==6 &&
-			(skip_sanity_check || is_sane_zip_eocd(f, buf_offset+i)))
-		{
-			*foundpos = buf_offset + i;
-			retval = 1;
-			goto done;
+#define ZIP_EOCD_SEARCH_BLKSIZE 8192
+	search_start = f->len - MAX_ZIP_EOCD_SEARCH;
+	if(search_start<0) search_start = 0;
+
+	// Each chunk contains the candidate positions chunk_lo...chunk_hi, plus the
+	// rest of a 22-byte record starting at chunk_hi.
+	buf = de_malloc(c, ZIP_EOCD_SEARCH_BLKSIZE+22);
+	chunk_hi = f->len-23; // We already tested f->len-22
+	while(chunk_hi >= search_start) {
+		i64 chunk_lo;
+		i64 idx;
+
+		chunk_lo = chunk_hi - (chunk_hi % ZIP_EOCD_SEARCH_BLKSIZE);
+		if(chunk_lo < search_start) chunk_lo = search_start;
+		dbuf_read(f, buf, chunk_lo, chunk_hi-chunk_lo+22);
+
+		idx = chunk_hi-chunk_lo;
+		while(1) {
+			idx = zip_eocd_search_backward(buf, idx);
+			if(idx<0) break;
+			if(skip_sanity_check || is_sane_zip_eocd(f, chunk_lo+idx, &buf[idx])) {
+				*foundpos = chunk_lo+idx;
+				retval = 1;
+				goto done;
+			}
+			idx--;
 		}
+
+		chunk_hi = chunk_lo-1;
 	}
 
 done:
 	de_free(c, buf);
+	if(dd) {
+		// A failed "fast" search doesn't tell us anything definite.
+		if(retval || !(flags & 0x1)) {
+			dd->zip_eocd_looked_for = 1;
+			dd->zip_eocd_f = f;
+			dd->zip_eocd_found = (u8)retval;
+			dd->zip_eocd_pos = *foundpos;
+		}
+	}
 	return retval;
 }
 
@@ -1576,6 +1672,105 @@ done:
 	return retval;
 }
 
+// Try to figure out the length of the JPEG or JPEG-LS file that starts at pos1,
+// by walking its markers until we find EOI.
+// len is the maximum number of bytes to look at.
+// On success, returns nonzero and sets *pjpeg_len and *pis_jpegls.
+int fmtutil_detect_jpeg_len(deark *c, dbuf *f, i64 pos1, i64 len,
+	i64 *pjpeg_len, u8 *pis_jpegls)
+{
+	u8 b0, b1;
+	i64 pos;
+	i64 seg_size;
+	int in_scan = 0;
+	int found_sof = 0;
+	int found_scan = 0;
+	// A window into the file, so we can skip over non-marker bytes quickly.
+	u8 wbuf[4096];
+	i64 wpos = 0;
+	i64 wlen = 0;
+
+	*pjpeg_len = 0;
+	*pis_jpegls = 0;
+	pos = pos1;
+
+	while(1) {
+		if(pos>=pos1+len)
+			break;
+
+		if(pos<wpos || pos>=wpos+wlen) {
+			wpos = pos;
+			wlen = de_min_int((i64)sizeof(wbuf), pos1+len-pos);
+			dbuf_read(f, wbuf, wpos, wlen);
+		}
+		b0 = wbuf[pos-wpos];
+
+		if(b0!=0xff) {
+			const u8 *p;
+
+			// Skip to the next 0xff byte.
+			p = de_memchr(&wbuf[pos-wpos], 0xff, (size_t)(wpos+wlen-pos));
+			pos = p ? (wpos + (i64)(p-wbuf)) : (wpos+wlen);
+			continue;
+		}
+
+		// Peek at the next byte (after this 0xff byte).
+		b1 = dbuf_getbyte(f, pos+1);
+
+		if(b1==0xff) {
+			// A "fill byte", not a marker.
+			pos++;
+			continue;
+		}
+		else if(b1==0x00 || (*pis_jpegls && b1<0x80 && in_scan)) {
+			// An escape sequence, not a marker.
+			pos+=2;
+			continue;
+		}
+		else if(b1==0xd9) { // EOI. That's what we're looking for.
+			if(!found_sof || !found_scan) return 0;
+			pos+=2;
+			*pjpeg_len = pos-pos1;
+			return 1;
+		}
+		else if(b1==0xf7) {
+			de_dbg(c, "Looks like a JPEG-LS file.");
+			found_sof = 1;
+			*pis_jpegls = 1;
+		}
+		else if(b1>=0xc0 && b1<=0xcf && b1!=0xc4 && b1!=0xc8 && b1!=0xcc) {
+			found_sof = 1;
+		}
+
+		if(b1==0xda) { // SOS - Start of scan
+			if(!found_sof) return 0;
+			found_scan = 1;
+			in_scan = 1;
+		}
+		else if(b1>=0xd0 && b1<=0xd7) {
+			// RSTn markers don't change the in_scan state.
+			;
+		}
+		else {
+			in_scan = 0;
+		}
+
+		if((b1>=0xd0 && b1<=0xda) || b1==0x01) {
+			// Markers that have no content.
+			pos+=2;
+			continue;
+		}
+
+		// Everything else should be a marker segment, with a length field.
+		seg_size = dbuf_getu16be(f, pos+2);
+		if(seg_size<2) break; // bogus size
+
+		pos += seg_size+2;
+	}
+
+	return 0;
+}
+
 static const u8 example_dqt_data0[] = {
 	0x10,0x0b,0x0c,0x0e,0x0c,0x0a,0x10,0x0e,
 	0x0d,0x0e,0x12,0x11,0x10,0x13,0x18,0x28,